@@ -137,6 +137,15 @@ void initDsp()
             }
       // fall through to not hardware optimized routines
 #endif
+      // Pick the widest vector routines the cpu supports.
+      const DspArch arch = bestDspArch();
+      dsp = newDsp(arch);
+      if(dsp)
+      {
+        if(debugMsg)
+          printf("Muse: using %s dsp routines\n", dspArchName(arch));
+        return;
+      }
       if(debugMsg)
         printf("Muse: using unoptimized non-SSE dsp routines\n");
       dsp = new Dsp();
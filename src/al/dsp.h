@@ -70,6 +70,28 @@ class Dsp {
             for (unsigned i = 0; i < n; ++i)
                   dst[i] += src[i];
             }
+      // Writes srcL * gainL to dstL and srcR * gainR to dstR in one pass.
+      // For mono-to-stereo panning pass the same source twice.
+      virtual void gainPan(float* dstL, float* dstR, float* srcL, float* srcR,
+         unsigned n, float gainL, float gainR) {
+            for (unsigned i = 0; i < n; ++i) {
+                  const float l = srcL[i];
+                  const float r = srcR[i];
+                  dstL[i] = l * gainL;
+                  dstR[i] = r * gainR;
+                  }
+            }
+      // Like peak(), but also adds the sum of the squared samples to sumSq.
+      virtual float peakRms(float* buf, unsigned n, float current, double* sumSq) {
+            float sum = 0.0f;
+            for (unsigned i = 0; i < n; ++i) {
+                  const float f = buf[i];
+                  current = f_max(current, fabsf(f));
+                  sum += f * f;
+                  }
+            *sumSq += sum;
+            return current;
+            }
       virtual void cpy(float* dst, float* src, unsigned n, bool addDenormal = false);
 /*      
       {
@@ -100,6 +122,20 @@ class Dsp {
             
       };
 
+//---------------------------------------------------------
+//   DspArch
+//    Available implementations, in order of preference.
+//---------------------------------------------------------
+
+enum DspArch { DSP_GENERIC, DSP_SSE2, DSP_AVX2, DSP_AVX512, DSP_NEON };
+
+extern const char* dspArchName(DspArch);
+// Returns a new Dsp for the given implementation, or null if it was
+//  not built in or the cpu does not support it.
+extern Dsp* newDsp(DspArch);
+// Returns the best implementation supported by the cpu.
+extern DspArch bestDspArch();
+
 extern void initDsp();
 extern void exitDsp();
 extern Dsp* dsp;
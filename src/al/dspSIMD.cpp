@@ -0,0 +1,613 @@
+//=============================================================================
+//  AL
+//  Audio Utility Library
+//
+//  dspSIMD.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//=============================================================================
+
+//---------------------------------------------------------
+//  Vectorized dsp routines, selected at run time.
+//  The whole library is built for the baseline of the
+//   architecture (SSE2 on x86_64, NEON on aarch64). The
+//   wider x86 kernels are compiled with per-function target
+//   attributes and only called after the cpu was checked.
+//  All loads and stores are unaligned, so that any buffer
+//   offset is allowed. The tails are done by the scalar code.
+//---------------------------------------------------------
+
+#include "al.h"
+#include "dsp.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define DSP_HAVE_X86_SIMD
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DSP_HAVE_NEON
+#endif
+
+namespace AL {
+
+#ifdef DSP_HAVE_X86_SIMD
+
+//---------------------------------------------------------
+//   SSE2 kernels
+//---------------------------------------------------------
+
+static inline __m128 sse2_abs(__m128 v)
+      {
+      return _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+      }
+
+static inline float sse2_hmax(__m128 v)
+      {
+      v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+      v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+      return _mm_cvtss_f32(v);
+      }
+
+static inline float sse2_hsum(__m128 v)
+      {
+      v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+      v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+      return _mm_cvtss_f32(v);
+      }
+
+static unsigned sse2_fill(float* dst, unsigned n, float val)
+      {
+      const __m128 v = _mm_set1_ps(val);
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(dst + i, v);
+      return i;
+      }
+
+static unsigned sse2_addConst(float* dst, const float* src, unsigned n, float val)
+      {
+      const __m128 v = _mm_set1_ps(val);
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(src + i), v));
+      return i;
+      }
+
+static unsigned sse2_peak(const float* buf, unsigned n, float* current)
+      {
+      __m128 m = _mm_set1_ps(*current);
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            m = _mm_max_ps(m, sse2_abs(_mm_loadu_ps(buf + i)));
+      *current = sse2_hmax(m);
+      return i;
+      }
+
+static unsigned sse2_applyGain(float* buf, unsigned n, float gain)
+      {
+      const __m128 g = _mm_set1_ps(gain);
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i), g));
+      return i;
+      }
+
+static unsigned sse2_mixWithGain(float* dst, const float* src, unsigned n, float gain)
+      {
+      const __m128 g = _mm_set1_ps(gain);
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i),
+               _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+      return i;
+      }
+
+static unsigned sse2_mix(float* dst, const float* src, unsigned n)
+      {
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+      return i;
+      }
+
+static unsigned sse2_gainPan(float* dstL, float* dstR, const float* srcL, const float* srcR,
+   unsigned n, float gainL, float gainR)
+      {
+      const __m128 gl = _mm_set1_ps(gainL);
+      const __m128 gr = _mm_set1_ps(gainR);
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4) {
+            const __m128 l = _mm_loadu_ps(srcL + i);
+            const __m128 r = _mm_loadu_ps(srcR + i);
+            _mm_storeu_ps(dstL + i, _mm_mul_ps(l, gl));
+            _mm_storeu_ps(dstR + i, _mm_mul_ps(r, gr));
+            }
+      return i;
+      }
+
+static unsigned sse2_peakRms(const float* buf, unsigned n, float* current, double* sumSq)
+      {
+      __m128 m = _mm_set1_ps(*current);
+      __m128 s = _mm_setzero_ps();
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4) {
+            const __m128 v = _mm_loadu_ps(buf + i);
+            m = _mm_max_ps(m, sse2_abs(v));
+            s = _mm_add_ps(s, _mm_mul_ps(v, v));
+            }
+      *current = sse2_hmax(m);
+      *sumSq += sse2_hsum(s);
+      return i;
+      }
+
+//---------------------------------------------------------
+//   AVX2 kernels
+//---------------------------------------------------------
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_AVX2 static inline __m256 avx2_abs(__m256 v)
+      {
+      return _mm256_and_ps(v, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
+      }
+
+TARGET_AVX2 static unsigned avx2_fill(float* dst, unsigned n, float val)
+      {
+      const __m256 v = _mm256_set1_ps(val);
+      unsigned i = 0;
+      for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(dst + i, v);
+      return i;
+      }
+
+TARGET_AVX2 static unsigned avx2_addConst(float* dst, const float* src, unsigned n, float val)
+      {
+      const __m256 v = _mm256_set1_ps(val);
+      unsigned i = 0;
+      for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(src + i), v));
+      return i;
+      }
+
+TARGET_AVX2 static unsigned avx2_peak(const float* buf, unsigned n, float* current)
+      {
+      __m256 m = _mm256_set1_ps(*current);
+      unsigned i = 0;
+      for (; i + 8 <= n; i += 8)
+            m = _mm256_max_ps(m, avx2_abs(_mm256_loadu_ps(buf + i)));
+      *current = sse2_hmax(_mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1)));
+      return i;
+      }
+
+TARGET_AVX2 static unsigned avx2_applyGain(float* buf, unsigned n, float gain)
+      {
+      const __m256 g = _mm256_set1_ps(gain);
+      unsigned i = 0;
+      for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(buf + i, _mm256_mul_ps(_mm256_loadu_ps(buf + i), g));
+      return i;
+      }
+
+TARGET_AVX2 static unsigned avx2_mixWithGain(float* dst, const float* src, unsigned n, float gain)
+      {
+      const __m256 g = _mm256_set1_ps(gain);
+      unsigned i = 0;
+      for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i),
+               _mm256_mul_ps(_mm256_loadu_ps(src + i), g)));
+      return i;
+      }
+
+TARGET_AVX2 static unsigned avx2_mix(float* dst, const float* src, unsigned n)
+      {
+      unsigned i = 0;
+      for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+      return i;
+      }
+
+TARGET_AVX2 static unsigned avx2_gainPan(float* dstL, float* dstR, const float* srcL, const float* srcR,
+   unsigned n, float gainL, float gainR)
+      {
+      const __m256 gl = _mm256_set1_ps(gainL);
+      const __m256 gr = _mm256_set1_ps(gainR);
+      unsigned i = 0;
+      for (; i + 8 <= n; i += 8) {
+            const __m256 l = _mm256_loadu_ps(srcL + i);
+            const __m256 r = _mm256_loadu_ps(srcR + i);
+            _mm256_storeu_ps(dstL + i, _mm256_mul_ps(l, gl));
+            _mm256_storeu_ps(dstR + i, _mm256_mul_ps(r, gr));
+            }
+      return i;
+      }
+
+TARGET_AVX2 static unsigned avx2_peakRms(const float* buf, unsigned n, float* current, double* sumSq)
+      {
+      __m256 m = _mm256_set1_ps(*current);
+      __m256 s = _mm256_setzero_ps();
+      unsigned i = 0;
+      for (; i + 8 <= n; i += 8) {
+            const __m256 v = _mm256_loadu_ps(buf + i);
+            m = _mm256_max_ps(m, avx2_abs(v));
+            s = _mm256_add_ps(s, _mm256_mul_ps(v, v));
+            }
+      *current = sse2_hmax(_mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1)));
+      *sumSq += sse2_hsum(_mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1)));
+      return i;
+      }
+
+//---------------------------------------------------------
+//   AVX-512 kernels
+//    Only the foundation instructions are used.
+//---------------------------------------------------------
+
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+
+// Some gcc versions warn about the undefined pass-through operands
+//  inside their own AVX-512 headers.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+TARGET_AVX512 static inline __m512 avx512_abs(__m512 v)
+      {
+      return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(v), _mm512_set1_epi32(0x7fffffff)));
+      }
+
+TARGET_AVX512 static unsigned avx512_fill(float* dst, unsigned n, float val)
+      {
+      const __m512 v = _mm512_set1_ps(val);
+      unsigned i = 0;
+      for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(dst + i, v);
+      return i;
+      }
+
+TARGET_AVX512 static unsigned avx512_addConst(float* dst, const float* src, unsigned n, float val)
+      {
+      const __m512 v = _mm512_set1_ps(val);
+      unsigned i = 0;
+      for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(src + i), v));
+      return i;
+      }
+
+TARGET_AVX512 static unsigned avx512_peak(const float* buf, unsigned n, float* current)
+      {
+      __m512 m = _mm512_set1_ps(*current);
+      unsigned i = 0;
+      for (; i + 16 <= n; i += 16)
+            m = _mm512_max_ps(m, avx512_abs(_mm512_loadu_ps(buf + i)));
+      *current = _mm512_reduce_max_ps(m);
+      return i;
+      }
+
+TARGET_AVX512 static unsigned avx512_applyGain(float* buf, unsigned n, float gain)
+      {
+      const __m512 g = _mm512_set1_ps(gain);
+      unsigned i = 0;
+      for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(buf + i, _mm512_mul_ps(_mm512_loadu_ps(buf + i), g));
+      return i;
+      }
+
+TARGET_AVX512 static unsigned avx512_mixWithGain(float* dst, const float* src, unsigned n, float gain)
+      {
+      const __m512 g = _mm512_set1_ps(gain);
+      unsigned i = 0;
+      for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i),
+               _mm512_mul_ps(_mm512_loadu_ps(src + i), g)));
+      return i;
+      }
+
+TARGET_AVX512 static unsigned avx512_mix(float* dst, const float* src, unsigned n)
+      {
+      unsigned i = 0;
+      for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), _mm512_loadu_ps(src + i)));
+      return i;
+      }
+
+TARGET_AVX512 static unsigned avx512_gainPan(float* dstL, float* dstR, const float* srcL, const float* srcR,
+   unsigned n, float gainL, float gainR)
+      {
+      const __m512 gl = _mm512_set1_ps(gainL);
+      const __m512 gr = _mm512_set1_ps(gainR);
+      unsigned i = 0;
+      for (; i + 16 <= n; i += 16) {
+            const __m512 l = _mm512_loadu_ps(srcL + i);
+            const __m512 r = _mm512_loadu_ps(srcR + i);
+            _mm512_storeu_ps(dstL + i, _mm512_mul_ps(l, gl));
+            _mm512_storeu_ps(dstR + i, _mm512_mul_ps(r, gr));
+            }
+      return i;
+      }
+
+TARGET_AVX512 static unsigned avx512_peakRms(const float* buf, unsigned n, float* current, double* sumSq)
+      {
+      __m512 m = _mm512_set1_ps(*current);
+      __m512 s = _mm512_setzero_ps();
+      unsigned i = 0;
+      for (; i + 16 <= n; i += 16) {
+            const __m512 v = _mm512_loadu_ps(buf + i);
+            m = _mm512_max_ps(m, avx512_abs(v));
+            s = _mm512_add_ps(s, _mm512_mul_ps(v, v));
+            }
+      *current = _mm512_reduce_max_ps(m);
+      *sumSq += _mm512_reduce_add_ps(s);
+      return i;
+      }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // DSP_HAVE_X86_SIMD
+
+#ifdef DSP_HAVE_NEON
+
+//---------------------------------------------------------
+//   NEON kernels
+//---------------------------------------------------------
+
+static unsigned neon_fill(float* dst, unsigned n, float val)
+      {
+      const float32x4_t v = vdupq_n_f32(val);
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            vst1q_f32(dst + i, v);
+      return i;
+      }
+
+static unsigned neon_addConst(float* dst, const float* src, unsigned n, float val)
+      {
+      const float32x4_t v = vdupq_n_f32(val);
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            vst1q_f32(dst + i, vaddq_f32(vld1q_f32(src + i), v));
+      return i;
+      }
+
+static unsigned neon_peak(const float* buf, unsigned n, float* current)
+      {
+      float32x4_t m = vdupq_n_f32(*current);
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            m = vmaxq_f32(m, vabsq_f32(vld1q_f32(buf + i)));
+      *current = vmaxvq_f32(m);
+      return i;
+      }
+
+static unsigned neon_applyGain(float* buf, unsigned n, float gain)
+      {
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            vst1q_f32(buf + i, vmulq_n_f32(vld1q_f32(buf + i), gain));
+      return i;
+      }
+
+static unsigned neon_mixWithGain(float* dst, const float* src, unsigned n, float gain)
+      {
+      unsigned i = 0;
+      // Separate multiply and add, to give the same result as the scalar code.
+      for (; i + 4 <= n; i += 4)
+            vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vmulq_n_f32(vld1q_f32(src + i), gain)));
+      return i;
+      }
+
+static unsigned neon_mix(float* dst, const float* src, unsigned n)
+      {
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4)
+            vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+      return i;
+      }
+
+static unsigned neon_gainPan(float* dstL, float* dstR, const float* srcL, const float* srcR,
+   unsigned n, float gainL, float gainR)
+      {
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4) {
+            const float32x4_t l = vld1q_f32(srcL + i);
+            const float32x4_t r = vld1q_f32(srcR + i);
+            vst1q_f32(dstL + i, vmulq_n_f32(l, gainL));
+            vst1q_f32(dstR + i, vmulq_n_f32(r, gainR));
+            }
+      return i;
+      }
+
+static unsigned neon_peakRms(const float* buf, unsigned n, float* current, double* sumSq)
+      {
+      float32x4_t m = vdupq_n_f32(*current);
+      float32x4_t s = vdupq_n_f32(0.0f);
+      unsigned i = 0;
+      for (; i + 4 <= n; i += 4) {
+            const float32x4_t v = vld1q_f32(buf + i);
+            m = vmaxq_f32(m, vabsq_f32(v));
+            s = vaddq_f32(s, vmulq_f32(v, v));
+            }
+      *current = vmaxvq_f32(m);
+      *sumSq += vaddvq_f32(s);
+      return i;
+      }
+
+#endif // DSP_HAVE_NEON
+
+//---------------------------------------------------------
+//   DspSIMD
+//    Template over a set of kernels. Each kernel does the
+//    whole vectors and returns how far it got, the rest is
+//    done by the generic routines.
+//---------------------------------------------------------
+
+template <class K>
+class DspSIMD : public Dsp {
+   public:
+      DspSIMD() {}
+      virtual ~DspSIMD() {}
+
+      virtual void clear(float* dst, unsigned n, bool addDenormal = false) {
+            if (!addDenormal) {
+                  memset(dst, 0, n * sizeof(float));
+                  return;
+                  }
+            const unsigned i = K::fill(dst, n, denormalBias);
+            Dsp::clear(dst + i, n - i, true);
+            }
+      virtual void cpy(float* dst, float* src, unsigned n, bool addDenormal = false) {
+            if (!addDenormal) {
+                  memcpy(dst, src, sizeof(float) * n);
+                  return;
+                  }
+            const unsigned i = K::addConst(dst, src, n, denormalBias);
+            Dsp::cpy(dst + i, src + i, n - i, true);
+            }
+      virtual float peak(float* buf, unsigned n, float current) {
+            const unsigned i = K::peak(buf, n, &current);
+            return Dsp::peak(buf + i, n - i, current);
+            }
+      virtual void applyGainToBuffer(float* buf, unsigned n, float gain) {
+            const unsigned i = K::applyGain(buf, n, gain);
+            Dsp::applyGainToBuffer(buf + i, n - i, gain);
+            }
+      virtual void mixWithGain(float* dst, float* src, unsigned n, float gain) {
+            const unsigned i = K::mixWithGain(dst, src, n, gain);
+            Dsp::mixWithGain(dst + i, src + i, n - i, gain);
+            }
+      virtual void mix(float* dst, float* src, unsigned n) {
+            const unsigned i = K::mix(dst, src, n);
+            Dsp::mix(dst + i, src + i, n - i);
+            }
+      virtual void gainPan(float* dstL, float* dstR, float* srcL, float* srcR,
+         unsigned n, float gainL, float gainR) {
+            const unsigned i = K::gainPan(dstL, dstR, srcL, srcR, n, gainL, gainR);
+            Dsp::gainPan(dstL + i, dstR + i, srcL + i, srcR + i, n - i, gainL, gainR);
+            }
+      virtual float peakRms(float* buf, unsigned n, float current, double* sumSq) {
+            const unsigned i = K::peakRms(buf, n, &current, sumSq);
+            return Dsp::peakRms(buf + i, n - i, current, sumSq);
+            }
+      };
+
+#define DSP_KERNELS(name, prefix) \
+struct name { \
+      static unsigned fill(float* d, unsigned n, float v) { return prefix##_fill(d, n, v); } \
+      static unsigned addConst(float* d, const float* s, unsigned n, float v) { return prefix##_addConst(d, s, n, v); } \
+      static unsigned peak(const float* b, unsigned n, float* c) { return prefix##_peak(b, n, c); } \
+      static unsigned applyGain(float* b, unsigned n, float g) { return prefix##_applyGain(b, n, g); } \
+      static unsigned mixWithGain(float* d, const float* s, unsigned n, float g) { return prefix##_mixWithGain(d, s, n, g); } \
+      static unsigned mix(float* d, const float* s, unsigned n) { return prefix##_mix(d, s, n); } \
+      static unsigned gainPan(float* dl, float* dr, const float* sl, const float* sr, unsigned n, float gl, float gr) \
+         { return prefix##_gainPan(dl, dr, sl, sr, n, gl, gr); } \
+      static unsigned peakRms(const float* b, unsigned n, float* c, double* s) { return prefix##_peakRms(b, n, c, s); } \
+      };
+
+#ifdef DSP_HAVE_X86_SIMD
+DSP_KERNELS(KernelsSSE2, sse2)
+DSP_KERNELS(KernelsAVX2, avx2)
+DSP_KERNELS(KernelsAVX512, avx512)
+#endif
+#ifdef DSP_HAVE_NEON
+DSP_KERNELS(KernelsNEON, neon)
+#endif
+
+//---------------------------------------------------------
+//   dspArchName
+//---------------------------------------------------------
+
+const char* dspArchName(DspArch arch)
+      {
+      switch (arch) {
+            case DSP_GENERIC: return "generic";
+            case DSP_SSE2:    return "SSE2";
+            case DSP_AVX2:    return "AVX2";
+            case DSP_AVX512:  return "AVX-512";
+            case DSP_NEON:    return "NEON";
+            }
+      return "unknown";
+      }
+
+//---------------------------------------------------------
+//   archSupported
+//---------------------------------------------------------
+
+static bool archSupported(DspArch arch)
+      {
+      switch (arch) {
+            case DSP_GENERIC:
+                  return true;
+#ifdef DSP_HAVE_X86_SIMD
+            case DSP_SSE2:
+                  return true;    // Always there on x86_64.
+            case DSP_AVX2:
+                  __builtin_cpu_init();
+                  return __builtin_cpu_supports("avx2");
+            case DSP_AVX512:
+                  __builtin_cpu_init();
+                  return __builtin_cpu_supports("avx512f");
+#endif
+#ifdef DSP_HAVE_NEON
+            case DSP_NEON:
+                  return true;    // Always there on aarch64.
+#endif
+            default:
+                  break;
+            }
+      return false;
+      }
+
+//---------------------------------------------------------
+//   newDsp
+//---------------------------------------------------------
+
+Dsp* newDsp(DspArch arch)
+      {
+      if (!archSupported(arch))
+            return 0;
+      switch (arch) {
+            case DSP_GENERIC: return new Dsp();
+#ifdef DSP_HAVE_X86_SIMD
+            case DSP_SSE2:    return new DspSIMD<KernelsSSE2>();
+            case DSP_AVX2:    return new DspSIMD<KernelsAVX2>();
+            case DSP_AVX512:  return new DspSIMD<KernelsAVX512>();
+#endif
+#ifdef DSP_HAVE_NEON
+            case DSP_NEON:    return new DspSIMD<KernelsNEON>();
+#endif
+            default:
+                  break;
+            }
+      return 0;
+      }
+
+//---------------------------------------------------------
+//   bestDspArch
+//---------------------------------------------------------
+
+DspArch bestDspArch()
+      {
+      static const DspArch order[] = { DSP_AVX512, DSP_AVX2, DSP_SSE2, DSP_NEON };
+      for (DspArch arch : order) {
+            if (archSupported(arch))
+                  return arch;
+            }
+      return DSP_GENERIC;
+      }
+
+} // namespace AL
@@ -0,0 +1,183 @@
+//=============================================================================
+//  AL
+//  Audio Utility Library
+//
+//  dsp_bench.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//=============================================================================
+
+//---------------------------------------------------------
+//  Micro-benchmark of the dsp routines.
+//  Times every routine of every implementation the cpu
+//   supports against the generic one, and checks that the
+//   results agree.
+//  Usage: muse_dsp_bench [frames] [iterations]
+//---------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "al.h"
+#include "dsp.h"
+
+using namespace AL;
+
+static unsigned frames = 1024;
+static unsigned iterations = 20000;
+
+//---------------------------------------------------------
+//   Buffers
+//    Offset by one float so that the unaligned case is
+//    measured, as the engine passes arbitrary offsets.
+//---------------------------------------------------------
+
+struct Buffers {
+      std::vector<float> a, b, c, d;
+      float* pa;
+      float* pb;
+      float* pc;
+      float* pd;
+
+      Buffers() : a(frames + 1), b(frames + 1), c(frames + 1), d(frames + 1) {
+            srand(1);
+            for (unsigned i = 0; i <= frames; ++i) {
+                  a[i] = (rand() / (float)RAND_MAX) * 2.0f - 1.0f;
+                  b[i] = (rand() / (float)RAND_MAX) * 2.0f - 1.0f;
+                  }
+            pa = a.data() + 1;
+            pb = b.data() + 1;
+            pc = c.data() + 1;
+            pd = d.data() + 1;
+            }
+      };
+
+//---------------------------------------------------------
+//   timeIt
+//    Returns nanoseconds per frame.
+//---------------------------------------------------------
+
+static double timeIt(const std::function<void()>& f)
+      {
+      for (unsigned i = 0; i < iterations / 10 + 1; ++i)
+            f();
+      const auto start = std::chrono::steady_clock::now();
+      for (unsigned i = 0; i < iterations; ++i)
+            f();
+      const auto end = std::chrono::steady_clock::now();
+      const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+      return ns / ((double)iterations * frames);
+      }
+
+//---------------------------------------------------------
+//   maxDiff
+//---------------------------------------------------------
+
+static float maxDiff(const float* x, const float* y, unsigned n)
+      {
+      float m = 0.0f;
+      for (unsigned i = 0; i < n; ++i)
+            m = f_max(m, fabsf(x[i] - y[i]));
+      return m;
+      }
+
+//---------------------------------------------------------
+//   Kernel
+//---------------------------------------------------------
+
+struct Kernel {
+      const char* name;
+      // Runs the routine on the buffers. Returns a scalar result, if any.
+      std::function<double(Dsp*, Buffers&)> run;
+      };
+
+static volatile double sink;
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      if (argc > 1)
+            frames = atoi(argv[1]);
+      if (argc > 2)
+            iterations = atoi(argv[2]);
+      if (frames == 0 || iterations == 0) {
+            fprintf(stderr, "usage: %s [frames] [iterations]\n", argv[0]);
+            return 1;
+            }
+
+      const std::vector<Kernel> kernels = {
+            { "clear (denormal)", [](Dsp* d, Buffers& b) {
+                  d->clear(b.pc, frames, true); return 0.0; } },
+            { "cpy (denormal)", [](Dsp* d, Buffers& b) {
+                  d->cpy(b.pc, b.pa, frames, true); return 0.0; } },
+            { "peak", [](Dsp* d, Buffers& b) {
+                  return (double)d->peak(b.pa, frames, 0.0f); } },
+            { "applyGainToBuffer", [](Dsp* d, Buffers& b) {
+                  d->cpy(b.pc, b.pa, frames);
+                  d->applyGainToBuffer(b.pc, frames, 0.5f); return 0.0; } },
+            { "mixWithGain", [](Dsp* d, Buffers& b) {
+                  d->cpy(b.pc, b.pb, frames);
+                  d->mixWithGain(b.pc, b.pa, frames, 0.7f); return 0.0; } },
+            { "mix", [](Dsp* d, Buffers& b) {
+                  d->cpy(b.pc, b.pb, frames);
+                  d->mix(b.pc, b.pa, frames); return 0.0; } },
+            { "gainPan (mono)", [](Dsp* d, Buffers& b) {
+                  d->gainPan(b.pc, b.pd, b.pa, b.pa, frames, 0.3f, 0.9f); return 0.0; } },
+            { "peakRms", [](Dsp* d, Buffers& b) {
+                  double sum = 0.0;
+                  const float p = d->peakRms(b.pa, frames, 0.0f, &sum);
+                  return p + sum; } },
+            };
+
+      Dsp* generic = newDsp(DSP_GENERIC);
+      const DspArch archs[] = { DSP_SSE2, DSP_AVX2, DSP_AVX512, DSP_NEON };
+
+      printf("%u frames, %u iterations, best: %s\n", frames, iterations, dspArchName(bestDspArch()));
+      printf("%-20s %-8s %10s %10s %8s %10s\n", "routine", "arch", "ns/frame", "generic", "speedup", "max diff");
+
+      int errors = 0;
+      for (const Kernel& k : kernels) {
+            Buffers ref;
+            const double ref_val = k.run(generic, ref);
+            const double t_gen = timeIt([&]() { sink = k.run(generic, ref); });
+            for (DspArch arch : archs) {
+                  Dsp* d = newDsp(arch);
+                  if (!d)
+                        continue;
+                  Buffers b;
+                  const double val = k.run(d, b);
+                  const double t = timeIt([&]() { sink = k.run(d, b); });
+                  // Vector sums are added in a different order.
+                  double diff = fabs(val - ref_val);
+                  diff = f_max(diff, maxDiff(b.pc, ref.pc, frames));
+                  diff = f_max(diff, maxDiff(b.pd, ref.pd, frames));
+                  const bool bad = diff > 1e-4 * (1.0 + fabs(ref_val));
+                  if (bad)
+                        ++errors;
+                  printf("%-20s %-8s %10.4f %10.4f %7.2fx %10.3g%s\n", k.name, dspArchName(arch),
+                     t, t_gen, t_gen / t, diff, bad ? "  MISMATCH" : "");
+                  delete d;
+                  }
+            }
+      delete generic;
+      return errors ? 1 : 0;
+      }
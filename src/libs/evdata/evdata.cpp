@@ -28,6 +28,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <new>
 
 namespace MusECore {
 
@@ -304,55 +305,32 @@ size_t SysExOutputProcessor::stageEvData(const EvData& evData, unsigned int fram
 //    variable len event data (sysex, meta etc.)
 //---------------------------------------------------------
 
-void EvData::resize(int l)
+unsigned char* EvData::alloc(int l)
 {
       // Setting the data destroys any reference. Dereference now.
       // The data may still be shared. Destroy it only if no more references.
-      if ( _refCount && (--(*_refCount ) == 0)) 
-      {
-        delete _refCount;
-        _refCount = 0;
-        
-        if( _data )
-          delete[] _data;
-      }
-      // Clear the data variable.
-      _data = 0;  
-        
-      if(l > 0) 
-      {
-        _data = new unsigned char[l];
-        
-        // Setting the data destroys any reference. Create a new reference now.
-        _refCount = new int(1);
-      }
-      _dataLen = l;
+      deref();
+      _dataLen = l > 0 ? l : 0;
+      if(_dataLen == 0)
+        return 0;
+      if(!isShared())
+        return _inline;
+      // Setting the data destroys any reference. Create a new reference now.
+      _block = new (::operator new(sizeof(Block) + _dataLen)) Block;
+      _block->refCount.store(1, std::memory_order_relaxed);
+      return _block->bytes();
+}
+
+void EvData::resize(int l)
+{
+      alloc(l);
 }
 
 void EvData::setData(const unsigned char* p, int l) 
 {
-      // Setting the data destroys any reference. Dereference now.
-      // The data may still be shared. Destroy it only if no more references.
-      if ( _refCount && (--(*_refCount ) == 0)) 
-      {
-        delete _refCount;
-        _refCount = 0;
-        
-        if( _data )
-          delete[] _data;
-      }
-      // Clear the data variable.
-      _data = 0;  
-        
-      if(l > 0) 
-      {
-        _data = new unsigned char[l];
-        memcpy( _data, p, l);
-        
-        // Setting the data destroys any reference. Create a new reference now.
-        _refCount = new int(1);
-      }
-      _dataLen = l;
+      unsigned char* d = alloc(l);
+      if(d)
+        memcpy(d, p, l);
 }
             
 void EvData::setData(const SysExInputProcessor* q) 
@@ -360,30 +338,12 @@ void EvData::setData(const SysExInputProcessor* q)
       // Let's not risk unterminated data: Accept a queue with a Finished state only.
       if(q->state() != SysExInputProcessor::Finished)
         return;
-      // Setting the data destroys any reference. Dereference now.
-      // The data may still be shared. Destroy it only if no more references.
-      if ( _refCount && (--(*_refCount ) == 0)) 
-      {
-        delete _refCount;
-        _refCount = 0;
-        
-        if( _data )
-          delete[] _data;
-      }
-      // Clear the data variable.
-      _data = 0;  
-        
       const size_t l = q->size();
-      if(l > 0) 
-      {
-        // Create a contiguous memory block to hold the data.
-        _data = new unsigned char[l];
-        // Copy the non-contiguous chunks of data to the contiguous data.
-        q->copy( _data, l);
-        // Setting the data destroys any reference. Create a new reference now.
-        _refCount = new int(1);
-      }
-      _dataLen = l;
+      // Create a contiguous memory block to hold the data.
+      unsigned char* d = alloc(l);
+      // Copy the non-contiguous chunks of data to the contiguous data.
+      if(d)
+        q->copy(d, l);
 }
 
 } // namespace MusECore
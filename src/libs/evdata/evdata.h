@@ -24,6 +24,9 @@
 #ifndef __EVDATA_H__
 #define __EVDATA_H__
 
+#include <atomic>
+#include <string.h>
+
 #include "memory.h"
 
 namespace MusECore {
@@ -33,61 +36,83 @@ class SysExInputProcessor;
 //---------------------------------------------------------
 //   EvData
 //    variable len event data (sysex, meta etc.)
+//    Short data is held in the EvData itself. Longer data
+//     is shared between copies, with an atomic reference
+//     count in front of the data in the same allocation.
 //---------------------------------------------------------
 
 class EvData {
+  public:
+      // Data up to this many bytes is not allocated.
+      enum { InlineSize = 16 };
+
   private:
-      int* _refCount;
-      unsigned char* _data;
+      struct Block {
+            std::atomic<int> refCount;
+            unsigned char* bytes() { return reinterpret_cast<unsigned char*>(this + 1); }
+            };
+      union {
+            Block* _block;
+            unsigned char _inline[InlineSize];
+            };
       int _dataLen;
 
-  public:
-      EvData()  {
-            _data     = 0;
-            _dataLen  = 0;
-            _refCount = 0;
+      bool isShared() const { return _dataLen > InlineSize; }
+      void ref() const {
+            if(isShared())
+              _block->refCount.fetch_add(1, std::memory_order_relaxed);
             }
+      void deref() {
+            if(isShared() && _block->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+              ::operator delete(_block);
+            }
+      void copyFrom(const EvData& ed) {
+            _dataLen = ed._dataLen;
+            if(isShared())
+              _block = ed._block;
+            else if(_dataLen > 0)
+              memcpy(_inline, ed._inline, _dataLen);
+            }
+      // Drops any data and makes room for l bytes. Returns the room, or null if l is zero.
+      unsigned char* alloc(int l);
+
+  public:
+      EvData() : _dataLen(0) { }
       EvData(const EvData& ed) {
-            _data     = ed._data;
-            _dataLen  = ed._dataLen;
-            _refCount = ed._refCount;
-            if( _refCount )
-              
-            (*_refCount )++;
+            copyFrom(ed);
+            ref();
+            }
+      EvData(EvData&& ed) {
+            copyFrom(ed);
+            ed._dataLen = 0;
             }
 
       EvData& operator=(const EvData& ed) {
-            if ( _data == ed._data )
+            if(this == &ed || (isShared() && ed.isShared() && _block == ed._block))
                   return *this;
-            if ( _refCount && (--(*_refCount ) == 0)) 
-            {
-              delete _refCount;
-              if( _data )
-                delete[] _data;
+            ed.ref();
+            deref();
+            copyFrom(ed);
+            return *this;
             }
-            
-            _data     = ed._data;
-            _dataLen  = ed._dataLen;
-            _refCount = ed._refCount;
-            if( _refCount )
-              
-            (*_refCount )++;
+      EvData& operator=(EvData&& ed) {
+            if(this == &ed)
+                  return *this;
+            deref();
+            copyFrom(ed);
+            ed._dataLen = 0;
             return *this;
             }
 
-      ~EvData() {
-            if ( _refCount && (--(*_refCount ) == 0)) {
-                  if( _data )
-                  {  
-                    delete[] _data;
-                    _data = 0;
-                  }  
-                  delete _refCount;
-                  _refCount = 0;
-                }
+      ~EvData() { deref(); }
+
+      const unsigned char* constData() const {
+            return isShared() ? _block->bytes() : (_dataLen > 0 ? _inline : 0);
+            }
+      // NOTE: Longer data is shared by all copies.
+      unsigned char* data() {
+            return isShared() ? _block->bytes() : (_dataLen > 0 ? _inline : 0);
             }
-      const unsigned char* constData() const { return _data; }
-      unsigned char* data() { return _data; }
       int dataLen() const { return _dataLen; }
       // Allocates enough space for n bytes. Does not fill.
       void resize(int l);
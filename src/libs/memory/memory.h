@@ -26,6 +26,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <atomic>
 
 // NOTE: Keep this code in case we need a dimensioned pool!
 #if 0
@@ -193,6 +194,106 @@ template <typename T, int itemsPerChunk> class TypedMemoryPool
       }
 };
 
+//---------------------------------------------------------
+//   SharedTypedMemoryPool
+//   A TypedMemoryPool which may be used from any thread.
+//   The free list is guarded by a spin lock, held only for
+//    a few pointer moves. New chunks are allocated outside
+//    of the lock. Chunks are only freed by the destructor.
+//---------------------------------------------------------
+
+template <typename T, int itemsPerChunk> class SharedTypedMemoryPool
+{
+      struct Verweis {
+            Verweis* next;
+            };
+      struct Chunk {
+            enum { size = itemsPerChunk * sizeof(T) };
+            Chunk* next;
+            alignas(T) char mem[size];
+            };
+      Chunk* chunks;
+      Verweis* head;
+      std::atomic_flag _lock = ATOMIC_FLAG_INIT;
+      SharedTypedMemoryPool(SharedTypedMemoryPool&);
+      void operator=(SharedTypedMemoryPool&);
+
+      void lock()   { while(_lock.test_and_set(std::memory_order_acquire)) ; }
+      void unlock() { _lock.clear(std::memory_order_release); }
+
+      // Creates a chunk and links its items. Called without the lock held.
+      static Chunk* newChunk()
+      {
+        const int esize = sizeof(T);
+        Chunk* n    = new Chunk;
+        n->next     = 0;
+        const int nelem = Chunk::size / esize;
+        char* start     = n->mem;
+        char* last      = &start[(nelem-1) * esize];
+        for(char* p = start; p < last; p += esize)
+          reinterpret_cast<Verweis*>(p)->next =
+            reinterpret_cast<Verweis*>(p + esize);
+        reinterpret_cast<Verweis*>(last)->next = 0;
+        return n;
+      }
+
+      // Adds a chunk to the pool. Called with the lock held.
+      void addChunk(Chunk* n)
+      {
+        n->next = chunks;
+        chunks  = n;
+        char* last = &n->mem[(Chunk::size / sizeof(T) - 1) * sizeof(T)];
+        reinterpret_cast<Verweis*>(last)->next = head;
+        head = reinterpret_cast<Verweis*>(n->mem);
+      }
+
+   public:
+      SharedTypedMemoryPool()
+      {
+        head   = 0;
+        chunks = 0;
+        addChunk(newChunk());  // preallocate
+      }
+
+      ~SharedTypedMemoryPool()
+      {
+        Chunk* n = chunks;
+        while (n)
+        {
+          Chunk* p = n;
+          n = n->next;
+          delete p;
+        }
+      }
+
+      void* alloc()
+      {
+        lock();
+        if(head == 0)
+        {
+          unlock();
+          Chunk* n = newChunk();
+          lock();
+          addChunk(n);
+        }
+        Verweis* p = head;
+        head = p->next;
+        unlock();
+        return p;
+      }
+
+      void free(void* b)
+      {
+        if(b == 0)
+          return;
+        Verweis* p = static_cast<Verweis*>(b);
+        lock();
+        p->next = head;
+        head = p;
+        unlock();
+      }
+};
+
 //---------------------------------------------------------
 //   MemoryQueue
 //   An efficient queue which grows by fixed chunk sizes,
@@ -0,0 +1,191 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  plugin_bridge_shm.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PLUGIN_BRIDGE_SHM_H__
+#define __PLUGIN_BRIDGE_SHM_H__
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+//==============================================
+// NOTICE:
+// The layout of the memory shared between MusE
+//  and the muse_plugin_bridge host. Both sides
+//  include this header, and they must be built
+//  together. The version is checked anyway.
+//==============================================
+
+namespace MusEPlugin {
+
+//---------------------------------------------------------
+//   PluginBridgeControl
+//    A control input value sent to the bridge, to take
+//     effect at the given frame of the cycle.
+//---------------------------------------------------------
+
+struct PluginBridgeControl {
+  uint32_t port;
+  uint32_t frame;
+  float value;
+};
+
+//---------------------------------------------------------
+//   PluginBridgeStage
+//    One plugin of the chain the host runs.
+//---------------------------------------------------------
+
+struct PluginBridgeStage {
+  char libPath[4096];
+  char label[256];
+  uint32_t instances;
+  // Audio ports of all instances together, in instance order.
+  //  Like in MusE, the chain channels are connected to them
+  //  in that order. The rest get silence or go nowhere.
+  uint32_t audioIns;
+  uint32_t audioOuts;
+  // Control ports of one instance. All instances share the
+  //  control inputs. The outputs are those of the first one.
+  uint32_t controlIns;
+  uint32_t controlOuts;
+  // Where the controls of this stage start, in the port
+  //  numbers of the control ring and in the control outputs.
+  uint32_t controlInBase;
+  uint32_t controlOutBase;
+  // Whether to run the stage in this cycle, or to pass the
+  //  audio through. Written along with the request.
+  uint32_t on;
+  // Bumped when MusE re-activates the plugin. The host re-activates its instances.
+  std::atomic<uint32_t> resets;
+};
+
+//---------------------------------------------------------
+//   PluginBridgeShm
+//    The header of the shared memory block. It is followed
+//     by the control output values of all stages, then the
+//     audio input and output buffers of the chain, maxFrames
+//     long.
+//    MusE fills in everything but the state, then starts
+//     the host, which sets the state to Ready or Failed.
+//    One cycle: MusE writes the inputs and frames, bumps
+//     request and wakes the host. The host runs the stages
+//     one after the other, each on the audio of the one
+//     before, writes the outputs, sets reply to request and
+//     wakes MusE. The bridge is idle when reply equals
+//     request. MusE does not wait for the reply in the same
+//     cycle, it collects it at the start of the next one.
+//---------------------------------------------------------
+
+struct PluginBridgeShm {
+  enum State { Starting = 0, Ready, Failed, Quit };
+
+  static constexpr uint32_t Magic = 0x4d42524b; // "MBRK"
+  static constexpr uint32_t Version = 2;
+  static constexpr uint32_t RingSize = 1024; // Power of 2.
+  static constexpr uint32_t MaxStages = 8; // As deep as the rack.
+  static constexpr size_t Align = 64;
+
+  uint32_t magic;
+  uint32_t version;
+  uint32_t sampleRate;
+  uint32_t maxFrames;
+  // Audio channels into and out of the chain.
+  uint32_t channels;
+  uint32_t stages;
+  // Of all stages together.
+  uint32_t controlOuts;
+  PluginBridgeStage stage[MaxStages];
+
+  std::atomic<uint32_t> state;
+  std::atomic<uint32_t> request;
+  std::atomic<uint32_t> reply;
+  uint32_t frames;
+
+  // Single producer (MusE), single consumer (host) ring of control changes.
+  std::atomic<uint32_t> controlWrite;
+  std::atomic<uint32_t> controlRead;
+  PluginBridgeControl controlRing[RingSize];
+
+  static size_t alignUp(size_t n) { return (n + Align - 1) & ~(Align - 1); }
+  static size_t controlOutsOffset() { return alignUp(sizeof(PluginBridgeShm)); }
+  size_t audioOffset() const { return controlOutsOffset() + alignUp(controlOuts * sizeof(float)); }
+  size_t bufferSize() const { return alignUp(maxFrames * sizeof(float)); }
+  size_t totalSize() const { return totalSize(maxFrames, channels, controlOuts); }
+  // The size to allocate, before the header exists.
+  static size_t totalSize(uint32_t maxFrames, uint32_t channels, uint32_t controlOuts)
+  {
+    return controlOutsOffset() + alignUp(controlOuts * sizeof(float)) +
+      2 * channels * alignUp(maxFrames * sizeof(float));
+  }
+
+  float* controlOutValues() { return reinterpret_cast<float*>(reinterpret_cast<char*>(this) + controlOutsOffset()); }
+  float* audioIn(uint32_t i) { return reinterpret_cast<float*>(reinterpret_cast<char*>(this) + audioOffset() + i * bufferSize()); }
+  float* audioOut(uint32_t i) { return audioIn(channels + i); }
+
+  // Producer side. Returns false if the ring is full.
+  bool pushControl(uint32_t port, uint32_t frame, float value)
+  {
+    const uint32_t w = controlWrite.load(std::memory_order_relaxed);
+    if(w - controlRead.load(std::memory_order_acquire) >= RingSize)
+      return false;
+    controlRing[w & (RingSize - 1)] = PluginBridgeControl{port, frame, value};
+    controlWrite.store(w + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false if the ring is empty.
+  bool popControl(PluginBridgeControl* c)
+  {
+    const uint32_t r = controlRead.load(std::memory_order_relaxed);
+    if(r == controlWrite.load(std::memory_order_acquire))
+      return false;
+    *c = controlRing[r & (RingSize - 1)];
+    controlRead.store(r + 1, std::memory_order_release);
+    return true;
+  }
+};
+
+//---------------------------------------------------------
+//   bridgeFutexWait
+//    Waits while the word equals val, for at most timeout
+//     if given. The memory is shared between processes, so
+//     the futex must not be a private one.
+//---------------------------------------------------------
+
+inline void bridgeFutexWait(std::atomic<uint32_t>* word, uint32_t val, const struct timespec* timeout)
+{
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, val, timeout, nullptr, 0);
+}
+
+inline void bridgeFutexWake(std::atomic<uint32_t>* word)
+{
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+} // namespace MusEPlugin
+
+#endif
@@ -77,6 +77,7 @@ void setPluginScanFileInfo(const QString& filename, PluginScanInfoStruct* info)
 //  info->_absolutePath     = PLUGIN_SET_QSTRING(fi.absolutePath());
 //  info->_path             = PLUGIN_SET_QSTRING(fi.path());
   info->_fileTime         = fi.lastModified().toMSecsSinceEpoch();
+  info->_fileSize         = fi.size();
 }
 
 //---------------------------------------------------------
@@ -284,6 +285,8 @@ bool readPluginScanInfo(MusECore::Xml& xml, PluginScanInfoStruct* info, bool rea
                               info->_uri = PLUGIN_SET_QSTRING(xml.parse1());
                         else if (tag == "filetime")
                               info->_fileTime = xml.parseLongLong();
+                        else if (tag == "filesize")
+                              info->_fileSize = xml.parseLongLong();
                         else if (tag == "fileIsBad")
                               info->_fileIsBad = xml.parseInt();
                         else if (tag == "type")
@@ -37,6 +37,11 @@
 #include <sys/stat.h>
 
 #include <map>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 #include <cstdio>
 #include <cstring>
@@ -1335,6 +1340,8 @@ void writePluginScanInfo(int level, MusECore::Xml& xml, const PluginScanInfoStru
 
       if(info._fileTime != 0)
         xml.longLongTag(level, "filetime", info._fileTime);
+      if(info._fileSize != 0)
+        xml.longLongTag(level, "filesize", info._fileSize);
       if(info._fileIsBad)
         xml.intTag(level, "fileIsBad", info._fileIsBad);
 
@@ -1564,8 +1571,171 @@ void writePluginScanInfo(int level, MusECore::Xml& xml, const PluginScanInfoStru
       xml.etag(--level, "plugin");
       }
 
+//---------------------------------------------------------
+//   pluginScanProgram
+//---------------------------------------------------------
+
+static QString pluginScanProgram()
+{
+  const QByteArray appDir = qgetenv("APPDIR");
+  if (!appDir.isEmpty())
+      return appDir + QString(BINDIR) + QString("/muse_plugin_scan");
+  return QString(BINDIR) + QString("/muse_plugin_scan");
+}
+
+//---------------------------------------------------------
+//   startPluginScanProcess
+//---------------------------------------------------------
+
+static void startPluginScanProcess(
+  QProcess& process,
+  const QString& filename,
+  const QString& tmpfilename,
+  MusEPlugin::PluginTypes_t types,
+  bool scanPorts)
+{
+  QStringList args;
+  args << QString("-t") + QString::number(types) << QString("-f") + filename << QString("-o") + tmpfilename;
+  if(scanPorts)
+    args << QString("-p");
+
+  process.start(pluginScanProgram(), args);
+}
+
+//---------------------------------------------------------
+//   finishPluginScanProcess
+//   Checks how a finished scan process exited.
+//   If debugStdErr is true, any stdout or stderr content
+//    received from the scan program will be printed.
+//   Returns true on success
+//---------------------------------------------------------
+
+static bool finishPluginScanProcess(QProcess& process, const QString& filename, bool debugStdErr)
+{
+  const QByteArray filename_ba = filename.toUtf8();
+  bool fail = false;
+
+  if(debugStdErr)
+  {
+    QByteArray out_array = process.readAllStandardOutput();
+    if(!out_array.isEmpty() && out_array.at(0) != 0)
+    {
+      // Terminate just to be sure.
+      out_array.append(char(0));
+      std::fprintf(stderr, "\npluginScan: Standard output from scan of %s:\n%s\n",
+                   filename_ba.constData(), out_array.constData());
+    }
+    QByteArray err_array = process.readAllStandardError();
+    if(!err_array.isEmpty() && err_array.at(0) != 0)
+    {
+      // Terminate just to be sure.
+      err_array.append(char(0));
+      std::fprintf(stderr, "\npluginScan: Standard error output from scan of %s:\n%s\n",
+                   filename_ba.constData(), err_array.constData());
+    }
+  }
+
+  if(process.exitStatus() != QProcess::NormalExit)
+  {
+    std::fprintf(stderr, "\npluginScan FAILED: Scan not exited normally: file: %s\n\n", filename_ba.constData());
+    fail = true;
+  }
+
+  if(process.exitCode() != 0)
+  {
+    std::fprintf(stderr, "\npluginScan FAILED: Scan exit code not 0: file: %s\n\n", filename_ba.constData());
+    fail = true;
+  }
+
+  return !fail;
+}
+
+//---------------------------------------------------------
+//   addBadPluginFile
+//   Adds a file which failed scanning to the list, marked as bad.
+//---------------------------------------------------------
+
+static void addBadPluginFile(const QString& filename, PluginScanList* list)
+{
+  PluginScanInfoStruct info;
+  setPluginScanFileInfo(filename, &info);
+  info._type = MusEPlugin::PluginTypeUnknown;
+  info._fileIsBad = true;
+  // We must include all plugins.
+  list->add(new PluginScanInfo(info));
+}
+
+//---------------------------------------------------------
+//   readPluginScanOutput
+//   Reads the plugins written by the scan program into the list.
+//   If that fails, the file is added to the list as bad.
+//   Returns true on success
+//---------------------------------------------------------
+
+static bool readPluginScanOutput(
+  const QString& filename,
+  const QString& tmpfilename,
+  PluginScanList* list,
+  bool scanPorts)
+{
+  const QByteArray filename_ba = filename.toUtf8();
+  const QByteArray tmpfilename_ba = tmpfilename.toUtf8();
+  bool fail = false;
+
+  // Open the temp file again...
+  QFile infile(tmpfilename);
+  if(!infile.exists())
+  {
+    std::fprintf(stderr, "\npluginScan FAILED: Temporary file does not exist: %s\n\n", tmpfilename_ba.constData());
+    fail = true;
+  }
+  if(!fail && !infile.open(QIODevice::ReadOnly /*| QIODevice::Text*/))
+  {
+    std::fprintf(stderr, "\npluginScan FAILED: Could not re-open temporary output file: %s\n\n",
+                tmpfilename_ba.constData());
+    fail = true;
+  }
+
+  if(!fail)
+  {
+    // Create an xml object based on the file.
+    MusECore::Xml xml(&infile);
+
+    // Read the list of plugins found in the xml.
+    // For now we don't supply a separate scanEnums flag in pluginScan(), so just use scanPorts instead.
+    int numPlugins = 0;
+    if(readPluginScan(xml, list, scanPorts, scanPorts, &numPlugins))
+    {
+      std::fprintf(stderr, "\npluginScan FAILED: On readPluginScan(): file: %s\n\n", filename_ba.constData());
+      fail = true;
+    }
+
+    // No plugins found in this file?
+    if(numPlugins == 0)
+    {
+      std::fprintf(stderr, "\npluginScan: No plugins found in file:%s! Putting this file in 'unknown' cache.\n\n", filename_ba.constData());
+      fail = true;
+    }
+
+    // Close the temp file.
+    infile.close();
+
+    if(!fail)
+      return true;
+  }
+
+  //---------------------------------------------------------------
+  // Plugin failed scanning. Add it to the list but mark it as bad!
+  //---------------------------------------------------------------
+
+  addBadPluginFile(filename, list);
+  return false;
+}
+
 //---------------------------------------------------------
 //   pluginScan
+//   Scans one file, asking the user what to do if
+//    the scan takes a very long time.
 //   If debugStdErr is true, any stderr content received
 //    from the scan program will be printed.
 //   Returns true on success
@@ -1588,7 +1758,6 @@ static bool pluginScan(
   }
   // Get the unique temp file name.
   const QString tmpfilename = tmpfile.fileName();
-  const QByteArray tmpfilename_ba = tmpfilename.toUtf8();
   // Close the temp file. It exists until tmpfile goes out of scope.
   tmpfile.close();
 
@@ -1596,37 +1765,10 @@ static bool pluginScan(
     std::fprintf(stderr, "\nChecking file: <%s>\n", filename.toLocal8Bit().constData());
 
   QProcess process;
-
-  QString prog;
-  const QByteArray appDir = qgetenv("APPDIR");
-  if (!appDir.isEmpty())
-      prog = appDir + QString(BINDIR) + QString("/muse_plugin_scan");
-  else
-      prog = QString(BINDIR) + QString("/muse_plugin_scan");
-
-  QStringList args;
-  args << QString("-t") + QString::number(types) << QString("-f") + filename << QString("-o") + tmpfilename;
-  if(scanPorts)
-    args << QString("-p");
-
-  process.start(prog, args);
+  startPluginScanProcess(process, filename, tmpfilename, types, scanPorts);
 
   bool fail = false;
 
-//   if(!process.waitForStarted(4000))
-//   {
-//     std::fprintf(stderr, "pluginScan: waitForStarted failed\n");
-// //     return false;
-//     fail = true;
-//   }
-
-//   if(!process.waitForReadyRead(4000))
-//   {
-//     std::fprintf(stderr, "pluginScan: waitForReadyRead failed\n");
-// //     return false;
-//     fail = true;
-//   }
-
   if(!process.waitForFinished(10000))
   {
     std::fprintf(stderr, "\npluginScan FAILED: waitForFinished: file: %s\n\n", filename_ba.constData());
@@ -1650,107 +1792,203 @@ static bool pluginScan(
     }
   }
 
-  if(!fail && debugStdErr)
+  if(fail || !finishPluginScanProcess(process, filename, debugStdErr))
   {
-    QByteArray out_array = process.readAllStandardOutput();
-    if(!out_array.isEmpty() && out_array.at(0) != 0)
-    {
-      // Terminate just to be sure.
-      out_array.append(char(0));
-      std::fprintf(stderr, "\npluginScan: Standard output from scan:\n%s\n", out_array.constData());
-    }
-    QByteArray err_array = process.readAllStandardError();
-    if(!err_array.isEmpty() && err_array.at(0) != 0)
-    {
-      // Terminate just to be sure.
-      err_array.append(char(0));
-      std::fprintf(stderr, "\npluginScan: Standard error output from scan:\n%s\n", err_array.constData());
-    }
+    addBadPluginFile(filename, list);
+    return false;
   }
 
-  if(process.exitStatus() != QProcess::NormalExit)
-  {
-    std::fprintf(stderr, "\npluginScan FAILED: Scan not exited normally: file: %s\n\n", filename_ba.constData());
-    fail = true;
-  }
+  // Going out of scope destroys the temporary file...
+  return readPluginScanOutput(filename, tmpfilename, list, scanPorts);
+}
 
-  if(process.exitCode() != 0)
+//---------------------------------------------------------
+//   PluginScanJob
+//   One file handled by the scanner pool.
+//---------------------------------------------------------
+
+struct PluginScanJob
+{
+  enum State { Pending, Cached, Finished, Failed, TimedOut };
+
+  QString _filename;
+  State _state;
+  // Holds the scan program's output until it is read. It exists until the job is destroyed.
+  QTemporaryFile _tmpfile;
+  QString _tmpfilename;
+  // The still valid cache entries of the file, when the state is Cached.
+  const std::vector<PluginScanInfoRef>* _cached;
+
+  PluginScanJob(const QString& filename) : _filename(filename), _state(Pending), _cached(nullptr) { }
+};
+
+//---------------------------------------------------------
+//   runPluginScanJob
+//   Called from the scanner pool's threads. Only runs the
+//    scan program. Reading its output is done afterwards
+//    by the caller, so that the list is not touched here.
+//---------------------------------------------------------
+
+static void runPluginScanJob(
+  PluginScanJob* job,
+  MusEPlugin::PluginTypes_t types,
+  bool scanPorts,
+  bool debugStdErr)
+{
+  if(debugStdErr)
+    std::fprintf(stderr, "\nChecking file: <%s>\n", job->_filename.toLocal8Bit().constData());
+
+  // No event loop is needed, waitForFinished() works in any thread.
+  QProcess process;
+  startPluginScanProcess(process, job->_filename, job->_tmpfilename, types, scanPorts);
+
+  if(!process.waitForFinished(10000))
   {
-    std::fprintf(stderr, "\npluginScan FAILED: Scan exit code not 0: file: %s\n\n", filename_ba.constData());
-    fail = true;
+    // Let the caller ask the user about it after the pool is finished.
+    process.kill();
+    process.waitForFinished(-1);
+    job->_state = PluginScanJob::TimedOut;
+    return;
   }
 
-  if(!fail)
+  job->_state = finishPluginScanProcess(process, job->_filename, debugStdErr) ?
+                  PluginScanJob::Finished : PluginScanJob::Failed;
+}
+
+//---------------------------------------------------------
+//   pluginScanThreadCount
+//---------------------------------------------------------
+
+static int pluginScanThreadCount(int threads)
+{
+  if(threads > 0)
+    return threads;
+  const int cores = std::thread::hardware_concurrency();
+  return cores > 0 ? cores : 1;
+}
+
+//---------------------------------------------------------
+//   scanPluginFiles
+//   Scans the files with a pool of up to 'threads' scan programs
+//    running at the same time (zero = one per cpu core), then
+//    merges the results into the list in the order of the files.
+//   Each file still has its own scan program so a crashing
+//    plugin only marks its own file as bad.
+//   Files found in the cache with an unchanged time stamp and
+//    size are not scanned, their cached entries are used.
+//   With one thread, or one file to scan, the files are
+//    scanned one by one as before.
+//   A file whose scan takes too long is scanned again afterwards
+//    on its own, letting the user decide whether to keep waiting.
+//---------------------------------------------------------
+
+static void scanPluginFiles(
+  const QStringList& files,
+  MusEPlugin::PluginTypes_t types,
+  PluginScanList* list,
+  bool scanPorts,
+  bool debugStdErr,
+  const PluginScanCache* cache,
+  int threads)
+{
+  std::vector<std::unique_ptr<PluginScanJob> > jobs;
+  jobs.reserve(files.size());
+  std::vector<PluginScanJob*> pending;
+
+  for(QStringList::const_iterator it = files.cbegin(); it != files.cend(); ++it)
   {
-    // Open the temp file again...
-    QFile infile(tmpfilename);
-    if(!infile.exists())
-    {
-      std::fprintf(stderr, "\npluginScan FAILED: Temporary file does not exist: %s\n\n", tmpfilename_ba.constData());
-      fail = true;
-    }
-    if(!fail && !infile.open(QIODevice::ReadOnly /*| QIODevice::Text*/))
-    {
-      std::fprintf(stderr, "\npluginScan FAILED: Could not re-open temporary output file: %s\n\n",
-                  tmpfilename_ba.constData());
-      fail = true;
-    }
+    PluginScanJob* job = new PluginScanJob(*it);
+    jobs.push_back(std::unique_ptr<PluginScanJob>(job));
 
-    if(!fail)
+    if(cache)
     {
-      // Create an xml object based on the file.
-      MusECore::Xml xml(&infile);
-
-      // Read the list of plugins found in the xml.
-      // For now we don't supply a separate scanEnums flag in pluginScan(), so just use scanPorts instead.
-      int numPlugins = 0;
-      if(readPluginScan(xml, list, scanPorts, scanPorts, &numPlugins))
+      PluginScanCache::const_iterator ic = cache->find(*it);
+      if(ic != cache->cend())
       {
-        std::fprintf(stderr, "\npluginScan FAILED: On readPluginScan(): file: %s\n\n", filename_ba.constData());
-        fail = true;
+        job->_state = PluginScanJob::Cached;
+        job->_cached = &ic->second;
+        continue;
       }
+    }
 
-      // No plugins found in this file?
-      if(numPlugins == 0)
-      {
-        std::fprintf(stderr, "\npluginScan: No plugins found in file:%s! Putting this file in 'unknown' cache.\n\n", filename_ba.constData());
-        fail = true;
-      }
+    // Must open the temp file to get its name.
+    if(!job->_tmpfile.open())
+    {
+      std::fprintf(stderr, "\npluginScan FAILED: Could not create temporary output file for input file: %s\n\n",
+                   it->toLocal8Bit().constData());
+      job->_state = PluginScanJob::Failed;
+      continue;
+    }
+    job->_tmpfilename = job->_tmpfile.fileName();
+    // Close the temp file. It exists until the job is destroyed.
+    job->_tmpfile.close();
+    pending.push_back(job);
+  }
 
-      // Close the temp file.
-      infile.close();
+  // With a single thread or file there is nothing to gain from a pool.
+  // The files are then scanned one by one as usual while merging below.
+  const int num_threads = std::min<int>(pluginScanThreadCount(threads), pending.size());
+  if(num_threads > 1)
+  {
+    if(debugStdErr)
+      std::fprintf(stderr, "Scanning %d plugin files with %d processes...\n", (int)pending.size(), num_threads);
 
-      // Now going out of scope destroys the temporary file...
-      if(!fail)
-        return true;
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> pool;
+    pool.reserve(num_threads);
+    for(int i = 0; i < num_threads; ++i)
+    {
+      pool.emplace_back([&]() {
+        for(size_t j = next++; j < pending.size(); j = next++)
+          runPluginScanJob(pending[j], types, scanPorts, debugStdErr);
+      });
     }
+    for(std::thread& t : pool)
+      t.join();
   }
 
-  //---------------------------------------------------------------
-  // Plugin failed scanning. Add it to the list but mark it as bad!
-  //---------------------------------------------------------------
+  // Merge the results, in the order of the files.
+  for(const std::unique_ptr<PluginScanJob>& job : jobs)
+  {
+    switch(job->_state)
+    {
+      case PluginScanJob::Cached:
+        DEBUG_PLUGIN_SCAN(stderr, "scanPluginFiles: Using cache for unchanged file <%s>\n",
+                          job->_filename.toLocal8Bit().constData());
+        for(const PluginScanInfoRef& ref : *job->_cached)
+          list->push_back(ref);
+      break;
 
-  PluginScanInfoStruct info;
-  setPluginScanFileInfo(filename, &info);
-  info._type = MusEPlugin::PluginTypeUnknown;
-  info._fileIsBad = true;
-  // We must include all plugins.
-  list->add(new PluginScanInfo(info));
+      case PluginScanJob::Finished:
+        readPluginScanOutput(job->_filename, job->_tmpfilename, list, scanPorts);
+      break;
 
-  return false;
+      case PluginScanJob::TimedOut:
+        std::fprintf(stderr, "\npluginScan: Scan took too long, scanning again on its own: file: %s\n\n",
+                     job->_filename.toLocal8Bit().constData());
+        pluginScan(job->_filename, types, list, scanPorts, debugStdErr);
+      break;
+
+      case PluginScanJob::Pending:
+        pluginScan(job->_filename, types, list, scanPorts, debugStdErr);
+      break;
+
+      case PluginScanJob::Failed:
+        addBadPluginFile(job->_filename, list);
+      break;
+    }
+  }
 }
 
 //---------------------------------------------------------
-//   scanPluginDir
+//   findPluginScanDir
+//   Gathers the library files to be scanned.
 //   This might be called recursively!
 //---------------------------------------------------------
 
-static void scanPluginDir(
+static void findPluginScanDir(
   const QString& dirname,
-  MusEPlugin::PluginTypes_t types,
-  PluginScanList* list,
-  bool scanPorts,
-  bool debugStdErr,
+  QStringList& files,
   // Only for recursions, original top caller should not touch!
   int recurseLevel = 0
 )
@@ -1758,7 +1996,7 @@ static void scanPluginDir(
   const int max_levels = 10;
   if(recurseLevel >= max_levels)
   {
-    std::fprintf(stderr, "scanPluginDir: Ignoring too-deep directory level (max:%d) at:%s\n",
+    std::fprintf(stderr, "findPluginScanDir: Ignoring too-deep directory level (max:%d) at:%s\n",
                  max_levels, dirname.toLocal8Bit().constData());
     return;
   }
@@ -1781,12 +2019,12 @@ static void scanPluginDir(
       if(fi.isDir())
       {
         // RECURSIVE!
-        scanPluginDir(fi.filePath(), types, list, scanPorts, debugStdErr, recurseLevel + 1);
+        findPluginScanDir(fi.filePath(), files, recurseLevel + 1);
       }
       else
       {
         if(QLibrary::isLibrary(fi.filePath()))
-          pluginScan(fi.filePath(), types, list, scanPorts, debugStdErr);
+          files.append(fi.filePath());
       }
 
       ++it;
@@ -1794,26 +2032,45 @@ static void scanPluginDir(
   }
 }
 
+//---------------------------------------------------------
+//   scanPluginDirs
+//---------------------------------------------------------
+
+static void scanPluginDirs(
+  const QStringList& dirs,
+  MusEPlugin::PluginTypes_t types,
+  PluginScanList* list,
+  bool scanPorts,
+  bool debugStdErr,
+  const PluginScanCache* cache,
+  int threads)
+{
+  QStringList files;
+  for(QStringList::const_iterator it = dirs.cbegin(); it != dirs.cend(); ++it)
+    findPluginScanDir(*it, files);
+  scanPluginFiles(files, types, list, scanPorts, debugStdErr, cache, threads);
+}
+
 //---------------------------------------------------------
 //   scanLadspaPlugins
 //---------------------------------------------------------
 
-void scanLadspaPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr)
+void scanLadspaPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr,
+  const PluginScanCache* cache, int threads)
 {
   QStringList sl = pluginGetLadspaDirectories(museGlobalLib);
-  for(QStringList::const_iterator it = sl.cbegin(); it != sl.cend(); ++it)
-    scanPluginDir(*it, MusEPlugin::PluginTypesAll, list, scanPorts, debugStdErr);
+  scanPluginDirs(sl, MusEPlugin::PluginTypesAll, list, scanPorts, debugStdErr, cache, threads);
 }
 
 //---------------------------------------------------------
 //   scanMessPlugins
 //---------------------------------------------------------
 
-void scanMessPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr)
+void scanMessPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr,
+  const PluginScanCache* cache, int threads)
 {
   QStringList sl = pluginGetMessDirectories(museGlobalLib);
-  for(QStringList::const_iterator it = sl.cbegin(); it != sl.cend(); ++it)
-    scanPluginDir(*it, MusEPlugin::PluginTypesAll, list, scanPorts, debugStdErr);
+  scanPluginDirs(sl, MusEPlugin::PluginTypesAll, list, scanPorts, debugStdErr, cache, threads);
 }
 
 //---------------------------------------------------------
@@ -1821,14 +2078,15 @@ void scanMessPlugins(const QString& museGlobalLib, PluginScanList* list, bool sc
 //---------------------------------------------------------
 
 #ifdef DSSI_SUPPORT
-void scanDssiPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr)
+void scanDssiPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr,
+  const PluginScanCache* cache, int threads)
 {
   QStringList sl = pluginGetDssiDirectories();
-  for(QStringList::const_iterator it = sl.cbegin(); it != sl.cend(); ++it)
-    scanPluginDir(*it, MusEPlugin::PluginTypesAll, list, scanPorts, debugStdErr);
+  scanPluginDirs(sl, MusEPlugin::PluginTypesAll, list, scanPorts, debugStdErr, cache, threads);
 }
 #else // No DSSI_SUPPORT
-void scanDssiPlugins(PluginScanList* /*list*/, bool /*scanPorts*/, bool /*debugStdErr*/)
+void scanDssiPlugins(PluginScanList* /*list*/, bool /*scanPorts*/, bool /*debugStdErr*/,
+  const PluginScanCache* /*cache*/, int /*threads*/)
 {
 }
 #endif // DSSI_SUPPORT
@@ -1838,7 +2096,8 @@ void scanDssiPlugins(PluginScanList* /*list*/, bool /*scanPorts*/, bool /*debugS
 //---------------------------------------------------------
 
 #ifdef VST_NATIVE_SUPPORT
-void scanLinuxVSTPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr)
+void scanLinuxVSTPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr,
+  const PluginScanCache* cache, int threads)
 {
   #ifdef VST_VESTIGE_SUPPORT
     std::fprintf(stderr, "Initializing Native VST support. Using VESTIGE compatibility implementation.\n");
@@ -1849,11 +2108,11 @@ void scanLinuxVSTPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr)
 //   sem_init(&_vstIdLock, 0, 1);
 
   QStringList sl = pluginGetLinuxVstDirectories();
-  for(QStringList::const_iterator it = sl.cbegin(); it != sl.cend(); ++it)
-    scanPluginDir(*it, MusEPlugin::PluginTypesAll, list, scanPorts, debugStdErr);
+  scanPluginDirs(sl, MusEPlugin::PluginTypesAll, list, scanPorts, debugStdErr, cache, threads);
 }
 #else
-void scanLinuxVSTPlugins(PluginScanList* /*list*/, bool /*scanPorts*/, bool /*debugStdErr*/)
+void scanLinuxVSTPlugins(PluginScanList* /*list*/, bool /*scanPorts*/, bool /*debugStdErr*/,
+  const PluginScanCache* /*cache*/, int /*threads*/)
 {
 }
 #endif // VST_NATIVE_SUPPORT
@@ -2661,23 +2920,25 @@ void scanAllPlugins(
   PluginScanList* list,
   bool scanPorts,
   bool debugStdErr,
-  MusEPlugin::PluginTypes_t types)
+  MusEPlugin::PluginTypes_t types,
+  const PluginScanCache* cache,
+  int threads)
 {
   if(types & (MusEPlugin::PluginTypeDSSI | MusEPlugin::PluginTypeDSSIVST))
     // Take care of DSSI plugins first...
-    scanDssiPlugins(list, scanPorts, debugStdErr);
+    scanDssiPlugins(list, scanPorts, debugStdErr, cache, threads);
 
   if(types & (MusEPlugin::PluginTypeLADSPA))
     // Now do LADSPA plugins...
-    scanLadspaPlugins(museGlobalLib, list, scanPorts, debugStdErr);
+    scanLadspaPlugins(museGlobalLib, list, scanPorts, debugStdErr, cache, threads);
 
   if(types & (MusEPlugin::PluginTypeMESS))
     // Now do MESS plugins...
-    scanMessPlugins(museGlobalLib, list, scanPorts, debugStdErr);
+    scanMessPlugins(museGlobalLib, list, scanPorts, debugStdErr, cache, threads);
 
   if(types & (MusEPlugin::PluginTypeLinuxVST))
     // Now do LinuxVST plugins...
-    scanLinuxVSTPlugins(list, scanPorts, debugStdErr);
+    scanLinuxVSTPlugins(list, scanPorts, debugStdErr, cache, threads);
 
 // SPECIAL for LV2: No need for a cache file. Do not create one here. Read directly into the list later.
 //   if(types & (MusEPlugin::PluginTypeLV2))
@@ -2685,8 +2946,24 @@ void scanAllPlugins(
 //     scanLv2Plugins(list, scanPorts, debugStdErr);
 }
 
-typedef std::map<QString, std::int64_t, std::less<QString> > filepath_set;
-typedef std::pair<QString, std::int64_t> filepath_set_pair;
+//---------------------------------------------------------
+//   PluginFileStamp
+//   A plugin file's time stamp and size, used to tell
+//    whether the file changed since it was scanned.
+//---------------------------------------------------------
+
+struct PluginFileStamp
+{
+  std::int64_t _time;
+  std::int64_t _size;
+
+  PluginFileStamp(std::int64_t time = 0, std::int64_t size = 0) : _time(time), _size(size) { }
+  bool operator==(const PluginFileStamp& other) const { return _time == other._time && _size == other._size; }
+  bool operator!=(const PluginFileStamp& other) const { return !(*this == other); }
+};
+
+typedef std::map<QString, PluginFileStamp, std::less<QString> > filepath_set;
+typedef std::pair<QString, PluginFileStamp> filepath_set_pair;
 
 //---------------------------------------------------------
 //   findPluginFilesDir
@@ -2733,7 +3010,8 @@ static QString findPluginFilesDir(
       else
       {
         if(QLibrary::isLibrary(fi.filePath()))
-          fplist.insert(filepath_set_pair(fi.filePath(), fi.lastModified().toMSecsSinceEpoch()));
+          fplist.insert(filepath_set_pair(fi.filePath(),
+            PluginFileStamp(fi.lastModified().toMSecsSinceEpoch(), fi.size())));
       }
 
       ++it;
@@ -2858,7 +3136,8 @@ static void findLv2PluginFile(const LilvPlugin *plugin,
   {
     QFileInfo fi(lfp);
     if(fi.exists())
-      fplist.insert(filepath_set_pair(fi.filePath(), fi.lastModified().toMSecsSinceEpoch()));
+      fplist.insert(filepath_set_pair(fi.filePath(),
+        PluginFileStamp(fi.lastModified().toMSecsSinceEpoch(), fi.size())));
   }
 
   lilv_free((void*)lfp); // Must free.
@@ -3032,10 +3311,12 @@ bool createPluginCacheFile(
   bool writePorts,
   const QString& museGlobalLib,
   MusEPlugin::PluginTypes_t types,
-  bool debugStdErr)
+  bool debugStdErr,
+  const PluginScanCache* cache,
+  int scanThreads)
 {
   // Scan all plugins into the list.
-  scanAllPlugins(museGlobalLib, list, writePorts, debugStdErr, type);
+  scanAllPlugins(museGlobalLib, list, writePorts, debugStdErr, type, cache, scanThreads);
 
   // Write the list's cache file.
   if(!writePluginCacheFile(path, QString(pluginCacheFilename(type)), *list, writePorts, types))
@@ -3057,11 +3338,13 @@ bool createPluginCacheFiles(
   bool writePorts,
   const QString& museGlobalLib,
   MusEPlugin::PluginTypes_t types,
-  bool debugStdErr)
+  bool debugStdErr,
+  const PluginScanCache* cache,
+  int scanThreads)
 {
   if(types & (MusEPlugin::PluginTypeDSSI | MusEPlugin::PluginTypeDSSIVST))
     createPluginCacheFile(path, MusEPlugin::PluginTypeDSSI, list, writePorts,
-      museGlobalLib, MusEPlugin::PluginTypeDSSI | MusEPlugin::PluginTypeDSSIVST, debugStdErr);
+      museGlobalLib, MusEPlugin::PluginTypeDSSI | MusEPlugin::PluginTypeDSSIVST, debugStdErr, cache, scanThreads);
 
   // NOTE: Because the dss-vst library installs itself in both the dssi AND ladspa folders,
   //        we must include dssi-vst types in the search here.
@@ -3069,32 +3352,69 @@ bool createPluginCacheFiles(
   //        and the dssi folder dss-vst file scan.
   if(types & MusEPlugin::PluginTypeLADSPA)
     createPluginCacheFile(path, MusEPlugin::PluginTypeLADSPA, list, writePorts,
-      museGlobalLib, MusEPlugin::PluginTypeLADSPA | MusEPlugin::PluginTypeDSSIVST, debugStdErr);
+      museGlobalLib, MusEPlugin::PluginTypeLADSPA | MusEPlugin::PluginTypeDSSIVST, debugStdErr, cache, scanThreads);
 
   if(types & MusEPlugin::PluginTypeLinuxVST)
     createPluginCacheFile(path, MusEPlugin::PluginTypeLinuxVST, list, writePorts,
-      museGlobalLib, MusEPlugin::PluginTypeLinuxVST, debugStdErr);
+      museGlobalLib, MusEPlugin::PluginTypeLinuxVST, debugStdErr, cache, scanThreads);
 
   if(types & MusEPlugin::PluginTypeMESS)
     createPluginCacheFile(path, MusEPlugin::PluginTypeMESS, list, writePorts,
-      museGlobalLib, MusEPlugin::PluginTypeMESS, debugStdErr);
+      museGlobalLib, MusEPlugin::PluginTypeMESS, debugStdErr, cache, scanThreads);
 
   // SPECIAL for LV2: No need for a cache file. Do not create one here. Read directly into the list later.
   //if(types & MusEPlugin::PluginTypeLV2)
   //  createPluginCacheFile(path, MusEPlugin::PluginTypeLV2, list, writePorts,
-  //    museGlobalLib, MusEPlugin::PluginTypeLV2, debugStdErr);
+  //    museGlobalLib, MusEPlugin::PluginTypeLV2, debugStdErr, cache, scanThreads);
 
   if(types & MusEPlugin::PluginTypeVST)
     createPluginCacheFile(path, MusEPlugin::PluginTypeVST, list, writePorts,
-      museGlobalLib, MusEPlugin::PluginTypeVST, debugStdErr);
+      museGlobalLib, MusEPlugin::PluginTypeVST, debugStdErr, cache, scanThreads);
 
   if(types & MusEPlugin::PluginTypeUnknown)
     createPluginCacheFile(path, MusEPlugin::PluginTypeUnknown, list, writePorts,
-      museGlobalLib, MusEPlugin::PluginTypeUnknown, debugStdErr);
+      museGlobalLib, MusEPlugin::PluginTypeUnknown, debugStdErr, cache, scanThreads);
 
   return true;
 }
 
+//---------------------------------------------------------
+//   findUnchangedCacheEntries
+//   Gathers the cache entries of the files which still have
+//    the same time stamp and size, one copy of each entry
+//    per file, so that those files need not be scanned again.
+//---------------------------------------------------------
+
+static void findUnchangedCacheEntries(const PluginScanList& list, const filepath_set& fpset, PluginScanCache* cache)
+{
+  for(ciPluginScanList ips = list.begin(); ips != list.end(); ++ips)
+  {
+    const PluginScanInfoRef& inforef = *ips;
+    const PluginScanInfoStruct& infos = inforef->info();
+    const QString filepath = PLUGIN_GET_QSTRING(infos.filePath());
+
+    filepath_set::const_iterator ifpset = fpset.find(filepath);
+    if(ifpset == fpset.cend() || ifpset->second != PluginFileStamp(infos._fileTime, infos._fileSize))
+      continue;
+
+    // The same entry may have been read from more than one cache file.
+    std::vector<PluginScanInfoRef>& entries = (*cache)[filepath];
+    bool dup = false;
+    for(const PluginScanInfoRef& ref : entries)
+    {
+      const PluginScanInfoStruct& e = ref->info();
+      if(e._type == infos._type && e._uniqueID == infos._uniqueID && e._subID == infos._subID &&
+         e._label == infos._label && e._uri == infos._uri)
+      {
+        dup = true;
+        break;
+      }
+    }
+    if(!dup)
+      entries.push_back(inforef);
+  }
+}
+
 //---------------------------------------------------------
 //   checkPluginCacheFiles
 //---------------------------------------------------------
@@ -3107,10 +3427,13 @@ bool checkPluginCacheFiles(
   bool dontRecreate,
   const QString& museGlobalLib,
   MusEPlugin::PluginTypes_t types,
-  bool debugStdErr
+  bool debugStdErr,
+  int scanThreads
 )
 {
   filepath_set cache_fpset;
+  // The current plugin files, if the cache files could all be read.
+  filepath_set cur_fpset;
   bool res = true;
   bool cache_dirty = false;
 
@@ -3131,8 +3454,8 @@ bool checkPluginCacheFiles(
     // Gather the current plugin files.
     //-----------------------------------------------------
 
-    filepath_set fpset;
-    findPluginFiles(museGlobalLib, fpset, debugStdErr, types);
+    findPluginFiles(museGlobalLib, cur_fpset, debugStdErr, types);
+    filepath_set fpset(cur_fpset);
 
     //-------------------------------------------------------------------------
     // Gather the unique (non-duplicate) plugin file paths found in our cache.
@@ -3142,7 +3465,8 @@ bool checkPluginCacheFiles(
     {
       PluginScanInfoRef inforef = *ips;
       const PluginScanInfoStruct& infos = inforef->info();
-      cache_fpset.insert(filepath_set_pair(PLUGIN_GET_QSTRING(infos.filePath()), infos._fileTime));
+      cache_fpset.insert(filepath_set_pair(PLUGIN_GET_QSTRING(infos.filePath()),
+        PluginFileStamp(infos._fileTime, infos._fileSize)));
     }
 
     //---------------------------------------
@@ -3161,10 +3485,12 @@ bool checkPluginCacheFiles(
             if(ifpset == fpset.end())
                 std::fprintf(stderr, "Missing plugin: %s:\n", icfps->first.toLocal8Bit().data());
             else
-                std::fprintf(stderr, "Modified plugin: %s (Cache ts: %ld / File ts: %ld)\n",
+                std::fprintf(stderr, "Modified plugin: %s (Cache ts: %ld size: %ld / File ts: %ld size: %ld)\n",
                              icfps->first.toLocal8Bit().data(),
-                             (long int) icfps->second,
-                             (long int) ifpset->second);
+                             (long int) icfps->second._time,
+                             (long int) icfps->second._size,
+                             (long int) ifpset->second._time,
+                             (long int) ifpset->second._size);
         }
 
         break;
@@ -3201,8 +3527,15 @@ bool checkPluginCacheFiles(
     if(debugStdErr)
       std::fprintf(stderr, "Re-scanning and creating plugin cache files...\n");
 
+    // Unless forcing recreation, files which did not change since the cache
+    //  was written keep their cached entries and are not scanned again.
+    PluginScanCache scan_cache;
+    if(!alwaysRecreate && !cur_fpset.empty())
+      findUnchangedCacheEntries(*list, cur_fpset, &scan_cache);
+
     list->clear();
-    if(!createPluginCacheFiles(path, list, writePorts, museGlobalLib, types, debugStdErr))
+    if(!createPluginCacheFiles(path, list, writePorts, museGlobalLib, types, debugStdErr,
+                               scan_cache.empty() ? nullptr : &scan_cache, scanThreads))
     {
       res = false;
       std::fprintf(stderr, "checkPluginCacheFiles: createPluginCacheFiles() failed\n");
@@ -32,6 +32,9 @@
 
 #include "synti/libsynti/mess.h"
 
+#include <map>
+#include <vector>
+
 #include <ladspa.h>
 
 #ifdef DSSI_SUPPORT
@@ -111,6 +114,10 @@ class Xml;
 
 namespace MusEPlugin {
 
+// Cache entries of plugin files which have not changed since they were scanned,
+//  by file path. Scanning uses them instead of scanning those files again.
+typedef std::map<QString, std::vector<PluginScanInfoRef> > PluginScanCache;
+
 //-----------------------------------------
 // functions
 //-----------------------------------------
@@ -149,10 +156,16 @@ bool writeUnknownPluginInfo(const char* filename, int level, MusECore::Xml& xml)
 void writePluginScanInfo(int level, MusECore::Xml& xml, const PluginScanInfoStruct& info, bool writePorts);
 
 // The museGlobalLib is where to find the application's installed libraries.
-void scanLadspaPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr);
-void scanMessPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr);
-void scanDssiPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr);
-void scanLinuxVSTPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr);
+// The files are scanned by up to 'threads' scan processes at the same time (zero = one per cpu core).
+// Files found in the optional cache are not scanned, their cached entries are used instead.
+void scanLadspaPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr,
+                       const PluginScanCache* cache = nullptr, int threads = 0);
+void scanMessPlugins(const QString& museGlobalLib, PluginScanList* list, bool scanPorts, bool debugStdErr,
+                     const PluginScanCache* cache = nullptr, int threads = 0);
+void scanDssiPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr,
+                     const PluginScanCache* cache = nullptr, int threads = 0);
+void scanLinuxVSTPlugins(PluginScanList* list, bool scanPorts, bool debugStdErr,
+                         const PluginScanCache* cache = nullptr, int threads = 0);
 #ifdef LV2_USE_PLUGIN_CACHE
 void scanLv2Plugins(PluginScanList* list, bool scanPorts, bool debugStdErr);
 #endif
@@ -161,7 +174,9 @@ void scanAllPlugins(const QString& museGlobalLib,
                     PluginScanList* list,
                     bool scanPorts,
                     bool debugStdErr,
-                    MusEPlugin::PluginTypes_t types = MusEPlugin::PluginTypesAll);
+                    MusEPlugin::PluginTypes_t types = MusEPlugin::PluginTypesAll,
+                    const PluginScanCache* cache = nullptr,
+                    int threads = 0);
 
 //-----------------------------------------
 // Public cache writer functions
@@ -182,7 +197,11 @@ bool createPluginCacheFile(
   // The types of plugins to write into this one file.
   MusEPlugin::PluginTypes_t types = MusEPlugin::PluginTypesAll,
   // Print some stderr text
-  bool debugStdErr = false
+  bool debugStdErr = false,
+  // Entries of unchanged files, which need not be scanned again. Optional.
+  const PluginScanCache* cache = nullptr,
+  // Number of scan processes to run at the same time. Zero means one per cpu core.
+  int scanThreads = 0
 );
 
 bool createPluginCacheFiles(
@@ -197,11 +216,17 @@ bool createPluginCacheFiles(
   // The types of plugin cache files to create.
   MusEPlugin::PluginTypes_t types = MusEPlugin::PluginTypesAll,
   // Print some stderr text
-  bool debugStdErr = false
+  bool debugStdErr = false,
+  // Entries of unchanged files, which need not be scanned again. Optional.
+  const PluginScanCache* cache = nullptr,
+  // Number of scan processes to run at the same time. Zero means one per cpu core.
+  int scanThreads = 0
 );
 
 // Checks existence of given cache file types.
 // Writes ALL the given types of cache files if ANY are not found.
+// If the cache files were found but some plugin files are new or changed,
+//  only those are scanned, unless alwaysRecreate is set.
 // Returns true on success.
 bool checkPluginCacheFiles(
   // Path to the cache file directory (eg. config path + /scanner).
@@ -219,7 +244,9 @@ bool checkPluginCacheFiles(
   // The types of plugin cache files to write.
   MusEPlugin::PluginTypes_t types = MusEPlugin::PluginTypesAll,
   // Print some stderr text
-  bool debugStdErr = false
+  bool debugStdErr = false,
+  // Number of scan processes to run at the same time. Zero means one per cpu core.
+  int scanThreads = 0
 );
 
 // Write the list of plugins to a plugin cache text file.
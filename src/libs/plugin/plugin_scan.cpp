@@ -139,6 +139,7 @@ float PluginPortInfo::max(float sampleRate) const
 //=======================================================
 PluginScanInfoStruct::PluginScanInfoStruct() :
   _fileTime(0),
+  _fileSize(0),
   _fileIsBad(false),
   _type(MusEPlugin::PluginTypeNone),
   _class(MusEPlugin::PluginClassNone),
@@ -307,6 +307,8 @@ class PluginScanInfoStruct
 
     // The file's time stamp in milliseconds since epoch.
     int64_t _fileTime;
+    // The file's size in bytes.
+    int64_t _fileSize;
     // Whether the file failed scanning.
     bool _fileIsBad;
 
@@ -0,0 +1,277 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  peak_builder.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <list>
+#include <set>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStringList>
+
+#include "peak_builder.h"
+#include "wave.h"
+
+// For debugging output: Uncomment the fprintf section.
+#define DEBUG_PEAK_BUILDER(dev, format, args...) // fprintf(dev, format, ##args)
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   PeakBuilderState
+//---------------------------------------------------------
+
+struct PeakBuilderState {
+      std::vector<std::thread> _threads;
+      std::mutex _mutex;
+      // Signalled when a job is queued or the workers must quit.
+      std::condition_variable _workCond;
+      // Signalled when a running job finishes.
+      std::condition_variable _doneCond;
+      std::list<SndFile*> _queue;
+      std::set<SndFile*> _running;
+      bool _quit = false;
+      std::atomic<bool> _changed { false };
+      };
+
+static PeakBuilderState peakBuilderState;
+
+//---------------------------------------------------------
+//   automaticThreads
+//---------------------------------------------------------
+
+static int automaticThreads()
+      {
+      const int cores = std::thread::hardware_concurrency();
+      // Peak building is mostly disk bound. A few threads are plenty.
+      return std::max(1, std::min(cores, 4));
+      }
+
+//---------------------------------------------------------
+//   workerLoop
+//---------------------------------------------------------
+
+static void workerLoop()
+      {
+      PeakBuilderState& st = peakBuilderState;
+      std::unique_lock<std::mutex> lock(st._mutex);
+      while(true)
+      {
+        st._workCond.wait(lock, [&st] { return st._quit || !st._queue.empty(); });
+        if(st._quit)
+          break;
+        SndFile* sf = st._queue.front();
+        st._queue.pop_front();
+        st._running.insert(sf);
+        lock.unlock();
+
+        DEBUG_PEAK_BUILDER(stderr, "PeakBuilder: building %s\n", sf->path().toLocal8Bit().constData());
+        sf->buildPeaks();
+
+        lock.lock();
+        st._running.erase(sf);
+        st._doneCond.notify_all();
+      }
+      }
+
+//---------------------------------------------------------
+//   start
+//---------------------------------------------------------
+
+void PeakBuilder::start(int threads)
+      {
+      stop();
+      if(threads <= 0)
+        threads = automaticThreads();
+      PeakBuilderState& st = peakBuilderState;
+      st._quit = false;
+      for(int i = 0; i < threads; ++i)
+        st._threads.emplace_back(workerLoop);
+      }
+
+//---------------------------------------------------------
+//   stop
+//---------------------------------------------------------
+
+void PeakBuilder::stop()
+      {
+      PeakBuilderState& st = peakBuilderState;
+      if(st._threads.empty())
+        return;
+      {
+        std::lock_guard<std::mutex> lock(st._mutex);
+        st._quit = true;
+        st._queue.clear();
+        for(SndFile* sf : st._running)
+          sf->_peakBuildCancel.store(true);
+      }
+      st._workCond.notify_all();
+      for(std::thread& t : st._threads)
+        t.join();
+      st._threads.clear();
+      }
+
+//---------------------------------------------------------
+//   isRunning
+//---------------------------------------------------------
+
+bool PeakBuilder::isRunning()
+      {
+      return !peakBuilderState._threads.empty();
+      }
+
+//---------------------------------------------------------
+//   enqueue
+//---------------------------------------------------------
+
+void PeakBuilder::enqueue(SndFile* sf)
+      {
+      PeakBuilderState& st = peakBuilderState;
+      {
+        std::lock_guard<std::mutex> lock(st._mutex);
+        st._queue.push_back(sf);
+      }
+      st._workCond.notify_one();
+      }
+
+//---------------------------------------------------------
+//   cancel
+//---------------------------------------------------------
+
+void PeakBuilder::cancel(SndFile* sf)
+      {
+      PeakBuilderState& st = peakBuilderState;
+      std::unique_lock<std::mutex> lock(st._mutex);
+      st._queue.remove(sf);
+      if(st._running.find(sf) == st._running.end())
+        return;
+      sf->_peakBuildCancel.store(true);
+      st._doneCond.wait(lock, [&st, sf] { return st._running.find(sf) == st._running.end(); });
+      sf->_peakBuildCancel.store(false);
+      }
+
+//---------------------------------------------------------
+//   pending
+//---------------------------------------------------------
+
+int PeakBuilder::pending()
+      {
+      PeakBuilderState& st = peakBuilderState;
+      std::lock_guard<std::mutex> lock(st._mutex);
+      return st._queue.size() + st._running.size();
+      }
+
+//---------------------------------------------------------
+//   takeChanged
+//---------------------------------------------------------
+
+bool PeakBuilder::takeChanged()
+      {
+      return peakBuilderState._changed.exchange(false);
+      }
+
+//---------------------------------------------------------
+//   setChanged
+//---------------------------------------------------------
+
+void PeakBuilder::setChanged()
+      {
+      peakBuilderState._changed.store(true);
+      }
+
+//---------------------------------------------------------
+//   buildDirectory
+//---------------------------------------------------------
+
+int PeakBuilder::buildDirectory(const QString& dir, int threads, bool verbose)
+      {
+      // Collect the candidates. Anything libsndfile can open is a sound file.
+      QStringList files;
+      QDirIterator it(dir, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+      while(it.hasNext())
+      {
+        const QString path = it.next();
+        const QString suffix = it.fileInfo().suffix().toLower();
+        if(suffix == "wpk" || suffix == "wca" || suffix == "med" || suffix == "tmp")
+          continue;
+        files.append(path);
+      }
+
+      if(threads <= 0)
+        threads = automaticThreads();
+      threads = std::max(1, std::min(threads, (int)files.size()));
+
+      std::atomic<int> next(0);
+      std::atomic<int> processed(0);
+      std::mutex out_mutex;
+
+      auto work = [&]()
+      {
+        while(true)
+        {
+          const int idx = next.fetch_add(1);
+          if(idx >= files.size())
+            break;
+          const QString& path = files.at(idx);
+
+          // Rebuild peak files which are older than their sound file.
+          const QFileInfo wavinfo(path);
+          const QFileInfo peakinfo(SndFile::peakFilePath(path));
+          if(peakinfo.exists() && peakinfo.lastModified() < wavinfo.lastModified())
+            SndFile::removePeakFiles(path);
+
+          // No converters are needed just for peaks.
+          SndFile sf(path, false);
+          if(sf.openRead(false, false))
+            continue;
+          // Build in this thread.
+          sf.readCache(SndFile::peakFilePath(path), false, false);
+          sf.close();
+          ++processed;
+
+          if(verbose)
+          {
+            std::lock_guard<std::mutex> lock(out_mutex);
+            fprintf(stderr, "%s\n", path.toLocal8Bit().constData());
+          }
+        }
+      };
+
+      std::vector<std::thread> pool;
+      for(int i = 1; i < threads; ++i)
+        pool.emplace_back(work);
+      work();
+      for(std::thread& t : pool)
+        t.join();
+
+      return processed.load();
+      }
+
+} // namespace MusECore
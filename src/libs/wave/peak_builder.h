@@ -0,0 +1,72 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  peak_builder.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PEAK_BUILDER_H__
+#define __PEAK_BUILDER_H__
+
+#include <QString>
+
+namespace MusECore {
+
+class SndFile;
+
+//---------------------------------------------------------
+//   PeakBuilder
+//    A pool of worker threads which build missing peak
+//     files in the background. While a file's peaks are
+//     being built, the completed range is published so
+//     that waveforms can be drawn partially.
+//    When the pool is not running, peak files are built
+//     in the foreground as before.
+//---------------------------------------------------------
+
+class PeakBuilder {
+   public:
+      // Starts the worker threads. Zero threads means automatic.
+      static void start(int threads = 0);
+      // Stops the worker threads. Queued jobs are dropped, running jobs are cancelled.
+      static void stop();
+      static bool isRunning();
+
+      // Queues a sound file for building its peaks. Called from SndFile only.
+      static void enqueue(SndFile* sf);
+      // Removes a queued sound file, or cancels and waits for it if it is being built.
+      static void cancel(SndFile* sf);
+      // Number of queued or running jobs.
+      static int pending();
+
+      // Returns whether any peak data became available since the last call.
+      static bool takeChanged();
+      // Called by the workers when peak data became available.
+      static void setChanged();
+
+      // Builds any missing or outdated peak files of all sound files found in
+      //  a directory and its subdirectories, using the given number of threads
+      //  (zero = automatic). Returns the number of sound files processed.
+      // Call before SndFile::initWaveModule(), the sound file list is not thread-safe.
+      static int buildDirectory(const QString& dir, int threads = 0, bool verbose = false);
+      };
+
+} // namespace MusECore
+
+#endif
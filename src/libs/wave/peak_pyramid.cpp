@@ -0,0 +1,395 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  peak_pyramid.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "peak_pyramid.h"
+
+// For debugging output: Uncomment the fprintf section.
+#define ERROR_PEAK_PYRAMID(dev, format, args...) fprintf(dev, format, ##args)
+#define DEBUG_PEAK_PYRAMID(dev, format, args...) // fprintf(dev, format, ##args)
+
+namespace MusECore {
+
+static const char peakFileMagic[8] = { 'M', 'u', 's', 'E', 'P', 'e', 'a', 'k' };
+static const uint32_t peakFileVersion = 1;
+
+static_assert(sizeof(PeakFileHeader) == 80, "PeakFileHeader layout changed");
+static_assert(sizeof(SampleV) == 2, "SampleV layout changed");
+
+const int PeakPyramid::_levelMag[NumLevels] = { 128, 1024, 8192, 65536 };
+
+//---------------------------------------------------------
+//   PeakPyramid
+//---------------------------------------------------------
+
+PeakPyramid::PeakPyramid()
+      {
+      _map = nullptr;
+      _mapBytes = 0;
+      _channels = 0;
+      _frames = 0;
+      for(int i = 0; i < NumLevels; ++i)
+        _count[i] = 0;
+      }
+
+PeakPyramid::~PeakPyramid()
+      {
+      unmap();
+      }
+
+//---------------------------------------------------------
+//   levelForMag
+//---------------------------------------------------------
+
+int PeakPyramid::levelForMag(int mag)
+      {
+      for(int i = NumLevels - 1; i >= 0; --i)
+      {
+        if(mag >= _levelMag[i])
+          return i;
+      }
+      return -1;
+      }
+
+//---------------------------------------------------------
+//   unmap
+//---------------------------------------------------------
+
+void PeakPyramid::unmap()
+      {
+      if(!_map)
+        return;
+#ifndef _WIN32
+      munmap(_map, _mapBytes);
+#endif
+      _map = nullptr;
+      _mapBytes = 0;
+      }
+
+//---------------------------------------------------------
+//   clear
+//---------------------------------------------------------
+
+void PeakPyramid::clear()
+      {
+      unmap();
+      _data.clear();
+      _heap.clear();
+      _channels = 0;
+      _frames = 0;
+      for(int i = 0; i < NumLevels; ++i)
+        _count[i] = 0;
+      }
+
+//---------------------------------------------------------
+//   setupCounts
+//---------------------------------------------------------
+
+void PeakPyramid::setupCounts(int channels, sf_count_t frames)
+      {
+      _channels = channels;
+      _frames = frames;
+      for(int i = 0; i < NumLevels; ++i)
+        _count[i] = (frames + _levelMag[i] - 1) / _levelMag[i];
+      }
+
+//---------------------------------------------------------
+//   setupHeap
+//    Sizes the in-memory storage to the counts and points
+//    the data at it.
+//---------------------------------------------------------
+
+void PeakPyramid::setupHeap()
+      {
+      _heap.resize(NumLevels * _channels);
+      _data.resize(NumLevels * _channels);
+      const SampleV zero = { 0, 0 };
+      for(int l = 0; l < NumLevels; ++l)
+      {
+        for(int ch = 0; ch < _channels; ++ch)
+        {
+          SampleVtype& v = _heap[l * _channels + ch];
+          v.resize(_count[l], zero);
+          _data[l * _channels + ch] = v.data();
+        }
+      }
+      }
+
+//---------------------------------------------------------
+//   resize
+//---------------------------------------------------------
+
+void PeakPyramid::resize(int channels, sf_count_t frames)
+      {
+      if(_map)
+      {
+        // Copy the mapped data into memory first.
+        std::vector<SampleVtype> heap(NumLevels * _channels);
+        for(int l = 0; l < NumLevels; ++l)
+        {
+          for(int ch = 0; ch < _channels; ++ch)
+          {
+            const SampleV* d = data(l, ch);
+            heap[l * _channels + ch].assign(d, d + _count[l]);
+          }
+        }
+        unmap();
+        _heap.swap(heap);
+      }
+
+      if(channels != _channels)
+        _heap.clear();
+
+      setupCounts(channels, frames);
+      setupHeap();
+      }
+
+//---------------------------------------------------------
+//   updateLevels
+//---------------------------------------------------------
+
+void PeakPyramid::updateLevels(sf_count_t from, sf_count_t to)
+      {
+      if(_map || _heap.empty())
+        return;
+
+      if(to < 0 || to > _count[0])
+        to = _count[0];
+
+      for(int l = 1; l < NumLevels; ++l)
+      {
+        const int ratio = _levelMag[l] / _levelMag[l - 1];
+        from /= ratio;
+        // Include any partially covered bucket.
+        to = (to + ratio - 1) / ratio;
+        if(to > _count[l])
+          to = _count[l];
+        const sf_count_t src_count = _count[l - 1];
+        for(int ch = 0; ch < _channels; ++ch)
+        {
+          const SampleV* src = _data[(l - 1) * _channels + ch];
+          SampleV* dst = _data[l * _channels + ch];
+          for(sf_count_t i = from; i < to; ++i)
+          {
+            const sf_count_t s_beg = i * ratio;
+            sf_count_t s_end = s_beg + ratio;
+            if(s_end > src_count)
+              s_end = src_count;
+            unsigned char peak = 0;
+            int rms = 0;
+            for(sf_count_t k = s_beg; k < s_end; ++k)
+            {
+              if(src[k].peak > peak)
+                peak = src[k].peak;
+              rms += src[k].rms;
+            }
+            dst[i].peak = peak;
+            dst[i].rms = s_end > s_beg ? rms / (s_end - s_beg) : 0;
+          }
+        }
+      }
+      }
+
+//---------------------------------------------------------
+//   load
+//---------------------------------------------------------
+
+bool PeakPyramid::load(const QString& path, int channels, sf_count_t frames)
+      {
+      clear();
+      if(channels <= 0 || frames <= 0)
+        return false;
+
+      const int fd = open(path.toLocal8Bit().constData(), O_RDONLY);
+      if(fd == -1)
+        return false;
+
+      PeakFileHeader h;
+      struct stat st;
+      if(fstat(fd, &st) != 0 || read(fd, &h, sizeof(h)) != sizeof(h) ||
+         memcmp(h._magic, peakFileMagic, sizeof(peakFileMagic)) != 0 ||
+         h._version != peakFileVersion || h._levels != NumLevels ||
+         (int)h._channels != channels || h._frames != frames)
+      {
+        DEBUG_PEAK_PYRAMID(stderr, "PeakPyramid::load: %s: no match\n", path.toLocal8Bit().constData());
+        ::close(fd);
+        return false;
+      }
+
+      setupCounts(channels, frames);
+      size_t bytes = sizeof(PeakFileHeader);
+      for(int l = 0; l < NumLevels; ++l)
+      {
+        if(h._levelMag[l] != (uint32_t)_levelMag[l] || h._count[l] != _count[l])
+        {
+          ::close(fd);
+          clear();
+          return false;
+        }
+        bytes += _count[l] * _channels * sizeof(SampleV);
+      }
+      if((size_t)st.st_size != bytes)
+      {
+        ERROR_PEAK_PYRAMID(stderr, "PeakPyramid::load: %s: unexpected size\n", path.toLocal8Bit().constData());
+        ::close(fd);
+        clear();
+        return false;
+      }
+
+#ifndef _WIN32
+      void* map = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if(map == MAP_FAILED)
+      {
+        ERROR_PEAK_PYRAMID(stderr, "PeakPyramid::load: %s: mmap failed: %s\n",
+                           path.toLocal8Bit().constData(), strerror(errno));
+        clear();
+        return false;
+      }
+      _map = map;
+      _mapBytes = bytes;
+      _data.resize(NumLevels * _channels);
+      SampleV* p = (SampleV*)((char*)_map + sizeof(PeakFileHeader));
+      for(int l = 0; l < NumLevels; ++l)
+      {
+        for(int ch = 0; ch < _channels; ++ch)
+        {
+          _data[l * _channels + ch] = p;
+          p += _count[l];
+        }
+      }
+#else
+      // No mapping available. Read the data into memory.
+      setupHeap();
+      bool ok = true;
+      for(int l = 0; l < NumLevels && ok; ++l)
+      {
+        for(int ch = 0; ch < _channels && ok; ++ch)
+        {
+          const size_t n = _count[l] * sizeof(SampleV);
+          ok = read(fd, _data[l * _channels + ch], n) == (ssize_t)n;
+        }
+      }
+      ::close(fd);
+      if(!ok)
+      {
+        clear();
+        return false;
+      }
+#endif
+
+      return true;
+      }
+
+//---------------------------------------------------------
+//   loadLegacy
+//---------------------------------------------------------
+
+bool PeakPyramid::loadLegacy(const QString& path, int channels, sf_count_t frames)
+      {
+      clear();
+      if(channels <= 0 || frames <= 0)
+        return false;
+
+      FILE* cfile = fopen(path.toLocal8Bit().constData(), "r");
+      if(!cfile)
+        return false;
+
+      resize(channels, frames);
+      bool ok = true;
+      for(int ch = 0; ch < channels && ok; ++ch)
+        ok = fread(level0(ch), _count[0] * sizeof(SampleV), 1, cfile) == 1;
+      fclose(cfile);
+
+      if(!ok)
+      {
+        clear();
+        return false;
+      }
+      updateLevels();
+      return true;
+      }
+
+//---------------------------------------------------------
+//   save
+//    The file is written under a temporary name and then
+//    renamed, so that other sound files which still map an
+//    existing peak file of the same name are not disturbed.
+//---------------------------------------------------------
+
+bool PeakPyramid::save(const QString& path) const
+      {
+      if(isEmpty())
+        return false;
+
+      const QByteArray tmp_path = (path + QString(".tmp")).toLocal8Bit();
+      FILE* cfile = fopen(tmp_path.constData(), "w");
+      if(!cfile)
+        return false;
+
+      PeakFileHeader h;
+      memset(&h, 0, sizeof(h));
+      memcpy(h._magic, peakFileMagic, sizeof(peakFileMagic));
+      h._version = peakFileVersion;
+      h._channels = _channels;
+      h._frames = _frames;
+      h._levels = NumLevels;
+      for(int l = 0; l < NumLevels; ++l)
+      {
+        h._levelMag[l] = _levelMag[l];
+        h._count[l] = _count[l];
+      }
+
+      bool ok = fwrite(&h, sizeof(h), 1, cfile) == 1;
+      for(int l = 0; l < NumLevels && ok; ++l)
+      {
+        for(int ch = 0; ch < _channels && ok; ++ch)
+        {
+          if(_count[l] > 0)
+            ok = fwrite(data(l, ch), _count[l] * sizeof(SampleV), 1, cfile) == 1;
+        }
+      }
+      if(fclose(cfile) != 0)
+        ok = false;
+
+      if(ok)
+        ok = rename(tmp_path.constData(), path.toLocal8Bit().constData()) == 0;
+
+      if(!ok)
+      {
+        ERROR_PEAK_PYRAMID(stderr, "PeakPyramid::save: %s: write failed\n", path.toLocal8Bit().constData());
+        remove(tmp_path.constData());
+      }
+      return ok;
+      }
+
+} // namespace MusECore
@@ -0,0 +1,138 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  peak_pyramid.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PEAK_PYRAMID_H__
+#define __PEAK_PYRAMID_H__
+
+#include <vector>
+#include <cstdint>
+#include <sndfile.h>
+
+#include <QString>
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   SampleV
+//    peak file value
+//---------------------------------------------------------
+
+struct SampleV {
+      unsigned char peak;
+      unsigned char rms;
+      };
+
+typedef std::vector<SampleV> SampleVtype;
+
+//---------------------------------------------------------
+//   PeakFileHeader
+//    Header of a peak pyramid file (.wpk).
+//    The header is followed by the SampleV data of each
+//     level, coarser levels last, each level holding the
+//     data of all channels one after the other.
+//    Values are stored in native byte order, as with the
+//     older single level .wca files.
+//---------------------------------------------------------
+
+struct PeakFileHeader {
+      enum { NumLevels = 4 };
+      char _magic[8];
+      uint32_t _version;
+      uint32_t _channels;
+      int64_t _frames;
+      uint32_t _levels;
+      uint32_t _reserved;
+      uint32_t _levelMag[NumLevels];
+      int64_t _count[NumLevels];
+      };
+
+//---------------------------------------------------------
+//   PeakPyramid
+//    Multi-resolution peak cache of a sound file.
+//    Level n holds one SampleV per levelMag(n) frames.
+//    The data is either memory-mapped from a peak file
+//     or held in memory while it is built or grown.
+//---------------------------------------------------------
+
+class PeakPyramid {
+   public:
+      enum { NumLevels = PeakFileHeader::NumLevels };
+
+   private:
+      static const int _levelMag[NumLevels];
+
+      int _channels;
+      sf_count_t _frames;
+      sf_count_t _count[NumLevels];
+      // Pointers to the data of each level and channel, indexed by level * _channels + channel.
+      std::vector<SampleV*> _data;
+      // In-memory storage, indexed like _data. Empty when mapped.
+      std::vector<SampleVtype> _heap;
+      // The mapped peak file, if any.
+      void* _map;
+      size_t _mapBytes;
+
+      void unmap();
+      void setupCounts(int channels, sf_count_t frames);
+      void setupHeap();
+
+   public:
+      PeakPyramid();
+      ~PeakPyramid();
+
+      // Frames per SampleV at the given level.
+      static int levelMag(int level) { return _levelMag[level]; }
+      // Returns the coarsest level whose buckets are not larger than mag frames,
+      //  or -1 if mag is smaller than the finest level.
+      static int levelForMag(int mag);
+
+      void clear();
+      bool isEmpty() const { return _data.empty(); }
+      bool isMapped() const { return _map != nullptr; }
+      int channels() const { return _channels; }
+      sf_count_t frames() const { return _frames; }
+      sf_count_t count(int level) const { return _count[level]; }
+      const SampleV* data(int level, int channel) const { return _data[level * _channels + channel]; }
+
+      // Makes the pyramid hold the given number of frames in memory, keeping any
+      //  existing data. Mapped data is copied. New buckets are zeroed.
+      void resize(int channels, sf_count_t frames);
+      // Writable finest level data of a channel. Only valid after resize().
+      SampleV* level0(int channel) { return _heap[channel].data(); }
+      // Recomputes the coarser levels from the finest level buckets from 'from' up to,
+      //  not including, 'to'. A negative 'to' means up to the end.
+      void updateLevels(sf_count_t from = 0, sf_count_t to = -1);
+
+      // Maps a peak file. Returns true on success. Fails if the file does not
+      //  match the given channels and frames, or has an unknown version.
+      bool load(const QString& path, int channels, sf_count_t frames);
+      // Reads an older single level .wca peak file into memory and builds
+      //  the coarser levels. Returns true on success.
+      bool loadLegacy(const QString& path, int channels, sf_count_t frames);
+      // Writes the pyramid to a peak file. Returns true on success.
+      bool save(const QString& path) const;
+      };
+
+} // namespace MusECore
+
+#endif
@@ -0,0 +1,431 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  record_writer.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+
+#include "record_writer.h"
+
+// For debugging output: Uncomment the fprintf section.
+#define DEBUG_RECORD_WRITER(dev, format, args...) // fprintf(dev, format, ##args)
+
+namespace MusECore {
+
+// Room for the file header when preallocating.
+static const int64_t headerSlack = 4096;
+// Data older than this is written even if it is less than a full write,
+//  so that live waveform display keeps moving.
+static const int64_t maxWaitMs = 250;
+
+//---------------------------------------------------------
+//   RecordWriterState
+//---------------------------------------------------------
+
+struct RecordWriterState {
+      std::thread _thread;
+      bool _running = false;
+      std::mutex _mutex;
+      // Signalled when there is work or the writer must quit.
+      std::condition_variable _workCond;
+      // Signalled after each pass over the streams.
+      std::condition_variable _doneCond;
+      std::vector<RecordStream*> _streams;
+      std::atomic<bool> _wake { false };
+      bool _quit = false;
+      unsigned _sampleRate = 0;
+      unsigned _writeFrames = 0;
+      int _preallocSeconds = 0;
+      };
+
+static RecordWriterState recordWriterState;
+
+//---------------------------------------------------------
+//   nowMs
+//---------------------------------------------------------
+
+static int64_t nowMs()
+      {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+      }
+
+//---------------------------------------------------------
+//   bytesPerFrame
+//---------------------------------------------------------
+
+static int bytesPerFrame(int format, int channels)
+      {
+      switch(format & SF_FORMAT_SUBMASK)
+      {
+        case SF_FORMAT_PCM_S8:
+        case SF_FORMAT_PCM_U8:
+          return channels;
+        case SF_FORMAT_PCM_16:
+          return 2 * channels;
+        case SF_FORMAT_PCM_24:
+          return 3 * channels;
+        case SF_FORMAT_DOUBLE:
+          return 8 * channels;
+        default:
+          return 4 * channels;
+      }
+      }
+
+//---------------------------------------------------------
+//   RecordStream
+//---------------------------------------------------------
+
+RecordStream::RecordStream(SndFileR file, int channels, unsigned blockFrames, unsigned capacityFrames,
+                           bool liveWaveUpdate, int64_t preallocAhead)
+   : _file(file), _channels(channels), _blockFrames(blockFrames),
+     _head(0), _tail(0), _flush(false), _liveWaveUpdate(liveWaveUpdate),
+     _fd(-1), _allocated(0), _preallocAhead(preallocAhead),
+     _worstBacklog(0), _worstWriteUs(0), _overruns(0)
+      {
+      _capacity = ((capacityFrames + blockFrames - 1) / blockFrames) * blockFrames;
+      _buffers.resize(_channels);
+      for(int ch = 0; ch < _channels; ++ch)
+        _buffers[ch] = new float[_capacity];
+      _positions.resize(_capacity / _blockFrames, 0);
+      _bytesPerFrame = bytesPerFrame(_file.format(), _file.channels());
+      _lastWriteMs = nowMs();
+
+#ifdef FALLOC_FL_KEEP_SIZE
+      _fd = ::open(_file.path().toLocal8Bit().constData(), O_WRONLY | O_CLOEXEC);
+#endif
+      }
+
+RecordStream::~RecordStream()
+      {
+      releasePreallocation();
+      for(float* buf : _buffers)
+        delete[] buf;
+      }
+
+//---------------------------------------------------------
+//   preallocate
+//    Reserves disk space without changing the file size,
+//     so that the file system need not find free blocks
+//     while recording.
+//---------------------------------------------------------
+
+void RecordStream::preallocate(int64_t bytes)
+      {
+      if(_fd < 0 || bytes <= _allocated)
+        return;
+#ifdef FALLOC_FL_KEEP_SIZE
+      if(fallocate(_fd, FALLOC_FL_KEEP_SIZE, 0, bytes) == 0)
+      {
+        DEBUG_RECORD_WRITER(stderr, "RecordStream: preallocated %lld bytes for %s\n",
+                            (long long)bytes, _file.path().toLocal8Bit().constData());
+        _allocated = bytes;
+        return;
+      }
+      // Not supported by the file system. Don't try again.
+      DEBUG_RECORD_WRITER(stderr, "RecordStream: fallocate failed: %s\n", strerror(errno));
+      ::close(_fd);
+      _fd = -1;
+#endif
+      }
+
+//---------------------------------------------------------
+//   releasePreallocation
+//    Gives back the reserved space past the end of the file.
+//---------------------------------------------------------
+
+void RecordStream::releasePreallocation()
+      {
+      if(_fd < 0)
+        return;
+      struct stat st;
+      if(_allocated > 0 && fstat(_fd, &st) == 0 && st.st_size < _allocated)
+      {
+        if(ftruncate(_fd, st.st_size) != 0)
+          fprintf(stderr, "RecordStream: Error releasing preallocated space of %s\n",
+                  _file.path().toLocal8Bit().constData());
+      }
+      ::close(_fd);
+      _fd = -1;
+      _allocated = 0;
+      }
+
+//---------------------------------------------------------
+//   put
+//---------------------------------------------------------
+
+bool RecordStream::put(sf_count_t pos, float** src)
+      {
+      const uint64_t head = _head.load(std::memory_order_relaxed);
+      const uint64_t tail = _tail.load(std::memory_order_acquire);
+      if(head - tail + _blockFrames > _capacity)
+      {
+        _overruns.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+
+      const unsigned idx = head % _capacity;
+      for(int ch = 0; ch < _channels; ++ch)
+        memcpy(_buffers[ch] + idx, src[ch], _blockFrames * sizeof(float));
+      _positions[idx / _blockFrames] = pos;
+      _head.store(head + _blockFrames, std::memory_order_release);
+
+      const unsigned bl = head + _blockFrames - tail;
+      if(bl > _worstBacklog.load(std::memory_order_relaxed))
+        _worstBacklog.store(bl, std::memory_order_relaxed);
+      if(bl >= RecordWriter::writeFrames())
+        RecordWriter::wake();
+      return true;
+      }
+
+//---------------------------------------------------------
+//   backlog
+//---------------------------------------------------------
+
+unsigned RecordStream::backlog() const
+      {
+      return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+      }
+
+//---------------------------------------------------------
+//   stats
+//---------------------------------------------------------
+
+RecordStreamStats RecordStream::stats() const
+      {
+      RecordStreamStats s;
+      s.backlog = backlog();
+      s.capacity = _capacity;
+      s.worstBacklog = _worstBacklog.load(std::memory_order_relaxed);
+      s.worstWriteMs = double(_worstWriteUs.load(std::memory_order_relaxed)) / 1000.0;
+      s.overruns = _overruns.load(std::memory_order_relaxed);
+      return s;
+      }
+
+//---------------------------------------------------------
+//   write
+//---------------------------------------------------------
+
+void RecordStream::write(bool all, unsigned writeFrames)
+      {
+      float* ptrs[_channels];
+      const int64_t now = nowMs();
+      while(true)
+      {
+        const uint64_t tail = _tail.load(std::memory_order_relaxed);
+        const uint64_t avail = _head.load(std::memory_order_acquire) - tail;
+        if(avail == 0)
+          break;
+        if(!all && avail < writeFrames && now - _lastWriteMs < maxWaitMs)
+          break;
+
+        // Gather consecutive blocks, up to the end of the ring and up to
+        //  the next multiple of writeFrames in the file.
+        const unsigned idx = tail % _capacity;
+        const sf_count_t pos = _positions[idx / _blockFrames];
+        const uint64_t limit = std::min<uint64_t>(std::min<uint64_t>(
+                                 writeFrames - (pos % writeFrames), _capacity - idx), avail);
+        unsigned frames = _blockFrames;
+        while(frames + _blockFrames <= limit && _positions[(idx + frames) / _blockFrames] == pos + frames)
+          frames += _blockFrames;
+
+        const int64_t end_bytes = (pos + frames) * _bytesPerFrame + headerSlack;
+        if(end_bytes > _allocated)
+          preallocate(end_bytes + _preallocAhead);
+
+        for(int ch = 0; ch < _channels; ++ch)
+          ptrs[ch] = _buffers[ch] + idx;
+
+        const auto t0 = std::chrono::steady_clock::now();
+        _file.seek(pos, SEEK_SET);
+        _file.write(_channels, ptrs, frames, _liveWaveUpdate);
+        const int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - t0).count();
+        if(us > _worstWriteUs.load(std::memory_order_relaxed))
+          _worstWriteUs.store(us, std::memory_order_relaxed);
+
+        DEBUG_RECORD_WRITER(stderr, "RecordStream::write: pos:%ld frames:%u us:%ld\n", (long)pos, frames, (long)us);
+
+        _tail.store(tail + frames, std::memory_order_release);
+        _lastWriteMs = now;
+      }
+      }
+
+//---------------------------------------------------------
+//   writerLoop
+//---------------------------------------------------------
+
+void RecordWriter::writerLoop()
+      {
+      RecordWriterState& st = recordWriterState;
+      std::unique_lock<std::mutex> lock(st._mutex);
+      while(true)
+      {
+        // Also wake up regularly, for data which waited too long.
+        st._workCond.wait_for(lock, std::chrono::milliseconds(maxWaitMs / 2),
+                              [&st] { return st._quit || st._wake.load(); });
+        st._wake.store(false);
+        const bool quit = st._quit;
+        for(RecordStream* s : st._streams)
+          s->write(quit || s->_flush.load(), st._writeFrames);
+        st._doneCond.notify_all();
+        if(quit)
+          break;
+      }
+      }
+
+//---------------------------------------------------------
+//   start
+//---------------------------------------------------------
+
+void RecordWriter::start(unsigned sampleRate, unsigned writeFrames, int preallocSeconds)
+      {
+      stop();
+      RecordWriterState& st = recordWriterState;
+      st._sampleRate = sampleRate;
+      st._writeFrames = std::max(1U, writeFrames);
+      st._preallocSeconds = preallocSeconds;
+      st._quit = false;
+      st._running = true;
+      st._thread = std::thread(writerLoop);
+      }
+
+//---------------------------------------------------------
+//   stop
+//---------------------------------------------------------
+
+void RecordWriter::stop()
+      {
+      RecordWriterState& st = recordWriterState;
+      if(!st._running)
+        return;
+      {
+        std::lock_guard<std::mutex> lock(st._mutex);
+        st._quit = true;
+      }
+      st._workCond.notify_all();
+      st._thread.join();
+      st._running = false;
+      }
+
+//---------------------------------------------------------
+//   isRunning
+//---------------------------------------------------------
+
+bool RecordWriter::isRunning()
+      {
+      return recordWriterState._running;
+      }
+
+//---------------------------------------------------------
+//   addStream
+//---------------------------------------------------------
+
+RecordStream* RecordWriter::addStream(SndFileR file, int channels, unsigned blockFrames,
+                                      unsigned capacityFrames, bool liveWaveUpdate)
+      {
+      RecordWriterState& st = recordWriterState;
+      if(!st._running || blockFrames == 0 || !file.isOpen())
+        return nullptr;
+
+      // Room for at least two full writes, so that one can fill while the other is written.
+      capacityFrames = std::max(capacityFrames, 2 * st._writeFrames + blockFrames);
+      const int bpf = bytesPerFrame(file.format(), file.channels());
+      const int64_t ahead = int64_t(st._preallocSeconds) * st._sampleRate * bpf;
+
+      // Hand the whole run to libsndfile at once.
+      file.setWriteSegSize(st._writeFrames);
+
+      RecordStream* s = new RecordStream(file, channels, blockFrames, capacityFrames, liveWaveUpdate, ahead);
+      s->preallocate(headerSlack + ahead);
+
+      std::lock_guard<std::mutex> lock(st._mutex);
+      st._streams.push_back(s);
+      return s;
+      }
+
+//---------------------------------------------------------
+//   removeStream
+//---------------------------------------------------------
+
+bool RecordWriter::removeStream(RecordStream* stream, int timeoutMs)
+      {
+      if(!stream)
+        return true;
+      RecordWriterState& st = recordWriterState;
+      bool res = true;
+      {
+        std::unique_lock<std::mutex> lock(st._mutex);
+        if(st._running)
+        {
+          stream->_flush.store(true);
+          st._wake.store(true);
+          st._workCond.notify_one();
+          res = st._doneCond.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                      [stream] { return stream->backlog() == 0; });
+        }
+        else
+        {
+          res = stream->backlog() == 0;
+        }
+        st._streams.erase(std::remove(st._streams.begin(), st._streams.end(), stream), st._streams.end());
+      }
+
+      if(!res)
+        fprintf(stderr, "RecordWriter::removeStream: Error: Timeout writing %u frames to %s\n",
+                stream->backlog(), stream->file().path().toLocal8Bit().constData());
+      delete stream;
+      return res;
+      }
+
+//---------------------------------------------------------
+//   wake
+//---------------------------------------------------------
+
+void RecordWriter::wake()
+      {
+      RecordWriterState& st = recordWriterState;
+      st._wake.store(true);
+      st._workCond.notify_one();
+      }
+
+//---------------------------------------------------------
+//   writeFrames
+//---------------------------------------------------------
+
+unsigned RecordWriter::writeFrames()
+      {
+      return recordWriterState._writeFrames;
+      }
+
+} // namespace MusECore
@@ -0,0 +1,153 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  record_writer.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __RECORD_WRITER_H__
+#define __RECORD_WRITER_H__
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+#include <sndfile.h>
+
+#include "wave.h"
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   RecordStreamStats
+//---------------------------------------------------------
+
+struct RecordStreamStats {
+      // Frames waiting to be written.
+      unsigned backlog = 0;
+      // Size of the buffer in frames.
+      unsigned capacity = 0;
+      // Highest backlog seen since recording started.
+      unsigned worstBacklog = 0;
+      // Longest single write, in milliseconds.
+      double worstWriteMs = 0.0;
+      // Number of blocks dropped because the buffer was full.
+      unsigned overruns = 0;
+      };
+
+//---------------------------------------------------------
+//   RecordStream
+//    A deep single producer, single consumer buffer between
+//     a track's recording fifo and its sound file.
+//    The prefetch thread puts blocks of recorded audio
+//     along with their file positions. The RecordWriter
+//     thread writes runs of consecutive blocks to the
+//     file in large writes.
+//---------------------------------------------------------
+
+class RecordStream {
+      friend class RecordWriter;
+
+      SndFileR _file;
+      int _channels;
+      unsigned _blockFrames;
+      unsigned _capacity;      // In frames, a whole number of blocks.
+      // One ring buffer per channel.
+      std::vector<float*> _buffers;
+      // The file position of each block in the ring.
+      std::vector<sf_count_t> _positions;
+      // Total frames put and written. Only the producer writes _head, only the writer writes _tail.
+      std::atomic<uint64_t> _head;
+      std::atomic<uint64_t> _tail;
+      // Whether everything must be written now, regardless of the write size.
+      std::atomic<bool> _flush;
+
+      bool _liveWaveUpdate;
+
+      // For preallocating the file's disk space.
+      int _fd;
+      int64_t _allocated;
+      int _bytesPerFrame;
+      // How far ahead of the writes to preallocate, in bytes.
+      int64_t _preallocAhead;
+
+      std::atomic<unsigned> _worstBacklog;
+      std::atomic<int64_t> _worstWriteUs;
+      std::atomic<unsigned> _overruns;
+      // When the writer last wrote, in milliseconds of the writer's clock.
+      int64_t _lastWriteMs;
+
+      void preallocate(int64_t bytes);
+      void releasePreallocation();
+      // Writes runs of consecutive blocks to the file. Unless all is true, only
+      //  full runs of writeFrames or data which waited too long. Writer thread only.
+      void write(bool all, unsigned writeFrames);
+
+   public:
+      // The file must already be open for writing. Called from the GUI thread.
+      RecordStream(SndFileR file, int channels, unsigned blockFrames, unsigned capacityFrames,
+                   bool liveWaveUpdate, int64_t preallocAhead);
+      ~RecordStream();
+
+      // Copies one block of blockFrames frames to the buffer, to be written at file position pos.
+      // Called from the prefetch thread. Returns false if the buffer is full and the block was dropped.
+      bool put(sf_count_t pos, float** src);
+      // Frames waiting to be written.
+      unsigned backlog() const;
+      RecordStreamStats stats() const;
+      SndFileR file() const { return _file; }
+      };
+
+//---------------------------------------------------------
+//   RecordWriter
+//    A thread which writes all record streams to disk.
+//    While it is not running, recording is written to the
+//     sound files directly by the prefetch thread as before.
+//---------------------------------------------------------
+
+class RecordWriter {
+      static void writerLoop();
+
+   public:
+      // Starts the writer thread. Writes are made in runs of up to writeFrames frames,
+      //  aligned to whole multiples of writeFrames in the file where possible.
+      // File space is preallocated preallocSeconds ahead of the writes.
+      static void start(unsigned sampleRate, unsigned writeFrames, int preallocSeconds);
+      // Stops the writer thread. Any remaining streams are written out first.
+      static void stop();
+      static bool isRunning();
+
+      // Creates a stream for an open sound file and adds it to the writer.
+      // Returns null if the writer is not running. Called from the GUI thread.
+      // If liveWaveUpdate is true, the file's peaks are updated with each write.
+      static RecordStream* addStream(SndFileR file, int channels, unsigned blockFrames,
+                                     unsigned capacityFrames, bool liveWaveUpdate);
+      // Waits for the stream to be written out, for at most timeoutMs milliseconds,
+      //  then removes and deletes it. Returns false on timeout. Called from the GUI thread.
+      static bool removeStream(RecordStream* stream, int timeoutMs = 10000);
+
+      // Called by the producer when a stream has enough data for a write.
+      static void wake();
+      // The write size.
+      static unsigned writeFrames();
+      };
+
+} // namespace MusECore
+
+#endif
@@ -23,6 +23,8 @@
 
 
 #include <cstring>
+#include <vector>
+#include <algorithm>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -33,6 +35,8 @@
 #include <QFile>
 
 #include "wave.h"
+#include "peak_builder.h"
+#include "wave_blocks.h"
 #include "type_defs.h"
 
 // For debugging output: Uncomment the fprintf section.
@@ -171,9 +175,10 @@ SndFile::SndFile(
       finfo = new QFileInfo(name);
       sf    = nullptr;
       sfUI  = nullptr;
-      csize = 0;
-      cache = nullptr;
       openFlag = false;
+      _peaksReady = 0;
+      _peakBuildCancel = false;
+      _blocks = nullptr;
       if(_sndFiles)
         _sndFiles->push_back(this);
       refCount = 0;
@@ -208,9 +213,10 @@ SndFile::SndFile(
       finfo = nullptr;
       sf    = nullptr;
       sfUI  = nullptr;
-      csize = 0;
-      cache = nullptr;
       openFlag = false;
+      _peaksReady = 0;
+      _peakBuildCancel = false;
+      _blocks = nullptr;
       //if(_sndFiles)
       //  _sndFiles->push_back(this);
       refCount = 0;
@@ -228,6 +234,8 @@ SndFile::~SndFile()
       DEBUG_WAVE(stderr, "SndFile dtor this:%p\n", this);
       if (openFlag)
             close();
+      if(_blocks)
+        _blocks->release();
       if(_sndFiles)
       {
         for (iSndFile i = _sndFiles->begin(); i != _sndFiles->end(); ++i) {
@@ -240,8 +248,6 @@ SndFile::~SndFile()
       }
       if(finfo)
         delete finfo;
-      if (cache)
-        delete[] cache;
       if(writeBuffer)
          delete [] writeBuffer;
 
@@ -336,6 +342,18 @@ bool SndFile::openRead(bool createCache, bool showProgress)
               return true;
           }
         }
+        // Join the block store of the file, if it is being edited through another SndFile.
+        if(!_blocks)
+        {
+          _blocks = WaveBlockStore::acquire(canonicalPath());
+          if(_blocks && _blocks->channels() != sfinfo.channels)
+          {
+            _blocks->release();
+            _blocks = nullptr;
+          }
+        }
+        if(_blocks && openBlockHandles())
+          return true;
       }
       // Memory based:
       else
@@ -374,9 +392,12 @@ bool SndFile::openRead(bool createCache, bool showProgress)
       writeFlag = false;
       openFlag  = true;
 
-      if (finfo && createCache) {
-        QString cacheName = finfo->absolutePath() + QString("/") + finfo->completeBaseName() + QString(".wca");
-        readCache(cacheName, showProgress);
+      if (finfo && createCache)
+      {
+        readCache(peakFilePath(path()), showProgress);
+        // The peak file describes the sound file itself.
+        if(hasBlockEdits())
+          updateBlockPeaks(nullptr);
       }
       return false;
       }
@@ -586,21 +607,50 @@ void SndFile::update(bool showProgress)
 
       close();
 
-      // force recreation of wca data
-      QString cacheName = finfo->absolutePath() +
-         QString("/") + finfo->completeBaseName() + QString(".wca");
-      QFile::remove(cacheName);
+      // force recreation of peak data
+      removePeakFiles(path());
       if (openRead(true, showProgress)) {
             ERROR_WAVE(stderr, "SndFile::update openRead(%s) failed: %s\n", path().toLocal8Bit().constData(), strerror().toLocal8Bit().constData());
             }
       }
 
+//---------------------------------------------------------
+//   peakFilePath
+//---------------------------------------------------------
+
+QString SndFile::peakFilePath(const QString& soundFilePath)
+{
+   const QFileInfo fi(soundFilePath);
+   return fi.absolutePath() + QString("/") + fi.completeBaseName() + QString(".wpk");
+}
+
+//---------------------------------------------------------
+//   legacyPeakFilePath
+//---------------------------------------------------------
+
+QString SndFile::legacyPeakFilePath(const QString& soundFilePath)
+{
+   const QFileInfo fi(soundFilePath);
+   return fi.absolutePath() + QString("/") + fi.completeBaseName() + QString(".wca");
+}
+
+//---------------------------------------------------------
+//   removePeakFiles
+//---------------------------------------------------------
+
+void SndFile::removePeakFiles(const QString& soundFilePath)
+{
+   QFile::remove(peakFilePath(soundFilePath));
+   QFile::remove(legacyPeakFilePath(soundFilePath));
+}
+
 //---------------------------------------------------
 //  create cache
 //---------------------------------------------------
 
 void SndFile::createCache(const QString& path, bool showProgress, bool bWrite, sf_count_t cstart)
 {
+   const sf_count_t csize = _peaks.count(0);
    if(!finfo || cstart >= csize)
       return;
    QProgressDialog* progress = nullptr;
@@ -616,8 +666,12 @@ void SndFile::createCache(const QString& path, bool showProgress, bool bWrite, s
    const int srcChannels = channels();
    float data[srcChannels][cacheMag];
    float* fp[srcChannels];
+   SampleV* cache[srcChannels];
    for (int k = 0; k < srcChannels; ++k)
+   {
       fp[k] = &data[k][0];
+      cache[k] = _peaks.level0(k);
+   }
    int interval = (csize - cstart) / 10;
 
    if(!interval)
@@ -646,6 +700,7 @@ void SndFile::createCache(const QString& path, bool showProgress, bool bWrite, s
          cache[ch][i].rms = rmsValue;
       }
    }
+   _peaks.updateLevels(cstart);
    if (showProgress)
       progress->setValue(csize);
    if(bWrite)
@@ -659,36 +714,154 @@ void SndFile::createCache(const QString& path, bool showProgress, bool bWrite, s
 //   readCache
 //---------------------------------------------------------
 
-void SndFile::readCache(const QString& path, bool showProgress)
+void SndFile::readCache(const QString& path, bool showProgress, bool background)
 {
    if(!finfo)
      return;
 
-   if (cache) {
-      delete[] cache;
-   }
+   PeakBuilder::cancel(this);
+   _peaksReady.store(0, std::memory_order_release);
+   _peaks.clear();
    if (samples() == 0)
       return;
 
    const int srcChannels = channels();
-   
-   csize = (samples() + cacheMag - 1)/cacheMag;
-   cache = new SampleVtype[srcChannels];
-   for (int ch = 0; ch < srcChannels; ++ch)
+
+   // Peak files describe the sound file itself. Any copy-on-write edits
+   //  are applied on top of them, and never saved to them.
+   const bool edited = hasBlockEdits();
+
+   if(_peaks.load(path, srcChannels, samples()))
    {
-      cache [ch].resize(csize);
+      _peaksReady.store(samples(), std::memory_order_release);
+      if(edited)
+         blockMapChanged(nullptr);
+      return;
    }
 
-   FILE* cfile = fopen(path.toLocal8Bit().constData(), "r");
-   if (cfile) {
-      for (int ch = 0; ch < srcChannels; ++ch)
-         fread(&cache[ch] [0], csize * sizeof(SampleV), 1, cfile);
-      fclose(cfile);
+   // Convert an older single level peak file if there is one.
+   const QFileInfo pinfo(path);
+   const QString legacyPath = pinfo.absolutePath() + QString("/") + pinfo.completeBaseName() + QString(".wca");
+   if(!_peaks.loadLegacy(legacyPath, srcChannels, samples()))
+   {
+      _peaks.resize(srcChannels, samples());
+      // Files opened for writing may grow while recording, keep those in the foreground.
+      // The builder reads the sound file itself, so edited files are also built here.
+      if(background && !writeFlag && !edited && PeakBuilder::isRunning())
+      {
+         _peakBuildPath = path;
+         _peakBuildCancel.store(false);
+         PeakBuilder::enqueue(this);
+         return;
+      }
+      // This reads through the block store, edits included.
+      createCache(path, showProgress, false);
+      _peaksReady.store(samples(), std::memory_order_release);
+      if(edited)
+         return;
+   }
+   else
+   {
+      _peaksReady.store(samples(), std::memory_order_release);
+      if(edited)
+      {
+         blockMapChanged(nullptr);
+         return;
+      }
+   }
+
+   // Prefer the mapped file over the in-memory data, if it could be written.
+   if(_peaks.save(path) && _peaks.load(path, srcChannels, samples()))
+      return;
+   if(_peaks.isEmpty())
+   {
+      _peaks.resize(srcChannels, samples());
+      createCache(path, false, false);
+   }
+}
+
+//---------------------------------------------------------
+//   buildPeaks
+//    Called from a PeakBuilder thread. Reads the file in
+//    large sequential blocks with a separate handle, and
+//    publishes each completed block.
+//---------------------------------------------------------
+
+void SndFile::buildPeaks()
+{
+   const sf_count_t csize = _peaks.count(0);
+   const int srcChannels = _peaks.channels();
+   if(csize <= 0 || srcChannels <= 0)
+      return;
+
+   SF_INFO info;
+   info.format = 0;
+   SNDFILE* bsf = sf_open(path().toLocal8Bit().constData(), SFM_READ, &info);
+   if(!bsf)
+   {
+      ERROR_WAVE(stderr, "SndFile::buildPeaks: cannot open %s\n", path().toLocal8Bit().constData());
+      return;
+   }
+   if(info.channels != srcChannels)
+   {
+      sf_close(bsf);
       return;
    }
 
+   // Number of finest level buckets read at once.
+   const sf_count_t blockBuckets = 512;
+   std::vector<float> buffer(blockBuckets * cacheMag * srcChannels);
+   bool cancelled = false;
+
+   for(sf_count_t b = 0; b < csize; b += blockBuckets)
+   {
+      if(_peakBuildCancel.load())
+      {
+         cancelled = true;
+         break;
+      }
+
+      const sf_count_t nb = std::min(blockBuckets, csize - b);
+      const sf_count_t frames = nb * cacheMag;
+      sf_count_t rn = sf_readf_float(bsf, buffer.data(), frames);
+      if(rn < 0)
+         rn = 0;
+      if(rn < frames)
+         std::fill(buffer.begin() + rn * srcChannels, buffer.begin() + frames * srcChannels, 0.0f);
+
+      for (int ch = 0; ch < srcChannels; ++ch) {
+         SampleV* cache = _peaks.level0(ch);
+         for (sf_count_t i = 0; i < nb; ++i) {
+            const float* src = buffer.data() + i * cacheMag * srcChannels + ch;
+            float rms = 0.0;
+            int peak = 0;
+            for (int n = 0; n < cacheMag; n++) {
+               const float fd = src[n * srcChannels];
+               rms += fd * fd;
+               int idata = int(fd * 255.0);
+               if (idata < 0)
+                  idata = -idata;
+               if (peak < idata)
+                  peak = idata;
+            }
+            // amplify rms value +12dB
+            int rmsValue = int((sqrt(rms/cacheMag) * 255.0));
+            if (rmsValue > 255)
+               rmsValue = 255;
+            cache[b + i].peak = peak > 255 ? 255 : peak;
+            cache[b + i].rms = rmsValue;
+         }
+      }
+
+      _peaks.updateLevels(b, b + nb);
+      _peaksReady.store(std::min((b + nb) * cacheMag, _peaks.frames()), std::memory_order_release);
+      PeakBuilder::setChanged();
+   }
+
+   sf_close(bsf);
 
-   createCache(path, showProgress, true);
+   if(!cancelled)
+      _peaks.save(_peakBuildPath);
 }
 
 //---------------------------------------------------------
@@ -700,13 +873,49 @@ void SndFile::writeCache(const QString& path)
       if(!finfo)
         return;
 
-      FILE* cfile = fopen(path.toLocal8Bit().constData(), "w");
-      if (cfile == 0)
+      _peaks.save(path);
+      }
+
+//---------------------------------------------------------
+//   readPeaks
+//    Reads the peak cache, at the coarsest level which
+//    still resolves mag frames.
+//---------------------------------------------------------
+
+void SndFile::readPeaks(SampleV* s, int mag, sf_count_t pos, bool overwrite) const
+      {
+      const int level = PeakPyramid::levelForMag(mag);
+      if(level < 0 || _peaks.isEmpty())
             return;
-      const int srcChannels = channels();
-      for (int ch = 0; ch < srcChannels; ++ch)
-            fwrite(&cache[ch] [0], csize * sizeof(SampleV), 1, cfile);
-      fclose(cfile);
+
+      const int srcChannels = std::min(channels(), _peaks.channels());
+      const int levelMag = PeakPyramid::levelMag(level);
+      // All the buckets which the frames [pos, pos + mag) touch, even partly.
+      const sf_count_t off  = pos / levelMag;
+      const sf_count_t buckets = (pos + mag + levelMag - 1) / levelMag - off;
+      // While the peaks are built in the background only part of them is available.
+      const sf_count_t ready = peaksReady();
+      const sf_count_t avail = ready >= _peaks.frames() ? _peaks.count(level) : ready / levelMag;
+      const sf_count_t rest = avail - off;
+      sf_count_t end  = buckets;
+      if (rest < buckets)
+            end = rest;
+
+      for (int ch = 0; ch < srcChannels; ++ch) {
+            const SampleV* cache = _peaks.data(level, ch);
+            int rms = 0;
+            for (sf_count_t offset = off; offset < off+end; offset++) {
+                  rms += cache[offset].rms;
+                  if (s[ch].peak < cache[offset].peak)
+                        s[ch].peak = cache[offset].peak;
+                        }
+
+            if(overwrite)
+              s[ch].rms = rms / buckets;
+
+            else
+              s[ch].rms += rms / buckets;
+            }
       }
 
 //---------------------------------------------------------
@@ -802,29 +1011,8 @@ void SndFile::read(SampleV* s, int mag, unsigned pos, bool overwrite, bool allow
                     s[ch].rms = 0;    // TODO rms / mag;
                   }
             }
-      else {
-            mag /= cacheMag;
-            int rest = csize - (pos/cacheMag);
-            int end  = mag;
-            if (rest < mag)
-                  end = rest;
-
-            for (int ch = 0; ch < srcChannels; ++ch) {
-                  int rms = 0;
-                  int off = pos/cacheMag;
-                  for (int offset = off; offset < off+end; offset++) {
-                        rms += cache[ch][offset].rms;
-                        if (s[ch].peak < cache[ch][offset].peak)
-                              s[ch].peak = cache[ch][offset].peak;
-                              }
-
-                  if(overwrite)
-                    s[ch].rms = rms / mag;
-
-                  else
-                    s[ch].rms += rms / mag;
-                  }
-            }
+      else
+            readPeaks(s, mag, pos, overwrite);
       }
 
 //---------------------------------------------------------
@@ -899,29 +1087,8 @@ void SndFile::readConverted(SampleV* s, int mag, sf_count_t pos, sf_count_t offs
                     s[ch].rms = 0;    // TODO rms / mag;
                   }
             }
-      else {
-            mag /= cacheMag;
-            sf_count_t rest = csize - ((offset + convertPosition(pos))/cacheMag);
-            sf_count_t end  = mag;
-            if (rest < mag)
-                  end = rest;
-
-            for (int ch = 0; ch < srcChannels; ++ch) {
-                  int rms = 0;
-                  sf_count_t off = (offset + convertPosition(pos))/cacheMag;
-                  for (sf_count_t offset = off; offset < off+end; offset++) {
-                        rms += cache[ch][offset].rms;
-                        if (s[ch].peak < cache[ch][offset].peak)
-                              s[ch].peak = cache[ch][offset].peak;
-                              }
-
-                  if(overwrite)
-                    s[ch].rms = rms / mag;
-
-                  else
-                    s[ch].rms += rms / mag;
-                  }
-            }
+      else
+            readPeaks(s, mag, offset + convertPosition(pos), overwrite);
       }
 
 //---------------------------------------------------------
@@ -941,6 +1108,9 @@ bool SndFile::openWrite()
         const QString p = path();
         if(p.isEmpty())
           return true;
+        // Direct writes must not be hidden by copy-on-write edits.
+        if(hasBlockEdits() && commitBlocks())
+          return true;
         sf = sf_open(p.toLocal8Bit().constData(), SFM_RDWR, &sfinfo);
       }
       // Memory based:
@@ -959,11 +1129,7 @@ bool SndFile::openWrite()
             openFlag  = true;
             writeFlag = true;
             if(finfo)
-            {
-              QString cacheName = finfo->absolutePath() +
-                QString("/") + finfo->completeBaseName() + QString(".wca");
-              readCache(cacheName, true);
-            }
+              readCache(peakFilePath(path()), true);
           }
       return !sf;
       }
@@ -975,11 +1141,22 @@ bool SndFile::openWrite()
 void SndFile::close()
       {
       DEBUG_WAVE(stderr, "SndFile::close this:%p\n", this);
+      // Stop any background peak build first, it reads the file.
+      PeakBuilder::cancel(this);
       if (!openFlag) {
             DEBUG_WAVE(stderr, "SndFile:: alread closed\n");
             return;
             }
-      if(int err = sf_close(sf))
+      if(_blocks && !writeFlag)
+      {
+        // Handles reading through the block store.
+        _blocks->closeHandle(sf);
+        sf = nullptr;
+        if(sfUI)
+          _blocks->closeHandle(sfUI);
+        sfUI = nullptr;
+      }
+      else if(int err = sf_close(sf))
       {
         err += 0; // Touch.
         ERROR_WAVE(stderr, "SndFile::close Error:%d on sf_close(sf:%p)\n", err, sf);
@@ -1391,47 +1568,359 @@ size_t SndFile::realWrite(int srcChannels, float** src, size_t n, size_t offs, b
 
    if(liveWaveUpdate)
    { //update cache
-      if(!cache)
-      {
-         cache = new SampleVtype[sfinfo.channels];
-         csize = 0;
-      }
+      const sf_count_t startFrame = sfinfo.frames;
       sf_count_t cstart = (sfinfo.frames + cacheMag - 1) / cacheMag;
       sfinfo.frames += n;
-      csize = (sfinfo.frames + cacheMag - 1) / cacheMag;
-      for (int ch = 0; ch < sfinfo.channels; ++ch)
-      {
-         cache [ch].resize(csize);
-      }
+      _peaks.resize(sfinfo.channels, sfinfo.frames);
+      const sf_count_t csize = _peaks.count(0);
 
       for (int i = cstart; i < csize; i++)
       {
+         // Where the bucket starts in the write buffer, which may hold several buckets.
+         const sf_count_t boffs = i * cacheMag - startFrame;
+         const int blen = std::min((sf_count_t)cacheMag, (sf_count_t)n - boffs);
          for (int ch = 0; ch < sfinfo.channels; ++ch)
          {
+            SampleV* cache = _peaks.level0(ch);
             float rms = 0.0;
-            cache[ch][i].peak = 0;
-            for (int n = 0; n < cacheMag; n++)
+            cache[i].peak = 0;
+            for (int n = 0; n < blen; n++)
             {
                //float fd = data[ch][n];
-               float fd = writeBuffer [n * sfinfo.channels + ch];
+               float fd = writeBuffer [(boffs + n) * sfinfo.channels + ch];
+               rms += fd * fd;
+               int idata = int(fd * 255.0);
+               if (idata < 0)
+                  idata = -idata;
+               if (cache[i].peak < idata)
+                  cache[i].peak = idata;
+            }
+            // amplify rms value +12dB
+            int rmsValue = blen > 0 ? int((sqrt(rms/blen) * 255.0)) : 0;
+            if (rmsValue > 255)
+               rmsValue = 255;
+            cache[i].rms = rmsValue;
+         }
+      }
+      _peaks.updateLevels(cstart);
+      _peaksReady.store(sfinfo.frames, std::memory_order_release);
+   }
+
+   return nbr;
+}
+
+//---------------------------------------------------------
+//   setWriteSegSize
+//---------------------------------------------------------
+
+void SndFile::setWriteSegSize(size_t frames)
+{
+   // Keep it a whole number of peak cache buckets.
+   frames = ((std::max(frames, (size_t)cacheMag) + cacheMag - 1) / cacheMag) * cacheMag;
+   if(frames == writeSegSize)
+      return;
+   writeSegSize = frames;
+   if(writeBuffer)
+   {
+      delete [] writeBuffer;
+      writeBuffer = new float [writeSegSize * std::max(2, sfinfo.channels)];
+   }
+}
+
+//---------------------------------------------------------
+//   openBlockHandles
+//    Replaces the sound file handles with handles which
+//    read through the block store.
+//---------------------------------------------------------
+
+bool SndFile::openBlockHandles()
+{
+   SNDFILE* h = _blocks->openHandle(sf);
+   if(!h)
+   {
+      sf_close(sf);
+      sf = nullptr;
+      if(sfUI)
+         sf_close(sfUI);
+      sfUI = nullptr;
+      return true;
+   }
+   sf = h;
+   if(sfUI)
+   {
+      h = _blocks->openHandle(sfUI);
+      if(!h)
+      {
+         sf_close(sfUI);
+         _blocks->closeHandle(sf);
+         sf = nullptr;
+         sfUI = nullptr;
+         return true;
+      }
+      sfUI = h;
+   }
+   return false;
+}
+
+//---------------------------------------------------------
+//   createBlockStore
+//---------------------------------------------------------
+
+bool SndFile::createBlockStore(const QString& sidePath)
+{
+   if(_blocks)
+      return false;
+   if(!finfo || !openFlag || writeFlag)
+      return true;
+   const QString cpath = canonicalPath();
+   WaveBlockStore* store = WaveBlockStore::acquire(cpath, sidePath);
+   if(!store)
+      return true;
+   if(useBlockStore(store))
+   {
+      store->release();
+      return true;
+   }
+   // The other open SndFile objects of the file must read through the same store,
+   //  or they would not see the edits.
+   if(_sndFiles)
+   {
+      for(SndFile* f : *_sndFiles)
+      {
+         if(f == this || f->_blocks || !f->finfo || !f->openFlag || f->writeFlag ||
+            f->canonicalPath() != cpath)
+            continue;
+         WaveBlockStore* s = WaveBlockStore::acquire(cpath);
+         if(f->useBlockStore(s))
+         {
+            ERROR_WAVE(stderr, "SndFile::createBlockStore: %s will not show the edits\n",
+                       cpath.toLocal8Bit().constData());
+            s->release();
+         }
+      }
+   }
+   return false;
+}
+
+//---------------------------------------------------------
+//   useBlockStore
+//---------------------------------------------------------
+
+bool SndFile::useBlockStore(WaveBlockStore* store)
+{
+   if(store->channels() != sfinfo.channels)
+      return true;
+   _blocks = store;
+   // Called while audio is idle, so the handles can be swapped while open.
+   SNDFILE* oldSf = sf;
+   SNDFILE* oldSfUI = sfUI;
+   const QByteArray p = path().toLocal8Bit();
+   SF_INFO info;
+   info.format = 0;
+   sf = sf_open(p.constData(), SFM_READ, &info);
+   info.format = 0;
+   sfUI = (sf && oldSfUI) ? sf_open(p.constData(), SFM_READ, &info) : nullptr;
+   if(!sf || (oldSfUI && !sfUI))
+   {
+      if(sf)
+         sf_close(sf);
+      sf = nullptr;
+   }
+   if(!sf || openBlockHandles())
+   {
+      ERROR_WAVE(stderr, "SndFile::useBlockStore: cannot read %s through the block store\n",
+                 p.constData());
+      sf = oldSf;
+      sfUI = oldSfUI;
+      _blocks = nullptr;
+      return true;
+   }
+   sf_close(oldSf);
+   if(oldSfUI)
+      sf_close(oldSfUI);
+   // The store may already hold edits made through another SndFile.
+   if(hasBlockEdits())
+      updateBlockPeaks(nullptr);
+   return false;
+}
+
+//---------------------------------------------------------
+//   newBlockMap
+//---------------------------------------------------------
+
+WaveBlockMap* SndFile::newBlockMap()
+{
+   return _blocks ? _blocks->newMap(_blocks->current()) : nullptr;
+}
+
+//---------------------------------------------------------
+//   readBlocks
+//---------------------------------------------------------
+
+size_t SndFile::readBlocks(const WaveBlockMap* map, sf_count_t pos, int dstChannels, float** dst, size_t n)
+{
+   if(!_blocks)
+      return 0;
+   return _blocks->read(map, pos, dstChannels, dst, n);
+}
+
+//---------------------------------------------------------
+//   writeBlocks
+//---------------------------------------------------------
+
+bool SndFile::writeBlocks(WaveBlockMap* map, sf_count_t pos, int srcChannels, float** src, size_t n)
+{
+   if(!_blocks || !map)
+      return true;
+   return !_blocks->write(map, pos, srcChannels, src, n);
+}
+
+//---------------------------------------------------------
+//   blockMap
+//---------------------------------------------------------
+
+WaveBlockMap* SndFile::blockMap() const
+{
+   return _blocks ? _blocks->current() : nullptr;
+}
+
+//---------------------------------------------------------
+//   setBlockMap
+//---------------------------------------------------------
+
+WaveBlockMap* SndFile::setBlockMap(WaveBlockMap* map)
+{
+   if(!_blocks || !map)
+      return nullptr;
+   return _blocks->setCurrent(map);
+}
+
+//---------------------------------------------------------
+//   hasBlockEdits
+//---------------------------------------------------------
+
+bool SndFile::hasBlockEdits() const
+{
+   return _blocks && _blocks->current()->editedBlocks() != 0;
+}
+
+//---------------------------------------------------------
+//   updatePeaks
+//---------------------------------------------------------
+
+void SndFile::updatePeaks(sf_count_t pos, sf_count_t frames)
+{
+   const int srcChannels = _peaks.channels();
+   const sf_count_t csize = _peaks.count(0);
+   const sf_count_t cstart = pos / cacheMag;
+   const sf_count_t cend = std::min((pos + frames + cacheMag - 1) / cacheMag, csize);
+   if(cstart >= cend || !_blocks)
+      return;
+
+   // Whole blocks at a time.
+   const sf_count_t chunk = WaveBlockStore::BlockFrames / cacheMag;
+   std::vector<float> data(chunk * cacheMag * srcChannels);
+   float* fp[srcChannels];
+   for (int ch = 0; ch < srcChannels; ++ch)
+      fp[ch] = data.data() + ch * chunk * cacheMag;
+
+   const WaveBlockMap* map = _blocks->current();
+   for(sf_count_t b = cstart; b < cend; b += chunk)
+   {
+      const sf_count_t nb = std::min(chunk, cend - b);
+      const sf_count_t rn = _blocks->read(map, b * cacheMag, srcChannels, fp, nb * cacheMag);
+      for (int ch = 0; ch < srcChannels; ++ch) {
+         std::fill(fp[ch] + rn, fp[ch] + nb * cacheMag, 0.0f);
+         SampleV* cache = _peaks.level0(ch);
+         for (sf_count_t i = 0; i < nb; ++i) {
+            const float* src = fp[ch] + i * cacheMag;
+            float rms = 0.0;
+            int peak = 0;
+            for (int n = 0; n < cacheMag; n++) {
+               const float fd = src[n];
                rms += fd * fd;
                int idata = int(fd * 255.0);
                if (idata < 0)
                   idata = -idata;
-               if (cache[ch][i].peak < idata)
-                  cache[ch][i].peak = idata;
+               if (peak < idata)
+                  peak = idata;
             }
             // amplify rms value +12dB
             int rmsValue = int((sqrt(rms/cacheMag) * 255.0));
             if (rmsValue > 255)
                rmsValue = 255;
-            cache[ch][i].rms = rmsValue;
+            cache[b + i].peak = peak > 255 ? 255 : peak;
+            cache[b + i].rms = rmsValue;
          }
       }
+   }
+   _peaks.updateLevels(cstart, cend);
+}
+
+//---------------------------------------------------------
+//   blockMapChanged
+//    Only the peaks of the blocks which changed are
+//    recomputed.
+//---------------------------------------------------------
 
+void SndFile::blockMapChanged(const WaveBlockMap* prev)
+{
+   if(!_blocks)
+      return;
+   if(!_sndFiles)
+   {
+      updateBlockPeaks(prev);
+      return;
    }
+   for(SndFile* f : *_sndFiles)
+   {
+      if(f->_blocks == _blocks)
+         f->updateBlockPeaks(prev);
+   }
+}
 
-   return nbr;
+//---------------------------------------------------------
+//   updateBlockPeaks
+//---------------------------------------------------------
+
+void SndFile::updateBlockPeaks(const WaveBlockMap* prev)
+{
+   if(!_blocks || _peaks.isEmpty())
+      return;
+
+   // The background build reads the sound file itself. Finish it here instead.
+   const sf_count_t ready = peaksReady();
+   if(ready < samples())
+      PeakBuilder::cancel(this);
+   // Mapped peak data belongs to the peak file, edit a copy.
+   if(_peaks.isMapped())
+      _peaks.resize(_peaks.channels(), _peaks.frames());
+   if(ready < samples())
+   {
+      const sf_count_t from = (ready / cacheMag) * cacheMag;
+      updatePeaks(from, samples() - from);
+      _peaksReady.store(samples(), std::memory_order_release);
+   }
+
+   _blocks->forEachChange(prev, _blocks->current(),
+      [this](sf_count_t first, sf_count_t frames) { updatePeaks(first, frames); });
+   PeakBuilder::setChanged();
+}
+
+//---------------------------------------------------------
+//   commitBlocks
+//---------------------------------------------------------
+
+bool SndFile::commitBlocks()
+{
+   if(!hasBlockEdits())
+      return false;
+   if(!_blocks->commit())
+      return true;
+   // The peaks now describe the sound file itself.
+   if(!_peaks.isEmpty() && peaksReady() >= samples())
+      _peaks.save(peakFilePath(path()));
+   return false;
 }
 
 //---------------------------------------------------------
@@ -1542,6 +2031,23 @@ SndFile* SndFileList::search(const QString& name)
       return nullptr;
       }
 
+//---------------------------------------------------------
+//   commitBlocks
+//---------------------------------------------------------
+
+bool SndFileList::commitBlocks()
+      {
+      bool err = false;
+      for (iSndFile i = begin(); i != end(); ++i) {
+            if ((*i)->commitBlocks()) {
+                  ERROR_WAVE(stderr, "SndFileList::commitBlocks: cannot write edits to %s\n",
+                             (*i)->path().toLocal8Bit().constData());
+                  err = true;
+                  }
+            }
+      return err;
+      }
+
 // DELETETHIS 170
 #if 0
 //---------------------------------------------------------
@@ -1853,6 +2359,22 @@ size_t SndFileR::readDirect(float* f, size_t n) { return sf ? sf->readDirect(f,
 size_t SndFileR::write(int channel, float** f, size_t n, bool liveWaveUpdate /*= false*/) {
       return sf ? sf->write(channel, f, n, liveWaveUpdate) : 0;
       }
+void SndFileR::setWriteSegSize(size_t frames) { if(sf) sf->setWriteSegSize(frames); }
+
+bool SndFileR::createBlockStore(const QString& sidePath) { return sf ? sf->createBlockStore(sidePath) : true; }
+bool SndFileR::hasBlockStore() const { return sf ? sf->hasBlockStore() : false; }
+WaveBlockMap* SndFileR::newBlockMap() { return sf ? sf->newBlockMap() : nullptr; }
+size_t SndFileR::readBlocks(const WaveBlockMap* map, sf_count_t pos, int dstChannels, float** dst, size_t n) {
+      return sf ? sf->readBlocks(map, pos, dstChannels, dst, n) : 0;
+      }
+bool SndFileR::writeBlocks(WaveBlockMap* map, sf_count_t pos, int srcChannels, float** src, size_t n) {
+      return sf ? sf->writeBlocks(map, pos, srcChannels, src, n) : true;
+      }
+WaveBlockMap* SndFileR::blockMap() const { return sf ? sf->blockMap() : nullptr; }
+WaveBlockMap* SndFileR::setBlockMap(WaveBlockMap* map) { return sf ? sf->setBlockMap(map) : nullptr; }
+void SndFileR::blockMapChanged(const WaveBlockMap* prev) { if(sf) sf->blockMapChanged(prev); }
+bool SndFileR::hasBlockEdits() const { return sf ? sf->hasBlockEdits() : false; }
+bool SndFileR::commitBlocks() { return sf ? sf->commitBlocks() : false; }
 
 sf_count_t SndFileR::readConverted(sf_count_t pos, int channel,
                           float** buffer, sf_count_t frames, bool overwrite) {
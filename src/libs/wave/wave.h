@@ -35,6 +35,7 @@
 #include <QFileInfo>
 
 #include "muse_time.h"
+#include "peak_pyramid.h"
 #include "time_stretch.h"
 #include "audio_convert/audio_converter_plugin.h"
 #include "audio_convert/audio_converter_settings_group.h"
@@ -58,19 +59,9 @@ class SndFileVirtualData
       : _virtualData(virtualData), _virtualBytes(virtualBytes), _virtualCurPos(0) { }
 };
 
-//---------------------------------------------------------
-//   SampleV
-//    peak file value
-//---------------------------------------------------------
-
-struct SampleV {
-      unsigned char peak;
-      unsigned char rms;
-      };
-
-typedef std::vector<SampleV> SampleVtype;
-
 class SndFileList;
+class WaveBlockStore;
+class WaveBlockMap;
 
 //---------------------------------------------------------
 //   SndFile
@@ -93,21 +84,44 @@ class SndFile {
       bool _useConverter;
 
       SF_INFO sfinfo;
-      SampleVtype* cache;
-      sf_count_t csize;                    //!< frames in cache
+      PeakPyramid _peaks;
+      // Number of frames covered by the peak data so far. Grows while the peaks
+      //  are built in the background.
+      std::atomic<sf_count_t> _peaksReady;
+      // Set to stop a background peak build early.
+      std::atomic<bool> _peakBuildCancel;
+      // Where a background peak build writes the peak file.
+      QString _peakBuildPath;
 
       // For virtual (memory or stream) operation:
       SndFileVirtualData _virtualData;
 
+      // Copy-on-write store of destructive edits, if any, shared with the other
+      //  SndFile objects of the file. While it exists sf and sfUI read through
+      //  its current block map.
+      WaveBlockStore* _blocks;
+
       float *writeBuffer;
       size_t writeSegSize;
 
       void writeCache(const QString& path);
+      // Reads peak values of mag frames from the peak cache.
+      void readPeaks(SampleV* s, int mag, sf_count_t pos, bool overwrite) const;
 
       bool openFlag;
       bool writeFlag;
       size_t readInternal(int srcChannels, float** dst, size_t n, bool overwrite, float *buffer);
       size_t realWrite(int srcChannels, float** src, size_t n, size_t offs = 0, bool liveWaveUpdate = false);
+      // Recomputes the finest level peaks of frames from pos and the coarser levels above them,
+      //  reading through the block store.
+      void updatePeaks(sf_count_t pos, sf_count_t frames);
+      // Replaces sf and sfUI with handles reading through the block store. Returns true on error.
+      bool openBlockHandles();
+      // Switches the open handles over to a store, taking over one of its users.
+      //  Returns true on error, and the caller still has the user.
+      bool useBlockStore(WaveBlockStore* store);
+      // Rebuilds the peaks of the blocks which differ between prev and the current map.
+      void updateBlockPeaks(const WaveBlockMap* prev);
       
    protected:
       std::atomic_int refCount;
@@ -156,8 +170,25 @@ class SndFile {
       // For virtual (memory or stream) operation.
       SndFileVirtualData& virtualData() { return _virtualData; }
 
+      // Builds the peak cache from the sound file, starting at finest level bucket cstart.
       void createCache(const QString& path, bool showProgress, bool bWrite, sf_count_t cstart = 0);
-      void readCache(const QString& path, bool progress);
+      // Maps the peak file at path, falling back to an older .wca peak file of the same
+      //  base name, or builds and writes the peak file if neither is usable.
+      // If background is true and the PeakBuilder is running, a read-only file's peaks
+      //  are built in the background and become available progressively.
+      void readCache(const QString& path, bool progress, bool background = true);
+      // Builds the peaks into the pre-sized pyramid, reading the file with a separate handle.
+      // Called from a PeakBuilder thread.
+      void buildPeaks();
+      // Number of frames for which peak data is available.
+      sf_count_t peaksReady() const { return _peaksReady.load(std::memory_order_acquire); }
+
+      // The peak file path of a sound file path.
+      static QString peakFilePath(const QString& soundFilePath);
+      // The older single level peak file path of a sound file path.
+      static QString legacyPeakFilePath(const QString& soundFilePath);
+      // Removes all peak files belonging to a sound file path.
+      static void removePeakFiles(const QString& soundFilePath);
 
       // Creates a new converter based on the supplied settings and AudioConverterSettings::ModeType mode.
       // If isLocalSettings is true, settings is treated as a local settings which may override the 
@@ -226,8 +257,35 @@ class SndFile {
       size_t readWithHeap(int channel, float**, size_t, bool overwrite = true);
       size_t readDirect(float* buf, size_t n)    { return sf_readf_float(sf, buf, n); }
       size_t write(int channel, float**, size_t, bool liveWaveUpdate /*= false*/);
+      // Sets the most frames handed to libsndfile by one write. Not while another thread writes.
+      void setWriteSegSize(size_t frames);
       size_t writeDirect(float *buf, size_t n) { return sf_writef_float(sf, buf, n); }
 
+      // Copy-on-write editing. Edits are written to blocks of a side file and only
+      //  reach the sound file itself with commitBlocks().
+      // Starts copy-on-write editing with the side file at sidePath. The file must be
+      //  open for reading. Audio must be idle. Returns true on error.
+      bool createBlockStore(const QString& sidePath);
+      bool hasBlockStore() const { return _blocks != nullptr; }
+      // Starts an edit. Returns a new block map based on the current one, or null
+      //  if there is no block store.
+      WaveBlockMap* newBlockMap();
+      // Reads n frames from pos as described by a block map.
+      size_t readBlocks(const WaveBlockMap* map, sf_count_t pos, int dstChannels, float** dst, size_t n);
+      // Writes n frames at pos into the blocks of a map from newBlockMap(). Returns true on error.
+      bool writeBlocks(WaveBlockMap* map, sf_count_t pos, int srcChannels, float** src, size_t n);
+      // The current block map, or null if there is no block store.
+      WaveBlockMap* blockMap() const;
+      // Makes a block map current and returns the previous one. Called from the audio thread.
+      WaveBlockMap* setBlockMap(WaveBlockMap* map);
+      // Rebuilds the peaks of the blocks which differ between prev and the current map,
+      //  in all SndFile objects sharing the block store.
+      void blockMapChanged(const WaveBlockMap* prev);
+      // Whether the current block map holds edits not yet in the sound file.
+      bool hasBlockEdits() const;
+      // Writes the edits into the sound file. Audio must be idle. Returns true on error.
+      bool commitBlocks();
+
       // For now I must provide separate routines here, don't want to upset anything else.
       // Reads realtime audio converted if a samplerate or shift/stretch converter is active. Otherwise a normal read.
       sf_count_t readConverted(sf_count_t pos, int srcChannels,
@@ -259,6 +317,7 @@ class SndFile {
       double maxPitchShiftRatio() const;
 
       friend class SndFileR;
+      friend class PeakBuilder;
       };
 
 //---------------------------------------------------------
@@ -378,6 +437,18 @@ class SndFileR {
       size_t readDirect(float* f, size_t n);
 
       size_t write(int channel, float** f, size_t n, bool liveWaveUpdate /*= false*/);
+      void setWriteSegSize(size_t frames);
+
+      bool createBlockStore(const QString& sidePath);
+      bool hasBlockStore() const;
+      WaveBlockMap* newBlockMap();
+      size_t readBlocks(const WaveBlockMap* map, sf_count_t pos, int dstChannels, float** dst, size_t n);
+      bool writeBlocks(WaveBlockMap* map, sf_count_t pos, int srcChannels, float** src, size_t n);
+      WaveBlockMap* blockMap() const;
+      WaveBlockMap* setBlockMap(WaveBlockMap* map);
+      void blockMapChanged(const WaveBlockMap* prev);
+      bool hasBlockEdits() const;
+      bool commitBlocks();
 
       // For now I must provide separate routines here, don't want to upset anything else.
       // Reads realtime audio converted if a samplerate or shift/stretch converter is active. Otherwise a normal read.
@@ -417,6 +488,9 @@ class SndFileR {
 class SndFileList : public std::list<SndFile*> {
    public:
       SndFile* search(const QString& name);
+      // Writes the copy-on-write edits of all files into the files. Audio must be idle.
+      // Returns true if any file failed.
+      bool commitBlocks();
       // void clearDelete(); // clearDelete MUST NOT exist! deleting is handled by the refcounting SndFileRs!
                              // this SndFileList is just for information, consider it as "weak pointers"
       };
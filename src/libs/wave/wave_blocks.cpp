@@ -0,0 +1,520 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  wave_blocks.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <map>
+
+#include "wave_blocks.h"
+
+// For debugging output: Uncomment the fprintf section.
+#define ERROR_WAVE_BLOCKS(dev, format, args...) fprintf(dev, format, ##args)
+#define DEBUG_WAVE_BLOCKS(dev, format, args...) // fprintf(dev, format, ##args)
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   WaveBlockCursor
+//    State of a read handle opened by openHandle().
+//    libsndfile reads the data as raw native floats
+//     through the virtual io functions below.
+//---------------------------------------------------------
+
+struct WaveBlockCursor {
+      WaveBlockStore* _store;
+      // The handle on the sound file itself, for unedited blocks.
+      SNDFILE* _orig;
+      // The handle given out.
+      SNDFILE* _handle;
+      // Position in bytes.
+      sf_count_t _pos;
+      std::vector<float> _buffer;
+      };
+
+static sf_count_t blocks_vio_get_filelen(void* user_data)
+{
+  const WaveBlockCursor* c = (const WaveBlockCursor*)user_data;
+  return c->_store->frames() * c->_store->channels() * (sf_count_t)sizeof(float);
+}
+
+static sf_count_t blocks_vio_seek(sf_count_t offset, int whence, void* user_data)
+{
+  WaveBlockCursor* c = (WaveBlockCursor*)user_data;
+  const sf_count_t len = blocks_vio_get_filelen(user_data);
+  sf_count_t pos;
+  switch(whence)
+  {
+    case SEEK_CUR:
+      pos = c->_pos + offset;
+    break;
+    case SEEK_END:
+      pos = len + offset;
+    break;
+    default:
+      pos = offset;
+    break;
+  }
+  if(pos < 0 || pos > len)
+    return -1;
+  c->_pos = pos;
+  return pos;
+}
+
+static sf_count_t blocks_vio_read(void* ptr, sf_count_t count, void* user_data)
+{
+  WaveBlockCursor* c = (WaveBlockCursor*)user_data;
+  const sf_count_t len = blocks_vio_get_filelen(user_data);
+  if(count <= 0 || c->_pos >= len)
+    return 0;
+  if(c->_pos + count > len)
+    count = len - c->_pos;
+
+  // libsndfile may ask for part of a frame. Read whole frames and copy out the bytes.
+  const int channels = c->_store->channels();
+  const sf_count_t frameBytes = channels * (sf_count_t)sizeof(float);
+  const sf_count_t first = c->_pos / frameBytes;
+  const sf_count_t last = (c->_pos + count + frameBytes - 1) / frameBytes;
+  const sf_count_t frames = last - first;
+  if((sf_count_t)c->_buffer.size() < frames * channels)
+    c->_buffer.resize(frames * channels);
+
+  // Load the map once, so that a read is never split over two maps.
+  const WaveBlockMap* map = c->_store->current();
+  c->_store->readInterleaved(map, c->_orig, first, c->_buffer.data(), frames);
+  memcpy(ptr, (const char*)c->_buffer.data() + (c->_pos - first * frameBytes), count);
+  c->_pos += count;
+  return count;
+}
+
+static sf_count_t blocks_vio_write(const void*, sf_count_t, void*)
+{
+  return 0;
+}
+
+static sf_count_t blocks_vio_tell(void* user_data)
+{
+  return ((const WaveBlockCursor*)user_data)->_pos;
+}
+
+static SF_VIRTUAL_IO blocks_vio
+{
+  blocks_vio_get_filelen,
+  blocks_vio_seek,
+  blocks_vio_read,
+  blocks_vio_write,
+  blocks_vio_tell
+};
+
+//---------------------------------------------------------
+//   editedBlocks
+//---------------------------------------------------------
+
+size_t WaveBlockMap::editedBlocks() const
+      {
+      size_t n = 0;
+      for (int64_t s : _slots)
+            if (s >= 0)
+                  ++n;
+      return n;
+      }
+
+//---------------------------------------------------------
+//   WaveBlockStore
+//---------------------------------------------------------
+
+// The stores by canonical path of their sound file.
+static std::map<QString, WaveBlockStore*> blockStores;
+
+WaveBlockStore::WaveBlockStore(const QString& path, const QString& sidePath)
+   : _path(path), _sidePath(sidePath), _fd(-1), _channels(0), _samplerate(0),
+     _frames(0), _slotCount(0), _orig(nullptr), _current(nullptr), _refs(0)
+      {
+      SF_INFO info;
+      memset(&info, 0, sizeof(info));
+      _orig = sf_open(path.toLocal8Bit().constData(), SFM_READ, &info);
+      if (!_orig) {
+            ERROR_WAVE_BLOCKS(stderr, "WaveBlockStore: cannot open %s: %s\n",
+               path.toLocal8Bit().constData(), sf_strerror(nullptr));
+            return;
+            }
+      _channels = info.channels;
+      _samplerate = info.samplerate;
+      _frames = info.frames;
+
+      _fd = ::open(sidePath.toLocal8Bit().constData(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (_fd < 0)
+            ERROR_WAVE_BLOCKS(stderr, "WaveBlockStore: cannot create %s: %s\n",
+               sidePath.toLocal8Bit().constData(), strerror(errno));
+
+      _block.resize((size_t)BlockFrames * _channels);
+      WaveBlockMap* map = new WaveBlockMap((_frames + BlockFrames - 1) / BlockFrames, 0);
+      _maps.push_back(map);
+      _current.store(map, std::memory_order_release);
+      }
+
+WaveBlockStore::~WaveBlockStore()
+      {
+      while (!_cursors.empty())
+            closeHandle(_cursors.back()->_handle);
+      if (_orig)
+            sf_close(_orig);
+      if (_fd >= 0) {
+            ::close(_fd);
+            ::unlink(_sidePath.toLocal8Bit().constData());
+            }
+      for (WaveBlockMap* m : _maps)
+            delete m;
+      }
+
+//---------------------------------------------------------
+//   acquire
+//---------------------------------------------------------
+
+WaveBlockStore* WaveBlockStore::acquire(const QString& path, const QString& sidePath)
+      {
+      if (path.isEmpty())
+            return nullptr;
+      auto i = blockStores.find(path);
+      if (i != blockStores.end()) {
+            ++i->second->_refs;
+            return i->second;
+            }
+      if (sidePath.isEmpty())
+            return nullptr;
+      WaveBlockStore* store = new WaveBlockStore(path, sidePath);
+      if (!store->isValid()) {
+            delete store;
+            return nullptr;
+            }
+      store->_refs = 1;
+      blockStores[path] = store;
+      return store;
+      }
+
+//---------------------------------------------------------
+//   release
+//---------------------------------------------------------
+
+void WaveBlockStore::release()
+      {
+      if (--_refs > 0)
+            return;
+      blockStores.erase(_path);
+      delete this;
+      }
+
+//---------------------------------------------------------
+//   blockFrames
+//    The last block may be short.
+//---------------------------------------------------------
+
+sf_count_t WaveBlockStore::blockFrames(size_t block) const
+      {
+      const sf_count_t start = (sf_count_t)block * BlockFrames;
+      return std::min((sf_count_t)BlockFrames, _frames - start);
+      }
+
+//---------------------------------------------------------
+//   setCurrent
+//---------------------------------------------------------
+
+WaveBlockMap* WaveBlockStore::setCurrent(WaveBlockMap* map)
+      {
+      return _current.exchange(map, std::memory_order_acq_rel);
+      }
+
+//---------------------------------------------------------
+//   newMap
+//---------------------------------------------------------
+
+WaveBlockMap* WaveBlockStore::newMap(const WaveBlockMap* base)
+      {
+      WaveBlockMap* map = new WaveBlockMap((_frames + BlockFrames - 1) / BlockFrames, _slotCount);
+      if (base)
+            map->_slots = base->_slots;
+      _maps.push_back(map);
+      return map;
+      }
+
+//---------------------------------------------------------
+//   readBlock
+//---------------------------------------------------------
+
+bool WaveBlockStore::readBlock(const WaveBlockMap* map, SNDFILE* orig, size_t block,
+   sf_count_t offset, float* dst, sf_count_t frames) const
+      {
+      const int64_t slot = map ? map->slot(block) : -1;
+      sf_count_t got = 0;
+      if (slot < 0) {
+            if (sf_seek(orig, (sf_count_t)block * BlockFrames + offset, SEEK_SET) >= 0) {
+                  got = sf_readf_float(orig, dst, frames);
+                  if (got < 0)
+                        got = 0;
+                  }
+            }
+      else {
+            const size_t frameBytes = _channels * sizeof(float);
+            const size_t bytes = frames * frameBytes;
+            off_t where = (off_t)slot * slotBytes() + offset * frameBytes;
+            size_t done = 0;
+            while (done < bytes) {
+                  const ssize_t n = ::pread(_fd, (char*)dst + done, bytes - done, where + done);
+                  if (n < 0 && errno == EINTR)
+                        continue;
+                  if (n <= 0)
+                        break;
+                  done += n;
+                  }
+            got = done / frameBytes;
+            }
+      if (got < frames) {
+            memset(dst + got * _channels, 0, (frames - got) * _channels * sizeof(float));
+            return false;
+            }
+      return true;
+      }
+
+//---------------------------------------------------------
+//   writeSlot
+//---------------------------------------------------------
+
+bool WaveBlockStore::writeSlot(int64_t slot, const float* src, sf_count_t frames)
+      {
+      const size_t bytes = frames * _channels * sizeof(float);
+      const off_t where = (off_t)slot * slotBytes();
+      size_t done = 0;
+      while (done < bytes) {
+            const ssize_t n = ::pwrite(_fd, (const char*)src + done, bytes - done, where + done);
+            if (n < 0 && errno == EINTR)
+                  continue;
+            if (n <= 0) {
+                  ERROR_WAVE_BLOCKS(stderr, "WaveBlockStore: write to %s failed: %s\n",
+                     _sidePath.toLocal8Bit().constData(), strerror(errno));
+                  return false;
+                  }
+            done += n;
+            }
+      return true;
+      }
+
+//---------------------------------------------------------
+//   readInterleaved
+//---------------------------------------------------------
+
+sf_count_t WaveBlockStore::readInterleaved(const WaveBlockMap* map, SNDFILE* orig, sf_count_t pos,
+   float* dst, sf_count_t frames) const
+      {
+      if (pos < 0 || pos >= _frames)
+            return 0;
+      if (pos + frames > _frames)
+            frames = _frames - pos;
+      sf_count_t done = 0;
+      while (done < frames) {
+            const size_t block = (pos + done) / BlockFrames;
+            const sf_count_t offset = (pos + done) % BlockFrames;
+            const sf_count_t n = std::min(frames - done, (sf_count_t)BlockFrames - offset);
+            readBlock(map, orig, block, offset, dst + done * _channels, n);
+            done += n;
+            }
+      return frames;
+      }
+
+//---------------------------------------------------------
+//   read
+//---------------------------------------------------------
+
+sf_count_t WaveBlockStore::read(const WaveBlockMap* map, sf_count_t pos, int dstChannels, float** dst, sf_count_t frames)
+      {
+      if (!isValid() || pos < 0 || pos >= _frames)
+            return 0;
+      if (pos + frames > _frames)
+            frames = _frames - pos;
+      sf_count_t done = 0;
+      while (done < frames) {
+            const sf_count_t n = std::min(frames - done, (sf_count_t)BlockFrames);
+            readInterleaved(map, _orig, pos + done, _block.data(), n);
+            for (int ch = 0; ch < dstChannels; ++ch) {
+                  const float* s = _block.data() + std::min(ch, _channels - 1);
+                  float* d = dst[ch] + done;
+                  for (sf_count_t i = 0; i < n; ++i)
+                        d[i] = s[i * _channels];
+                  }
+            done += n;
+            }
+      return frames;
+      }
+
+//---------------------------------------------------------
+//   write
+//---------------------------------------------------------
+
+bool WaveBlockStore::write(WaveBlockMap* map, sf_count_t pos, int srcChannels, float** src, sf_count_t frames)
+      {
+      if (!isValid() || pos < 0 || srcChannels <= 0)
+            return false;
+      if (pos + frames > _frames)
+            frames = _frames - pos;
+      sf_count_t done = 0;
+      while (done < frames) {
+            const size_t block = (pos + done) / BlockFrames;
+            const sf_count_t offset = (pos + done) % BlockFrames;
+            const sf_count_t len = blockFrames(block);
+            const sf_count_t n = std::min(frames - done, len - offset);
+
+            // Complete a partly covered block with its current data.
+            if (n < len)
+                  readBlock(map, _orig, block, 0, _block.data(), len);
+            for (int ch = 0; ch < _channels; ++ch) {
+                  const float* s = src[std::min(ch, srcChannels - 1)] + done;
+                  float* d = _block.data() + offset * _channels + ch;
+                  for (sf_count_t i = 0; i < n; ++i)
+                        d[i * _channels] = s[i];
+                  }
+
+            int64_t slot = map->_slots[block];
+            if (slot < map->_firstOwnSlot)
+                  slot = _slotCount++;
+            if (!writeSlot(slot, _block.data(), len))
+                  return false;
+            map->_slots[block] = slot;
+            done += n;
+            }
+      DEBUG_WAVE_BLOCKS(stderr, "WaveBlockStore::write pos:%ld frames:%ld slots:%ld\n",
+         (long)pos, (long)frames, (long)_slotCount);
+      return true;
+      }
+
+//---------------------------------------------------------
+//   openHandle
+//---------------------------------------------------------
+
+SNDFILE* WaveBlockStore::openHandle(SNDFILE* orig)
+      {
+      if (!isValid() || !orig)
+            return nullptr;
+      WaveBlockCursor* c = new WaveBlockCursor;
+      c->_store = this;
+      c->_orig = orig;
+      c->_pos = 0;
+      c->_buffer.resize((size_t)4096 * _channels);
+
+      SF_INFO info;
+      memset(&info, 0, sizeof(info));
+      info.format = SF_FORMAT_RAW | SF_FORMAT_FLOAT | SF_ENDIAN_CPU;
+      info.channels = _channels;
+      info.samplerate = _samplerate;
+      c->_handle = sf_open_virtual(&blocks_vio, SFM_READ, &info, c);
+      if (!c->_handle) {
+            ERROR_WAVE_BLOCKS(stderr, "WaveBlockStore::openHandle failed: %s\n", sf_strerror(nullptr));
+            delete c;
+            return nullptr;
+            }
+      _cursors.push_back(c);
+      return c->_handle;
+      }
+
+//---------------------------------------------------------
+//   closeHandle
+//---------------------------------------------------------
+
+void WaveBlockStore::closeHandle(SNDFILE* handle)
+      {
+      for (auto i = _cursors.begin(); i != _cursors.end(); ++i) {
+            WaveBlockCursor* c = *i;
+            if (c->_handle != handle)
+                  continue;
+            sf_close(c->_handle);
+            sf_close(c->_orig);
+            _cursors.erase(i);
+            delete c;
+            return;
+            }
+      }
+
+//---------------------------------------------------------
+//   commit
+//---------------------------------------------------------
+
+bool WaveBlockStore::commit()
+      {
+      WaveBlockMap* cur = current();
+      if (!isValid() || cur->editedBlocks() == 0)
+            return true;
+
+      SF_INFO info;
+      memset(&info, 0, sizeof(info));
+      SNDFILE* out = sf_open(_path.toLocal8Bit().constData(), SFM_RDWR, &info);
+      if (!out) {
+            ERROR_WAVE_BLOCKS(stderr, "WaveBlockStore::commit: cannot open %s for writing: %s\n",
+               _path.toLocal8Bit().constData(), sf_strerror(nullptr));
+            return false;
+            }
+
+      std::vector<float> orig(_block.size());
+      bool ok = true;
+      for (size_t b = 0; b < cur->blocks(); ++b) {
+            const int64_t slot = cur->_slots[b];
+            if (slot < 0)
+                  continue;
+            const sf_count_t len = blockFrames(b);
+
+            // Move the sound file's own data to the side file for the maps which still use it.
+            int64_t keep = -1;
+            for (WaveBlockMap* m : _maps) {
+                  if (m->_slots[b] >= 0)
+                        continue;
+                  if (keep < 0) {
+                        readBlock(nullptr, _orig, b, 0, orig.data(), len);
+                        keep = _slotCount++;
+                        if (!writeSlot(keep, orig.data(), len)) {
+                              ok = false;
+                              break;
+                              }
+                        }
+                  m->_slots[b] = keep;
+                  }
+            if (!ok)
+                  break;
+
+            readBlock(cur, _orig, b, 0, _block.data(), len);
+            if (sf_seek(out, (sf_count_t)b * BlockFrames, SEEK_SET) < 0 ||
+               sf_writef_float(out, _block.data(), len) != len) {
+                  ERROR_WAVE_BLOCKS(stderr, "WaveBlockStore::commit: write to %s failed: %s\n",
+                     _path.toLocal8Bit().constData(), sf_strerror(out));
+                  ok = false;
+                  break;
+                  }
+
+            // The slot's data is now the sound file's own data.
+            for (WaveBlockMap* m : _maps)
+                  if (m->_slots[b] == slot)
+                        m->_slots[b] = -1;
+            }
+      sf_close(out);
+      return ok;
+      }
+
+} // namespace MusECore
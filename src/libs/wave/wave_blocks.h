@@ -0,0 +1,190 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  wave_blocks.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __WAVE_BLOCKS_H__
+#define __WAVE_BLOCKS_H__
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <sndfile.h>
+
+#include <QString>
+
+namespace MusECore {
+
+struct WaveBlockCursor;
+
+//---------------------------------------------------------
+//   WaveBlockMap
+//    Where each block of a sound file's data is found:
+//     either in the sound file itself, or in a slot of
+//     the block store's side file.
+//    A map is not changed once it has been made current,
+//     except by WaveBlockStore::commit() while audio is idle.
+//---------------------------------------------------------
+
+class WaveBlockMap {
+      friend class WaveBlockStore;
+
+      // Side file slot of each block, or -1 for the sound file's own data.
+      std::vector<int64_t> _slots;
+      // Slots from this one on were written for this map. They can be
+      //  written again while the map is being edited.
+      int64_t _firstOwnSlot;
+
+      WaveBlockMap(size_t blocks, int64_t firstOwnSlot)
+        : _slots(blocks, -1), _firstOwnSlot(firstOwnSlot) { }
+
+   public:
+      size_t blocks() const { return _slots.size(); }
+      int64_t slot(size_t block) const { return _slots[block]; }
+      // Number of blocks which are not the sound file's own data.
+      size_t editedBlocks() const;
+      };
+
+//---------------------------------------------------------
+//   WaveBlockStore
+//    Copy-on-write sample store of a sound file.
+//    Edits write whole blocks of float frames to a side
+//     file and produce a new block map. Making a map
+//     current switches all reads of the sound file over
+//     to it at once, so undo and redo just swap maps.
+//    The sound file itself is only written by commit().
+//    All maps are owned by the store and live as long as
+//     it does, so that undo operations can refer to them.
+//    There is one store per sound file, shared by all the
+//     SndFile objects of the file, so that an edit made
+//     through one of them is seen by all of them.
+//---------------------------------------------------------
+
+class WaveBlockStore {
+   public:
+      // Frames per block. A multiple of the peak cache magnification.
+      enum { BlockFrames = 32768 };
+
+   private:
+      QString _path;
+      QString _sidePath;
+      int _fd;
+      int _channels;
+      int _samplerate;
+      sf_count_t _frames;
+      // Slots written to the side file so far.
+      int64_t _slotCount;
+      // A read handle on the sound file, for the GUI thread.
+      SNDFILE* _orig;
+      std::atomic<WaveBlockMap*> _current;
+      std::vector<WaveBlockMap*> _maps;
+      std::vector<WaveBlockCursor*> _cursors;
+      // Scratch buffer of one block, for the GUI thread.
+      std::vector<float> _block;
+      // Users of the store, see acquire() and release().
+      int _refs;
+
+      size_t slotBytes() const { return (size_t)BlockFrames * _channels * sizeof(float); }
+      sf_count_t blockFrames(size_t block) const;
+      // Reads frames of one block starting at offset, interleaved, through a map.
+      bool readBlock(const WaveBlockMap* map, SNDFILE* orig, size_t block,
+                     sf_count_t offset, float* dst, sf_count_t frames) const;
+      bool writeSlot(int64_t slot, const float* src, sf_count_t frames);
+
+      // Opens the sound file at path for reading and creates the side file at sidePath.
+      WaveBlockStore(const QString& path, const QString& sidePath);
+      // Removes the side file.
+      ~WaveBlockStore();
+
+   public:
+      // Returns the store of the sound file at path, a canonical path, with one more user.
+      //  If there is none yet and a sidePath is given, creates one with its side file there.
+      //  Returns null if there is none, or it could not be created. GUI thread only.
+      static WaveBlockStore* acquire(const QString& path, const QString& sidePath = QString());
+      // Drops a user. The last one deletes the store. GUI thread only.
+      void release();
+
+      bool isValid() const { return _fd >= 0 && _orig; }
+      int channels() const { return _channels; }
+      sf_count_t frames() const { return _frames; }
+      const QString& sidePath() const { return _sidePath; }
+
+      // The current map. Any thread.
+      WaveBlockMap* current() const { return _current.load(std::memory_order_acquire); }
+      // Makes a map current. Returns the previous one. Called from the audio thread.
+      WaveBlockMap* setCurrent(WaveBlockMap* map);
+
+      // Returns a new map, a copy of base, to be edited with write().
+      WaveBlockMap* newMap(const WaveBlockMap* base);
+      // Reads frames from pos through a map into non-interleaved buffers. GUI thread.
+      // Returns the number of frames read.
+      sf_count_t read(const WaveBlockMap* map, sf_count_t pos, int dstChannels, float** dst, sf_count_t frames);
+      // Writes frames of non-interleaved data at pos into new blocks of a map made by newMap().
+      // Partly covered blocks are completed with the map's data. GUI thread. Returns false on error.
+      bool write(WaveBlockMap* map, sf_count_t pos, int srcChannels, float** src, sf_count_t frames);
+      // Calls f(firstFrame, frames) for each run of blocks whose data differs between two maps.
+      // A null map stands for the sound file's own data.
+      template <typename F> void forEachChange(const WaveBlockMap* a, const WaveBlockMap* b, F f) const;
+
+      // Opens a read handle on the sound file which reads through the current map.
+      // Takes over orig, a read handle on the sound file. Returns null on error.
+      SNDFILE* openHandle(SNDFILE* orig);
+      // Closes a handle from openHandle(), and its sound file handle.
+      void closeHandle(SNDFILE* handle);
+      // Reads interleaved frames from pos through a map. Used by the handles.
+      sf_count_t readInterleaved(const WaveBlockMap* map, SNDFILE* orig, sf_count_t pos,
+                                 float* dst, sf_count_t frames) const;
+
+      // Writes the current map's edited blocks into the sound file. The sound file's
+      //  previous data goes to the side file and all maps are adjusted, so that every
+      //  map still describes the same data. Audio must be idle. Returns false on error.
+      bool commit();
+      };
+
+//---------------------------------------------------------
+//   forEachChange
+//---------------------------------------------------------
+
+template <typename F> void WaveBlockStore::forEachChange(const WaveBlockMap* a, const WaveBlockMap* b, F f) const
+      {
+      const size_t blocks = a ? a->blocks() : (b ? b->blocks() : 0);
+      size_t start = 0;
+      bool inRun = false;
+      for (size_t i = 0; i <= blocks; ++i) {
+            const bool changed = i < blocks &&
+               (a ? a->slot(i) : -1) != (b ? b->slot(i) : -1);
+            if (changed && !inRun) {
+                  start = i;
+                  inRun = true;
+                  }
+            else if (!changed && inRun) {
+                  const sf_count_t first = (sf_count_t)start * BlockFrames;
+                  const sf_count_t end = std::min((sf_count_t)i * BlockFrames, _frames);
+                  f(first, end - first);
+                  inRun = false;
+                  }
+            }
+      }
+
+} // namespace MusECore
+
+#endif
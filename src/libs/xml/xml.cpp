@@ -25,6 +25,7 @@
 #include <stdarg.h>
 
 #include "xml.h"
+#include "xml_chunks.h"
 
 namespace MusECore {
 
@@ -54,6 +55,8 @@ Xml::Xml(const char* buf)
       inTag     = false;
       inComment = false;
       bufptr    = buf;
+      _bufEnd   = nullptr;
+      _chunkWriter  = nullptr;
       _minorVersion = -1;
       _majorVersion = -1;
       }
@@ -66,9 +69,10 @@ Xml::Xml(QString* s)
       level     = 0;
       inTag     = false;
       inComment = false;
-      lbuffer[0] = 0;
-      bufptr     = lbuffer;
+      bufptr     = "";
+      _bufEnd    = bufptr;
       _destStr   = s;
+      _chunkWriter  = nullptr;
       _minorVersion = -1;
       _majorVersion = -1;
       }
@@ -82,8 +86,9 @@ Xml::Xml(QIODevice* d)
       level     = 0;
       inTag     = false;
       inComment = false;
-      lbuffer[0] = 0;
-      bufptr     = lbuffer;
+      bufptr     = "";
+      _bufEnd    = bufptr;
+      _chunkWriter  = nullptr;
       _minorVersion = -1;
       _majorVersion = -1;
       }
@@ -100,14 +105,20 @@ Xml::Xml(QIODevice* d)
 
 void Xml::next()
       {
-      if (*bufptr == 0) {
-            if((!_destIODev) || (_destIODev && _destIODev->readLine(lbuffer, 512) <= 0))
-            {
-              c = EOF;
-              return;
-            }
-
-            bufptr = lbuffer;
+      while (*bufptr == 0) {
+            if (!_destIODev) {
+                  c = EOF;
+                  return;
+                  }
+            // Skip a nul byte inside the block.
+            if (bufptr < _bufEnd) {
+                  ++bufptr;
+                  continue;
+                  }
+            if (!fill()) {
+                  c = EOF;
+                  return;
+                  }
             }
       c = *bufptr++;
       if (c == '\n') {
@@ -117,6 +128,57 @@ void Xml::next()
       ++_col;
       }
 
+//---------------------------------------------------------
+//   fill
+//    Reading the device in large blocks instead of line by
+//    line saves most of the device overhead on big files.
+//---------------------------------------------------------
+
+bool Xml::fill()
+      {
+      // The song text of a chunk file is read all at once.
+      if (_chunkReader)
+            return false;
+      const qint64 blockSize = 256 * 1024;
+      const bool first = _readBuffer.isEmpty();
+      if (_readBuffer.size() != blockSize + 1)
+            _readBuffer.resize(blockSize + 1);
+      char* b = _readBuffer.data();
+      const qint64 n = _destIODev->read(b, blockSize);
+      if (n <= 0)
+            return false;
+      if (first && XmlChunkReader::isChunkFile(b, n))
+            return readChunkFile(n);
+      b[n]    = 0;
+      bufptr  = b;
+      _bufEnd = b + n;
+      return true;
+      }
+
+//---------------------------------------------------------
+//   readChunkFile
+//---------------------------------------------------------
+
+bool Xml::readChunkFile(qint64 n)
+      {
+      QByteArray file(_readBuffer.constData(), n);
+      for (;;) {
+            const qint64 m = _destIODev->read(_readBuffer.data(), _readBuffer.size() - 1);
+            if (m <= 0)
+                  break;
+            file.append(_readBuffer.constData(), m);
+            }
+      std::shared_ptr<XmlChunkReader> reader = std::make_shared<XmlChunkReader>();
+      if (!reader->read(file)) {
+            _readError = reader->errorString();
+            return false;
+            }
+      _chunkReader = reader;
+      bufptr  = _chunkReader->songText().constData();
+      _bufEnd = bufptr + _chunkReader->songText().size();
+      return true;
+      }
+
 //---------------------------------------------------------
 //   nextc
 //    get next non space character
@@ -130,23 +192,44 @@ void Xml::nextc()
       }
 
 //---------------------------------------------------------
-//   token
-//    read token into _s2
+//   scan
+//    read token into _span
 //---------------------------------------------------------
 
-void Xml::token(int cc)
+void Xml::scan(int cc)
       {
-      QByteArray buffer;
+      _span.clear();
       int i = 0;
       for (; i < 9999999;) {   // Stop at a reasonably large amount 10 million.
             if (c == ' ' || c == '\t' || c == cc || c == '\n' || c == EOF)
                   break;
-            buffer.append(c);
+            _span.push_back(c);
             i++;
             next();
             }
-      buffer.append(char(0));
-      _s2 = buffer;     // deep copy !?
+      }
+
+//---------------------------------------------------------
+//   token
+//    read token into _s2
+//---------------------------------------------------------
+
+void Xml::token(int cc)
+      {
+      scan(cc);
+      _s2 = QString::fromUtf8(_span.data(), (int)_span.size());
+      }
+
+//---------------------------------------------------------
+//   name
+//---------------------------------------------------------
+
+const QString& Xml::name()
+      {
+      std::unordered_map<std::string, QString>::const_iterator i = _names.find(_span);
+      if (i != _names.cend())
+            return i->second;
+      return _names.emplace(_span, QString::fromUtf8(_span.data(), (int)_span.size())).first->second;
       }
 
 //---------------------------------------------------------
@@ -156,15 +239,15 @@ void Xml::token(int cc)
 
 void Xml::stoken()
       {
-      QByteArray buffer;
+      _span.clear();
       int i = 0;
-      buffer.append(c);
+      _span.push_back(c);
       i++;
       next();
 
       for (;i < 10000000*4-1;) {  // Stop at a reasonably large amount 10 million.
             if (c == '"') {
-                  buffer.append(c);
+                  _span.push_back(c);
                   i++;
                   next();
                   break;
@@ -198,40 +281,30 @@ void Xml::stoken()
                   if (c == EOF || k == 6) {
                         // dump entity
                         int n = 0;
-                        buffer.append('&');
+                        _span.push_back('&');
                         i++;
                         for (;(i < 511) && (n < k); ++i, ++n)
-                              buffer.append(entity[n]);
+                              _span.push_back(entity[n]);
                         }
                   else {
-                        buffer.append(c);
+                        _span.push_back(c);
                         i++;
                      }
                   }
             else if(c != EOF)
             {
-              buffer.append(c);
+              _span.push_back(c);
               i++;
             }
             if (c == EOF)
                   break;
             next();
             }
-      buffer.append(char(0));
-      _s2 = buffer;
-      }
-
-//---------------------------------------------------------
-//   strip
-//    strip `"` from string
-//---------------------------------------------------------
-
-QString Xml::strip(const QString& s)
-      {
-      int l = s.length();
-      if (l >= 2 && s[0] == '"')
-            return s.mid(1, l-2);
-      return s;
+      // Strip the quotes.
+      if (_span.size() >= 2)
+            _s2 = QString::fromUtf8(_span.data() + 1, (int)_span.size() - 2);
+      else
+            _s2 = QString::fromUtf8(_span.data(), (int)_span.size());
       }
 
 //---------------------------------------------------------
@@ -240,8 +313,6 @@ QString Xml::strip(const QString& s)
 
 Xml::Token Xml::parse()
       {
-      QByteArray buffer;
-
  again:
       bool endFlag = false;
       nextc();
@@ -270,9 +341,9 @@ Xml::Token Xml::parse()
                   --level;
                   return TagEnd;
                   }
-            _s2.clear();
-            token('=');
-            _s1 = _s2;
+            scan('=');
+            _s1 = name();
+            _s2 = _s1;
             nextc();      // skip space
             if (c == EOF) {
                   //if (level > 0 || MusEGlobal::debugMsg)
@@ -290,7 +361,6 @@ Xml::Token Xml::parse()
                   inTag = false;
             else
                   --bufptr;
-            _s2 = strip(_s2);
             return Attribut;
             }
       if (c == '<') {
@@ -304,19 +374,18 @@ Xml::Token Xml::parse()
                   }
             if (c == '?') {
                   next();
-                  buffer.clear();
+                  _span.clear();
                   for (;;) {
                         if (c == '?' || c == EOF || c == '>')
                               break;
                         
-                        buffer.append(c);
+                        _span.push_back(c);
                         
                         // TODO: check overflow
                         next();
                         }
                   
-                  buffer.append(char(0));
-                  _s1 = QString(buffer);
+                  _s1 = QString::fromUtf8(_span.data(), (int)_span.size());
 
                   if (c == EOF) {
                         fprintf(stderr, "XML: unexpected EOF\n");
@@ -383,19 +452,18 @@ Xml::Token Xml::parse()
                         }
                   goto again;
                   }
-            buffer.clear();
+            _span.clear();
             for (;;) {
                   if (c == '/' || c == ' ' || c == '\t' || c == '>' || c == '\n' || c == EOF)
                         break;
                   // TODO: check overflow
                   
-                  buffer.append(c);
+                  _span.push_back(c);
                   
                   next();
                   }
             
-            buffer.append(char(0));
-            _s1 = QString(buffer);
+            _s1 = name();
 
             // skip white space:
             while (c == ' ' || c == '\t' || c == '\n')
@@ -444,14 +512,14 @@ Xml::Token Xml::parse()
                   fprintf(stderr, "XML: level = 0\n");
                   goto error;
                   }
-            buffer.clear();
+            _span.clear();
             for (;;) {
                   if (c == EOF || c == '<')
                         break;
                   if (c == '&') {
                         next();
                         if (c == '<') {         // be tolerant with old muse files
-                              buffer.append('&');
+                              _span.push_back('&');
                               continue;
                               }
                               
@@ -485,13 +553,12 @@ Xml::Token Xml::parse()
                         
                         }
 
-                  buffer.append(c);
+                  _span.push_back(c);
                   
                   next();
                   }
                   
-            buffer.append(char(0));
-            _s1 = QString(buffer);
+            _s1 = QString::fromUtf8(_span.data(), (int)_span.size());
 
             if (c == '<')
                   --bufptr;
@@ -699,8 +766,7 @@ void Xml::dump(QString &dump)
         {
           const qint64 pos = _destIODev->pos();
           _destIODev->seek(0);
-          while(_destIODev->read(lbuffer, 512) > 0)
-              dump.append(lbuffer);
+          dump.append(QString::fromUtf8(_destIODev->readAll()));
           _destIODev->seek(pos);
         }
       }
@@ -710,6 +776,16 @@ void Xml::dump(QString &dump)
       }
       }
 
+//---------------------------------------------------------
+//   XmlTagDispatch
+//---------------------------------------------------------
+
+XmlTagDispatch::XmlTagDispatch(std::initializer_list<std::pair<const char*, int> > tags)
+      {
+      for (const std::pair<const char*, int>& t : tags)
+            _ids.insert(QString(t.first), t.second);
+      }
+
 //---------------------------------------------------------
 //   Basic functions:
 //---------------------------------------------------------
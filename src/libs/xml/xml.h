@@ -25,8 +25,14 @@
 #define __XML_H__
 
 #include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <initializer_list>
+#include <utility>
+#include <memory>
 
 #include <QString>
+#include <QHash>
 #include <QByteArray>
 #include <QColor>
 #include <QRect>
@@ -35,6 +41,9 @@
 
 namespace MusECore {
 
+class XmlChunkWriter;
+class XmlChunkReader;
+
 //---------------------------------------------------------
 //   Xml
 //    very simple XML-like parser
@@ -63,15 +72,36 @@ class Xml {
       int _majorVersion;                      // Currently loaded songfile major version
 
       char c;            // current char
-      char lbuffer[512];
+      // When constructed with a QIODevice* parameter, blocks of the device are read into this.
+      QByteArray _readBuffer;
+      // End of the data in _readBuffer.
+      const char* _bufEnd;
       // When constructed with a const char* parameter, this will be valid.
       const char* bufptr;
+      // The bytes of the current token. Reused, so that scanning does not allocate.
+      std::string _span;
+      // Tag and attribute names seen so far. Names repeat throughout a file,
+      //  so each one is converted to a QString only once and then shared.
+      std::unordered_map<std::string, QString> _names;
+      // When writing a chunk file, bulk data goes to these chunks.
+      XmlChunkWriter* _chunkWriter;
+      // When the device turns out to hold a chunk file, its chunks.
+      std::shared_ptr<XmlChunkReader> _chunkReader;
+      // Why the device could not be read, if it could not. Empty otherwise.
+      QString _readError;
 
       void next();
       void nextc();
+      // Reads the next block from the device. Returns false at the end of the device.
+      bool fill();
+      // Reads the rest of a chunk file whose first n bytes are in _readBuffer.
+      bool readChunkFile(qint64 n);
+      // Scans bytes into _span up to white space or cc.
+      void scan(int cc);
       void token(int);
       void stoken();
-      QString strip(const QString& s);
+      // Returns _span as a QString, shared with earlier names of the same bytes.
+      const QString& name();
       void putLevel(int n);
       
    public:
@@ -121,6 +151,14 @@ class Xml {
       int col()  const    { return _col; }     // current col
       const QString& s1() { return _s1; }
       const QString& s2() { return _s2; }
+      // Whether bulk data should be written to binary chunks, and where to.
+      XmlChunkWriter* chunkWriter() const { return _chunkWriter; }
+      void setChunkWriter(XmlChunkWriter* w) { _chunkWriter = w; }
+      // The chunks of the file being read, or null if it is not a chunk file.
+      const XmlChunkReader* chunkReader() const { return _chunkReader.get(); }
+      // Why the device could not be read, like a damaged chunk file, which then
+      //  reads as empty. Empty if there was no such error.
+      const QString& readError() const { return _readError; }
       void dump(QString &dump);
 
       void header();
@@ -155,6 +193,22 @@ class Xml {
       void skip(const QString& tag);
       };
 
+//---------------------------------------------------------
+//   XmlTagDispatch
+//    Maps a fixed set of tag names to ids, so that reading
+//     functions with many tags can switch on the id instead
+//     of comparing the tag against each name in turn.
+//---------------------------------------------------------
+
+class XmlTagDispatch {
+      QHash<QString, int> _ids;
+
+   public:
+      XmlTagDispatch(std::initializer_list<std::pair<const char*, int> > tags);
+      // Returns the id of a tag, or -1 if it is not one of the set.
+      int id(const QString& tag) const { return _ids.value(tag, -1); }
+      };
+
   //---------------------------------------------------------
   //   Basic functions:
   //---------------------------------------------------------
@@ -0,0 +1,205 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  xml_chunks.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <string.h>
+
+#include "xml_chunks.h"
+
+namespace MusECore {
+
+static const char chunkFileMagic[8] = { 'M', 'u', 's', 'E', 'B', 'S', 'n', 'g' };
+static const int fileHeaderSize  = 16;
+static const int chunkHeaderSize = 20;
+
+//---------------------------------------------------------
+//   putU32
+//---------------------------------------------------------
+
+void putU32(QByteArray& ba, uint32_t v)
+      {
+      for (int i = 0; i < 4; ++i)
+            ba.append(char((v >> (8 * i)) & 0xff));
+      }
+
+void putU64(QByteArray& ba, uint64_t v)
+      {
+      for (int i = 0; i < 8; ++i)
+            ba.append(char((v >> (8 * i)) & 0xff));
+      }
+
+//---------------------------------------------------------
+//   getU32
+//---------------------------------------------------------
+
+uint32_t getU32(const char* p)
+      {
+      uint32_t v = 0;
+      for (int i = 0; i < 4; ++i)
+            v |= uint32_t((unsigned char)p[i]) << (8 * i);
+      return v;
+      }
+
+uint64_t getU64(const char* p)
+      {
+      uint64_t v = 0;
+      for (int i = 0; i < 8; ++i)
+            v |= uint64_t((unsigned char)p[i]) << (8 * i);
+      return v;
+      }
+
+//---------------------------------------------------------
+//   xmlChunkCrc32
+//---------------------------------------------------------
+
+uint32_t xmlChunkCrc32(const char* data, int64_t size)
+      {
+      static const std::vector<uint32_t> table = [] {
+            std::vector<uint32_t> t(256);
+            for (uint32_t i = 0; i < 256; ++i) {
+                  uint32_t c = i;
+                  for (int k = 0; k < 8; ++k)
+                        c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+                  t[i] = c;
+                  }
+            return t;
+            }();
+
+      uint32_t crc = 0xffffffffu;
+      for (int64_t i = 0; i < size; ++i)
+            crc = table[(crc ^ (unsigned char)data[i]) & 0xff] ^ (crc >> 8);
+      return crc ^ 0xffffffffu;
+      }
+
+//---------------------------------------------------------
+//   add
+//---------------------------------------------------------
+
+int XmlChunkWriter::add(uint32_t type, uint32_t version, const QByteArray& data)
+      {
+      _chunks.push_back(Chunk{type, version, data});
+      // The song text is chunk 0.
+      return _chunks.size();
+      }
+
+//---------------------------------------------------------
+//   write
+//---------------------------------------------------------
+
+bool XmlChunkWriter::write(QIODevice* dev, const QByteArray& songText) const
+      {
+      QByteArray header(chunkFileMagic, sizeof(chunkFileMagic));
+      putU32(header, FormatVersion);
+      putU32(header, _chunks.size() + 1);
+      if (dev->write(header) != header.size())
+            return false;
+
+      const Chunk song{XmlSongChunk, 1, songText};
+      for (size_t i = 0; i <= _chunks.size(); ++i) {
+            const Chunk& c = i == 0 ? song : _chunks[i - 1];
+            QByteArray ch;
+            putU32(ch, c.type);
+            putU32(ch, c.version);
+            putU64(ch, c.data.size());
+            putU32(ch, xmlChunkCrc32(c.data.constData(), c.data.size()));
+            if (dev->write(ch) != ch.size() || dev->write(c.data) != c.data.size())
+                  return false;
+            }
+      return true;
+      }
+
+//---------------------------------------------------------
+//   isChunkFile
+//---------------------------------------------------------
+
+bool XmlChunkReader::isChunkFile(const char* data, int64_t size)
+      {
+      return size >= (int64_t)sizeof(chunkFileMagic) &&
+             memcmp(data, chunkFileMagic, sizeof(chunkFileMagic)) == 0;
+      }
+
+//---------------------------------------------------------
+//   read
+//---------------------------------------------------------
+
+bool XmlChunkReader::read(const QByteArray& file)
+      {
+      _chunks.clear();
+      _songText.clear();
+      const char* p = file.constData();
+      const int64_t size = file.size();
+      if (size < fileHeaderSize || !isChunkFile(p, size)) {
+            _errorString = QString("Not a chunk file");
+            return false;
+            }
+      const uint32_t version = getU32(p + 8);
+      if (version > XmlChunkWriter::FormatVersion) {
+            _errorString = QString("Chunk file format %1 is newer than this version of MusE supports").arg(version);
+            return false;
+            }
+      const uint32_t count = getU32(p + 12);
+      int64_t pos = fileHeaderSize;
+      for (uint32_t i = 0; i < count; ++i) {
+            if (size - pos < chunkHeaderSize) {
+                  _errorString = QString("Chunk %1 is truncated").arg(i);
+                  return false;
+                  }
+            Chunk c;
+            c.type    = getU32(p + pos);
+            c.version = getU32(p + pos + 4);
+            const uint64_t len = getU64(p + pos + 8);
+            const uint32_t crc = getU32(p + pos + 16);
+            pos += chunkHeaderSize;
+            if (len > uint64_t(size - pos)) {
+                  _errorString = QString("Chunk %1 is truncated").arg(i);
+                  return false;
+                  }
+            if (xmlChunkCrc32(p + pos, len) != crc) {
+                  _errorString = QString("Chunk %1 has a bad checksum").arg(i);
+                  return false;
+                  }
+            c.data = QByteArray(p + pos, len);
+            pos += len;
+            _chunks.push_back(c);
+            }
+      if (_chunks.empty() || _chunks[0].type != XmlSongChunk) {
+            _errorString = QString("Chunk file has no song");
+            return false;
+            }
+      _songText = _chunks[0].data;
+      return true;
+      }
+
+//---------------------------------------------------------
+//   chunk
+//---------------------------------------------------------
+
+const QByteArray* XmlChunkReader::chunk(int index, uint32_t type, uint32_t* version) const
+      {
+      if (index < 0 || index >= (int)_chunks.size() || _chunks[index].type != type)
+            return nullptr;
+      if (version)
+            *version = _chunks[index].version;
+      return &_chunks[index].data;
+      }
+
+} // namespace MusECore
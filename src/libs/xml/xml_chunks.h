@@ -0,0 +1,115 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  xml_chunks.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __XML_CHUNKS_H__
+#define __XML_CHUNKS_H__
+
+#include <vector>
+#include <cstdint>
+
+#include <QString>
+#include <QByteArray>
+#include <QIODevice>
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   Chunk file
+//    A binary song file. It holds the song text as usual
+//     in its first chunk, except that bulk data such as
+//     events and automation is stored in further binary
+//     chunks which the text refers to by index.
+//
+//    File:  8 bytes magic "MusEBSng", u32 format version,
+//           u32 number of chunks, then the chunks.
+//    Chunk: u32 type, u32 chunk version, u64 data size,
+//           u32 crc32 of the data, then the data.
+//    All numbers are little endian.
+//---------------------------------------------------------
+
+enum XmlChunkType : uint32_t {
+      XmlSongChunk  = 0x474e4f53,   // "SONG"  The song text.
+      XmlEventChunk = 0x544e5645,   // "EVNT"  The midi events of a part.
+      XmlCtrlChunk  = 0x4c525443    // "CTRL"  The points of a controller list.
+      };
+
+//---------------------------------------------------------
+//   XmlChunkWriter
+//---------------------------------------------------------
+
+class XmlChunkWriter {
+      struct Chunk {
+            uint32_t type;
+            uint32_t version;
+            QByteArray data;
+            };
+      std::vector<Chunk> _chunks;
+
+   public:
+      enum { FormatVersion = 1 };
+
+      // Adds a data chunk. Returns its index, by which the song text refers to it.
+      int add(uint32_t type, uint32_t version, const QByteArray& data);
+      // Writes the file: the song text, followed by the data chunks. Returns false on error.
+      bool write(QIODevice* dev, const QByteArray& songText) const;
+      };
+
+//---------------------------------------------------------
+//   XmlChunkReader
+//---------------------------------------------------------
+
+class XmlChunkReader {
+      struct Chunk {
+            uint32_t type;
+            uint32_t version;
+            QByteArray data;
+            };
+      std::vector<Chunk> _chunks;
+      QByteArray _songText;
+      QString _errorString;
+
+   public:
+      // Whether data, the start of a file, is the start of a chunk file.
+      static bool isChunkFile(const char* data, int64_t size);
+
+      // Reads a whole chunk file and checks all chunks. Returns false on error.
+      bool read(const QByteArray& file);
+      const QString& errorString() const { return _errorString; }
+      const QByteArray& songText() const { return _songText; }
+      // Returns the data of the chunk at index, or null if there is no such chunk of the given type.
+      // The chunk version is returned in version if given.
+      const QByteArray* chunk(int index, uint32_t type, uint32_t* version = nullptr) const;
+      };
+
+// The crc32 checksum used in chunk files, as in zlib.
+uint32_t xmlChunkCrc32(const char* data, int64_t size);
+
+// Little endian numbers, as in chunk files.
+void putU32(QByteArray& ba, uint32_t v);
+void putU64(QByteArray& ba, uint64_t v);
+uint32_t getU32(const char* p);
+uint64_t getU64(const char* p);
+
+} // namespace MusECore
+
+#endif
@@ -39,8 +39,10 @@
 #include <QDir>
 #include <QFile>
 #include <QIODevice>
+#include <QBuffer>
 #include <QProcess>
 #include <QStatusBar>
+#include <QElapsedTimer>
 #if QT_VERSION >= 0x050b00
 #include <QScreen>
 #endif
@@ -58,6 +60,10 @@
 #include "audio.h"
 #include "audiodev.h"
 #include "audioprefetch.h"
+#include "audio_graph.h"
+#include "peak_builder.h"
+#include "record_writer.h"
+#include "autosave.h"
 // FIXME Move cliplist into components ?
 #include "cliplist/cliplist.h"
 //#include "debug.h"
@@ -150,6 +156,7 @@
 #include "musemdiarea.h"
 #include "snooper.h"
 #include "xml.h"
+#include "xml_chunks.h"
 #ifdef BUILD_EXPERIMENTAL
   #include "rhythm.h"
 #endif
@@ -366,6 +373,13 @@ bool MusE::seqStart()
       else
         fprintf(stderr, "seqStart(): audioPrefetch is NULL\n");
 
+      if(MusEGlobal::audioGraph)
+      {
+        // Start the audio graph workers at the same priority as the audio thread.
+        MusEGlobal::audioGraph->start(MusEGlobal::realTimePriority);
+        MusEGlobal::audioGraph->rebuild();
+      }
+
       if(MusEGlobal::audio)
       {
         if(!MusEGlobal::audio->isRunning())
@@ -418,6 +432,10 @@ void MusE::seqStop()
       if(MusEGlobal::midiSeq)
          MusEGlobal::midiSeq->stop(true);
       MusEGlobal::audio->stop(true);
+      if(MusEGlobal::audioGraph)
+        MusEGlobal::audioGraph->stop();
+      if (MusEGlobal::debugMsg)
+            MusEGlobal::audioPrefetch->dumpStats(stderr);
       MusEGlobal::audioPrefetch->stop(true);
       if (MusEGlobal::realTimeScheduling && watchdogThread)
             pthread_cancel(watchdogThread);
@@ -483,6 +501,7 @@ MusE::MusE() : QMainWindow()
       setFocusPolicy(Qt::NoFocus);
       MusEGlobal::muse      = this;    // hack
       _isRestartingApp      = false;
+      _headless             = false;
       midiSyncConfig        = nullptr;
       midiRemoteConfig      = nullptr;
       midiPortConfig        = nullptr;
@@ -509,6 +528,7 @@ MusE::MusE() : QMainWindow()
       //routingPopupMenu      = 0;
       progress              = nullptr;
       saveIncrement         = 0;
+      _autosave             = new MusECore::AutosaveJournal();
       activeTopWin          = nullptr;
       currentMenuSharingTopwin = nullptr;
       waitingForTopwin      = nullptr;
@@ -532,6 +552,8 @@ MusE::MusE() : QMainWindow()
       connect(MusEGlobal::heartBeatTimer, SIGNAL(timeout()), SLOT(heartBeat()));
       connect(this, SIGNAL(activeTopWinChanged(MusEGui::TopWin*)), SLOT(activeTopWinChangedSlot(MusEGui::TopWin*)));
       connect(MusEGlobal::song, SIGNAL(sigDirty()), this, SLOT(setDirty()));
+      connect(MusEGlobal::song, SIGNAL(songChanged(MusECore::SongChangedStruct_t)), this,
+              SLOT(autosaveSongChanged(MusECore::SongChangedStruct_t)));
 
       blinkTimer = new QTimer(this);
       blinkTimer->setObjectName("blinkTimer");
@@ -1328,6 +1350,7 @@ MusE::~MusE()
     disconnect(it.value()._conn);
   _pendingObjectDestructions.clear();
 #endif
+  delete _autosave;
 }
 
 //---------------------------------------------------------
@@ -1423,10 +1446,52 @@ void MusE::heartBeat()
                                   MusEGlobal::song->dspLoad(),
                                   MusEGlobal::song->xRunsCount());
 
-    if (statusBar()->isVisible())
+    if (statusBar()->isVisible()) {
         cpuStatusBar->setValues(MusEGlobal::song->cpuLoad(),
                                 MusEGlobal::song->dspLoad(),
                                 MusEGlobal::song->xRunsCount());
+        cpuStatusBar->setUndoMemory(MusEGlobal::song->undoMemoryUsage(),
+                                    MusEGlobal::config.undoMemoryLimit);
+    }
+
+    if (!cpuLoadToolbar->isVisible() && !statusBar()->isVisible())
+        return;
+
+    // Record writer statistics of the tracks prepared for recording.
+    bool disk_active = false;
+    bool disk_overrun = false;
+    double disk_percent = 0.0;
+    QString disk_details;
+    const double sr = MusEGlobal::sampleRate;
+    MusECore::TrackList* tl = MusEGlobal::song->tracks();
+    for (MusECore::ciTrack it = tl->cbegin(); it != tl->cend(); ++it) {
+        if ((*it)->isMidiTrack())
+            continue;
+        const MusECore::AudioTrack* at = static_cast<const MusECore::AudioTrack*>(*it);
+        const MusECore::RecordStream* rs = at->recordStream();
+        if (!rs)
+            continue;
+        const MusECore::RecordStreamStats st = rs->stats();
+        disk_active = true;
+        if (st.overruns)
+            disk_overrun = true;
+        if (st.capacity)
+            disk_percent = std::max(disk_percent, 100.0 * st.backlog / st.capacity);
+        if (!disk_details.isEmpty())
+            disk_details += "\n";
+        disk_details += tr("%1: backlog %2 s (worst %3 of %4 s), worst write %5 ms, dropped blocks %6")
+                        .arg(at->name())
+                        .arg(st.backlog / sr, 0, 'f', 2)
+                        .arg(st.worstBacklog / sr, 0, 'f', 2)
+                        .arg(st.capacity / sr, 0, 'f', 1)
+                        .arg(st.worstWriteMs, 0, 'f', 1)
+                        .arg(st.overruns);
+    }
+
+    if (cpuLoadToolbar->isVisible())
+        cpuLoadToolbar->setDiskValues(disk_active, disk_percent, disk_overrun, disk_details);
+    if (statusBar()->isVisible())
+        cpuStatusBar->setDiskValues(disk_active, disk_percent, disk_overrun, disk_details);
 }
 
 void MusE::populateAddTrack()
@@ -1454,6 +1519,7 @@ void MusE::messagePollTimerSlot()
 void MusE::setDirty()
       {
       MusEGlobal::song->dirty = true;
+      _autosave->setDirty();
       setWindowTitle(projectTitle(project.absoluteFilePath()) + " <unsaved changes>");
       }
 
@@ -1621,7 +1687,7 @@ bool MusE::loadProjectFile(const QString& name, bool songTemplate, bool doReadMi
       // Prompt and send init sequences.
       MusEGlobal::audio->msgInitMidiDevices(false);
 
-      if (MusEGlobal::song->getSongInfo().length()>0 && MusEGlobal::song->showSongInfoOnStartup()) {
+      if (!_headless && MusEGlobal::song->getSongInfo().length()>0 && MusEGlobal::song->showSongInfoOnStartup()) {
           startSongInfo(false);
         }
 
@@ -1732,7 +1798,7 @@ bool MusE::finishLoadProjectFile(bool restartSequencer)
       // Prompt and send init sequences.
       MusEGlobal::audio->msgInitMidiDevices(false);
 
-      if (MusEGlobal::song->getSongInfo().length()>0 && MusEGlobal::song->showSongInfoOnStartup()) {
+      if (!_headless && MusEGlobal::song->getSongInfo().length()>0 && MusEGlobal::song->showSongInfoOnStartup()) {
           startSongInfo(false);
         }
 
@@ -1741,6 +1807,18 @@ bool MusE::finishLoadProjectFile(bool restartSequencer)
       }
 #endif
 
+//---------------------------------------------------------
+//   criticalMessage
+//---------------------------------------------------------
+
+void MusE::criticalMessage(const QString& text)
+      {
+      if (_headless)
+            fprintf(stderr, "Error: %s\n", text.toLocal8Bit().constData());
+      else
+            QMessageBox::critical(this, QString("MusE"), text);
+      }
+
 //---------------------------------------------------------
 //   loadProjectFile
 //    load *.med, *.mid, *.kar
@@ -1774,8 +1852,7 @@ bool MusE::loadProjectFile1(const QString& name, bool songTemplate, bool doReadM
       if (songTemplate)
       {
             if(!fi.isReadable()) {
-                QMessageBox::critical(this, QString("MusE"),
-                    tr("Cannot read template"));
+                criticalMessage(tr("Cannot read template"));
                 return false;
                 }
             project.setFile(MusEGui::getUniqueUntitledName());
@@ -1798,11 +1875,12 @@ bool MusE::loadProjectFile1(const QString& name, bool songTemplate, bool doReadM
       if((mex == "gz") || (mex == "bz2"))
         mex = ex.section('.', -2, -2);
 
-      if (ex.isEmpty() || mex == "med") {
+      bool recovering = false;
+      if (ex.isEmpty() || mex == "med" || mex == "medb") {
             //
             //  read *.med file
             //
-            MusEFile::File f(fi.filePath(), QString(".med"), this);
+            MusEFile::File f(autosaveRecoveryFile(fi.filePath(), songTemplate, &recovering), QString(".med"), this);
             const bool isCompressed = f.isCompressed();
 
             const MusEFile::File::ErrorCode ecode = fileOpen(f, QIODevice::ReadOnly, this, true);
@@ -1820,7 +1898,7 @@ bool MusE::loadProjectFile1(const QString& name, bool songTemplate, bool doReadM
 
                 default:
                   // FIXME: TODO: Correct replacement for previous "if (errno != ENOENT)" ?
-                  QMessageBox::critical(this, QString("MusE"), tr("File open error"));
+                  criticalMessage(tr("File open error"));
                   setUntitledProject();
                   _lastProjectFilePath = QString();
                 break;
@@ -1863,7 +1941,7 @@ bool MusE::loadProjectFile1(const QString& name, bool songTemplate, bool doReadM
 
                           default:
                             // FIXME: TODO: Correct replacement for previous "if (errno != ENOENT)" ?
-                            QMessageBox::critical(this, QString("MusE"), tr("File open error"));
+                            criticalMessage(tr("File open error"));
                             setUntitledProject();
                             _lastProjectFilePath = QString();
                           break;
@@ -1905,11 +1983,13 @@ bool MusE::loadProjectFile1(const QString& name, bool songTemplate, bool doReadM
                            " current system rate (%1Hz):").arg(MusEGlobal::sampleRate);
                       }
 
-                      bool ok;
-                      const int res = QInputDialog::getInt(
-                        this, tr("Project sample rate"),
-                        sugg_phrase, sugg_val,
-                        0, (10 * 1000 * 1000), 1, &ok);
+                      bool ok = true;
+                      int res = sugg_val;
+                      if(!_headless)
+                        res = QInputDialog::getInt(
+                          this, tr("Project sample rate"),
+                          sugg_phrase, sugg_val,
+                          0, (10 * 1000 * 1000), 1, &ok);
 
                       if(ok)
                         MusEGlobal::projectSampleRate = res;
@@ -1930,7 +2010,10 @@ bool MusE::loadProjectFile1(const QString& name, bool songTemplate, bool doReadM
                         "The files can be permanently converted to the new sample rate.\n\n"
                         "Save this song if you are sure you didn't mean to open it\n"
                         " at the original sample rate.").arg(MusEGlobal::projectSampleRate).arg(MusEGlobal::sampleRate);
-                      QMessageBox::warning(MusEGlobal::muse,"Wrong sample rate", msg);
+                      if(_headless)
+                        fprintf(stderr, "Warning: %s\n", msg.toLocal8Bit().constData());
+                      else
+                        QMessageBox::warning(MusEGlobal::muse,"Wrong sample rate", msg);
                       // Automatically convert the project.
                       // No: Try to keep the rate until user tells it to change.
                       //convertProjectSampleRate();
@@ -1944,11 +2027,17 @@ bool MusE::loadProjectFile1(const QString& name, bool songTemplate, bool doReadM
                   const MusEFile::File::ErrorCode ecode = f.error();
                   const QString etxt = f.errorString();
                   f.close();
-                  if (ecode != MusEFile::File::NoError) {
-                        QMessageBox::critical(this, QString("MusE"),
-                          tr("File read error") + QString(": ") + etxt);
+                  if (ecode != MusEFile::File::NoError || !xml.readError().isEmpty()) {
+                        criticalMessage(tr("File read error") + QString(": ") +
+                                        (ecode != MusEFile::File::NoError ? etxt : xml.readError()));
                         setUntitledProject();
                         _lastProjectFilePath = QString();
+                        recovering = false;
+                        }
+                  else if (recovering) {
+                        const int n = MusECore::AutosaveJournal::replay(fi.filePath());
+                        fprintf(stderr, "Recovered autosave of %s, replayed %d journal records\n",
+                                fi.filePath().toLocal8Bit().constData(), n);
                         }
                   }
             }
@@ -1961,8 +2050,7 @@ bool MusE::loadProjectFile1(const QString& name, bool songTemplate, bool doReadM
             }
             }
       else {
-            QMessageBox::critical(this, QString("MusE"),
-               tr("Unknown File Format: %1").arg(ex));
+            criticalMessage(tr("Unknown File Format: %1").arg(ex));
             setUntitledProject();
             _lastProjectFilePath = QString();
             }
@@ -2030,6 +2118,10 @@ bool MusE::loadProjectFile1(const QString& name, bool songTemplate, bool doReadM
       //  these flags which are already sent in the call to MusE::read() above:
       MusEGlobal::song->update(~SC_TRACK_INSERTED);
       MusEGlobal::song->updatePos();
+      // A recovered song is not saved yet. It keeps its autosave until it is.
+      _autosave->reset(songTemplate ? QString() : project.filePath(), recovering);
+      if (recovering)
+            setDirty();
       arrangerView->clipboardChanged(); // enable/disable "Paste"
       arrangerView->selectionChanged(); // enable/disable "Copy" & "Paste"
       arrangerView->scoreNamingChanged(); // inform the score menus about the new scores and their names
@@ -2090,8 +2182,7 @@ bool MusE::finishLoadProjectFile1(const QString& name, bool songTemplate, bool d
       if (songTemplate)
       {
             if(!fi.isReadable()) {
-                QMessageBox::critical(this, QString("MusE"),
-                    tr("Cannot read template"));
+                criticalMessage(tr("Cannot read template"));
                 return false;
                 }
             project.setFile(MusEGui::getUniqueUntitledName());
@@ -2114,11 +2205,12 @@ bool MusE::finishLoadProjectFile1(const QString& name, bool songTemplate, bool d
       if((mex == "gz") || (mex == "bz2"))
         mex = ex.section('.', -2, -2);
 
-      if (ex.isEmpty() || mex == "med") {
+      bool recovering = false;
+      if (ex.isEmpty() || mex == "med" || mex == "medb") {
             //
             //  read *.med file
             //
-            MusEFile::File f(fi.filePath(), QString(".med"), this);
+            MusEFile::File f(autosaveRecoveryFile(fi.filePath(), songTemplate, &recovering), QString(".med"), this);
             const bool isCompressed = f.isCompressed();
 
             const MusEFile::File::ErrorCode ecode = fileOpen(f, QIODevice::ReadOnly, this, true);
@@ -2136,7 +2228,7 @@ bool MusE::finishLoadProjectFile1(const QString& name, bool songTemplate, bool d
 
                 default:
                   // FIXME: TODO: Correct replacement for previous "if (errno != ENOENT)" ?
-                  QMessageBox::critical(this, QString("MusE"), tr("File open error"));
+                  criticalMessage(tr("File open error"));
                   setUntitledProject();
                   _lastProjectFilePath = QString();
                 break;
@@ -2179,7 +2271,7 @@ bool MusE::finishLoadProjectFile1(const QString& name, bool songTemplate, bool d
 
                           default:
                             // FIXME: TODO: Correct replacement for previous "if (errno != ENOENT)" ?
-                            QMessageBox::critical(this, QString("MusE"), tr("File open error"));
+                            criticalMessage(tr("File open error"));
                             setUntitledProject();
                             _lastProjectFilePath = QString();
                           break;
@@ -2221,11 +2313,13 @@ bool MusE::finishLoadProjectFile1(const QString& name, bool songTemplate, bool d
                            " current system rate (%1Hz):").arg(MusEGlobal::sampleRate);
                       }
 
-                      bool ok;
-                      const int res = QInputDialog::getInt(
-                        this, tr("Project sample rate"),
-                        sugg_phrase, sugg_val,
-                        0, (10 * 1000 * 1000), 1, &ok);
+                      bool ok = true;
+                      int res = sugg_val;
+                      if(!_headless)
+                        res = QInputDialog::getInt(
+                          this, tr("Project sample rate"),
+                          sugg_phrase, sugg_val,
+                          0, (10 * 1000 * 1000), 1, &ok);
 
                       if(ok)
                         MusEGlobal::projectSampleRate = res;
@@ -2246,7 +2340,10 @@ bool MusE::finishLoadProjectFile1(const QString& name, bool songTemplate, bool d
                         "The files can be permanently converted to the new sample rate.\n\n"
                         "Save this song if you are sure you didn't mean to open it\n"
                         " at the original sample rate.").arg(MusEGlobal::projectSampleRate).arg(MusEGlobal::sampleRate);
-                      QMessageBox::warning(MusEGlobal::muse,"Wrong sample rate", msg);
+                      if(_headless)
+                        fprintf(stderr, "Warning: %s\n", msg.toLocal8Bit().constData());
+                      else
+                        QMessageBox::warning(MusEGlobal::muse,"Wrong sample rate", msg);
                       // Automatically convert the project.
                       // No: Try to keep the rate until user tells it to change.
                       //convertProjectSampleRate();
@@ -2263,11 +2360,17 @@ bool MusE::finishLoadProjectFile1(const QString& name, bool songTemplate, bool d
                   const MusEFile::File::ErrorCode ecode = f.error();
                   const QString etxt = f.errorString();
                   f.close();
-                  if (ecode != MusEFile::File::NoError) {
-                        QMessageBox::critical(this, QString("MusE"),
-                          tr("File read error") + QString(": ") + etxt);
+                  if (ecode != MusEFile::File::NoError || !xml.readError().isEmpty()) {
+                        criticalMessage(tr("File read error") + QString(": ") +
+                                        (ecode != MusEFile::File::NoError ? etxt : xml.readError()));
                         setUntitledProject();
                         _lastProjectFilePath = QString();
+                        recovering = false;
+                        }
+                  else if (recovering) {
+                        const int n = MusECore::AutosaveJournal::replay(fi.filePath());
+                        fprintf(stderr, "Recovered autosave of %s, replayed %d journal records\n",
+                                fi.filePath().toLocal8Bit().constData(), n);
                         }
                   }
             }
@@ -2280,8 +2383,7 @@ bool MusE::finishLoadProjectFile1(const QString& name, bool songTemplate, bool d
             }
             }
       else {
-            QMessageBox::critical(this, QString("MusE"),
-               tr("Unknown File Format: %1").arg(ex));
+            criticalMessage(tr("Unknown File Format: %1").arg(ex));
             setUntitledProject();
             _lastProjectFilePath = QString();
             }
@@ -2349,6 +2451,10 @@ bool MusE::finishLoadProjectFile1(const QString& name, bool songTemplate, bool d
       //  these flags which are already sent in the call to MusE::read() above:
       MusEGlobal::song->update(~SC_TRACK_INSERTED);
       MusEGlobal::song->updatePos();
+      // A recovered song is not saved yet. It keeps its autosave until it is.
+      _autosave->reset(songTemplate ? QString() : project.filePath(), recovering);
+      if (recovering)
+            setDirty();
       arrangerView->clipboardChanged(); // enable/disable "Paste"
       arrangerView->selectionChanged(); // enable/disable "Copy" & "Paste"
       arrangerView->scoreNamingChanged(); // inform the score menus about the new scores and their names
@@ -2723,9 +2829,33 @@ bool MusE::save(const QString& name, bool overwriteWarn, bool writeTopwins)
       MusEFile::File::ErrorCode res = MusEGui::fileOpen(f, QIODevice::WriteOnly, this, false, overwriteWarn);
       if (res != MusEFile::File::NoError)
             return false;
-      MusECore::Xml xml(f.iodevice());
-      write(xml, writeTopwins);
-      if (f.error() != MusEFile::File::NoError) {
+
+      // Destructive wave edits are kept in block stores until the project is saved.
+      MusEGlobal::audio->msgIdle(true);
+      const bool waveErr = MusEGlobal::sndFiles.commitBlocks();
+      MusEGlobal::audio->msgIdle(false);
+      if (waveErr)
+            QMessageBox::warning(this, tr("MusE: Write File failed"),
+               tr("Some wave edits could not be written to their sound files.\n"
+                  "They are kept until the next save."));
+
+      bool chunkErr = false;
+      // A .medb file is a chunk file: the song text with events and
+      //  automation stored in binary chunks, much faster to write.
+      if (f.filePath().endsWith(".medb", Qt::CaseInsensitive)) {
+            QBuffer songText;
+            songText.open(QIODevice::WriteOnly);
+            MusECore::XmlChunkWriter chunks;
+            MusECore::Xml xml(&songText);
+            xml.setChunkWriter(&chunks);
+            write(xml, writeTopwins);
+            chunkErr = !chunks.write(f.iodevice(), songText.data());
+            }
+      else {
+            MusECore::Xml xml(f.iodevice());
+            write(xml, writeTopwins);
+            }
+      if (chunkErr || f.error() != MusEFile::File::NoError) {
             QString s = "Write File\n" + name + "\nfailed: "
                + f.errorString();
             QMessageBox::critical(this,
@@ -2740,6 +2870,7 @@ bool MusE::save(const QString& name, bool overwriteWarn, bool writeTopwins)
             MusEGlobal::song->dirty = false;
             setWindowTitle(projectTitle(project.absoluteFilePath()));
             saveIncrement = 0;
+            _autosave->reset(name);
             setStatusBarText(tr("Project saved."), 600);
             return true;
             }
@@ -2767,7 +2898,8 @@ void MusE::closeEvent(QCloseEvent* event)
     while (MusEGlobal::audio->isPlaying()) {
         qApp->processEvents();
     }
-    if (MusEGlobal::song->dirty) {
+    // A headless render never saves anything.
+    if (MusEGlobal::song->dirty && !_headless) {
         int n = 0;
         n = QMessageBox::warning(this, appName,
                                  tr("The current project contains unsaved data.\n"
@@ -2789,6 +2921,9 @@ void MusE::closeEvent(QCloseEvent* event)
         }
     }
 
+    // Saved or discarded. The autosave is not needed any more.
+    _autosave->reset(QString());
+    _autosave->stop();
 
     seqStop();
 
@@ -2805,14 +2940,16 @@ void MusE::closeEvent(QCloseEvent* event)
     //      QSettings settings;
     //      settings.setValue("MusE/geometry", saveGeometry());
 
-    MusEGlobal::config.geometryMain = geometry();
+    if (!_headless) {
+        MusEGlobal::config.geometryMain = geometry();
 
-    // must be done here as the close events of child windows are not always called on quit
-    saveStateTopLevels();
+        // must be done here as the close events of child windows are not always called on quit
+        saveStateTopLevels();
 
-    saveStateExtra();
+        saveStateExtra();
 
-    writeGlobalConfiguration();
+        writeGlobalConfiguration();
+    }
 
     if(MusEGlobal::debugMsg)
         fprintf(stderr, "MusE: Exiting JackAudio\n");
@@ -2844,7 +2981,7 @@ void MusE::closeEvent(QCloseEvent* event)
         QFileInfo fi(filename);
         QDir d = fi.dir();
         d.remove(filename);
-        d.remove(fi.completeBaseName() + ".wca");
+        MusECore::SndFile::removePeakFiles(filename);
     }
 
     if(MusEGlobal::usePythonBridge)
@@ -2876,6 +3013,9 @@ void MusE::closeEvent(QCloseEvent* event)
     MusECore::exitOSC();
 
     delete MusEGlobal::audioPrefetch;
+    MusECore::exitAudioGraphExecutor();
+    MusECore::PeakBuilder::stop();
+    MusECore::RecordWriter::stop();
     delete MusEGlobal::audio;
 
     // Destroy the sequencer object if it exists.
@@ -4312,6 +4452,251 @@ void MusE::bounceToFile(MusECore::AudioOutput* ao)
     MusEGlobal::song->setPlay(true);
 }
 
+//---------------------------------------------------------
+//   renderToFile
+//    Command line version of bounceToFile.
+//---------------------------------------------------------
+
+bool MusE::renderToFile(const QString& path, const QString& range)
+{
+    if(MusEGlobal::audio->bounce())
+        return false;
+    MusEGlobal::song->bounceOutput = nullptr;
+    MusEGlobal::song->bounceTrack = nullptr;
+
+    // If only one output, pick it, else pick the first selected, else the first.
+    MusECore::OutputList* ol = MusEGlobal::song->outputs();
+    if(ol->empty())
+    {
+        fprintf(stderr, "Error: render: No audio output tracks found\n");
+        return false;
+    }
+    MusECore::AudioOutput* ao = ol->front();
+    for(MusECore::iAudioOutput iao = ol->begin(); iao != ol->end(); ++iao)
+    {
+        if((*iao)->selected())
+        {
+            ao = *iao;
+            break;
+        }
+    }
+
+    unsigned start = MusEGlobal::song->lPos().frame();
+    unsigned end   = MusEGlobal::song->rPos().frame();
+    if(!range.isEmpty() && range.toUpper() != "L-R")
+    {
+        const int sep = range.indexOf('-');
+        bool ok_start = false;
+        bool ok_end = true;
+        const double start_sec = range.left(sep).toDouble(&ok_start);
+        const QString end_str = sep < 0 ? QString() : range.mid(sep + 1);
+        double end_sec = 0.0;
+        if(!end_str.isEmpty())
+            end_sec = end_str.toDouble(&ok_end);
+        if(sep < 0 || !ok_start || !ok_end || start_sec < 0.0)
+        {
+            fprintf(stderr, "Error: render: Invalid range: %s\n", range.toLocal8Bit().constData());
+            return false;
+        }
+        start = start_sec * MusEGlobal::sampleRate;
+        if(end_str.isEmpty())
+            end = MusECore::Pos(MusEGlobal::song->len(), true).frame();
+        else
+            end = end_sec * MusEGlobal::sampleRate;
+    }
+    if(end <= start)
+    {
+        fprintf(stderr, "Error: render: Empty range\n");
+        return false;
+    }
+    MusEGlobal::song->setPos(MusECore::Song::LPOS, MusECore::Pos(start, false));
+    MusEGlobal::song->setPos(MusECore::Song::RPOS, MusECore::Pos(end, false));
+
+    QString fname = path;
+    if(QFileInfo(fname).suffix().isEmpty())
+        fname += ".wav";
+    // As with the mixdown dialog, simply remove any old file.
+    if(QFileInfo::exists(fname))
+        QFile::remove(fname);
+    MusECore::SndFile* sf = new MusECore::SndFile(fname);
+    sf->setFormat(SF_FORMAT_WAV | SF_FORMAT_FLOAT, ao->channels(), MusEGlobal::sampleRate);
+
+    // Switch all wave converters to offline settings mode.
+    MusEGlobal::song->setAudioConvertersOfflineOperation(true);
+
+    // This will wait a few cycles until freewheel is set and a seek is done.
+    MusEGlobal::audio->msgBounce();
+    MusEGlobal::song->bounceOutput = ao;
+    ao->setRecFile(sf);
+    MusEGlobal::song->setRecord(true, false);
+    MusEGlobal::song->setRecordFlag(ao, true);
+    ao->prepareRecording();
+    MusEGlobal::song->setPlay(true);
+
+    // The bounce output is reset when the transport stops at the right locator
+    //  and the recording is finished, which happens in the event loop.
+    QElapsedTimer timer;
+    timer.start();
+    bool started = false;
+    int last_percent = -1;
+    while(MusEGlobal::song->bounceOutput == ao)
+    {
+        qApp->processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents);
+        if(MusEGlobal::audio->isPlaying())
+            started = true;
+        else if(!started && timer.elapsed() > 30000)
+        {
+            fprintf(stderr, "Error: render: Transport did not start\n");
+            MusEGlobal::song->setStop(true);
+            // The transport never rolled, so nothing stopped the bounce.
+            //  Undo the setup like the end of a recording does.
+            MusEGlobal::song->bounceOutput = nullptr;
+            MusEGlobal::song->setRecordFlag(ao, false);
+            ao->setRecFile(nullptr); // Deletes the sound file.
+            MusEGlobal::song->setRecord(false);
+            MusEGlobal::song->setAudioConvertersOfflineOperation(false);
+            QFile::remove(fname);
+            return false;
+        }
+        const unsigned pos = MusEGlobal::audio->pos().frame();
+        if(started && pos >= start)
+        {
+            const int percent = pos >= end ? 100 : (int)(100.0 * (pos - start) / (end - start));
+            if(percent != last_percent)
+            {
+                fprintf(stderr, "\rRendering: %3d%%", percent);
+                last_percent = percent;
+            }
+        }
+    }
+    fprintf(stderr, "\rRendered %s in %.1f seconds\n", fname.toLocal8Bit().constData(), timer.elapsed() / 1000.0);
+    return true;
+}
+
+
+//---------------------------------------------------------
+//   freezeTrack
+//    Bounces the track in freewheel mode from the song start
+//    to its end plus a tail, capturing the data after its
+//    plugin chain.
+//---------------------------------------------------------
+
+void MusE::freezeTrack(MusECore::AudioTrack* track)
+      {
+      if(!track || !track->canFreeze() || track->isFrozen())
+        return;
+
+      if(MusEGlobal::audio->isPlaying() || MusEGlobal::audio->bounce())
+      {
+        QMessageBox::critical(this, tr("MusE: Freeze Track"),
+            tr("Stop the transport before freezing a track"));
+        return;
+      }
+      if(track->off() || track->isMute())
+      {
+        QMessageBox::critical(this, tr("MusE: Freeze Track"),
+            tr("Cannot freeze a muted or disabled track"));
+        return;
+      }
+
+      QDir dir(MusEGlobal::museProject + QString("/frozen"));
+      if(!dir.exists() && !dir.mkpath("."))
+      {
+        QMessageBox::critical(this, tr("MusE: Freeze Track"),
+            tr("Cannot create directory %1").arg(dir.path()));
+        return;
+      }
+      QString base = track->name();
+      base.replace('/', '_');
+      QString path;
+      for(int i = 1; ; ++i)
+      {
+        path = dir.filePath(QString("%1_%2.wav").arg(base).arg(i));
+        if(!QFile::exists(path))
+          break;
+      }
+
+      // No converters are needed, the file is streamed at the project rate.
+      MusECore::SndFileR sf(new MusECore::SndFile(path, false));
+      sf.setFormat(SF_FORMAT_WAV | SF_FORMAT_FLOAT, track->channels(), MusEGlobal::sampleRate);
+      if(sf.openWrite())
+      {
+        QMessageBox::critical(this, tr("MusE: Freeze Track"),
+            tr("Cannot create file %1").arg(path));
+        return;
+      }
+
+      // Render from the song start to its end, plus a few seconds for reverb tails etc.
+      const MusECore::Pos old_lpos = MusEGlobal::song->lPos();
+      const MusECore::Pos old_rpos = MusEGlobal::song->rPos();
+      const unsigned end = MusECore::Pos(MusEGlobal::song->len(), true).frame() + 2 * MusEGlobal::sampleRate;
+      MusEGlobal::song->setPos(MusECore::Song::LPOS, MusECore::Pos(0, false));
+      MusEGlobal::song->setPos(MusECore::Song::RPOS, MusECore::Pos(end, false));
+
+      QApplication::setOverrideCursor(Qt::WaitCursor);
+      MusEGlobal::song->setAudioConvertersOfflineOperation(true);
+      // Hand the file to the audio thread, which writes to it while rendering.
+      MusECore::PendingOperationList operations;
+      operations.add(MusECore::PendingOperationItem(track, sf, MusECore::PendingOperationItem::SetTrackFreezeRecFile));
+      MusEGlobal::audio->msgExecutePendingOperations(operations);
+      // This will wait a few cycles until freewheel is set and a seek is done.
+      MusEGlobal::audio->msgBounce(true);
+      MusEGlobal::song->setPlay(true);
+
+      // The transport stops by itself at the right locator.
+      QElapsedTimer timer;
+      timer.start();
+      bool started = false;
+      while(true)
+      {
+        qApp->processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents);
+        if(MusEGlobal::audio->isPlaying())
+          started = true;
+        else if(started || timer.elapsed() > 10000)
+          break;
+      }
+
+      // Take it back before closing it.
+      operations.clear();
+      operations.add(MusECore::PendingOperationItem(track, MusECore::SndFileR(), MusECore::PendingOperationItem::SetTrackFreezeRecFile));
+      MusEGlobal::audio->msgExecutePendingOperations(operations);
+      sf.close();
+      MusEGlobal::song->setPos(MusECore::Song::LPOS, old_lpos);
+      MusEGlobal::song->setPos(MusECore::Song::RPOS, old_rpos);
+      QApplication::restoreOverrideCursor();
+
+      if(!started)
+      {
+        MusEGlobal::song->setAudioConvertersOfflineOperation(false);
+        QFile::remove(path);
+        QMessageBox::critical(this, tr("MusE: Freeze Track"),
+            tr("The transport did not start"));
+        return;
+      }
+
+      if(sf.openRead(false))
+      {
+        QMessageBox::critical(this, tr("MusE: Freeze Track"),
+            tr("Cannot read file %1").arg(path));
+        return;
+      }
+
+      MusEGlobal::song->applyOperation(MusECore::UndoOp(
+        MusECore::UndoOp::SetTrackFreeze, track, MusECore::SndFileR(), sf));
+      }
+
+//---------------------------------------------------------
+//   unfreezeTrack
+//    The freeze file is kept, so that the unfreeze can be undone.
+//---------------------------------------------------------
+
+void MusE::unfreezeTrack(MusECore::AudioTrack* track)
+      {
+      if(!track || !track->isFrozen())
+        return;
+      MusEGlobal::song->applyOperation(MusECore::UndoOp(
+        MusECore::UndoOp::SetTrackFreeze, track, track->freezeFile(), MusECore::SndFileR()));
+      }
 
 //---------------------------------------------------------
 //   checkRegionNotNull
@@ -4422,6 +4807,8 @@ bool MusE::clearSong(bool clear_all)
                 return false;
             break;
         case 1:
+            // Discarded. The autosave is not needed any more.
+            _autosave->reset(QString());
             break;
         case 2:
             return false;
@@ -4541,6 +4928,8 @@ bool MusE::clearSong(bool clear_all)
                 return false;
             break;
         case 1:
+            // Discarded. The autosave is not needed any more.
+            _autosave->reset(QString());
             break;
         case 2:
             return false;
@@ -5566,13 +5955,18 @@ void MusE::saveTimerSlot()
         //printf("conditions not met, ignore %d %d\n", MusEGlobal::config.autoSave, MusEGlobal::song->dirty);
         return;
     }
+    // Changed parts and automation go to the autosave journal right away.
+    if (_autosave->writeChanges(project.filePath()))
+        return;
+    // Other changes need a snapshot of the whole song, at most every five minutes.
     saveIncrement++;
     if (saveIncrement > 4) {
         // printf("five minutes passed %d %d\n", MusEGlobal::config.autoSave, MusEGlobal::song->dirty);
         // time to see if we are allowed to save, if so. Do
         if (MusEGlobal::audio->isPlaying() == false) {
             fprintf(stderr, "Performing autosave\n");
-            save(project.filePath(), false, writeTopwinState);
+            _autosave->writeBase(project.filePath(), autosaveSnapshot());
+            saveIncrement = 0;
         } else
         {
             //printf("isPlaying, can't save\n");
@@ -5580,6 +5974,61 @@ void MusE::saveTimerSlot()
     }
 }
 
+//---------------------------------------------------------
+//   autosaveSongChanged
+//---------------------------------------------------------
+
+void MusE::autosaveSongChanged(MusECore::SongChangedStruct_t flags)
+{
+    _autosave->songChanged(flags);
+}
+
+//---------------------------------------------------------
+//   autosaveSnapshot
+//    The serialising is done here, the writing by the
+//    autosave thread.
+//---------------------------------------------------------
+
+QByteArray MusE::autosaveSnapshot() const
+{
+    QBuffer songText;
+    songText.open(QIODevice::WriteOnly);
+    MusECore::XmlChunkWriter chunks;
+    MusECore::Xml xml(&songText);
+    xml.setChunkWriter(&chunks);
+    write(xml, writeTopwinState);
+
+    QBuffer file;
+    file.open(QIODevice::WriteOnly);
+    chunks.write(&file, songText.data());
+    return file.data();
+}
+
+//---------------------------------------------------------
+//   autosaveRecoveryFile
+//---------------------------------------------------------
+
+QString MusE::autosaveRecoveryFile(const QString& name, bool songTemplate, bool* recovering)
+{
+    *recovering = false;
+    if (songTemplate || !MusECore::AutosaveJournal::hasRecovery(name))
+        return name;
+    if (_headless) {
+        fprintf(stderr, "Warning: %s has an autosave with unsaved changes. It is not recovered.\n",
+                name.toLocal8Bit().constData());
+        return name;
+    }
+    const int n = QMessageBox::warning(this, appName,
+                                       tr("This project has an autosave with changes which were not saved.\n"
+                                          "MusE may not have been closed properly.\n\n"
+                                          "Recover the changes? Otherwise the autosave is discarded."),
+                                       tr("&Recover"), tr("&Discard"), QString(), 0, 1);
+    if (n != 0)
+        return name;
+    *recovering = true;
+    return MusECore::AutosaveJournal::recoveryFile(name);
+}
+
 void MusE::toggleTrackArmSelectedTrack()
 {
     // If there is only one track selected we toggle it's rec-arm status.
@@ -5719,9 +6168,8 @@ bool MusE::importWaveToTrack(QString& name, unsigned tick, MusECore::Track* trac
 
         QFileInfo fi(f.name());
 
-        //remove old peak-file to cut down on clutter. It will be recreated at the new wave location
-        QString cacheName = fi.absolutePath() + QString("/") + fi.completeBaseName() + QString(".wca");
-        QFile::remove(cacheName);
+        //remove old peak-files to cut down on clutter. They will be recreated at the new wave location
+        MusECore::SndFile::removePeakFiles(fi.filePath());
 
         if(MusEGlobal::museProject == MusEGlobal::museProjectInitPath)
         {
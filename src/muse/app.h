@@ -28,6 +28,7 @@
 #include "config.h"
 #include "globaldefs.h"
 #include "cobject.h"
+#include "type_defs.h"
 
 #include <QFileInfo>
 #include <QMainWindow>
@@ -67,6 +68,8 @@ class QAction;
 
 namespace MusECore {
 class AudioOutput;
+class AudioTrack;
+class AutosaveJournal;
 class MidiInstrument;
 class MidiPort;
 class MidiTrack;
@@ -300,6 +303,11 @@ class MusE : public QMainWindow
 
     // Set to restart MusE (almost) from scratch before calling close().
     bool _isRestartingApp;
+    // Running without a visible main window, for command line rendering.
+    // No dialogs are shown and the configuration is not saved.
+    bool _headless;
+    // Shows an error message box, or prints the message to stderr when headless.
+    void criticalMessage(const QString& text);
 
 //    bool readMidi(FILE*);
     void read(MusECore::Xml& xml, bool doReadMidiPorts, bool isTemplate);
@@ -340,6 +348,11 @@ class MusE : public QMainWindow
     QTimer *blinkTimer;
     QTimer *messagePollTimer;
     int saveIncrement;
+    MusECore::AutosaveJournal* _autosave;
+    // Writes the song as a chunk file, for autosave base snapshots.
+    QByteArray autosaveSnapshot() const;
+    // Asks whether to recover an autosave of the project. Returns the file to load.
+    QString autosaveRecoveryFile(const QString& name, bool songTemplate, bool* recovering);
 
     timeval lastCpuTime;
     timespec lastSysTime;
@@ -366,6 +379,7 @@ private slots:
     void heartBeat();
     void blinkTimerSlot();
     void saveTimerSlot();
+    void autosaveSongChanged(MusECore::SongChangedStruct_t);
     void messagePollTimerSlot();
     void loadProject();
     bool save();
@@ -439,6 +453,10 @@ public slots:
     void saveAsTemplate();
     void bounceToFile(MusECore::AudioOutput* ao = nullptr);
     void bounceToTrack(MusECore::AudioOutput* ao = nullptr);
+    // Renders a wave or synth track, including its plugins, to a freeze file
+    //  which is played back instead. Both are undoable.
+    void freezeTrack(MusECore::AudioTrack* track);
+    void unfreezeTrack(MusECore::AudioTrack* track);
     void closeEvent(QCloseEvent*event) override;
     void loadProjectFile(const QString&);
 #ifdef USE_SENDPOSTEDEVENTS_FOR_TOPWIN_CLOSE
@@ -521,6 +539,15 @@ public:
     bool restartingApp() const { return _isRestartingApp;}
     // Set to restart MusE (almost) from scratch before calling close().
     void setRestartingApp(bool v) { _isRestartingApp = v;}
+    // Whether running without a visible main window, for command line rendering.
+    bool headless() const { return _headless; }
+    // Set before loading a song. No dialogs are shown and the configuration is not saved.
+    void setHeadless(bool v) { _headless = v; }
+    // Renders the song's audio output to a wave file as fast as possible, without
+    //  user interaction. The range is either "L-R" for the left and right locators,
+    //  or "start-end" in seconds, where an empty end means the end of the song.
+    // The audio device must be a dummy device in offline mode. Returns true on success.
+    bool renderToFile(const QString& path, const QString& range);
     Arranger* arranger() const { return _arranger; }
     int arrangerRaster() const;
     int currentPartColorIndex() const;
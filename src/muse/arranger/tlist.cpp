@@ -2567,6 +2567,22 @@ void TList::mousePressEvent(QMouseEvent* ev)
                 a->setData(1021);
                 p->addSeparator();
 
+                if (t->type() == MusECore::Track::WAVE || t->type() == MusECore::Track::AUDIO_SOFTSYNTH)
+                {
+                    if (static_cast<MusECore::AudioTrack*>(t)->isFrozen())
+                    {
+                        a = p->addAction(tr("Unfreeze Track"));
+                        a->setData(1023);
+                    }
+                    else
+                    {
+                        a = p->addAction(tr("Freeze Track"));
+                        a->setData(1022);
+                        a->setEnabled(!MusEGlobal::audio->isPlaying());
+                    }
+                    p->addSeparator();
+                }
+
                 if (t->type()==MusECore::Track::DRUM)
                 {
                     a=p->addAction(tr("Save Track's Drumlist"));
@@ -2656,6 +2672,12 @@ void TList::mousePressEvent(QMouseEvent* ev)
                             MusEGlobal::song->update(SC_TRACK_MODIFIED);
                         }
                             break;
+                        case 1022:
+                            MusEGlobal::muse->freezeTrack(static_cast<MusECore::AudioTrack*>(t));
+                            break;
+                        case 1023:
+                            MusEGlobal::muse->unfreezeTrack(static_cast<MusECore::AudioTrack*>(t));
+                            break;
 
                         case 1010:
                             saveTrackDrummap((MusECore::MidiTrack*)t, true);
@@ -24,6 +24,7 @@
 
 #include "muse_math.h"
 #include <set>
+#include <cstring>
 #include <errno.h>
 #include <fcntl.h>
 
@@ -34,6 +35,7 @@
 #include "mididev.h"
 #include "alsamidi.h"
 #include "audioprefetch.h"
+#include "audio_graph.h"
 #include "audio.h"
 #include "tempo.h"
 #include "wave.h"
@@ -59,6 +61,7 @@
 #include "synth.h"
 #include "undo.h"
 #include "operations.h"
+#include "plugin_bridge.h"
 
 #ifdef _WIN32
 #define pipe(fds) _pipe(fds, 4096, _O_BINARY)
@@ -188,6 +191,12 @@ Audio::Audio()
       
       _ignoreNextEnableAllControllers = false;
 
+      // Differ, so that the first cycle scans.
+      _latencySerial = 1;
+      _latencyScanSerial = 0;
+      _latencyScanKey = 0;
+      _latencyScanCount = 0;
+
       //---------------------------------------------------
       //  establish pipes/sockets
       //---------------------------------------------------
@@ -707,6 +716,10 @@ void Audio::shutdown()
 void Audio::process(unsigned frames)
       {
       _curCycleFrames = frames;
+#ifdef PLUGIN_BRIDGE_SUPPORT
+      // One budget for all the bridged plugins of this cycle.
+      PluginBridge::beginCycle(frames);
+#endif
       if (!MusEGlobal::checkAudioDevice()) return;
       if (msg) {
             processMsg(msg);
@@ -962,6 +975,103 @@ void Audio::process(unsigned frames)
         _extClockHistorySize = 0;
       }
 
+//---------------------------------------------------------
+//   latencyKeyMix
+//---------------------------------------------------------
+
+static inline void latencyKeyMix(uint64_t& key, uint64_t v)
+{
+  key ^= v + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+}
+
+static inline void latencyKeyMixLatency(uint64_t& key, float latency)
+{
+  uint32_t bits;
+  memcpy(&bits, &latency, sizeof(bits));
+  latencyKeyMix(key, bits);
+}
+
+//---------------------------------------------------------
+//   latencyTrackKeyMix
+//---------------------------------------------------------
+
+static void latencyTrackKeyMix(uint64_t& key, Track* track)
+{
+  latencyKeyMix(key, (uintptr_t)track);
+  latencyKeyMix(key, track->off() | (track->canPassThruLatency() << 1));
+  latencyKeyMix(key, (track->inRoutes()->size() << 16) | track->outRoutes()->size());
+  if(track->isMidiTrack())
+  {
+    const MidiTrack* mt = static_cast<const MidiTrack*>(track);
+    latencyKeyMix(key, (mt->outPort() << 8) | mt->outChannel());
+  }
+  else
+  {
+    // Plugin and synth latencies, plus port latencies of input and output tracks.
+    const AudioTrack* at = static_cast<const AudioTrack*>(track);
+    const bool has_ports = track->type() == Track::AUDIO_INPUT || track->type() == Track::AUDIO_OUTPUT;
+    const int chans = has_ports ? at->channels() : 1;
+    for(int ch = 0; ch < chans; ++ch)
+      latencyKeyMixLatency(key, at->selfLatencyAudio(ch));
+  }
+}
+
+//---------------------------------------------------------
+//   latencyDeviceKeyMix
+//---------------------------------------------------------
+
+static void latencyDeviceKeyMix(uint64_t& key, MidiDevice* md)
+{
+  latencyKeyMix(key, (uintptr_t)md);
+  latencyKeyMix(key, (md->midiPort() << 8) | (md->openFlags() << 2) | (md->readEnable() << 1) | md->writeEnable());
+  latencyKeyMixLatency(key, md->selfLatencyMidi(0, true /*capture*/));
+  latencyKeyMixLatency(key, md->selfLatencyMidi(0, false /*playback*/));
+}
+
+//---------------------------------------------------------
+//   latencyInputsKey
+//    Returns a key of the latency scan inputs which change
+//     without bumping the latency serial: settings, on/off
+//     and monitoring states, route counts, and the latencies
+//     reported by plugins, synths and ports. Reading them is
+//     much cheaper than the scan, which walks the routes.
+//    Audio thread only.
+//---------------------------------------------------------
+
+uint64_t Audio::latencyInputsKey(const MetronomeSettings* metro_settings) const
+{
+  uint64_t key = 0;
+  latencyKeyMix(key,
+    MusEGlobal::config.enableLatencyCorrection |
+    (MusEGlobal::config.correctUnterminatedOutBranchLatency << 1) |
+    (MusEGlobal::config.correctUnterminatedInBranchLatency << 2) |
+    (MusEGlobal::config.monitoringAffectsLatency << 3) |
+    (MusEGlobal::config.commonProjectLatency << 4) |
+    (metro_settings->audioClickFlag << 5) |
+    (metro_settings->midiClickFlag << 6));
+  latencyKeyMix(key, (uintptr_t)metro_settings);
+  latencyKeyMix(key, (uintptr_t)MusEGlobal::song->bounceOutput);
+  latencyKeyMix(key, (uintptr_t)MusEGlobal::song->bounceTrack);
+
+  // This includes synthesizers.
+  const TrackList& tl = *MusEGlobal::song->tracks();
+  for(TrackList::size_type it = 0; it < tl.size(); ++it)
+    latencyTrackKeyMix(key, tl[it]);
+
+  for(ciMidiDevice imd = MusEGlobal::midiDevices.cbegin(); imd != MusEGlobal::midiDevices.cend(); ++imd)
+  {
+    MidiDevice* md = *imd;
+    // Device not in use?
+    if(md->midiPort() < 0 || md->midiPort() >= MusECore::MIDI_PORTS)
+      continue;
+    latencyDeviceKeyMix(key, md);
+  }
+
+  latencyTrackKeyMix(key, static_cast<AudioTrack*>(metronome));
+  latencyDeviceKeyMix(key, static_cast<MidiDevice*>(metronome));
+  return key;
+}
+
 //---------------------------------------------------------
 //   process1
 //---------------------------------------------------------
@@ -1004,37 +1114,46 @@ void Audio::process1(unsigned samplePos, unsigned offset, unsigned frames)
         //  audio processing, because THAT is done at the very end of this routine.
         // This will also reset the track's processed flag.         Tim.
         track->preProcessAlways();
-
-        // Reset some latency info to prepare for (re)computation.
-        track->prepareLatencyScan();
       }
 
-      // This includes synthesizers.
-      for(ciMidiDevice imd = mdl.cbegin(); imd != mdl.cend(); ++imd) 
-      {
-        MidiDevice* md = *imd;
-        // Device not in use?
-        if(md->midiPort() < 0 || md->midiPort() >= MusECore::MIDI_PORTS)
-          continue;
-
-        // Reset some latency info to prepare for (re)computation.
-        md->prepareLatencyScan();
-      }
-      
       // Pre-process the metronome.
       metronome->preProcessAlways();
-      // Reset some latency info to prepare for (re)computation.
-      static_cast<AudioTrack*>(metronome)->prepareLatencyScan();
-      static_cast<MidiDevice*>(metronome)->prepareLatencyScan();
 
       //---------------------------------------------
       // BEGIN Latency correction/compensation processing
-      // TODO: Instead of doing this blindly every cycle, do it only when
-      //        a latency controller changes or a connection is made etc,
-      //        ie only when something changes.
+      // The results are kept in the tracks and devices until
+      //  something changes, so only scan when the latency serial
+      //  or the key of the other latency inputs changed.
       //---------------------------------------------
 
-      if(MusEGlobal::config.enableLatencyCorrection)
+      const unsigned int latency_serial = _latencySerial.load(std::memory_order_acquire);
+      const uint64_t latency_key = latencyInputsKey(metro_settings);
+      const bool latency_rescan = latency_serial != _latencyScanSerial || latency_key != _latencyScanKey;
+      if(latency_rescan)
+      {
+        _latencyScanSerial = latency_serial;
+        _latencyScanKey = latency_key;
+        _latencyScanCount.fetch_add(1, std::memory_order_relaxed);
+
+        // Reset some latency info to prepare for (re)computation.
+        for(TrackList::size_type it = 0; it < tl_sz; ++it) 
+          tl[it]->prepareLatencyScan();
+
+        // This includes synthesizers.
+        for(ciMidiDevice imd = mdl.cbegin(); imd != mdl.cend(); ++imd) 
+        {
+          MidiDevice* md = *imd;
+          // Device not in use?
+          if(md->midiPort() < 0 || md->midiPort() >= MusECore::MIDI_PORTS)
+            continue;
+          md->prepareLatencyScan();
+        }
+
+        static_cast<AudioTrack*>(metronome)->prepareLatencyScan();
+        static_cast<MidiDevice*>(metronome)->prepareLatencyScan();
+      }
+
+      if(latency_rescan && MusEGlobal::config.enableLatencyCorrection)
       {
         float song_worst_latency = 0.0f;
         
@@ -1451,6 +1570,12 @@ void Audio::process1(unsigned samplePos, unsigned offset, unsigned frames)
       // Audio processing
       //---------------------------------------------
       
+      // If enabled, process the independent tracks concurrently first.
+      // Every track it processes is marked as processed, so the serial
+      //  passes below just gather the already computed buffers.
+      if(MusEGlobal::audioGraph)
+        MusEGlobal::audioGraph->process(samplePos, frames);
+
       // Process Aux tracks first.
       for(AuxList::size_type it = 0; it < aux_tl_sz; ++it) 
       {
@@ -1505,12 +1630,15 @@ void Audio::processMsg(AudioMsg* msg)
       switch(msg->id) {
             case AUDIO_ROUTEADD:
                   addRoute(msg->sroute, msg->droute);
+                  latencyChanged();
                   break;
             case AUDIO_ROUTEREMOVE:
                   removeRoute(msg->sroute, msg->droute);
+                  latencyChanged();
                   break;
             case AUDIO_REMOVEROUTES:      
                   removeAllRoutes(msg->sroute, msg->droute);
+                  latencyChanged();
                   break;
             case SEQM_SET_AUX:
                   msg->snode->setAuxSend(msg->ival, msg->dval);
@@ -1520,6 +1648,7 @@ void Audio::processMsg(AudioMsg* msg)
                   break;
             case AUDIO_SET_CHANNELS:
                   msg->snode->setChannels(msg->ival);
+                  latencyChanged();
                   break;
             case AUDIO_SEEK_PREV_AC_EVENT:
                   msg->snode->seekPrevACEvent(msg->ival);
@@ -1530,6 +1659,7 @@ void Audio::processMsg(AudioMsg* msg)
 
             case AUDIO_SET_SEND_METRONOME:
                   msg->snode->setSendMetronome((bool)msg->ival);
+                  latencyChanged();
                   break;
             
             case SEQM_RESET_DEVICES:
@@ -1579,6 +1709,11 @@ void Audio::processMsg(AudioMsg* msg)
                   
             case SEQM_IDLE:
                   idle = msg->a;
+                  // Structures may be edited while idle. Don't trust the audio graph until it is rebuilt.
+                  if(idle && MusEGlobal::audioGraph)
+                    MusEGlobal::audioGraph->invalidate();
+                  // Likewise the latency results.
+                  latencyChanged();
                   if(MusEGlobal::midiSeq)
                     MusEGlobal::midiSeq->sendMsg(msg);
                   break;
@@ -1589,6 +1724,7 @@ void Audio::processMsg(AudioMsg* msg)
 
             default:
                   MusEGlobal::song->processMsg(msg);
+                  latencyChanged();
                   break;
             }
       }
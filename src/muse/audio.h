@@ -41,6 +41,7 @@ class AudioDevice;
 class AudioTrack;
 class MidiDevice;
 class MidiInstrument;
+struct MetronomeSettings;
 class MidiPlayEvent;
 class MidiPort;
 class MidiTrack;
@@ -199,6 +200,14 @@ class Audio {
       // If set, tells the next call to seek() to NOT re-enable all controller streams.
       // The flag is reset in seek().
       std::atomic<bool> _ignoreNextEnableAllControllers;
+
+      // Incremented whenever the latency graph may have changed. See latencyChanged().
+      std::atomic<unsigned int> _latencySerial;
+      // Audio thread only. The serial and the key of the other inputs at the last latency scan.
+      unsigned int _latencyScanSerial;
+      uint64_t _latencyScanKey;
+      // Diagnostics. Number of latency scans run.
+      std::atomic<unsigned int> _latencyScanCount;
       
       // Can be called by any thread.
       void sendLocalOff();
@@ -212,6 +221,7 @@ class Audio {
       void panic();
       void processMsg(AudioMsg* msg);
       void process1(unsigned samplePos, unsigned offset, unsigned samples);
+      uint64_t latencyInputsKey(const MetronomeSettings*) const;
 
       void collectEvents(MidiTrack*, unsigned int startTick, unsigned int endTick,
                          unsigned int frames, unsigned int latency_offset);
@@ -296,7 +306,7 @@ class Audio {
       void msgResetMidiDevices();
       void msgIdle(bool);
       void msgAudioWait();
-      void msgBounce();
+      void msgBounce(bool forceFreewheel = false);
       void msgClearControllerEvents(AudioTrack*, int);
       void msgSeekPrevACEvent(AudioTrack*, int);
       void msgSeekNextACEvent(AudioTrack*, int);
@@ -356,6 +366,11 @@ class Audio {
       void sendMsgToGui(char c);
       bool bounce() const { return _bounceState == BounceStart || _bounceState == BounceOn; }
 
+      // Marks the latency graph as changed, so that the next cycle scans it again.
+      // Safe to call from any thread.
+      void latencyChanged() { _latencySerial.fetch_add(1, std::memory_order_release); }
+      unsigned int latencyScanCount() const { return _latencyScanCount.load(std::memory_order_relaxed); }
+
       long getXruns() { return m_Xruns; }
       void resetXruns() { m_Xruns = 0; }
       void incXruns() { m_Xruns++; }
@@ -0,0 +1,616 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  audio_graph.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <map>
+#include <set>
+
+#include "audio_graph.h"
+#include "globals.h"
+#include "gconfig.h"
+#include "song.h"
+#include "track.h"
+#include "route.h"
+
+// For debugging output: Uncomment the fprintf section.
+#define DEBUG_AUDIO_GRAPH(dev, format, args...) // fprintf(dev, format, ##args);
+
+namespace MusEGlobal {
+MusECore::AudioGraphExecutor* audioGraph = nullptr;
+}
+
+namespace MusECore {
+
+void initAudioGraphExecutor()
+{
+  MusEGlobal::audioGraph = new AudioGraphExecutor();
+}
+
+void exitAudioGraphExecutor()
+{
+  if(MusEGlobal::audioGraph)
+    delete MusEGlobal::audioGraph;
+  MusEGlobal::audioGraph = nullptr;
+}
+
+//---------------------------------------------------------
+//   cpuRelax
+//   Busy-wait helper. Yields every so often so that spinning
+//    realtime threads sharing a core do not starve each other.
+//---------------------------------------------------------
+
+static inline void cpuRelax(unsigned int& spins)
+{
+  if((++spins & 63) == 0)
+    sched_yield();
+  else
+  {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+  }
+}
+
+//---------------------------------------------------------
+//   AudioGraph
+//---------------------------------------------------------
+
+AudioGraph::AudioGraph()
+{
+  _numAudioThreadOnly = 0;
+  _serial = 0;
+  _trackListSize = 0;
+  _pending = nullptr;
+  _readyQueue = nullptr;
+  _rtReadyQueue = nullptr;
+}
+
+AudioGraph::~AudioGraph()
+{
+  if(_pending)
+    delete[] _pending;
+  if(_readyQueue)
+    delete[] _readyQueue;
+  if(_rtReadyQueue)
+    delete[] _rtReadyQueue;
+}
+
+//---------------------------------------------------------
+//   AudioGraphExecutor
+//---------------------------------------------------------
+
+AudioGraphExecutor::AudioGraphExecutor()
+{
+  _semInit = (sem_init(&_wakeSem, 0, 0) == 0);
+  if(!_semInit)
+    fprintf(stderr, "AudioGraphExecutor: sem_init failed: %s\n", strerror(errno));
+  _quit.store(false);
+  _realTimePriority = 0;
+  _graph.store(nullptr);
+  _graphInUse.store(nullptr);
+  _serial.store(0);
+  _cycleGraph = nullptr;
+  _cyclePos = 0;
+  _cycleFrames = 0;
+  _readyPush.store(0);
+  _readyPop.store(0);
+  _rtReadyPush.store(0);
+  _rtReadyPop = 0;
+  _remaining.store(0);
+  _workersDone.store(0);
+  _workersWoken = 0;
+  _rebuildCount.store(0);
+  _parallelCycles.store(0);
+}
+
+AudioGraphExecutor::~AudioGraphExecutor()
+{
+  stop();
+  AudioGraph* g = _graph.exchange(nullptr);
+  if(g)
+    delete g;
+  if(_semInit)
+    sem_destroy(&_wakeSem);
+}
+
+//---------------------------------------------------------
+//   start
+//   Spawns the worker threads if parallel processing is enabled.
+//   Call from the gui thread, with audio stopped or idle.
+//---------------------------------------------------------
+
+void AudioGraphExecutor::start(int realTimePriority)
+{
+  stop();
+
+  if(!_semInit || !MusEGlobal::config.parallelAudioGraph)
+    return;
+
+  int n = MusEGlobal::config.audioGraphThreads;
+  if(n <= 0)
+  {
+    // Automatic. One less than the number of cores, since the audio thread also participates.
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    n = cores > 1 ? cores - 1 : 0;
+  }
+  if(n <= 0)
+    return;
+
+  _realTimePriority = realTimePriority;
+  _quit.store(false);
+
+  for(int i = 0; i < n; ++i)
+  {
+    pthread_attr_t* attributes = 0;
+    if (MusEGlobal::realTimeScheduling && _realTimePriority > 0) {
+          attributes = (pthread_attr_t*) malloc(sizeof(pthread_attr_t));
+          pthread_attr_init(attributes);
+
+          if (pthread_attr_setschedpolicy(attributes, SCHED_FIFO)) {
+                fprintf(stderr, "cannot set FIFO scheduling class for audio graph RT thread\n");
+                }
+          if (pthread_attr_setscope (attributes, PTHREAD_SCOPE_SYSTEM)) {
+                fprintf(stderr, "Cannot set scheduling scope for audio graph RT thread\n");
+                }
+          if (pthread_attr_setinheritsched(attributes, PTHREAD_EXPLICIT_SCHED)) {
+                fprintf(stderr, "Cannot set setinheritsched for audio graph RT thread\n");
+                }
+
+          struct sched_param rt_param;
+          memset(&rt_param, 0, sizeof(rt_param));
+          rt_param.sched_priority = _realTimePriority;
+          if (pthread_attr_setschedparam (attributes, &rt_param)) {
+                fprintf(stderr, "Cannot set scheduling priority %d for audio graph RT thread (%s)\n",
+                   _realTimePriority, strerror(errno));
+                }
+          }
+
+    pthread_t thread;
+    int rv = pthread_create(&thread, attributes, workerLoop, this);
+    if(rv)
+    {
+      // Try again without attributes. See Thread::start().
+      if (MusEGlobal::realTimeScheduling && _realTimePriority > 0)
+        rv = pthread_create(&thread, nullptr, workerLoop, this);
+    }
+
+    if (attributes)
+    {
+      pthread_attr_destroy(attributes);
+      free(attributes);
+    }
+
+    if(rv)
+    {
+      fprintf(stderr, "creating audio graph worker thread failed: %s\n", strerror(rv));
+      break;
+    }
+    _threads.push_back(thread);
+  }
+
+  DEBUG_AUDIO_GRAPH(stderr, "AudioGraphExecutor::start: workers:%d priority:%d\n", (int)_threads.size(), _realTimePriority);
+}
+
+//---------------------------------------------------------
+//   stop
+//   Call from the gui thread, with audio stopped or idle.
+//---------------------------------------------------------
+
+void AudioGraphExecutor::stop()
+{
+  if(_threads.empty())
+    return;
+  _quit.store(true);
+  for(std::size_t i = 0; i < _threads.size(); ++i)
+    sem_post(&_wakeSem);
+  for(std::size_t i = 0; i < _threads.size(); ++i)
+    pthread_join(_threads[i], 0);
+  _threads.clear();
+  // Drain any left over wake-ups.
+  while(sem_trywait(&_wakeSem) == 0)
+    ;
+  _quit.store(false);
+}
+
+//---------------------------------------------------------
+//   workerLoop
+//---------------------------------------------------------
+
+void* AudioGraphExecutor::workerLoop(void* arg)
+{
+  AudioGraphExecutor* ex = static_cast<AudioGraphExecutor*>(arg);
+  while(true)
+  {
+    if(sem_wait(&ex->_wakeSem) != 0)
+    {
+      if(errno == EINTR)
+        continue;
+      break;
+    }
+    if(ex->_quit.load())
+      break;
+    ex->workerRun();
+  }
+  return 0;
+}
+
+//---------------------------------------------------------
+//   workerRun
+//   Claims and processes nodes from the general ready queue
+//    until every slot of the current cycle has been claimed.
+//---------------------------------------------------------
+
+void AudioGraphExecutor::workerRun()
+{
+  AudioGraph* g = _cycleGraph;
+  const int num_general = g->_nodes.size() - g->_numAudioThreadOnly;
+  while(true)
+  {
+    const int slot = _readyPop.fetch_add(1);
+    if(slot >= num_general)
+      break;
+    unsigned int spins = 0;
+    int idx;
+    // The slot is guaranteed to be filled eventually since every node is pushed exactly once.
+    while((idx = g->_readyQueue[slot].load(std::memory_order_acquire)) < 0)
+      cpuRelax(spins);
+    processNode(g, idx);
+  }
+  _workersDone.fetch_add(1, std::memory_order_acq_rel);
+}
+
+//---------------------------------------------------------
+//   processNode
+//---------------------------------------------------------
+
+void AudioGraphExecutor::processNode(AudioGraph* g, int idx)
+{
+  AudioTrack* track = g->_nodes[idx]._track;
+  // Processing with zero destination channels and the 'add' flag does all the
+  //  first-time work (data gathering, effects, controllers, meters, aux sends)
+  //  and caches the result without writing to any destination buffer.
+  float* dummy[MusECore::MAX_CHANNELS];
+  for(int i = 0; i < MusECore::MAX_CHANNELS; ++i)
+    dummy[i] = nullptr;
+  if(!track->processed())
+    track->copyData(_cyclePos, -1, track->channels(), 0, -1, -1, _cycleFrames, dummy, true);
+  nodeFinished(g, idx);
+}
+
+//---------------------------------------------------------
+//   nodeFinished
+//---------------------------------------------------------
+
+void AudioGraphExecutor::nodeFinished(AudioGraph* g, int idx)
+{
+  const AudioGraphNode& node = g->_nodes[idx];
+  for(int i = node._successorsBegin; i < node._successorsEnd; ++i)
+  {
+    const int s = g->_successors[i];
+    if(g->_pending[s].fetch_sub(1, std::memory_order_acq_rel) == 1)
+      pushReady(g, s);
+  }
+  _remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+//---------------------------------------------------------
+//   pushReady
+//---------------------------------------------------------
+
+void AudioGraphExecutor::pushReady(AudioGraph* g, int idx)
+{
+  if(g->_nodes[idx]._audioThreadOnly)
+  {
+    // Workers may also push here.
+    const int slot = _rtReadyPush.fetch_add(1, std::memory_order_acq_rel);
+    g->_rtReadyQueue[slot].store(idx, std::memory_order_release);
+  }
+  else
+  {
+    const int slot = _readyPush.fetch_add(1, std::memory_order_acq_rel);
+    g->_readyQueue[slot].store(idx, std::memory_order_release);
+  }
+}
+
+//---------------------------------------------------------
+//   helpUntilDone
+//   The audio thread processes its own nodes and helps with
+//    the general ones until all nodes are finished.
+//---------------------------------------------------------
+
+void AudioGraphExecutor::helpUntilDone(AudioGraph* g)
+{
+  const int num_general = g->_nodes.size() - g->_numAudioThreadOnly;
+  unsigned int spins = 0;
+  int idx;
+  while(_remaining.load(std::memory_order_acquire) > 0)
+  {
+    // Audio thread only nodes first.
+    if(_rtReadyPop < _rtReadyPush.load(std::memory_order_acquire))
+    {
+      const int slot = _rtReadyPop++;
+      while((idx = g->_rtReadyQueue[slot].load(std::memory_order_acquire)) < 0)
+        cpuRelax(spins);
+      processNode(g, idx);
+      continue;
+    }
+
+    // Only claim a general slot if it has been pushed, so that we never
+    //  block waiting on it while an audio thread only node becomes ready.
+    int slot = _readyPop.load(std::memory_order_acquire);
+    if(slot < num_general && slot < _readyPush.load(std::memory_order_acquire) &&
+       _readyPop.compare_exchange_weak(slot, slot + 1, std::memory_order_acq_rel))
+    {
+      while((idx = g->_readyQueue[slot].load(std::memory_order_acquire)) < 0)
+        cpuRelax(spins);
+      processNode(g, idx);
+      continue;
+    }
+
+    cpuRelax(spins);
+  }
+}
+
+//---------------------------------------------------------
+//   process
+//   Called by the audio thread.
+//---------------------------------------------------------
+
+bool AudioGraphExecutor::process(unsigned int pos, unsigned int frames)
+{
+  if(!MusEGlobal::config.parallelAudioGraph || _threads.empty())
+    return false;
+
+  AudioGraph* g = _graph.load();
+  if(!g)
+    return false;
+  // Announce that we are using the graph, then make sure it was not swapped out meanwhile.
+  _graphInUse.store(g);
+  if(_graph.load() != g ||
+     g->_serial != _serial.load() ||
+     g->_trackListSize != MusEGlobal::song->tracks()->size())
+  {
+    _graphInUse.store(nullptr);
+    return false;
+  }
+
+  // Audio inputs are processed by the audio thread first.
+  float* dummy[MusECore::MAX_CHANNELS];
+  for(int i = 0; i < MusECore::MAX_CHANNELS; ++i)
+    dummy[i] = nullptr;
+  for(std::vector<AudioTrack*>::const_iterator it = g->_serialTracks.cbegin(); it != g->_serialTracks.cend(); ++it)
+  {
+    AudioTrack* track = *it;
+    if(!track->processed())
+      track->copyData(pos, -1, track->channels(), 0, -1, -1, frames, dummy, true);
+  }
+
+  const int num_nodes = g->_nodes.size();
+  if(num_nodes == 0)
+  {
+    _graphInUse.store(nullptr);
+    return true;
+  }
+  const int num_general = num_nodes - g->_numAudioThreadOnly;
+
+  // Reset the per-cycle state.
+  for(int i = 0; i < num_nodes; ++i)
+  {
+    g->_pending[i].store(g->_nodes[i]._numPredecessors, std::memory_order_relaxed);
+    g->_readyQueue[i].store(-1, std::memory_order_relaxed);
+    g->_rtReadyQueue[i].store(-1, std::memory_order_relaxed);
+  }
+  _cycleGraph = g;
+  _cyclePos = pos;
+  _cycleFrames = frames;
+  _readyPush.store(0, std::memory_order_relaxed);
+  _readyPop.store(0, std::memory_order_relaxed);
+  _rtReadyPush.store(0, std::memory_order_relaxed);
+  _rtReadyPop = 0;
+  _workersDone.store(0, std::memory_order_relaxed);
+  _remaining.store(num_nodes, std::memory_order_release);
+
+  for(std::vector<int>::const_iterator it = g->_roots.cbegin(); it != g->_roots.cend(); ++it)
+    pushReady(g, *it);
+
+  // Wake up as many workers as could possibly be used. Posting also publishes the cycle state.
+  _workersWoken = num_general < (int)_threads.size() ? num_general : _threads.size();
+  for(int i = 0; i < _workersWoken; ++i)
+    sem_post(&_wakeSem);
+
+  helpUntilDone(g);
+
+  // Join. The workers must be finished with the cycle state before it is reused.
+  unsigned int spins = 0;
+  while(_workersDone.load(std::memory_order_acquire) < _workersWoken)
+    cpuRelax(spins);
+
+  _graphInUse.store(nullptr);
+  _parallelCycles.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+//---------------------------------------------------------
+//   invalidate
+//---------------------------------------------------------
+
+void AudioGraphExecutor::invalidate()
+{
+  _serial.fetch_add(1);
+}
+
+//---------------------------------------------------------
+//   build
+//   Builds a graph from the current song. Returns null if
+//    the graph could not be sorted (a cycle was found).
+//---------------------------------------------------------
+
+AudioGraph* AudioGraphExecutor::build() const
+{
+  const TrackList* tl = MusEGlobal::song->tracks();
+  AudioGraph* g = new AudioGraph();
+  g->_serial = _serial.load();
+  g->_trackListSize = tl->size();
+
+  std::map<const Track*, int> index;
+  for(ciTrack it = tl->cbegin(); it != tl->cend(); ++it)
+  {
+    Track* t = *it;
+    if(t->isMidiTrack())
+      continue;
+    AudioTrack* at = static_cast<AudioTrack*>(t);
+    switch(t->type())
+    {
+      // Outputs are pulled serially afterwards and are the join point.
+      case Track::AUDIO_OUTPUT:
+      break;
+
+      // Inputs read the driver's port buffers. Keep them in the audio thread.
+      case Track::AUDIO_INPUT:
+        g->_serialTracks.push_back(at);
+      break;
+
+      default:
+      {
+        AudioGraphNode node;
+        node._track = at;
+        node._numPredecessors = 0;
+        node._successorsBegin = 0;
+        node._successorsEnd = 0;
+        node._audioThreadOnly = t->isSynthTrack();
+        if(node._audioThreadOnly)
+          ++g->_numAudioThreadOnly;
+        index.insert(std::pair<const Track*, int>(t, g->_nodes.size()));
+        g->_nodes.push_back(node);
+      }
+      break;
+    }
+  }
+
+  const int num_nodes = g->_nodes.size();
+  std::vector<std::set<int> > succ(num_nodes);
+
+  for(int i = 0; i < num_nodes; ++i)
+  {
+    AudioTrack* at = g->_nodes[i]._track;
+    const RouteList* rl = at->inRoutes();
+    for(ciRoute ir = rl->cbegin(); ir != rl->cend(); ++ir)
+    {
+      if(ir->type != Route::TRACK_ROUTE || !ir->track || ir->track->isMidiTrack())
+        continue;
+      std::map<const Track*, int>::const_iterator ii = index.find(ir->track);
+      if(ii == index.cend() || ii->second == i)
+        continue;
+      succ[ii->second].insert(i);
+    }
+
+    // An aux gathers the sends of all the aux-supporting tracks which are
+    //  not themselves fed by an aux. See AudioAux::getData().
+    if(at->type() == Track::AUDIO_AUX)
+    {
+      for(int k = 0; k < num_nodes; ++k)
+      {
+        if(k == i)
+          continue;
+        AudioTrack* st = g->_nodes[k]._track;
+        if(st->hasAuxSend() && !st->auxRefCount())
+          succ[k].insert(i);
+      }
+    }
+  }
+
+  for(int i = 0; i < num_nodes; ++i)
+  {
+    AudioGraphNode& node = g->_nodes[i];
+    node._successorsBegin = g->_successors.size();
+    for(std::set<int>::const_iterator is = succ[i].cbegin(); is != succ[i].cend(); ++is)
+    {
+      g->_successors.push_back(*is);
+      ++g->_nodes[*is]._numPredecessors;
+    }
+    node._successorsEnd = g->_successors.size();
+  }
+
+  for(int i = 0; i < num_nodes; ++i)
+    if(g->_nodes[i]._numPredecessors == 0)
+      g->_roots.push_back(i);
+
+  // Make sure the graph can be fully sorted, otherwise a node would never become ready.
+  std::vector<int> pending(num_nodes);
+  std::vector<int> ready(g->_roots);
+  for(int i = 0; i < num_nodes; ++i)
+    pending[i] = g->_nodes[i]._numPredecessors;
+  int sorted = 0;
+  while(!ready.empty())
+  {
+    const int n = ready.back();
+    ready.pop_back();
+    ++sorted;
+    for(int i = g->_nodes[n]._successorsBegin; i < g->_nodes[n]._successorsEnd; ++i)
+      if(--pending[g->_successors[i]] == 0)
+        ready.push_back(g->_successors[i]);
+  }
+  if(sorted != num_nodes)
+  {
+    fprintf(stderr, "AudioGraphExecutor::build: Route graph has a cycle. Using serial processing.\n");
+    delete g;
+    return nullptr;
+  }
+
+  if(num_nodes > 0)
+  {
+    g->_pending = new std::atomic<int>[num_nodes];
+    g->_readyQueue = new std::atomic<int>[num_nodes];
+    g->_rtReadyQueue = new std::atomic<int>[num_nodes];
+  }
+
+  DEBUG_AUDIO_GRAPH(stderr, "AudioGraphExecutor::build: nodes:%d edges:%d roots:%d serial tracks:%d audio thread only:%d\n",
+                    num_nodes, (int)g->_successors.size(), (int)g->_roots.size(),
+                    (int)g->_serialTracks.size(), g->_numAudioThreadOnly);
+  return g;
+}
+
+//---------------------------------------------------------
+//   rebuild
+//---------------------------------------------------------
+
+void AudioGraphExecutor::rebuild()
+{
+  AudioGraph* g = MusEGlobal::config.parallelAudioGraph ? build() : nullptr;
+  AudioGraph* old = _graph.exchange(g);
+  if(old)
+  {
+    // Wait until the audio thread is no longer using the old graph.
+    while(_graphInUse.load() == old)
+      usleep(1000);
+    delete old;
+  }
+  _rebuildCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace MusECore
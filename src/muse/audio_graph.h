@@ -0,0 +1,169 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  audio_graph.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __AUDIO_GRAPH_H__
+#define __AUDIO_GRAPH_H__
+
+#include <atomic>
+#include <vector>
+#include <pthread.h>
+#include <semaphore.h>
+
+namespace MusECore {
+
+class AudioTrack;
+
+//---------------------------------------------------------
+//   AudioGraphNode
+//---------------------------------------------------------
+
+struct AudioGraphNode {
+      AudioTrack* _track;
+      // Number of nodes which must be processed before this one.
+      int _numPredecessors;
+      // Range of indices into AudioGraph::_successors.
+      int _successorsBegin;
+      int _successorsEnd;
+      // Whether the node must be processed by the audio thread itself.
+      // Synthesizers use the audio thread's non thread-safe event memory pool.
+      bool _audioThreadOnly;
+      };
+
+//---------------------------------------------------------
+//   AudioGraph
+//   A topologically sorted snapshot of the audio route graph.
+//   Built in the gui thread, read-only in the audio thread
+//    and the graph worker threads.
+//---------------------------------------------------------
+
+struct AudioGraph {
+      std::vector<AudioGraphNode> _nodes;
+      std::vector<int> _successors;
+      // Nodes with no predecessors.
+      std::vector<int> _roots;
+      // Tracks which are always processed serially by the audio thread
+      //  before any node is dispatched. (Audio inputs.)
+      std::vector<AudioTrack*> _serialTracks;
+      // The number of nodes with _audioThreadOnly set.
+      int _numAudioThreadOnly;
+      // The invalidation serial number this graph was built against.
+      unsigned int _serial;
+      // Number of tracks in the song track list when built. A sanity check.
+      unsigned int _trackListSize;
+
+      // Per-cycle state.
+      std::atomic<int>* _pending;
+      std::atomic<int>* _readyQueue;
+      std::atomic<int>* _rtReadyQueue;
+
+      AudioGraph();
+      ~AudioGraph();
+      };
+
+//---------------------------------------------------------
+//   AudioGraphExecutor
+//   Pre-processes independent audio tracks concurrently on a
+//    pool of realtime worker threads at the start of each
+//    audio cycle. Each track is processed exactly once through
+//    AudioTrack::copyData(), so that when the audio outputs
+//    later pull the graph serially, every track has already
+//    been processed and simply hands out its cached buffers.
+//---------------------------------------------------------
+
+class AudioGraphExecutor {
+      std::vector<pthread_t> _threads;
+      sem_t _wakeSem;
+      bool _semInit;
+      std::atomic<bool> _quit;
+      int _realTimePriority;
+
+      // The published graph, and the graph currently in use by the audio thread.
+      std::atomic<AudioGraph*> _graph;
+      std::atomic<AudioGraph*> _graphInUse;
+      // Incremented whenever the route graph may have changed.
+      std::atomic<unsigned int> _serial;
+
+      // Per-cycle dispatch state.
+      AudioGraph* _cycleGraph;
+      unsigned int _cyclePos;
+      unsigned int _cycleFrames;
+      std::atomic<int> _readyPush;
+      std::atomic<int> _readyPop;
+      std::atomic<int> _rtReadyPush;
+      // Only the audio thread pops audio thread only nodes.
+      int _rtReadyPop;
+      std::atomic<int> _remaining;
+      std::atomic<int> _workersDone;
+      // Number of workers woken for the current cycle.
+      int _workersWoken;
+
+      // Diagnostics.
+      std::atomic<unsigned int> _rebuildCount;
+      std::atomic<unsigned int> _parallelCycles;
+
+      static void* workerLoop(void*);
+      void workerRun();
+      void processNode(AudioGraph*, int idx);
+      void nodeFinished(AudioGraph*, int idx);
+      void pushReady(AudioGraph*, int idx);
+      // Runs nodes until all are finished. Used by the audio thread.
+      void helpUntilDone(AudioGraph*);
+      AudioGraph* build() const;
+
+   public:
+      AudioGraphExecutor();
+      ~AudioGraphExecutor();
+
+      // Starts or stops the worker threads. Call from the gui thread, with audio stopped.
+      void start(int realTimePriority);
+      void stop();
+      bool isRunning() const { return !_threads.empty(); }
+      int numWorkers() const { return _threads.size(); }
+
+      // Rebuilds the graph from the song's track and route lists and publishes it.
+      // Call from the gui thread only.
+      void rebuild();
+      // Marks the current graph as stale. It will not be used until rebuilt.
+      // Safe to call from any thread.
+      void invalidate();
+
+      // Called by the audio thread near the start of each cycle. Returns true if
+      //  the tracks were processed by the executor. If false, the caller just continues
+      //  with the normal serial processing which will process everything.
+      bool process(unsigned int pos, unsigned int frames);
+
+      unsigned int rebuildCount() const { return _rebuildCount.load(std::memory_order_relaxed); }
+      unsigned int parallelCycles() const { return _parallelCycles.load(std::memory_order_relaxed); }
+      };
+
+extern void initAudioGraphExecutor();
+extern void exitAudioGraphExecutor();
+
+} // namespace MusECore
+
+namespace MusEGlobal {
+extern MusECore::AudioGraphExecutor* audioGraph;
+}
+
+#endif
+
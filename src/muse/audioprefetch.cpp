@@ -26,6 +26,9 @@
 #endif
 #include <stdio.h>
 #include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
 //#include <limits.h>
 
 #include "audioprefetch.h"
@@ -34,6 +37,7 @@
 #include "song.h"
 #include "audio.h"
 #include "sync.h"
+#include "gconfig.h"
 
 // For debugging transport timing: Uncomment the fprintf section.
 #define AUDIO_PREFETCH_DEBUG_TRANSPORT_SYNC(dev, format, args...) // fprintf(dev, format, ##args);
@@ -52,7 +56,7 @@ void initAudioPrefetch()
 // Diagnostics.
 //#define AUDIOPREFETCH_DEBUG
 
-enum { PREFETCH_TICK, PREFETCH_SEEK
+enum { PREFETCH_TICK, PREFETCH_SEEK, PREFETCH_SYNC
       };
 
 //---------------------------------------------------------
@@ -74,6 +78,16 @@ AudioPrefetch::AudioPrefetch(const char* name)
       {
       seekPos  = ~0;
       seekCount.store(0);
+      _syncCount.store(0);
+      _workersQuit.store(false);
+      _nextJob.store(0);
+      _jobDoSeek = false;
+      _jobDoLoops = false;
+      _jobSeekTo = ~0;
+      _jobLPos = 0;
+      _jobRPos = 0;
+      sem_init(&_workSem, 0, 0);
+      sem_init(&_doneSem, 0, 0);
       }
 
 //---------------------------------------------------------
@@ -94,6 +108,7 @@ void AudioPrefetch::start(int priority, void *)
       {
       clearPollFd();
       seekCount.store(0);
+      _syncCount.store(0);
       addPollFd(toThreadFdr, POLLIN, MusECore::readMsgP, this, 0);
       Thread::start(priority);
       }
@@ -104,6 +119,112 @@ void AudioPrefetch::start(int priority, void *)
 
 AudioPrefetch::~AudioPrefetch()
       {
+      stopWorkers();
+      sem_destroy(&_workSem);
+      sem_destroy(&_doneSem);
+      }
+
+//---------------------------------------------------------
+//   threadStart
+//    called from prefetch thread
+//---------------------------------------------------------
+
+void AudioPrefetch::threadStart(void*)
+      {
+      startWorkers();
+      }
+
+//---------------------------------------------------------
+//   threadStop
+//    called from prefetch thread, or from the thread
+//    calling stop(true)
+//---------------------------------------------------------
+
+void AudioPrefetch::threadStop()
+      {
+      stopWorkers();
+      }
+
+//---------------------------------------------------------
+//   workerLoop
+//---------------------------------------------------------
+
+void* AudioPrefetch::workerLoop(void* arg)
+      {
+      AudioPrefetch* ap = (AudioPrefetch*)arg;
+      while(true)
+      {
+        if(sem_wait(&ap->_workSem) != 0)
+        {
+          if(errno == EINTR)
+            continue;
+          break;
+        }
+        if(ap->_workersQuit.load())
+          break;
+        ap->runJobs();
+        sem_post(&ap->_doneSem);
+      }
+      return nullptr;
+      }
+
+//---------------------------------------------------------
+//   startWorkers
+//    Workers inherit the scheduling of the prefetch thread.
+//---------------------------------------------------------
+
+void AudioPrefetch::startWorkers()
+      {
+      stopWorkers();
+
+      // Start from a clean slate, in case a previous run was cancelled mid-way.
+      sem_destroy(&_workSem);
+      sem_destroy(&_doneSem);
+      sem_init(&_workSem, 0, 0);
+      sem_init(&_doneSem, 0, 0);
+      _workersQuit.store(false);
+
+      int n = MusEGlobal::config.prefetchThreads;
+      if(n <= 0)
+      {
+        // Automatic. Disk reading and resampling do not scale much beyond a few threads.
+        const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        n = std::min(cores > 0 ? cores : 1L, 4L);
+      }
+      // The prefetch thread itself is one of them.
+      --n;
+
+      for(int i = 0; i < n; ++i)
+      {
+        pthread_t thread;
+        const int rv = pthread_create(&thread, nullptr, workerLoop, this);
+        if(rv)
+        {
+          fprintf(stderr, "AudioPrefetch: creating worker thread failed: %s\n", strerror(rv));
+          break;
+        }
+        _workers.push_back(thread);
+      }
+
+      #ifdef AUDIOPREFETCH_DEBUG
+      fprintf(stderr, "AudioPrefetch::startWorkers: workers:%d\n", (int)_workers.size());
+      #endif
+      }
+
+//---------------------------------------------------------
+//   stopWorkers
+//---------------------------------------------------------
+
+void AudioPrefetch::stopWorkers()
+      {
+      if(_workers.empty())
+        return;
+      _workersQuit.store(true);
+      for(std::size_t i = 0; i < _workers.size(); ++i)
+        sem_post(&_workSem);
+      for(std::size_t i = 0; i < _workers.size(); ++i)
+        pthread_join(_workers[i], nullptr);
+      _workers.clear();
       }
 
 //---------------------------------------------------------
@@ -145,6 +266,9 @@ void AudioPrefetch::processMsg1(const void* m)
                   // process seek in background
                   seek(msg->pos);
                   break;
+            case PREFETCH_SYNC:
+                  _syncCount.fetch_add(1);
+                  break;
             default:
                   fprintf(stderr, "AudioPrefetch::processMsg1: unknown message\n");
             }
@@ -171,6 +295,33 @@ void AudioPrefetch::msgTick(bool isRecTick, bool isPlayTick)
             }
       }
 
+//---------------------------------------------------------
+//   msgSync
+//    Waits until the thread has handled all messages sent
+//    before, so it no longer uses anything taken away from
+//    it before the call. Not for the audio RT context.
+//---------------------------------------------------------
+
+void AudioPrefetch::msgSync()
+      {
+      if (!isRunning())
+            return;
+      const unsigned int count = _syncCount.load();
+      PrefetchMsg msg;
+      msg.id  = PREFETCH_SYNC;
+      msg.pos = 0;
+      msg._isRecTick = false;
+      msg._isPlayTick = false;
+      while (sendMsg1(&msg, sizeof(msg))) {
+            fprintf(stderr, "AudioPrefetch::msgSync(): send failed!\n");
+            }
+      int tout = 10000; // Ten seconds.
+      while (_syncCount.load() == count && isRunning() && --tout > 0)
+            usleep(1000);
+      if (tout == 0)
+            fprintf(stderr, "AudioPrefetch::msgSync(): timeout\n");
+      }
+
 //---------------------------------------------------------
 //   msgSeek
 //    called from audio RT context
@@ -201,93 +352,228 @@ void AudioPrefetch::msgSeek(unsigned samplePos, bool force)
             }
       }
 
+//---------------------------------------------------------
+//   runJobs
+//    called from prefetch thread and workers
+//---------------------------------------------------------
+
+void AudioPrefetch::runJobs()
+      {
+      const int sz = _jobs.size();
+      while(true)
+      {
+        const int idx = _nextJob.fetch_add(1);
+        if(idx >= sz)
+          break;
+        AudioTrack* atrack = _jobs[idx]._track;
+        if(atrack->freezeStream())
+        {
+          if(_jobSeekTo != ~0U)
+          {
+            atrack->freezeFifo()->clear();
+            atrack->setFreezeWritePos(_jobSeekTo);
+            // The audio thread may have moved the file while freewheeling.
+            atrack->resetFreezeReadPos();
+          }
+          if(!atrack->off())
+            fillFreeze(atrack);
+          continue;
+        }
+        WaveTrack* track = static_cast<WaveTrack*>(atrack);
+        if(_jobSeekTo != ~0U)
+        {
+          track->clearPrefetchFifo();
+          track->setPrefetchWritePos(_jobSeekTo);
+          track->seekData(_jobSeekTo);
+        }
+        // Save time. Don't bother if track is off. Track On/Off not designed for rapid repeated response (but mute is). (p3.3.29)
+        if(track->off())
+          continue;
+        fillTrack(track, _jobDoSeek);
+      }
+      }
+
+//---------------------------------------------------------
+//   runAllJobs
+//    called from prefetch thread
+//---------------------------------------------------------
+
+void AudioPrefetch::runAllJobs()
+      {
+      _nextJob.store(0);
+      // Don't bother waking more workers than there are jobs for.
+      const int wake = std::min((int)_workers.size(), (int)_jobs.size() - 1);
+      for(int i = 0; i < wake; ++i)
+        sem_post(&_workSem);
+      runJobs();
+      for(int i = 0; i < wake; ++i)
+      {
+        while(sem_wait(&_doneSem) != 0 && errno == EINTR)
+          ;
+      }
+      }
+
+//---------------------------------------------------------
+//   fillTrack
+//    called from prefetch thread and workers
+//---------------------------------------------------------
+
+void AudioPrefetch::fillTrack(WaveTrack* track, bool doSeek)
+      {
+      Fifo* fifo = track->prefetchFifo();
+      const int empty_count = fifo->getEmptyCount();
+
+      track->updatePrefetchFill(fifo->getCount(), !doSeek);
+
+      // Diagnostics.
+      //if(empty_count >= 256)
+      //  fprintf(stderr, "WARNING: AudioPrefetch::prefetch: track:%s empty_count:%d >= 512\n", track->name().toUtf8().constData(), empty_count);
+
+      // Nothing to fill?
+      if(empty_count <= 0)
+      {
+        AUDIO_PREFETCH_DEBUG_TRANSPORT_SYNC(stderr, "AudioPrefetch::prefetch: empty_count <= 0!\n");
+        return;
+      }
+
+      unsigned int write_pos = track->prefetchWritePos();
+      if (write_pos == ~0U) {
+            fprintf(stderr, "AudioPrefetch::prefetch: invalid track write position\n");
+            return;
+            }
+
+      int ch           = track->channels();
+      float* bp[ch];
+
+      AUDIO_PREFETCH_DEBUG_TRANSPORT_SYNC(stderr, "AudioPrefetch::prefetch: Filling empty_count:%d do_loops:%d lpos_frame:%d rpos_frame:%d\n",
+              empty_count, _jobDoLoops, _jobLPos, _jobRPos);
+
+      // Fill up the empty buffers.
+      for(int i = 0; i < empty_count; ++i)
+      {
+        if(_jobDoLoops)
+        {
+          unsigned n = _jobRPos - write_pos;
+
+          AUDIO_PREFETCH_DEBUG_TRANSPORT_SYNC(stderr, "  do loops: write_pos:%d n:%d segmentSize:%d\n",
+                  write_pos, n, MusEGlobal::segmentSize);
+
+          if (n < MusEGlobal::segmentSize)
+          {
+            // adjust loop start so we get exact loop len
+            if (n > _jobLPos)
+                  n = 0;
+            write_pos = _jobLPos - n;
+            AUDIO_PREFETCH_DEBUG_TRANSPORT_SYNC(stderr, "  looping: new write_pos:%d\n", write_pos);
+
+            track->setPrefetchWritePos(write_pos);
+            track->seekData(write_pos);
+          }
+        }
+
+        if (fifo->getWriteBuffer(ch, MusEGlobal::segmentSize, bp, write_pos))
+        {
+          fprintf(stderr, "AudioPrefetch::prefetch: No write buffer!\n");
+          break;
+        }
+
+        // True = do overwrite.
+        track->fetchData(write_pos, MusEGlobal::segmentSize, bp, doSeek, true);
+
+        // Only the first fetch should seek if required. Reset the flag now.
+        doSeek = false;
+
+        write_pos += MusEGlobal::segmentSize;
+        track->setPrefetchWritePos(write_pos);
+      }
+      }
+
+//---------------------------------------------------------
+//   fillFreeze
+//    called from prefetch thread and workers
+//---------------------------------------------------------
+
+void AudioPrefetch::fillFreeze(AudioTrack* track)
+      {
+      Fifo* fifo = track->freezeFifo();
+      const int empty_count = fifo->getEmptyCount();
+      unsigned int write_pos = track->freezeWritePos();
+      const int ch = track->channels();
+      float* bp[ch];
+
+      for(int i = 0; i < empty_count; ++i)
+      {
+        if(_jobDoLoops)
+        {
+          unsigned n = _jobRPos - write_pos;
+          if (n < MusEGlobal::segmentSize)
+          {
+            // adjust loop start so we get exact loop len
+            if (n > _jobLPos)
+                  n = 0;
+            write_pos = _jobLPos - n;
+          }
+        }
+
+        if (fifo->getWriteBuffer(ch, MusEGlobal::segmentSize, bp, write_pos))
+        {
+          fprintf(stderr, "AudioPrefetch::fillFreeze: No write buffer!\n");
+          break;
+        }
+        track->readFreezeData(write_pos, ch, MusEGlobal::segmentSize, bp, true);
+        fifo->add();
+
+        write_pos += MusEGlobal::segmentSize;
+        track->setFreezeWritePos(write_pos);
+      }
+      }
+
 //---------------------------------------------------------
 //   prefetch
+//    Each wave track is an independent job. Tracks with the
+//    emptiest fifos are handed out first.
 //---------------------------------------------------------
 
 void AudioPrefetch::prefetch(bool doSeek)
       {
-      unsigned lpos_frame = 0;
-      unsigned rpos_frame = 0;
-      const bool do_loops = MusEGlobal::song->loop() && !MusEGlobal::audio->bounce() && !MusEGlobal::extSyncFlag;
-      if(do_loops)
+      _jobDoLoops = MusEGlobal::song->loop() && !MusEGlobal::audio->bounce() && !MusEGlobal::extSyncFlag;
+      _jobLPos = 0;
+      _jobRPos = 0;
+      if(_jobDoLoops)
       {
-        lpos_frame = MusEGlobal::song->lPos().frame();
-        rpos_frame = MusEGlobal::song->rPos().frame();
+        _jobLPos = MusEGlobal::song->lPos().frame();
+        _jobRPos = MusEGlobal::song->rPos().frame();
       }
+      _jobDoSeek = doSeek;
 
+      _jobs.clear();
       WaveTrackList* tl = MusEGlobal::song->waves();
       for (iWaveTrack it = tl->begin(); it != tl->end(); ++it) {
             WaveTrack* track = *it;
-            // Save time. Don't bother if track is off. Track On/Off not designed for rapid repeated response (but mute is). (p3.3.29)
-            if(track->off())
+            // A seek job must visit every track, even ones which are off.
+            if(_jobSeekTo == ~0U && track->off())
               continue;
-
-            Fifo* fifo = track->prefetchFifo();
-            const int empty_count = fifo->getEmptyCount();
-
-            // Diagnostics.
-            //if(empty_count >= 256)
-            //  fprintf(stderr, "WARNING: AudioPrefetch::prefetch: track:%s empty_count:%d >= 512\n", track->name().toUtf8().constData(), empty_count);
-
-            // Nothing to fill?
-            if(empty_count <= 0)
-            {
-              AUDIO_PREFETCH_DEBUG_TRANSPORT_SYNC(stderr, "AudioPrefetch::prefetch: empty_count <= 0!\n");
+            const PrefetchJob job = { track, track->freezeStream() ?
+              track->freezeFifo()->getCount() : track->prefetchFifo()->getCount() };
+            _jobs.push_back(job);
+            }
+      // Frozen synths stream their freeze files, too.
+      SynthIList* sl = MusEGlobal::song->syntis();
+      for (iSynthI it = sl->begin(); it != sl->end(); ++it) {
+            SynthI* synth = *it;
+            if(!synth->freezeStream() || (_jobSeekTo == ~0U && synth->off()))
               continue;
+            const PrefetchJob job = { synth, synth->freezeFifo()->getCount() };
+            _jobs.push_back(job);
             }
 
-            unsigned int write_pos = track->prefetchWritePos();
-            if (write_pos == ~0U) {
-                  fprintf(stderr, "AudioPrefetch::prefetch: invalid track write position\n");
-                  continue;
-                  }
+      if(_jobs.empty())
+        return;
 
-            int ch           = track->channels();
-            float* bp[ch];
-
-            AUDIO_PREFETCH_DEBUG_TRANSPORT_SYNC(stderr, "AudioPrefetch::prefetch: Filling empty_count:%d do_loops:%d lpos_frame:%d rpos_frame:%d\n",
-                    empty_count, do_loops, lpos_frame, rpos_frame);
-
-            // Fill up the empty buffers.
-            for(int i = 0; i < empty_count; ++i)
-            {
-              if(do_loops)
-              {
-                unsigned n = rpos_frame - write_pos;
-
-                AUDIO_PREFETCH_DEBUG_TRANSPORT_SYNC(stderr, "  do loops: write_pos:%d n:%d segmentSize:%d\n",
-                        write_pos, n, MusEGlobal::segmentSize);
-
-                if (n < MusEGlobal::segmentSize)
-                {
-                  // adjust loop start so we get exact loop len
-                  if (n > lpos_frame)
-                        n = 0;
-                  write_pos = lpos_frame - n;
-                  AUDIO_PREFETCH_DEBUG_TRANSPORT_SYNC(stderr, "  looping: new write_pos:%d\n", write_pos);
-
-                  track->setPrefetchWritePos(write_pos);
-                  track->seekData(write_pos);
-                }
-              }
-
-              if (fifo->getWriteBuffer(ch, MusEGlobal::segmentSize, bp, write_pos))
-              {
-                fprintf(stderr, "AudioPrefetch::prefetch: No write buffer!\n");
-                break;
-              }
-
-              // True = do overwrite.
-              track->fetchData(write_pos, MusEGlobal::segmentSize, bp, doSeek, true);
-              
-              // Only the first fetch should seek if required. Reset the flag now.
-              doSeek = false;
-              
-              write_pos += MusEGlobal::segmentSize;
-              track->setPrefetchWritePos(write_pos);
-            }
-          }
+      std::stable_sort(_jobs.begin(), _jobs.end(),
+        [](const PrefetchJob& a, const PrefetchJob& b) { return a._fill < b._fill; });
+
+      runAllJobs();
       }
 
 //---------------------------------------------------------
@@ -316,16 +602,11 @@ void AudioPrefetch::seek(unsigned seekTo)
         return;
       }
 
-      WaveTrackList* tl = MusEGlobal::song->waves();
-      for (iWaveTrack it = tl->begin(); it != tl->end(); ++it) {
-            WaveTrack* track = *it;
-            track->clearPrefetchFifo();
-            track->setPrefetchWritePos(seekTo);
-            track->seekData(seekTo);
-            }
-
-      // Indicate do a seek command before read (only on the first fetch).
+      // Clear and seek each track as part of its job, so that the seeks
+      //  also run in parallel. Indicate do a seek command before read (only on the first fetch).
+      _jobSeekTo = seekTo;
       prefetch(true);
+      _jobSeekTo = ~0;
 
       // To help speed things up even more, check the count again. Return if more seek messages are pending. (p3.3.20)
       if(seekCount.load() > 1)
@@ -342,6 +623,34 @@ void AudioPrefetch::seek(unsigned seekTo)
       #endif
       }
 
+//---------------------------------------------------------
+//   dumpStats
+//---------------------------------------------------------
+
+void AudioPrefetch::dumpStats(FILE* fp) const
+      {
+      fprintf(fp, "Audio prefetch: workers:%d fifo length:%u segment size:%u\n",
+              (int)_workers.size() + 1, MusEGlobal::fifoLength, MusEGlobal::segmentSize);
+      const WaveTrackList* tl = MusEGlobal::song->waves();
+      for (ciWaveTrack it = tl->begin(); it != tl->end(); ++it) {
+            const WaveTrack* track = *it;
+            fprintf(fp, "  %s: fill:%d min fill:%d underruns:%u\n",
+                    track->name().toLocal8Bit().constData(),
+                    track->prefetchFill(), track->prefetchMinFill(), track->prefetchUnderruns());
+            }
+      }
+
+//---------------------------------------------------------
+//   resetStats
+//---------------------------------------------------------
+
+void AudioPrefetch::resetStats()
+      {
+      WaveTrackList* tl = MusEGlobal::song->waves();
+      for (iWaveTrack it = tl->begin(); it != tl->end(); ++it)
+            (*it)->resetPrefetchStats();
+      }
+
 bool AudioPrefetch::seekDone() const { return seekCount.load() == 0; }
 
 } // namespace MusECore
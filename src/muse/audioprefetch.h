@@ -25,11 +25,29 @@
 #define __AUDIOPREFETCH_H__
 
 #include <atomic>
+#include <vector>
+#include <stdio.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 #include "thread.h"
 
 namespace MusECore {
 
+class AudioTrack;
+class WaveTrack;
+
+//---------------------------------------------------------
+//   PrefetchJob
+//---------------------------------------------------------
+
+struct PrefetchJob {
+      // A wave track, or a frozen track.
+      AudioTrack* _track;
+      // Number of full buffers in the track's prefetch or freeze fifo when the job was queued.
+      int _fill;
+      };
+
 //---------------------------------------------------------
 //   AudioPrefetch
 //---------------------------------------------------------
@@ -38,10 +56,41 @@ class AudioPrefetch : public Thread {
       unsigned seekPos; // remember last seek to optimize seeks
 
       virtual void processMsg1(const void*);
+      virtual void threadStart(void*);
+      virtual void threadStop();
       void prefetch(bool doSeek);
       void seek(unsigned pos);
 
       std::atomic<int> seekCount;
+      // Counts the sync messages handled.
+      std::atomic<unsigned int> _syncCount;
+
+      // Worker pool. The prefetch thread hands out one job per wave track
+      //  and works on the jobs itself along with the workers.
+      std::vector<pthread_t> _workers;
+      sem_t _workSem;
+      sem_t _doneSem;
+      std::atomic<bool> _workersQuit;
+      std::vector<PrefetchJob> _jobs;
+      std::atomic<int> _nextJob;
+      // Per-run job parameters, set by the prefetch thread before waking the workers.
+      bool _jobDoSeek;
+      bool _jobDoLoops;
+      // If not ~0, the job first clears the track's fifo and seeks the track here.
+      unsigned _jobSeekTo;
+      unsigned _jobLPos;
+      unsigned _jobRPos;
+
+      static void* workerLoop(void*);
+      void startWorkers();
+      void stopWorkers();
+      // Runs queued jobs until there are none left.
+      void runJobs();
+      // Runs all queued jobs, in parallel if there are workers.
+      void runAllJobs();
+      void fillTrack(WaveTrack* track, bool doSeek);
+      // Fills the freeze fifo of a frozen track from its freeze file.
+      void fillFreeze(AudioTrack* track);
 
    public:
       AudioPrefetch(const char* name);
@@ -51,8 +100,16 @@ class AudioPrefetch : public Thread {
 
       void msgTick(bool isRecTick, bool isPlayTick);
       void msgSeek(unsigned samplePos, bool force=false);
+      void msgSync();
       
       bool seekDone() const;
+
+      int numWorkers() const { return _workers.size(); }
+      // Prints the per-track prefetch fifo fill and underrun counters.
+      void dumpStats(FILE* fp) const;
+      // Resets the per-track prefetch fifo counters. Called from gui thread
+      //  whenever the transport starts.
+      void resetStats();
       };
 
 } // namespace MusECore
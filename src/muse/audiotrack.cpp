@@ -25,10 +25,12 @@
 //#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <map>
 
 #include <QMessageBox>
 #include <QFile>
+#include <QFileInfo>
 
 #include "globals.h"
 #include "globaldefs.h"
@@ -40,6 +42,7 @@
 #include "xml.h"
 #include "undo.h"
 #include "plugin.h"
+#include "pluginloader.h"
 #include "audiodev.h"
 #include "synth.h"
 #include "app.h"
@@ -49,6 +52,8 @@
 #include "latency_compensator.h"
 #include "ticksynth.h"
 #include "xml_statistics.h"
+#include "record_writer.h"
+#include "audioprefetch.h"
 
 namespace MusECore {
 
@@ -294,6 +299,13 @@ AudioTrack::AudioTrack(TrackType t, int channels)
       _latencyComp = new LatencyCompensator();
       _recFilePos = 0;
       _previousLatency = 0.0f;
+      _freezeFifo = nullptr;
+      _freezeStream = nullptr;
+      _recStream = nullptr;
+      _freezeWritePos = 0;
+      _freezeReadFile = nullptr;
+      _freezeReadPos = -1;
+      _freezeRecPos = 0;
 
       _processed = false;
       _haveData = false;
@@ -341,6 +353,13 @@ AudioTrack::AudioTrack(const AudioTrack& t, int flags)
       _latencyComp = new LatencyCompensator();
       _recFilePos = 0;
       _previousLatency = 0.0f;
+      _freezeFifo = nullptr;
+      _freezeStream = nullptr;
+      _recStream = nullptr;
+      _freezeWritePos = 0;
+      _freezeReadFile = nullptr;
+      _freezeReadPos = -1;
+      _freezeRecPos = 0;
 
       _processed      = false;
       _haveData       = false;
@@ -562,8 +581,14 @@ void AudioTrack::assign(const Track& t, int flags)
 
 AudioTrack::~AudioTrack()
 {
+      if(_recStream)
+        RecordWriter::removeStream(_recStream);
+
       delete _efxPipe;
 
+      if(_freezeFifo)
+        delete _freezeFifo;
+
       if(audioInSilenceBuf)
         free(audioInSilenceBuf);
 
@@ -1880,6 +1905,14 @@ void AudioTrack::writeProperties(int level, Xml& xml) const
       xml.intTag(level, "sendMetronome", sendMetronome());
       xml.intTag(level, "automation", int(automationType()));
       xml.doubleTag(level, "gain", _gain);
+      if (isFrozen()) {
+            // Store the path relative to the project directory, if possible.
+            QString path = _freezeFile.path();
+            const QString dir = MusEGlobal::museProject + QString("/");
+            if (path.startsWith(dir))
+                  path.remove(0, dir.length());
+            xml.strTag(level, "freezeFile", path);
+            }
       if (hasAuxSend()) {
             int naux = MusEGlobal::song->auxs()->size();
             for (int idx = 0; idx < naux; ++idx) {
@@ -1995,6 +2028,12 @@ bool AudioTrack::readProperties(Xml& xml, const QString& tag)
                 {
                   PluginConfiguration &pic = pi->initialConfiguration();
                   (*_efxPipe)[pi->id()] = pi;
+                  // Only prepared while a song is loading. Let the loader instantiate it.
+                  if(pi->plugin())
+                  {
+                    if(PluginLoader* loader = PluginLoader::current())
+                      loader->add(pi);
+                  }
 
                   //---------------------------------------------------------
                   // If any automation controllers were included with in XML,
@@ -2069,6 +2108,19 @@ bool AudioTrack::readProperties(Xml& xml, const QString& tag)
             _sendMetronome = xml.parseInt();
       else if (tag == "gain")
             _gain = xml.parseDouble();
+      else if (tag == "freezeFile") {
+            QString path = xml.parse1();
+            if (QFileInfo(path).isRelative())
+                  path = MusEGlobal::museProject + QString("/") + path;
+            SndFileR sf(new SndFile(path, false));
+            if (sf.openRead(false))
+                  fprintf(stderr, "AudioTrack::readProperties: Error: Could not open freeze file %s, track is unfrozen\n",
+                          path.toLocal8Bit().constData());
+            else {
+                  prepareFreeze();
+                  setFreezeFile(sf);
+                  }
+            }
       else if (tag == "automation")
             setAutomationType(AutomationType(xml.parseInt()));
       else if (tag == "controller") {
@@ -2173,6 +2225,13 @@ void AudioTrack::updateUiWindowTitles()
 
 void AudioTrack::mapRackPluginsToControllers()
 {
+  // While a song is loading, the rack plugins are not instantiated yet. The loader maps them later.
+  if(PluginLoader* loader = PluginLoader::current())
+  {
+    loader->addTrack(this);
+    return;
+  }
+
   // Iterate all possible plugin controller indexes...
   for(int idx = MusECore::PipelineDepth - 1; idx >= 0; idx--)
   {
@@ -3135,8 +3194,36 @@ bool AudioTrack::prepareRecording()
       _recFilePos = 0;
       _previousLatency = 0.0f;
 
+      // Let the record writer thread do the disk writing, if it is running.
+      if(!_recStream && MusEGlobal::config.recordBufferSeconds > 0)
+        _recStream = RecordWriter::addStream(_recFile, _channels, MusEGlobal::segmentSize,
+                                             MusEGlobal::config.recordBufferSeconds * MusEGlobal::sampleRate,
+                                             MusEGlobal::config.liveWaveUpdate);
+
       return true;
 }
+
+//---------------------------------------------------------
+//   finishRecordStream
+//---------------------------------------------------------
+
+void AudioTrack::finishRecordStream()
+{
+      if(!_recStream)
+        return;
+
+      // The prefetch thread may still be moving the fifo to the stream.
+      int tout = 100; // Ten seconds.
+      while(fifo.getCount() != 0 && --tout > 0)
+        usleep(100000);
+
+      // Take the stream away from the prefetch thread, and wait until
+      //  it is surely not writing to it any more before deleting it.
+      RecordStream* rs = _recStream.exchange(nullptr);
+      if(MusEGlobal::audioPrefetch)
+        MusEGlobal::audioPrefetch->msgSync();
+      RecordWriter::removeStream(rs);
+}
 double AudioTrack::auxSend(int idx) const
       {
       if (unsigned(idx) >= _auxSend.size()) {
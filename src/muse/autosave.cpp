@@ -0,0 +1,527 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  autosave.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+
+#include "autosave.h"
+#include "globals.h"
+#include "song.h"
+#include "track.h"
+#include "part.h"
+#include "ctrl.h"
+#include "xml_chunks.h"
+
+// For debugging output: Uncomment the fprintf section.
+#define DEBUG_AUTOSAVE(dev, format, args...) // fprintf(dev, format, ##args)
+
+namespace MusECore {
+
+static const char journalMagic[8] = { 'M', 'u', 's', 'E', 'J', 'r', 'n', 'l' };
+static const uint32_t journalVersion = 1;
+static const int journalHeaderSize = 16;
+static const int recordHeaderSize = 24;
+
+// Changes which can be journalled. Any other change needs a base snapshot.
+static const SongChangedStruct_t journalFlags =
+  SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED | SC_AUDIO_CONTROLLER;
+static const SongChangedStruct_t eventFlags =
+  SC_EVENT_INSERTED | SC_EVENT_REMOVED | SC_EVENT_MODIFIED;
+// Changes which are not saved, or not worth a base snapshot.
+static const SongChangedStruct_t ignoredFlags =
+  SC_SELECTION | SC_PART_SELECTION | SC_TRACK_SELECTION | SC_PIANO_SELECTION |
+  SC_DRUM_SELECTION | SC_AUDIO_CONTROLLER_SELECTION | SC_PORT_ALIAS_PREFERENCE | SC_WAVE_PEAKS;
+
+//---------------------------------------------------------
+//   AutosaveJournal
+//---------------------------------------------------------
+
+AutosaveJournal::AutosaveJournal()
+   : _flags(SC_NOTHING), _dirty(false), _needsBase(false), _running(false), _busy(false), _quit(false)
+      {
+      }
+
+AutosaveJournal::~AutosaveJournal()
+      {
+      stop();
+      }
+
+//---------------------------------------------------------
+//   basePath
+//---------------------------------------------------------
+
+QString AutosaveJournal::basePath(const QString& projectPath)
+      {
+      return projectPath + QString(".autosave.medb");
+      }
+
+QString AutosaveJournal::journalPath(const QString& projectPath)
+      {
+      return projectPath + QString(".journal");
+      }
+
+//---------------------------------------------------------
+//   hasRecovery
+//---------------------------------------------------------
+
+bool AutosaveJournal::hasRecovery(const QString& projectPath)
+      {
+      const QFileInfo project(projectPath);
+      const QFileInfo base(basePath(projectPath));
+      const QFileInfo journal(journalPath(projectPath));
+      if (base.exists() && (!project.exists() || base.lastModified() >= project.lastModified()))
+            return true;
+      return journal.exists() && journal.size() > journalHeaderSize &&
+             (!project.exists() || journal.lastModified() >= project.lastModified());
+      }
+
+//---------------------------------------------------------
+//   recoveryFile
+//---------------------------------------------------------
+
+QString AutosaveJournal::recoveryFile(const QString& projectPath)
+      {
+      const QString base = basePath(projectPath);
+      return QFile::exists(base) ? base : projectPath;
+      }
+
+//---------------------------------------------------------
+//   replay
+//    Records are replayed up to the first one which is
+//    incomplete or damaged, which happens if MusE died
+//    while it was being written.
+//---------------------------------------------------------
+
+int AutosaveJournal::replay(const QString& projectPath)
+      {
+      QFile f(journalPath(projectPath));
+      if (!f.exists())
+            return 0;
+      if (!f.open(QIODevice::ReadOnly)) {
+            fprintf(stderr, "AutosaveJournal::replay: cannot open %s\n", f.fileName().toLocal8Bit().constData());
+            return -1;
+            }
+      const QByteArray file = f.readAll();
+      f.close();
+      const char* p = file.constData();
+      const int64_t size = file.size();
+      if (size < journalHeaderSize || memcmp(p, journalMagic, sizeof(journalMagic)) != 0 ||
+          getU32(p + 8) > journalVersion) {
+            fprintf(stderr, "AutosaveJournal::replay: %s is not a journal\n", f.fileName().toLocal8Bit().constData());
+            return -1;
+            }
+      const int sampleRate = getU32(p + 12);
+
+      // Loading the song has already added the controller events of the
+      //  midi parts to the port caches. Take them out while the events change.
+      MusEGlobal::song->changeMidiCtrlCacheEvents(false);
+
+      TrackList* tl = MusEGlobal::song->tracks();
+      int n = 0;
+      for (int64_t pos = journalHeaderSize; size - pos >= recordHeaderSize; ) {
+            const uint32_t type  = getU32(p + pos);
+            const uint32_t track = getU32(p + pos + 4);
+            const int32_t item   = int32_t(getU32(p + pos + 8));
+            const uint64_t len   = getU64(p + pos + 12);
+            const uint32_t crc   = getU32(p + pos + 20);
+            pos += recordHeaderSize;
+            if (len > uint64_t(size - pos) || xmlChunkCrc32(p + pos, len) != crc) {
+                  fprintf(stderr, "AutosaveJournal::replay: journal ends with a damaged record\n");
+                  break;
+                  }
+            const QByteArray data(p + pos, len);
+            pos += len;
+
+            if (track >= tl->size()) {
+                  fprintf(stderr, "AutosaveJournal::replay: no track %u\n", track);
+                  continue;
+                  }
+            Track* t = tl->index(track);
+
+            if (type == XmlEventChunk) {
+                  PartList* pl = t->parts();
+                  if (item < 0 || item >= (int)pl->size()) {
+                        fprintf(stderr, "AutosaveJournal::replay: no part %d on track %u\n", item, track);
+                        continue;
+                        }
+                  iPart ip = pl->begin();
+                  std::advance(ip, item);
+                  Part* part = ip->second;
+                  if (part->partType() != Part::MidiPartType)
+                        continue;
+                  part->nonconst_events().clear();
+                  if (!part->readEventChunkData(data))
+                        fprintf(stderr, "AutosaveJournal::replay: events of part %s are damaged\n",
+                                part->name().toLocal8Bit().constData());
+                  // Clones hold clones of the same events, with the same ids.
+                  for (Part* c = part->nextClone(); c != part; c = c->nextClone()) {
+                        c->nonconst_events().clear();
+                        for (ciEvent ie = part->events().cbegin(); ie != part->events().cend(); ++ie) {
+                              Event e = ie->second.clone();
+                              c->addEvent(e);
+                              }
+                        }
+                  ++n;
+                  }
+            else if (type == XmlCtrlChunk) {
+                  if (t->isMidiTrack())
+                        continue;
+                  CtrlListList* cll = static_cast<AudioTrack*>(t)->controller();
+                  iCtrlList icl = cll->find(item);
+                  if (icl == cll->end() || data.size() < 8) {
+                        fprintf(stderr, "AutosaveJournal::replay: no controller %d on track %u\n", item, track);
+                        continue;
+                        }
+                  CtrlList* cl = icl->second;
+                  double curVal;
+                  QDataStream ds(data);
+                  ds.setByteOrder(QDataStream::LittleEndian);
+                  ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
+                  ds >> curVal;
+                  cl->clear();
+                  cl->setCurVal(curVal);
+                  if (!cl->readChunkData(data.mid(8), sampleRate))
+                        fprintf(stderr, "AutosaveJournal::replay: points of controller %d are damaged\n", item);
+                  ++n;
+                  }
+            }
+
+      MusEGlobal::song->changeMidiCtrlCacheEvents(true);
+      return n;
+      }
+
+//---------------------------------------------------------
+//   remember
+//    Notes the state of all parts and controller lists,
+//    after a snapshot of the whole song.
+//---------------------------------------------------------
+
+void AutosaveJournal::remember()
+      {
+      _partSerials.clear();
+      _ctrlSerials.clear();
+      const TrackList* tl = MusEGlobal::song->tracks();
+      for (ciTrack it = tl->cbegin(); it != tl->cend(); ++it) {
+            const Track* t = *it;
+            const PartList* pl = t->cparts();
+            for (ciPart ip = pl->cbegin(); ip != pl->cend(); ++ip)
+                  _partSerials[ip->second] = ip->second->events().serial();
+            if (t->isMidiTrack())
+                  continue;
+            const CtrlListList* cll = static_cast<const AudioTrack*>(t)->controller();
+            for (ciCtrlList icl = cll->cbegin(); icl != cll->cend(); ++icl)
+                  _ctrlSerials[icl->second] = std::make_pair(icl->second->serial(), icl->second->curVal());
+            }
+      _flags = SC_NOTHING;
+      _dirty = false;
+      }
+
+//---------------------------------------------------------
+//   reset
+//---------------------------------------------------------
+
+void AutosaveJournal::reset(const QString& projectPath, bool keepFiles)
+      {
+      std::vector<Task> tasks;
+      if (!_projectPath.isEmpty() && _projectPath != projectPath)
+            tasks.push_back(Task{Task::RemoveFiles, _projectPath, QByteArray(), 0, 0, 0, 0});
+      if (!projectPath.isEmpty() && !keepFiles)
+            tasks.push_back(Task{Task::RemoveFiles, projectPath, QByteArray(), 0, 0, 0, 0});
+      post(tasks);
+
+      _projectPath = projectPath;
+      _needsBase = keepFiles;
+      remember();
+      }
+
+//---------------------------------------------------------
+//   songChanged
+//---------------------------------------------------------
+
+void AutosaveJournal::songChanged(SongChangedStruct_t flags)
+      {
+      flags &= ~ignoredFlags;
+      if (!flags)
+            return;
+      if (flags & ~journalFlags)
+            _needsBase = true;
+      _flags |= flags;
+      }
+
+//---------------------------------------------------------
+//   writeChanges
+//    Parts and controller lists are recognized by their
+//    serial numbers, which change with their contents.
+//    A part or controller list which was not there at the
+//    last snapshot means the structure changed, which needs
+//    a base snapshot.
+//---------------------------------------------------------
+
+bool AutosaveJournal::writeChanges(const QString& projectPath)
+      {
+      if (projectPath != _projectPath) {
+            _projectPath = projectPath;
+            _needsBase = true;
+            }
+      if (_needsBase)
+            return false;
+      if (!_flags) {
+            if (!_dirty)
+                  return true;
+            // Marked dirty without a song change.
+            _needsBase = true;
+            return false;
+            }
+
+      std::vector<Task> tasks;
+      const TrackList* tl = MusEGlobal::song->tracks();
+      uint32_t trackIdx = 0;
+      for (ciTrack it = tl->cbegin(); it != tl->cend(); ++it, ++trackIdx) {
+            const Track* t = *it;
+            if (_flags & eventFlags) {
+                  const PartList* pl = t->cparts();
+                  int32_t partIdx = 0;
+                  for (ciPart ip = pl->cbegin(); ip != pl->cend(); ++ip, ++partIdx) {
+                        const Part* part = ip->second;
+                        auto is = _partSerials.find(part);
+                        if (is == _partSerials.end()) {
+                              _needsBase = true;
+                              return false;
+                              }
+                        if (is->second == part->events().serial())
+                              continue;
+                        // Wave events refer to clips and files, which are written with the base.
+                        if (part->partType() != Part::MidiPartType) {
+                              _needsBase = true;
+                              return false;
+                              }
+                        // The clones were changed the same way. Replaying the record updates them, too.
+                        for (const Part* c = part; ; ) {
+                              _partSerials[c] = c->events().serial();
+                              c = c->nextClone();
+                              if (c == part)
+                                    break;
+                              }
+                        tasks.push_back(Task{Task::AppendRecord, projectPath, part->eventChunkData(),
+                                             XmlEventChunk, trackIdx, partIdx, 0});
+                        }
+                  }
+            if ((_flags & SC_AUDIO_CONTROLLER) && !t->isMidiTrack()) {
+                  const CtrlListList* cll = static_cast<const AudioTrack*>(t)->controller();
+                  for (ciCtrlList icl = cll->cbegin(); icl != cll->cend(); ++icl) {
+                        const CtrlList* cl = icl->second;
+                        auto is = _ctrlSerials.find(cl);
+                        if (is == _ctrlSerials.end()) {
+                              _needsBase = true;
+                              return false;
+                              }
+                        if (is->second.first == cl->serial() && is->second.second == cl->curVal())
+                              continue;
+                        is->second = std::make_pair(cl->serial(), cl->curVal());
+                        QByteArray data;
+                        QDataStream ds(&data, QIODevice::WriteOnly);
+                        ds.setByteOrder(QDataStream::LittleEndian);
+                        ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
+                        ds << cl->curVal();
+                        data += cl->chunkData();
+                        tasks.push_back(Task{Task::AppendRecord, projectPath, data,
+                                             XmlCtrlChunk, trackIdx, cl->id(), 0});
+                        }
+                  }
+            }
+      for (Task& task : tasks)
+            task._sampleRate = MusEGlobal::sampleRate;
+      DEBUG_AUTOSAVE(stderr, "AutosaveJournal::writeChanges: %d records\n", (int)tasks.size());
+      _flags = SC_NOTHING;
+      _dirty = false;
+      post(tasks);
+      return true;
+      }
+
+//---------------------------------------------------------
+//   writeBase
+//---------------------------------------------------------
+
+void AutosaveJournal::writeBase(const QString& projectPath, const QByteArray& file)
+      {
+      std::vector<Task> tasks;
+      if (!_projectPath.isEmpty() && _projectPath != projectPath)
+            tasks.push_back(Task{Task::RemoveFiles, _projectPath, QByteArray(), 0, 0, 0, 0});
+      tasks.push_back(Task{Task::WriteBase, projectPath, file, 0, 0, 0, 0});
+      post(tasks);
+
+      _projectPath = projectPath;
+      _needsBase = false;
+      remember();
+      }
+
+//---------------------------------------------------------
+//   post
+//---------------------------------------------------------
+
+void AutosaveJournal::post(std::vector<Task>& tasks)
+      {
+      if (tasks.empty())
+            return;
+      std::unique_lock<std::mutex> lock(_mutex);
+      for (Task& task : tasks)
+            _tasks.push_back(std::move(task));
+      if (!_running) {
+            _quit = false;
+            _running = true;
+            _thread = std::thread(&AutosaveJournal::run, this);
+            }
+      _workCond.notify_one();
+      }
+
+//---------------------------------------------------------
+//   run
+//    The worker thread.
+//---------------------------------------------------------
+
+void AutosaveJournal::run()
+      {
+      std::unique_lock<std::mutex> lock(_mutex);
+      for (;;) {
+            _workCond.wait(lock, [this] { return _quit || !_tasks.empty(); });
+            if (_tasks.empty()) {
+                  // Quitting, and everything is written.
+                  break;
+                  }
+            std::vector<Task> tasks(std::make_move_iterator(_tasks.begin()), std::make_move_iterator(_tasks.end()));
+            _tasks.clear();
+            _busy = true;
+            lock.unlock();
+            process(tasks);
+            lock.lock();
+            _busy = false;
+            _doneCond.notify_all();
+            }
+      }
+
+//---------------------------------------------------------
+//   process
+//---------------------------------------------------------
+
+void AutosaveJournal::process(std::vector<Task>& tasks)
+      {
+      QFile journal;
+      for (const Task& task : tasks) {
+            const QString journalName = journalPath(task._projectPath);
+            if (journal.isOpen() && (task._type != Task::AppendRecord || journal.fileName() != journalName)) {
+                  journal.flush();
+                  fdatasync(journal.handle());
+                  journal.close();
+                  }
+
+            switch (task._type) {
+                  case Task::RemoveFiles:
+                        QFile::remove(journalName);
+                        QFile::remove(basePath(task._projectPath));
+                        break;
+
+                  case Task::WriteBase:
+                  {
+                        // The journal belongs to the old base. Without it, the old base is
+                        //  still a consistent recovery point should the new one fail.
+                        QFile::remove(journalName);
+                        QSaveFile f(basePath(task._projectPath));
+                        if (!f.open(QIODevice::WriteOnly) || f.write(task._data) != task._data.size() || !f.commit())
+                              fprintf(stderr, "AutosaveJournal: cannot write %s: %s\n",
+                                      f.fileName().toLocal8Bit().constData(), f.errorString().toLocal8Bit().constData());
+                        DEBUG_AUTOSAVE(stderr, "AutosaveJournal: wrote base %s\n", f.fileName().toLocal8Bit().constData());
+                  }
+                  break;
+
+                  case Task::AppendRecord:
+                  {
+                        if (!journal.isOpen()) {
+                              journal.setFileName(journalName);
+                              if (!journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+                                    fprintf(stderr, "AutosaveJournal: cannot open %s: %s\n",
+                                            journalName.toLocal8Bit().constData(), journal.errorString().toLocal8Bit().constData());
+                                    break;
+                                    }
+                              if (journal.size() == 0) {
+                                    QByteArray header(journalMagic, sizeof(journalMagic));
+                                    putU32(header, journalVersion);
+                                    putU32(header, task._sampleRate);
+                                    journal.write(header);
+                                    }
+                              }
+                        QByteArray record;
+                        putU32(record, task._recordType);
+                        putU32(record, task._track);
+                        putU32(record, uint32_t(task._item));
+                        putU64(record, task._data.size());
+                        putU32(record, xmlChunkCrc32(task._data.constData(), task._data.size()));
+                        record += task._data;
+                        if (journal.write(record) != record.size())
+                              fprintf(stderr, "AutosaveJournal: cannot write %s: %s\n",
+                                      journalName.toLocal8Bit().constData(), journal.errorString().toLocal8Bit().constData());
+                  }
+                  break;
+                  }
+            }
+      if (journal.isOpen()) {
+            journal.flush();
+            fdatasync(journal.handle());
+            journal.close();
+            }
+      }
+
+//---------------------------------------------------------
+//   flush
+//---------------------------------------------------------
+
+void AutosaveJournal::flush()
+      {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _doneCond.wait(lock, [this] { return _tasks.empty() && !_busy; });
+      }
+
+//---------------------------------------------------------
+//   stop
+//---------------------------------------------------------
+
+void AutosaveJournal::stop()
+      {
+      {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (!_running)
+                  return;
+            _quit = true;
+            _workCond.notify_one();
+      }
+      _thread.join();
+      std::unique_lock<std::mutex> lock(_mutex);
+      _running = false;
+      }
+
+} // namespace MusECore
@@ -0,0 +1,139 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  autosave.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __AUTOSAVE_H__
+#define __AUTOSAVE_H__
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include <condition_variable>
+
+#include <QString>
+#include <QByteArray>
+
+#include "type_defs.h"
+
+namespace MusECore {
+
+class Part;
+class CtrlList;
+
+//---------------------------------------------------------
+//   AutosaveJournal
+//    Autosave without rewriting the whole project.
+//    Changes since the project was saved are appended to a
+//     journal next to the project by a worker thread: the
+//     events of changed midi parts and the points of changed
+//     audio controller lists. Other changes need a base
+//     snapshot of the whole song, a chunk file written next
+//     to the project, after which the journal starts over.
+//    To recover, the base snapshot is loaded, or the project
+//     if there is none, and the journal is replayed onto it.
+//
+//    Journal: 8 bytes magic "MusEJrnl", u32 format version,
+//             u32 sample rate, then the records.
+//    Record:  u32 type, u32 track index, i32 part index or
+//             controller id, u64 data size, u32 crc32 of the
+//             data, then the data. The data is that of an event
+//             or controller chunk of a chunk file, for
+//             controllers preceded by the current value as a
+//             double. All numbers are little endian.
+//---------------------------------------------------------
+
+class AutosaveJournal {
+      struct Task {
+            enum Type { RemoveFiles, WriteBase, AppendRecord };
+            Type _type;
+            QString _projectPath;
+            QByteArray _data;
+            uint32_t _recordType;
+            uint32_t _track;
+            int32_t _item;
+            unsigned _sampleRate;
+            };
+
+      QString _projectPath;
+      SongChangedStruct_t _flags;
+      // Whether the song was marked dirty since the last snapshot.
+      bool _dirty;
+      bool _needsBase;
+      // The event list and controller list serial numbers, and controller current values,
+      //  at the time of the last snapshot.
+      std::map<const Part*, unsigned int> _partSerials;
+      std::map<const CtrlList*, std::pair<unsigned int, double> > _ctrlSerials;
+
+      std::thread _thread;
+      bool _running;
+      std::mutex _mutex;
+      std::condition_variable _workCond;
+      std::condition_variable _doneCond;
+      std::deque<Task> _tasks;
+      bool _busy;
+      bool _quit;
+
+      void remember();
+      void post(std::vector<Task>& tasks);
+      void run();
+      void process(std::vector<Task>& tasks);
+
+   public:
+      AutosaveJournal();
+      ~AutosaveJournal();
+
+      static QString basePath(const QString& projectPath);
+      static QString journalPath(const QString& projectPath);
+      // Whether there is an autosave of the project which is newer than the project.
+      static bool hasRecovery(const QString& projectPath);
+      // The file to load to recover the project: the base snapshot, or the project itself.
+      static QString recoveryFile(const QString& projectPath);
+      // Replays the journal of the project onto the loaded song. The audio must be stopped.
+      // Returns the number of records replayed, or -1 if the journal could not be read.
+      static int replay(const QString& projectPath);
+
+      // GUI thread. Starts over for the song, which was just loaded or saved as projectPath,
+      //  and removes the autosave files. With keepFiles, the song was recovered from the
+      //  autosave files: they are kept until a new base snapshot replaces them.
+      void reset(const QString& projectPath, bool keepFiles = false);
+      // GUI thread. Notes the flags of a song change.
+      void songChanged(SongChangedStruct_t flags);
+      // GUI thread. Notes that the song was marked dirty. Some changes, like the state
+      //  of a plugin, only do that. Without the flags of a song change they need a base snapshot.
+      void setDirty() { _dirty = true; }
+      // GUI thread. Hands records of the parts and controllers changed since the last snapshot
+      //  to the writer. Returns false if there are other changes, which need a base snapshot.
+      bool writeChanges(const QString& projectPath);
+      // GUI thread. Hands a base snapshot, the song written as a chunk file, to the writer.
+      void writeBase(const QString& projectPath, const QByteArray& file);
+      // Waits until everything handed to the writer is written.
+      void flush();
+      // Writes what is pending and stops the worker thread.
+      void stop();
+      };
+
+} // namespace MusECore
+
+#endif
@@ -23,6 +23,7 @@
 #include <QWidget>
 #include <QString>
 #include <QToolButton>
+#include <QAction>
 #include <QLatin1Char>
 #include <QHBoxLayout>
 #include <QMouseEvent>
@@ -161,6 +162,9 @@ void CpuToolbar::init()
     _dspLabel->setPrecision(1);
     _xrunsLabel = new PaddedValueLabel(false, this, Qt::Widget, "XRUNS: ");
     _xrunsLabel->setFieldWidth(3);
+    _diskLabel = new PaddedValueLabel(true, this, Qt::Widget, "DISK: ", "%");
+    _diskLabel->setFieldWidth(5);
+    _diskLabel->setPrecision(1);
 
     setValues(0.0f, 0.0f, 0);
 
@@ -168,6 +172,8 @@ void CpuToolbar::init()
     addWidget(_cpuLabel);
     addWidget(_dspLabel);
     addWidget(_xrunsLabel);
+    _diskAction = addWidget(_diskLabel);
+    _diskAction->setVisible(false);
 
     connect(_resetButton, SIGNAL(clicked(bool)), SIGNAL(resetClicked()));
 }
@@ -179,6 +185,16 @@ void CpuToolbar::setValues(float cpuLoad, float dspLoad, long xRunsCount)
     _xrunsLabel->setIntValue(xRunsCount);
 }
 
+void CpuToolbar::setDiskValues(bool active, double backlogPercent, bool overrun, const QString& details)
+{
+    _diskAction->setVisible(active);
+    if(!active)
+        return;
+    _diskLabel->setFloatValue(backlogPercent);
+    _diskLabel->setStyleSheet(overrun ? "QLabel { color : red; }" : QString());
+    _diskLabel->setToolTip(details);
+}
+
 //---------------------------------
 //   CpuStatusbar
 //---------------------------------
@@ -206,7 +222,19 @@ CpuStatusBar::CpuStatusBar(QWidget* parent)
     xrunsLabel->setStatusTip(tr("Number of xruns.\nDouble-click to reset."));
     xrunsLabel->setFieldWidth(3);
 
+    diskLabel = new PaddedValueLabel(true, this, Qt::Widget, "DISK: ", "%");
+    diskLabel->setStatusTip(tr("Fullest record buffer while recording. Hover for each track's statistics."));
+    diskLabel->setFieldWidth(5);
+    diskLabel->setPrecision(1);
+    diskLabel->setVisible(false);
+
+    undoLabel = new PaddedValueLabel(true, this, Qt::Widget, "UNDO: ", " MB");
+    undoLabel->setStatusTip(tr("Memory held by the undo history."));
+    undoLabel->setFieldWidth(5);
+    undoLabel->setPrecision(1);
+
     setValues(0.0f, 0.0f, 0);
+    setUndoMemory(0, 0);
 
     QHBoxLayout *layout = new QHBoxLayout(this);
     layout->setContentsMargins(4, 0, 4, 0);
@@ -214,6 +242,8 @@ CpuStatusBar::CpuStatusBar(QWidget* parent)
     layout->addWidget(cpuLabel);
     layout->addWidget(dspLabel);
     layout->addWidget(xrunsLabel);
+    layout->addWidget(diskLabel);
+    layout->addWidget(undoLabel);
 
     connect(xrunsLabel, SIGNAL(doubleclicked()), SIGNAL(resetClicked()));
 }
@@ -225,5 +255,25 @@ void CpuStatusBar::setValues(float cpuLoad, float dspLoad, long xRunsCount)
     xrunsLabel->setIntValue(xRunsCount);
 }
 
+void CpuStatusBar::setDiskValues(bool active, double backlogPercent, bool overrun, const QString& details)
+{
+    diskLabel->setVisible(active);
+    if(!active)
+        return;
+    diskLabel->setFloatValue(backlogPercent);
+    diskLabel->setStyleSheet(overrun ? "QLabel { color : red; }" : QString());
+    diskLabel->setToolTip(details);
+}
+
+void CpuStatusBar::setUndoMemory(size_t bytes, int limitMegabytes)
+{
+    undoLabel->setFloatValue(double(bytes) / (1024.0 * 1024.0));
+    if(limitMegabytes > 0)
+        undoLabel->setToolTip(tr("Memory held by the undo history.\n"
+                                 "Beyond %1 MB the oldest undo steps are forgotten.").arg(limitMegabytes));
+    else
+        undoLabel->setToolTip(tr("Memory held by the undo history.\nThere is no limit."));
+}
+
 
 }  // namespace MusEGui
@@ -30,6 +30,7 @@ class QWidget;
 class QString;
 class QToolButton;
 class QSize;
+class QAction;
 
 namespace MusEGui
 {
@@ -104,6 +105,8 @@ private:
     PaddedValueLabel* _cpuLabel;
     PaddedValueLabel* _dspLabel;
     PaddedValueLabel* _xrunsLabel;
+    PaddedValueLabel* _diskLabel;
+    QAction* _diskAction;
 
     void init();
 
@@ -115,6 +118,8 @@ public:
     void setDspLabelText(const QString&);
     void setXrunsLabelText(const QString&);
     void setValues(float cpuLoad, float dspLoad, long xRunsCount);
+    // Record writer backlog of the fullest recording track. Shown only while active.
+    void setDiskValues(bool active, double backlogPercent, bool overrun, const QString& details);
 
 signals:
     void resetClicked();
@@ -133,6 +138,8 @@ private:
     PaddedValueLabel* cpuLabel;
     PaddedValueLabel* dspLabel;
     PaddedValueLabel* xrunsLabel;
+    PaddedValueLabel* diskLabel;
+    PaddedValueLabel* undoLabel;
 
 public:
     CpuStatusBar(QWidget* parent = nullptr);
@@ -141,6 +148,10 @@ public:
     void setDspLabelText(const QString&);
     void setXrunsLabelText(const QString&);
     void setValues(float cpuLoad, float dspLoad, long xRunsCount);
+    // Record writer backlog of the fullest recording track. Shown only while active.
+    void setDiskValues(bool active, double backlogPercent, bool overrun, const QString& details);
+    // Memory held by the undo history, and its configured limit in megabytes (0 = no limit).
+    void setUndoMemory(size_t bytes, int limitMegabytes);
 
 signals:
     void resetClicked();
@@ -23,6 +23,26 @@ PluginSettings::PluginSettings(MusECore::PluginIBase *plugin, bool globalScaleRe
     ui->cbTransportAffectsLatency->setChecked(plugin->quirks()._transportAffectsAudioLatency);
     ui->cbTransportAffectsLatency->setEnabled(plugin->usesTransportSource());
 
+    ui->cbSerialLoad->setChecked(plugin->quirks()._serialLoad);
+
+    // Rack plugins only. Synths are neither bridged nor fed at control rate.
+    const MusECore::PluginI* rackPlugin = dynamic_cast<const MusECore::PluginI*>(plugin);
+
+    ui->cbRunInBridge->setChecked(plugin->quirks()._runInBridge);
+#ifdef PLUGIN_BRIDGE_SUPPORT
+    ui->cbRunInBridge->setEnabled(rackPlugin && rackPlugin->pluginType() == MusEPlugin::PluginTypeLADSPA);
+#else
+    ui->cbRunInBridge->setEnabled(false);
+#endif
+
+    ui->cbBlockRateControls->setChecked(plugin->quirks()._blockRateControls);
+    ui->cbBlockRateControls->setEnabled(rackPlugin != nullptr);
+    if (rackPlugin)
+        ui->labelSlices->setText(tr("Runs per cycle: %1 last, %2 most")
+                                 .arg(rackPlugin->cycleSlices()).arg(rackPlugin->maxCycleSlices()));
+    else
+        ui->labelSlices->hide();
+
     ui->cbOverrideLatency->setChecked(plugin->quirks()._overrideReportedLatency);
     ui->sbOverrideLatency->setValue(plugin->quirks()._latencyOverrideValue);
     ui->sbOverrideLatency->setEnabled(plugin->cquirks()._overrideReportedLatency);
@@ -36,6 +56,7 @@ PluginSettings::PluginSettings(MusECore::PluginIBase *plugin, bool globalScaleRe
         ui->rbRevertScalingOff->setChecked(true);
 
     settings = &plugin->quirks();
+    _plugin = plugin;
 }
 
 PluginSettings::~PluginSettings()
@@ -73,6 +94,19 @@ void PluginSettings::on_buttonBox_accepted()
     if (routeChanged)
         MusEGlobal::song->update(SC_ROUTE);
 
+    // Takes effect the next time the song is loaded.
+    if (ui->cbSerialLoad->isChecked() != settings->_serialLoad)
+        settings->_serialLoad = ui->cbSerialLoad->isChecked();
+
+    // Takes effect in the next cycle.
+    if (ui->cbBlockRateControls->isChecked() != settings->_blockRateControls)
+        settings->_blockRateControls = ui->cbBlockRateControls->isChecked();
+
+    if (ui->cbRunInBridge->isChecked() != settings->_runInBridge) {
+        settings->_runInBridge = ui->cbRunInBridge->isChecked();
+        _plugin->quirksChanged();
+    }
+
     MusECore::PluginQuirks::NatUISCaling scaleMode;
     if (ui->rbRevertScalingFollowGlobal->isChecked())
         scaleMode = MusECore::PluginQuirks::GLOBAL;
@@ -31,6 +31,7 @@ private:
     Ui::PluginSettings *ui;
 
     MusECore::PluginQuirks *settings;
+    MusECore::PluginIBase *_plugin;
 };
 
 }
@@ -113,12 +113,14 @@ void UnusedWaveFiles::accept()
 
         foreach(QString file, allWaveFiles) {
             QFile::rename(MusEGlobal::museProject+ "/"+file, MusEGlobal::museProject + "/unused/" +file);
-            // move the wca file if it exists
+            // move the peak files if they exist
             QFileInfo wf(MusEGlobal::museProject + "/" + file);
-            if (QFile::exists(MusEGlobal::museProject + "/" + wf.baseName()+".wca")) {
-                QFile::rename(MusEGlobal::museProject + "/" + wf.baseName()+".wca",
-                              MusEGlobal::museProject + "/unused/" +wf.baseName()+".wca");
-
+            const char* peakExts[] = { ".wpk", ".wca" };
+            for (const char* ext : peakExts) {
+                if (QFile::exists(MusEGlobal::museProject + "/" + wf.baseName()+ext)) {
+                    QFile::rename(MusEGlobal::museProject + "/" + wf.baseName()+ext,
+                                  MusEGlobal::museProject + "/unused/" +wf.baseName()+ext);
+                }
             }
         }
     }
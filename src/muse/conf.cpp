@@ -1353,6 +1353,20 @@ void readConfiguration(Xml& xml, bool doReadMidiPortConfig, bool doReadGlobalCon
                               MusEGlobal::config.monitoringAffectsLatency = xml.parseInt();
                         else if (tag == "commonProjectLatency")
                               MusEGlobal::config.commonProjectLatency = xml.parseInt();
+                        else if (tag == "parallelAudioGraph")
+                              MusEGlobal::config.parallelAudioGraph = xml.parseInt();
+                        else if (tag == "audioGraphThreads")
+                              MusEGlobal::config.audioGraphThreads = xml.parseInt();
+                        else if (tag == "prefetchThreads")
+                              MusEGlobal::config.prefetchThreads = xml.parseInt();
+                        else if (tag == "peakBuildThreads")
+                              MusEGlobal::config.peakBuildThreads = xml.parseInt();
+                        else if (tag == "pluginScanThreads")
+                              MusEGlobal::config.pluginScanThreads = xml.parseInt();
+                        else if (tag == "recordBufferSeconds")
+                              MusEGlobal::config.recordBufferSeconds = xml.parseInt();
+                        else if (tag == "undoMemoryLimit")
+                              MusEGlobal::config.undoMemoryLimit = xml.parseInt();
                         
                         else if (tag == "minControlProcessPeriod")
                               MusEGlobal::config.minControlProcessPeriod = xml.parseUInt();
@@ -2045,6 +2059,13 @@ void MusE::writeGlobalConfiguration(int level, MusECore::Xml& xml) const
       xml.intTag(level, "correctUnterminatedOutBranchLatency", MusEGlobal::config.correctUnterminatedOutBranchLatency);
       xml.intTag(level, "monitoringAffectsLatency", MusEGlobal::config.monitoringAffectsLatency);
       xml.intTag(level, "commonProjectLatency", MusEGlobal::config.commonProjectLatency);
+      xml.intTag(level, "parallelAudioGraph", MusEGlobal::config.parallelAudioGraph);
+      xml.intTag(level, "audioGraphThreads", MusEGlobal::config.audioGraphThreads);
+      xml.intTag(level, "prefetchThreads", MusEGlobal::config.prefetchThreads);
+      xml.intTag(level, "peakBuildThreads", MusEGlobal::config.peakBuildThreads);
+      xml.intTag(level, "pluginScanThreads", MusEGlobal::config.pluginScanThreads);
+      xml.intTag(level, "recordBufferSeconds", MusEGlobal::config.recordBufferSeconds);
+      xml.intTag(level, "undoMemoryLimit", MusEGlobal::config.undoMemoryLimit);
 
       xml.uintTag(level, "minControlProcessPeriod", MusEGlobal::config.minControlProcessPeriod);
       xml.intTag(level, "guiRefresh", MusEGlobal::config.guiRefresh);
@@ -27,7 +27,10 @@
 // Turn on debugging messages
 //#define _CTRL_DEBUG_
 
+#include <algorithm>
+
 #include <QLocale>
+#include <QDataStream>
 
 #include "muse_math.h"
 #include "gconfig.h"
@@ -36,6 +39,7 @@
 #include "ctrl.h"
 #include "midictrl.h"
 #include "hex_float.h"
+#include "xml_chunks.h"
 
 // Forwards from header:
 #include "xml.h"
@@ -594,6 +598,7 @@ CtrlList::CtrlList(bool dontShow)
       _visible = false;
       _valueUnit = -1;
       _displayHint = DisplayDefault;
+      _playbackCursor = 0;
       initColor(0);
       }
 
@@ -608,6 +613,7 @@ CtrlList::CtrlList(int id, bool dontShow)
       _valueType = VAL_LINEAR;
       _valueUnit = -1;
       _displayHint = DisplayDefault;
+      _playbackCursor = 0;
 
       _dontShow = dontShow;
       _visible = false;
@@ -628,6 +634,7 @@ CtrlList::CtrlList(int id, QString name, double min, double max, CtrlValueType v
       _visible = false;
       _valueUnit = -1;
       _displayHint = DisplayDefault;
+      _playbackCursor = 0;
       initColor(id);
 }
 
@@ -635,6 +642,7 @@ CtrlList::CtrlList(const CtrlList& l, int flags)
 {
   _id          = l._id;
   _valueType   = l._valueType;
+  _playbackCursor = 0;
   assign(l, flags | ASSIGN_PROPERTIES);
 }
 
@@ -655,6 +663,7 @@ CtrlList::CtrlList(const CtrlList& cl)
   _visible       = cl._visible;
   _valueUnit     = cl._valueUnit;
   _displayHint   = cl._displayHint;
+  _playbackCursor = 0;
 }
 
 //---------------------------------------------------------
@@ -679,7 +688,10 @@ void CtrlList::assign(const CtrlList& l, int flags)
   }
   
   if(flags & ASSIGN_VALUES)
+  {
     CtrlList_t::operator=(l); // Let map copy the items.
+    invalidateSnapshot();
+  }
 }
 
 //---------------------------------------------------------
@@ -742,6 +754,114 @@ void CtrlList::getInterpolation(unsigned int frame, bool cur_val_only, CtrlInter
   }
 }
 
+//---------------------------------------------------------
+//   getPlaybackInterpolation
+//   Audio thread only. Same results as getInterpolation().
+//   During playback the frames only move forward, so the item
+//    found last time or the one after it is almost always the
+//    right one. Only after a seek a binary search is needed.
+//---------------------------------------------------------
+
+void CtrlList::getPlaybackInterpolation(unsigned int frame, bool cur_val_only, CtrlInterpolate* interp) const
+{
+  bool taken;
+  const CtrlListSnapshot* snap = _playback.take(&taken);
+  if(taken)
+    _playbackCursor = 0;
+  if(cur_val_only || !snap || snap->_items.empty())
+  {
+    getInterpolation(frame, cur_val_only, interp);
+    return;
+  }
+
+  const std::vector<CtrlSnapshotItem>& items = snap->_items;
+  const unsigned int sz = items.size();
+
+  // Find the first item after the frame, like upper_bound().
+  unsigned int i = _playbackCursor;
+  if(i > sz || (i > 0 && items[i - 1].frame > frame))
+    i = sz + 1;  // Went backwards. Search.
+  else if(i < sz && items[i].frame <= frame)
+  {
+    // Went forwards. Try the next one first.
+    ++i;
+    if(i < sz && items[i].frame <= frame)
+      i = sz + 1;
+  }
+  if(i > sz)
+  {
+    i = std::upper_bound(items.cbegin(), items.cend(), frame,
+      [](unsigned int f, const CtrlSnapshotItem& item) { return f < item.frame; }) - items.cbegin();
+  }
+  _playbackCursor = i;
+
+  interp->eStop = false; // During processing, control FIFO ring buffers will set this true.
+
+  if(i == sz)   // if we are past all items just return the last value
+  {
+    const CtrlSnapshotItem& it = items[i - 1];
+    interp->sFrame = it.frame;
+    interp->eFrame = 0;
+    interp->eFrameValid = false;
+    interp->sVal = it.value;
+    interp->eVal = it.value;
+    interp->doInterp = false;
+  }
+  else if(i == 0)
+  {
+    const CtrlSnapshotItem& it = items[0];
+    interp->sFrame = 0;
+    interp->eFrame = it.frame;
+    interp->eFrameValid = true;
+    interp->sVal = it.value;
+    interp->eVal = it.value;
+    interp->doInterp = false;
+  }
+  else
+  {
+    const CtrlSnapshotItem& it2 = items[i];
+    const CtrlSnapshotItem& it1 = items[i - 1];
+    interp->eFrame = it2.frame;
+    interp->eFrameValid = true;
+    interp->eVal = it2.value;
+    interp->sFrame = it1.frame;
+    interp->sVal = it1.value;
+
+    if(_mode == DISCRETE || it1.discrete)
+      interp->doInterp = false;
+    else
+      interp->doInterp = (interp->eVal != interp->sVal && interp->eFrame > interp->sFrame);
+  }
+}
+
+//---------------------------------------------------------
+//   invalidateSnapshot
+//---------------------------------------------------------
+
+void CtrlList::invalidateSnapshot()
+{
+  _playback.invalidate();
+}
+
+//---------------------------------------------------------
+//   updateSnapshot
+//   GUI thread only.
+//---------------------------------------------------------
+
+bool CtrlList::updateSnapshot()
+{
+  unsigned int serial;
+  if(!_playback.needsUpdate(&serial))
+    return false;
+
+  CtrlListSnapshot* s = new CtrlListSnapshot();
+  s->_items.reserve(size());
+  for(ciCtrl ic = cbegin(); ic != cend(); ++ic)
+    s->_items.push_back(CtrlSnapshotItem { ic->first, ic->second.value(), ic->second.discrete() });
+  _playback.publish(s, serial);
+  return true;
+}
+
 //---------------------------------------------------------
 //   interpolate
 //   Returns interpolated value at given frame, from a CtrlInterpolate struct.
@@ -1085,6 +1205,7 @@ CtrlList& CtrlList::operator=(const CtrlList& cl)
   
   // Let map copy the items.
   CtrlList_t::operator=(cl);
+  invalidateSnapshot();
   return *this;
 }
 
@@ -1094,6 +1215,8 @@ void CtrlList::swap(CtrlList& cl) noexcept
   printf("CtrlList::swap id:%d\n", cl.id());  
 #endif
   CtrlList_t::swap(cl);
+  invalidateSnapshot();
+  cl.invalidateSnapshot();
 }
 
 std::pair<iCtrl, bool> CtrlList::insert(const CtrlListInsertPair_t& p)
@@ -1279,16 +1402,19 @@ void CtrlList::clear() noexcept
 
 std::pair<CtrlList::iterator, bool> CtrlList::add(unsigned int frame, double value, bool selected, bool discrete, bool groupEnd)
       {
+      invalidateSnapshot();
       return insert_or_assign(frame, CtrlVal(value, selected, discrete, groupEnd));
       }
 
 std::pair<CtrlList::iterator, bool> CtrlList::add(unsigned int frame, const CtrlVal& cv)
       {
+      invalidateSnapshot();
       return insert_or_assign(frame, cv);
       }
 
 std::pair<CtrlList::iterator, bool> CtrlList::add(unsigned int frame, double value, CtrlVal::CtrlValueFlags flags)
       {
+      invalidateSnapshot();
       return insert_or_assign(frame, CtrlVal(value, flags));
       }
 
@@ -1303,6 +1429,7 @@ std::pair<CtrlList::iterator, bool> CtrlList::modify(unsigned int frame, double
   if(ic == end())
   {
     const CtrlVal::CtrlModifyValueFlags f = validAddFlags & CtrlVal::VAL_MODIFY_SAME_AS ? validModifyFlags : validAddFlags;
+    invalidateSnapshot();
     return insert(CtrlListInsertPair_t(frame, CtrlVal(f & CtrlVal::VAL_MODIFY_VALUE ? value : 0.0, (flags & f) & CtrlVal::VAL_FLAGS_MASK)));
   }
   else
@@ -1318,6 +1445,7 @@ void CtrlList::modify(iterator ic, double value, CtrlVal::CtrlValueFlags flags,
   if(validModifyFlags & CtrlVal::VAL_MODIFY_VALUE)
     ic->second.setValue(value);
   ic->second.setFlags(((ic->second.flags() & ~validModifyFlags) | (flags & validModifyFlags)) & CtrlVal::VAL_FLAGS_MASK);
+  invalidateSnapshot();
 }
 
 //---------------------------------------------------------
@@ -1330,6 +1458,7 @@ void CtrlList::del(unsigned int frame)
       if (e == end())
             return;
       erase(e);
+      invalidateSnapshot();
       }
 
 bool CtrlList::updateGroups()
@@ -1544,6 +1673,70 @@ void CtrlList::readValues(const QString& tag, const int samplerate)
   }
 }
 
+//---------------------------------------------------------
+//   chunkData
+//   Per point a u32 frame, a double value and u32 flags.
+//---------------------------------------------------------
+
+QByteArray CtrlList::chunkData() const
+{
+  QByteArray data;
+  QDataStream ds(&data, QIODevice::WriteOnly);
+  ds.setByteOrder(QDataStream::LittleEndian);
+  ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
+  ds << quint32(size());
+  for (ciCtrl ic = cbegin(); ic != cend(); ++ic)
+  {
+    CtrlVal::CtrlValueFlags flags = ic->second.flags();
+    flags &= ~CtrlVal::VAL_NON_GROUP_END;
+    ds << quint32(ic->first) << ic->second.value() << quint32(flags);
+  }
+  return data;
+}
+
+//---------------------------------------------------------
+//   readChunkData
+//---------------------------------------------------------
+
+bool CtrlList::readChunkData(const QByteArray& data, const int samplerate)
+{
+  QDataStream ds(data);
+  ds.setByteOrder(QDataStream::LittleEndian);
+  ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
+  quint32 n = 0;
+  ds >> n;
+  for(quint32 i = 0; i < n; ++i)
+  {
+    quint32 frame, flags;
+    double val;
+    ds >> frame >> val >> flags;
+    if(ds.status() != QDataStream::Ok)
+      return false;
+    // Same as readValues().
+    frame = MusEGlobal::convertFrame4ProjectSampleRate(frame, samplerate);
+    add(frame, val, CtrlVal::CtrlValueFlags(flags) | CtrlVal::VAL_NON_GROUP_END);
+  }
+  return ds.status() == QDataStream::Ok;
+}
+
+//---------------------------------------------------------
+//   readChunk
+//   Reads the points of a chunk file's chunk, as written by write().
+//---------------------------------------------------------
+
+void CtrlList::readChunk(const Xml& xml, int chunk, const int samplerate)
+{
+  uint32_t version = 0;
+  const QByteArray* data = xml.chunkReader() ? xml.chunkReader()->chunk(chunk, XmlCtrlChunk, &version) : nullptr;
+  if(!data || version > 1)
+  {
+    fprintf(stderr, "CtrlList::readChunk: no controller chunk %d\n", chunk);
+    return;
+  }
+  if(!readChunkData(*data, samplerate))
+    fprintf(stderr, "CtrlList::readChunk: controller chunk %d is corrupt\n", chunk);
+}
+
 //---------------------------------------------------------
 //   read
 //---------------------------------------------------------
@@ -1560,6 +1753,7 @@ bool CtrlList::read(Xml& xml)
       bool maxOk = false;
       int valType = VAL_LINEAR;
       int samplerate = MusEGlobal::sampleRate;
+      int chunk = -1;
 
       for (;;) {
             Xml::Token token = xml.parse();
@@ -1633,6 +1827,13 @@ bool CtrlList::read(Xml& xml)
                                 fprintf(stderr, "CtrlList::read failed reading samplerate string: %s\n",
                                         xml.s2().toLocal8Bit().constData());
                         }
+                        else if (tag == "chunk")
+                        {
+                              chunk = loc.toInt(xml.s2(), &ok);
+                              if(!ok)
+                                fprintf(stderr, "CtrlList::read failed reading chunk string: %s\n",
+                                        xml.s2().toLocal8Bit().constData());
+                        }
                         else
                               fprintf(stderr,"CtrlList::read unknown tag %s\n", tag.toLocal8Bit().constData());
                         break;
@@ -1644,6 +1845,8 @@ bool CtrlList::read(Xml& xml)
                   case Xml::TagEnd:
                         if (xml.s1() == "controller")
                         {
+                              if(chunk != -1)
+                                readChunk(xml, chunk, samplerate);
                               setId(id);
                               if(minOk && maxOk)
                                 setRange(min, max);
@@ -1668,6 +1871,14 @@ void CtrlList::write(int level, Xml& xml, int idMask) const
         QString s = QString("controller id=\"%1\" cur=\"%2\" color=\"%3\" visible=\"%4\"")
           .arg(ctlid).arg(MusELib::museStringFromDouble(curVal())).arg(color().name()).arg(isVisible());
 
+        // When writing a chunk file, the points go to a binary chunk.
+        if(!isempty && xml.chunkWriter())
+        {
+          const int idx = xml.chunkWriter()->add(XmlCtrlChunk, 1, chunkData());
+          xml.emptyTag(level, s + QString(" chunk=\"%1\"").arg(idx));
+          return;
+        }
+
         // List is empty? End the line now.
         if(isempty)
           xml.emptyTag(level, s);
@@ -1783,7 +1994,15 @@ ciCtrlList CtrlListList::findName(const QString &s) const
 
 void CtrlListList::clearAllAutomation() {
       for(iCtrlList i = begin(); i != end(); ++i)
+      {
         i->second->clear();
+        i->second->invalidateSnapshot();
+      }
+      }
+
+void CtrlListList::updateSnapshots() {
+      for(iCtrlList i = begin(); i != end(); ++i)
+        i->second->updateSnapshot();
       }
 
 //---------------------------------------------------------
@@ -31,13 +31,17 @@
 #include <list>
 #include <vector>
 #include <set>
+#include <atomic>
 
 #include <QColor>
 #include <QString>
 #include <QUuid>
+#include <QByteArray>
 
 #include <stdint.h>
 
+#include "snapshot_exchange.h"
+
 #define AC_PLUGIN_CTL_BASE         0x1000
 #define AC_PLUGIN_CTL_BASE_POW     12
 #define AC_PLUGIN_CTL_ID_MASK      0xFFF
@@ -258,6 +262,24 @@ class MidiAudioCtrlMap : public std::multimap<MidiAudioCtrlMap_idx_t, MidiAudioC
 // Forward reference.
 class PasteCtrlTrackMap;
 
+//---------------------------------------------------------
+//   CtrlListSnapshot
+//    A read-only copy of a CtrlList's items in a flat
+//     sorted array, for the audio thread.
+//---------------------------------------------------------
+
+struct CtrlSnapshotItem {
+      unsigned int frame;
+      double value;
+      bool discrete;
+      };
+
+struct CtrlListSnapshot {
+      std::vector<CtrlSnapshotItem> _items;
+      // The list's serial number when the snapshot was built.
+      unsigned int _serial;
+      };
+
 //---------------------------------------------------------
 //   CtrlList
 //    arrange controller events of a specific type in a
@@ -300,6 +322,10 @@ class CtrlList : public CtrlList_t {
       // Can be -1 meaning no units.
       int _valueUnit;
       DisplayHints _displayHint;
+      // Snapshots of the items for the audio thread.
+      mutable SnapshotExchange<CtrlListSnapshot> _playback;
+      // Audio thread only. Index of the first snapshot item after the last looked up frame.
+      mutable unsigned int _playbackCursor;
 
    public:
       CtrlList(bool dontShow=false);
@@ -359,6 +385,18 @@ class CtrlList : public CtrlList_t {
       void setValueType(CtrlValueType t);
       void getInterpolation(unsigned int frame, bool cur_val_only, CtrlInterpolate* interp) const;
       double interpolate(unsigned int frame, const CtrlInterpolate& interp) const;
+      // Audio thread only. Same as getInterpolation(), but looks up the frame in the
+      //  snapshot, starting at the last position. Falls back to getInterpolation()
+      //  while the snapshot is not up to date.
+      void getPlaybackInterpolation(unsigned int frame, bool cur_val_only, CtrlInterpolate* interp) const;
+      // Marks the snapshot as out of date. Call after changing the items directly,
+      //  the add, modify and del methods do it automatically.
+      void invalidateSnapshot();
+      // Changes whenever the items change. For telling whether the list changed since some earlier time.
+      unsigned int serial() const { return _playback.serial(); }
+      // GUI thread only. Builds and publishes a new snapshot if the items changed.
+      // Returns true if a new snapshot was published.
+      bool updateSnapshot();
 
       double value(unsigned int frame, bool cur_val_only = false,
                    unsigned int* nextFrame = nullptr, bool* nextFrameValid = nullptr) const;
@@ -387,6 +425,12 @@ class CtrlList : public CtrlList_t {
       bool updateGroups(iterator);
       // The samplerate of the complete controller graph is given. Graph times are converted.
       void readValues(const QString& tag, const int samplerate);
+      // Reads the points from a chunk of a chunk file. Graph times are converted as with readValues().
+      void readChunk(const Xml& xml, int chunk, const int samplerate);
+      // The points in the binary form of a chunk file's controller chunk.
+      QByteArray chunkData() const;
+      // Adds the points of a controller chunk's data. Returns false if the data is corrupt.
+      bool readChunkData(const QByteArray& data, const int samplerate);
       bool read(Xml& xml);
       // If idMask is given, mask the id bits when saving.
       void write(int level, Xml& xml, int idMask = -1) const;
@@ -446,6 +490,8 @@ class CtrlListList : public std::map<int, CtrlList*, std::less<int> > {
                    unsigned int* nextFrame = nullptr, bool* nextFrameValid = nullptr) const;
       void updateCurValues(unsigned int frame);
       void clearAllAutomation();
+      // GUI thread only. Updates the snapshots of all lists, see CtrlList::updateSnapshot().
+      void updateSnapshots();
       // If startId and/or endId are given, writes only that range.
       // Either can be -1 meaning open-ended. Note that endId means one past the last id.
       // If idMask is given, mask the id bits when saving.
@@ -1149,7 +1149,7 @@ void CtrlCanvas::updateItems()
                       {
                           if(mcvl && last.empty()) 
                           {
-                                lastce = new CEvent(MusECore::Event(), part, mcvl->value(part->tick()));
+                                lastce = new CEvent(MusECore::Event(), part, mcvl->index()->value(part->tick()));
                                 items.add(lastce);
                           }
                           if (lastce)
@@ -58,6 +58,8 @@ class DummyAudioDevice : public AudioDevice {
       float* buffer;
       int _realTimePriority;
       bool _freewheelMode;
+      // Offline mode: Run the cycles back to back while the transport is rolling.
+      bool _offline;
 
       // Critical variables that need to all update at once.
       // We employ a 'flipping' technique.
@@ -89,7 +91,7 @@ class DummyAudioDevice : public AudioDevice {
         _criticalVariablesIdx = idx;
       }
 
-      DummyAudioDevice();
+      DummyAudioDevice(bool offline = false);
       virtual ~DummyAudioDevice()
       { 
         free(buffer); 
@@ -113,6 +115,9 @@ class DummyAudioDevice : public AudioDevice {
       virtual unsigned framesAtCycleStart() const { return _framesAtCycleStart[_criticalVariablesIdx]; }
       virtual unsigned framesSinceCycleStart() const 
       { 
+        // Wall clock time has no relation to the cycles in offline mode.
+        if(_offline)
+          return 0;
         const uint64_t ct = systemTimeUS();
         DEBUG_DUMMY(stderr, "DummyAudioDevice::framesSinceCycleStart systemTimeUS:%lu timeUSAtCycleStart:%lu\n", 
                 ct, _timeUSAtCycleStart[_criticalVariablesIdx]);
@@ -178,15 +183,17 @@ class DummyAudioDevice : public AudioDevice {
       virtual int realtimePriority() const { return _realTimePriority; }
 
       bool freewheelMode() const { return _freewheelMode; }
+      bool offline() const { return _offline; }
       virtual void setFreewheel(bool v) { _freewheelMode = v; }
       virtual int setMaster(bool, bool /*unconditional*/ = false) { return 1; }
       };
 
 DummyAudioDevice* dummyAudio = 0;
 
-DummyAudioDevice::DummyAudioDevice() : AudioDevice()
+DummyAudioDevice::DummyAudioDevice(bool offline) : AudioDevice()
       {
         _freewheelMode = false;
+        _offline = offline;
 //       MusEGlobal::sampleRate = MusEGlobal::config.dummyAudioSampleRate;
 //       MusEGlobal::segmentSize = MusEGlobal::config.dummyAudioBufSize;
         
@@ -246,11 +253,13 @@ void exitDummyAudio()
 
 //---------------------------------------------------------
 //   initDummyAudio
+//    offline - Do not pace the cycles in real time while
+//               the transport is rolling. For rendering.
 //---------------------------------------------------------
 
-bool initDummyAudio()
+bool initDummyAudio(bool offline)
       {
-      dummyAudio = new DummyAudioDevice();
+      dummyAudio = new DummyAudioDevice(offline);
       MusEGlobal::audioDevice = dummyAudio;
       return false;
       }
@@ -313,7 +322,9 @@ static void* dummyLoop(void* ptr)
           drvPtr->processTransport(MusEGlobal::segmentSize);
         }
 
-        if(!freewheel)
+        // In offline mode, only pace the cycles while idle, so that
+        //  the render runs as fast as the cpu allows.
+        if(!freewheel && !(drvPtr->offline() && MusEGlobal::audio->isPlaying()))
           usleep(MusEGlobal::segmentSize*1000000/MusEGlobal::sampleRate);
       }
       pthread_exit(0);
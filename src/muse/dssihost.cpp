@@ -1406,7 +1406,7 @@ bool DssiSynthIF::getData(MidiPort* /*mp*/, unsigned pos, int ports, unsigned nf
         {
           if(cl && plug_id != -1 && (unsigned long)cl->id() == genACnum(plug_id, k))
           {
-            cl->getInterpolation(slice_frame, no_auto || !_controls[k].enCtrl, &ci);
+            cl->getPlaybackInterpolation(slice_frame, no_auto || !_controls[k].enCtrl, &ci);
             if(icl != cll->end())
               ++icl;
           }
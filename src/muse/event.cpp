@@ -36,7 +36,7 @@
 
 namespace MusECore {
 
-EventID_t EventBase::idGen=0;
+std::atomic<EventID_t> EventBase::idGen(0);
 
 //---------------------------------------------------------
 //   Event
@@ -133,7 +133,7 @@ void EventBase::dump(int n) const
       {
       for (int i = 0; i < n; ++i)
             putchar(' ');
-      printf("Event %p refs:%d ", this, refCount);
+      printf("Event %p refs:%d ", this, getRefCount());
       PosLen::dump(n+2);
       }
 
@@ -28,6 +28,9 @@
 
 #include <map>
 #include <set>
+#include <vector>
+#include <atomic>
+#include <utility>
 #include <sys/types.h>
 #include <sndfile.h>
 
@@ -35,6 +38,7 @@
 #include "pos.h"
 #include "mpevent.h"
 #include "wave.h"
+#include "snapshot_exchange.h"
 #include "config.h"
 
 namespace MusECore {
@@ -52,6 +56,8 @@ class Fifo;
 
 class Event {
       EventBase* ev;
+      // For building snapshots.
+      friend class EventList;
 
    public:
       Event();
@@ -192,14 +198,94 @@ typedef EL::const_iterator ciEvent;
 typedef std::pair <ciEvent, ciEvent> cEventRange;
 typedef std::pair <iEvent, iEvent> EventRange;
 
+//---------------------------------------------------------
+//   FlatEvent
+//    A compact copy of an event in an EventList, for
+//     playback and drawing without chasing tree nodes.
+//---------------------------------------------------------
+
+struct FlatEvent {
+      // The event's key in the list. Ticks, or frames for wave events.
+      unsigned tick;
+      unsigned lenTick;
+      int a, b, c;
+      EventType type;
+      // The event itself, for anything else such as sysex data.
+      // Valid only while the snapshot is up to date.
+      EventBase* base;
+      };
+
+//---------------------------------------------------------
+//   EventListSnapshot
+//    A read-only copy of an EventList in a flat array,
+//     sorted like the list.
+//---------------------------------------------------------
+
+class EventListSnapshot {
+      friend class EventList;
+      template <typename T> friend class SnapshotExchange;
+
+      std::vector<FlatEvent> _items;
+      // The list's serial number when the snapshot was built.
+      unsigned int _serial;
+
+   public:
+      typedef std::vector<FlatEvent>::const_iterator const_iterator;
+
+      const_iterator begin() const { return _items.cbegin(); }
+      const_iterator end() const   { return _items.cend(); }
+      size_t size() const          { return _items.size(); }
+      bool empty() const           { return _items.empty(); }
+      // Binary searches by tick, like the list's lower_bound() and upper_bound().
+      const_iterator lower_bound(unsigned tick) const;
+      const_iterator upper_bound(unsigned tick) const;
+      };
+
 //---------------------------------------------------------
 //   EventList
 //    tick sorted list of events
+//    Besides the map, the list keeps a flat snapshot of its
+//     events for playback and drawing. All changes to the
+//     items must go through the list, so that the snapshot
+//     is known to be out of date.
 //---------------------------------------------------------
 
 class EventList : public EL {
+      // Snapshots of the events, for the audio thread.
+      mutable SnapshotExchange<EventListSnapshot> _playback;
 
    public:
+      // The map's modifiers, marking the snapshot out of date.
+      template <typename... Args> auto insert(Args&&... args) {
+            invalidateSnapshot();
+            return EL::insert(std::forward<Args>(args)...);
+            }
+      template <typename... Args> auto erase(Args&&... args) {
+            invalidateSnapshot();
+            return EL::erase(std::forward<Args>(args)...);
+            }
+      void clear() noexcept { EL::clear(); invalidateSnapshot(); }
+      void swap(EventList& other) noexcept {
+            EL::swap(other);
+            invalidateSnapshot();
+            other.invalidateSnapshot();
+            }
+
+      // Marks the snapshot as out of date. Call after changing the
+      //  values of events in the list directly.
+      void invalidateSnapshot() { _playback.invalidate(); }
+      // Changes whenever the items change. For telling whether the list changed since some earlier time.
+      unsigned int serial() const { return _playback.serial(); }
+      // GUI thread only. Builds and publishes a new snapshot if the items changed.
+      // Returns true if a new snapshot was published.
+      bool updateSnapshot() const;
+      // GUI thread only. Returns an up to date snapshot, building it if required.
+      const EventListSnapshot* flatEvents() const;
+      // Audio thread only. Returns the snapshot, or null while it is not up to date.
+      const EventListSnapshot* playbackEvents() const;
+      // Returns a flat copy of the event at an iterator.
+      static FlatEvent flatEvent(ciEvent ie);
+
       // Looks for specific event (EventBase pointer).
       ciEvent find(const Event&) const;
       iEvent find(const Event&);
@@ -0,0 +1,180 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  event_batch_bench.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//  Micro-benchmark of batched event edits.
+//  Quantizes and transposes every note of a part, once the
+//   old way with one ModifyEvent operation per note, each
+//   applied as an erase and an add, and once with an
+//   EventBatchBuilder and a single sorted merge. Times
+//   building the operations and applying them, and checks
+//   that both give the same event list.
+//  Usage: muse_event_batch_bench [notes] [repeats]
+//---------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "event.h"
+#include "eventbatch.h"
+#include "part.h"
+#include "undo.h"
+
+using namespace MusECore;
+
+static unsigned notes = 10000;
+static unsigned repeats = 5;
+
+//---------------------------------------------------------
+//   fillPart
+//---------------------------------------------------------
+
+static void fillPart(Part* part)
+      {
+      srand(1);
+      for (unsigned i = 0; i < notes; ++i) {
+            Event e(Note);
+            e.setTick(i * 24 + rand() % 12);
+            e.setLenTick(12 + rand() % 48);
+            e.setPitch(36 + rand() % 48);
+            e.setVelo(1 + rand() % 127);
+            part->nonconst_events().add(e);
+            }
+      }
+
+//---------------------------------------------------------
+//   edit
+//    Returns the new version of a note.
+//---------------------------------------------------------
+
+static Event edit(const Event& e)
+      {
+      Event n = e.clone();
+      n.setTick((e.tick() + 24) / 48 * 48);
+      n.setPitch(e.pitch() < 127 ? e.pitch() + 1 : e.pitch());
+      return n;
+      }
+
+//---------------------------------------------------------
+//   sameNotes
+//    The event bases differ per path, so compare the values.
+//---------------------------------------------------------
+
+static bool sameNotes(const EventList& a, const EventList& b)
+      {
+      if (a.size() != b.size())
+            return false;
+      for (ciEvent ia = a.cbegin(), ib = b.cbegin(); ia != a.cend(); ++ia, ++ib) {
+            if (ia->first != ib->first || ia->second.pitch() != ib->second.pitch() ||
+               ia->second.lenTick() != ib->second.lenTick() || ia->second.velo() != ib->second.velo())
+                  return false;
+            }
+      return true;
+      }
+
+static double msSince(const std::chrono::steady_clock::time_point& start)
+      {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      }
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      if (argc > 1)
+            notes = atoi(argv[1]);
+      if (argc > 2)
+            repeats = atoi(argv[2]);
+      if (notes == 0 || repeats == 0) {
+            fprintf(stderr, "usage: %s [notes] [repeats]\n", argv[0]);
+            return 1;
+            }
+
+      printf("%u notes, %u repeats\n", notes, repeats);
+      printf("%-10s %12s %12s %12s\n", "path", "build ms", "apply ms", "total ms");
+
+      double perBuild = 0.0, perApply = 0.0, batchBuild = 0.0, batchApply = 0.0;
+      int errors = 0;
+      for (unsigned r = 0; r < repeats; ++r) {
+            MidiPart perPart(nullptr);
+            MidiPart batchPart(nullptr);
+            fillPart(&perPart);
+            // Share the events, like the clones of a part do.
+            for (ciEvent ie = perPart.events().cbegin(); ie != perPart.events().cend(); ++ie)
+                  batchPart.nonconst_events().add(ie->second);
+
+            // Per event: one operation per note, merged into the group one by one,
+            //  then like the pending DeleteEvent and AddEvent operations.
+            auto start = std::chrono::steady_clock::now();
+            Undo ops;
+            for (ciEvent ie = perPart.events().cbegin(); ie != perPart.events().cend(); ++ie)
+                  ops.push_back(UndoOp(UndoOp::ModifyEvent, edit(ie->second), ie->second, &perPart, false, false));
+            perBuild += msSince(start);
+            start = std::chrono::steady_clock::now();
+            for (const UndoOp& op : ops) {
+                  iEvent ie = perPart.nonconst_events().findWithId(op.oEvent);
+                  if (ie != perPart.nonconst_events().end())
+                        perPart.nonconst_events().erase(ie);
+                  perPart.nonconst_events().add(op.nEvent);
+                  }
+            perApply += msSince(start);
+
+            // Batched: the same edits, then one merge and a constant time swap.
+            start = std::chrono::steady_clock::now();
+            EventBatchBuilder builder;
+            for (ciEvent ie = batchPart.events().cbegin(); ie != batchPart.events().cend(); ++ie)
+                  builder.modify(ie->second, edit(ie->second), &batchPart);
+            Undo batchOps;
+            builder.appendTo(batchOps);
+            batchBuild += msSince(start);
+            start = std::chrono::steady_clock::now();
+            for (const UndoOp& op : batchOps) {
+                  if (op.type != UndoOp::ModifyEventBatch)
+                        continue;
+                  EventList* el = op._eventBatch->apply(batchPart.events(), false);
+                  batchPart.nonconst_events().swap(*el);
+                  delete el;
+                  }
+            batchApply += msSince(start);
+
+            // The notes were edited in the same order, so the lists must be identical.
+            if (!sameNotes(perPart.events(), batchPart.events()))
+                  ++errors;
+
+            for (UndoOp& op : batchOps) {
+                  if (op.type == UndoOp::ModifyEventBatch)
+                        delete op._eventBatch;
+                  }
+            }
+
+      printf("%-10s %12.3f %12.3f %12.3f\n", "per event", perBuild / repeats, perApply / repeats,
+         (perBuild + perApply) / repeats);
+      printf("%-10s %12.3f %12.3f %12.3f\n", "batched", batchBuild / repeats, batchApply / repeats,
+         (batchBuild + batchApply) / repeats);
+      if (errors)
+            printf("MISMATCH in %d of %u runs\n", errors, repeats);
+      return errors ? 1 : 0;
+      }
@@ -0,0 +1,208 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  event_pool_bench.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//  Micro-benchmark of event allocation.
+//  Times an import, which fills an event list with notes,
+//   controllers and sysex events and then frees it, and a
+//   bulk edit, which quantizes every event of the list by
+//   replacing it with an edited clone. Then compares the
+//   event pool against the heap for blocks the size of a
+//   MidiEventBase, from one thread and from two threads at
+//   once, as the gui and audio threads share events.
+//  For the import and edit times without the pool, run
+//   the same program built from a tree before it.
+//  Usage: muse_event_pool_bench [events] [repeats]
+//---------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "event.h"
+#include "midievent.h"
+#include "memory.h"
+
+using namespace MusECore;
+
+static unsigned events = 500000;
+static unsigned repeats = 5;
+
+//---------------------------------------------------------
+//   fillList
+//    Mostly notes, like a big orchestral import, with
+//    some controllers and short and long sysexes.
+//---------------------------------------------------------
+
+static void fillList(EventList* el)
+      {
+      static const unsigned char shortSysex[6] = { 0x7e, 0x7f, 0x09, 0x01, 0x00, 0x00 };
+      static unsigned char longSysex[64];
+      srand(1);
+      for (unsigned i = 0; i < events; ++i) {
+            const int kind = rand() % 100;
+            if (kind < 80) {
+                  Event e(Note);
+                  e.setTick(i * 4 + rand() % 12);
+                  e.setLenTick(12 + rand() % 48);
+                  e.setPitch(36 + rand() % 48);
+                  e.setVelo(1 + rand() % 127);
+                  el->add(e);
+                  }
+            else if (kind < 98) {
+                  Event e(Controller);
+                  e.setTick(i * 4);
+                  e.setA(rand() % 120);
+                  e.setB(rand() % 128);
+                  el->add(e);
+                  }
+            else {
+                  Event e(Sysex);
+                  e.setTick(i * 4);
+                  if (kind == 98)
+                        e.setData(shortSysex, sizeof(shortSysex));
+                  else
+                        e.setData(longSysex, sizeof(longSysex));
+                  el->add(e);
+                  }
+            }
+      }
+
+//---------------------------------------------------------
+//   quantize
+//    Replaces every event by a quantized clone, like the
+//    pending DeleteEvent and AddEvent operations do.
+//---------------------------------------------------------
+
+static void quantize(EventList* el)
+      {
+      std::vector<Event> old;
+      old.reserve(el->size());
+      for (ciEvent ie = el->cbegin(); ie != el->cend(); ++ie)
+            old.push_back(ie->second);
+      for (const Event& e : old) {
+            Event n = e.clone();
+            n.setTick((e.tick() + 24) / 48 * 48);
+            iEvent ie = el->findWithId(e);
+            if (ie != el->end())
+                  el->erase(ie);
+            el->add(n);
+            }
+      }
+
+static double msSince(const std::chrono::steady_clock::time_point& start)
+      {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      }
+
+//---------------------------------------------------------
+//   Block
+//    The size of a MidiEventBase.
+//---------------------------------------------------------
+
+struct Block {
+      alignas(MidiEventBase) char mem[sizeof(MidiEventBase)];
+      };
+
+static SharedTypedMemoryPool<Block, 4096> blockPool;
+
+//---------------------------------------------------------
+//   churn
+//    Allocates and frees blocks in batches, as loading
+//    and editing do.
+//---------------------------------------------------------
+
+static void churn(bool pool, unsigned count)
+      {
+      std::vector<void*> blocks(1024);
+      for (unsigned n = 0; n < count; n += blocks.size()) {
+            for (void*& b : blocks)
+                  b = pool ? blockPool.alloc() : ::operator new(sizeof(Block));
+            for (void* b : blocks) {
+                  if (pool)
+                        blockPool.free(b);
+                  else
+                        ::operator delete(b);
+                  }
+            }
+      }
+
+static double timeChurn(bool pool, int threads)
+      {
+      const auto start = std::chrono::steady_clock::now();
+      std::vector<std::thread> t;
+      for (int i = 1; i < threads; ++i)
+            t.emplace_back(churn, pool, events);
+      churn(pool, events);
+      for (std::thread& th : t)
+            th.join();
+      return msSince(start);
+      }
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+      {
+      if (argc > 1)
+            events = atoi(argv[1]);
+      if (argc > 2)
+            repeats = atoi(argv[2]);
+      if (events == 0 || repeats == 0) {
+            fprintf(stderr, "usage: %s [events] [repeats]\n", argv[0]);
+            return 1;
+            }
+
+      printf("%u events, %u repeats\n", events, repeats);
+
+      double fill = 0.0, edit = 0.0, clear = 0.0;
+      for (unsigned r = 0; r < repeats; ++r) {
+            EventList* el = new EventList();
+            auto start = std::chrono::steady_clock::now();
+            fillList(el);
+            fill += msSince(start);
+            start = std::chrono::steady_clock::now();
+            quantize(el);
+            edit += msSince(start);
+            start = std::chrono::steady_clock::now();
+            delete el;
+            clear += msSince(start);
+            }
+      printf("%-12s %12s %12s %12s\n", "", "import ms", "edit ms", "free ms");
+      printf("%-12s %12.3f %12.3f %12.3f\n", "events", fill / repeats, edit / repeats, clear / repeats);
+
+      printf("\n%-12s %12s %12s\n", "blocks", "1 thread ms", "2 threads ms");
+      double heap1 = 0.0, heap2 = 0.0, pool1 = 0.0, pool2 = 0.0;
+      for (unsigned r = 0; r < repeats; ++r) {
+            heap1 += timeChurn(false, 1);
+            heap2 += timeChurn(false, 2);
+            pool1 += timeChurn(true, 1);
+            pool2 += timeChurn(true, 2);
+            }
+      printf("%-12s %12.3f %12.3f\n", "heap", heap1 / repeats, heap2 / repeats);
+      printf("%-12s %12.3f %12.3f\n", "pool", pool1 / repeats, pool2 / repeats);
+      return 0;
+      }
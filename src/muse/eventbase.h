@@ -27,6 +27,8 @@
 #include <sys/types.h>
 #include <sndfile.h>
 
+#include <atomic>
+
 #include "type_defs.h"
 #include "pos.h"
 #include "evdata.h"
@@ -48,14 +50,15 @@ class Fifo;
 
 class EventBase : public PosLen {
       EventType _type;
-      static EventID_t idGen;
+      static std::atomic<EventID_t> idGen;
       // An always unique id.
       EventID_t _uniqueId; 
       // Can be either _uniqueId or the same _uniqueId as other clone 'group' events. De-cloning restores it to _uniqueId.
       EventID_t _id;       
 
    protected:
-      int refCount;
+      // Events are shared between threads, for example through operation groups.
+      std::atomic<int> refCount;
       bool _selected;
 
    public:
@@ -65,7 +68,7 @@ class EventBase : public PosLen {
 
       virtual ~EventBase() { }
 
-      int getRefCount() const    { return refCount; }
+      int getRefCount() const    { return refCount.load(std::memory_order_relaxed); }
 
       EventID_t id() const       { return _id; }
       EventID_t newId()          { return idGen++; }
@@ -0,0 +1,217 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  eventbatch.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "eventbatch.h"
+#include "part.h"
+#include "undo.h"
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   hasDeletions
+//---------------------------------------------------------
+
+bool EventBatch::hasDeletions() const
+{
+  for(const Change& c : _changes)
+  {
+    if(c.newEvent.empty())
+      return true;
+  }
+  return false;
+}
+
+//---------------------------------------------------------
+//   apply
+//---------------------------------------------------------
+
+EventList* EventBatch::apply(const EventList& src, bool revert) const
+{
+  std::unordered_set<EventID_t> removed;
+  std::unordered_set<EventID_t> addedIds;
+  std::vector<Event> added;
+  removed.reserve(_changes.size());
+  addedIds.reserve(_changes.size());
+  added.reserve(_changes.size());
+  for(const Change& c : _changes)
+  {
+    const Event& from = revert ? c.newEvent : c.oldEvent;
+    const Event& to   = revert ? c.oldEvent : c.newEvent;
+    if(!from.empty())
+      removed.insert(from.id());
+    if(!to.empty())
+    {
+      added.push_back(to);
+      addedIds.insert(to.id());
+    }
+  }
+
+  // Like Song::changeEventOperation(), do not add an event which is already in the list.
+  if(!addedIds.empty())
+  {
+    std::unordered_set<EventID_t> present;
+    for(ciEvent ie = src.cbegin(); ie != src.cend(); ++ie)
+    {
+      const EventID_t id = ie->second.id();
+      if(addedIds.find(id) != addedIds.end() && removed.find(id) == removed.end())
+        present.insert(id);
+    }
+    if(!present.empty())
+      added.erase(std::remove_if(added.begin(), added.end(),
+        [&present](const Event& e) { return present.find(e.id()) != present.end(); }), added.end());
+  }
+
+  // EventList::add() puts other events before the notes at the same tick, each after the existing ones.
+  std::stable_sort(added.begin(), added.end(), [](const Event& a, const Event& b) {
+    if(a.tick() != b.tick())
+      return a.tick() < b.tick();
+    return a.type() != Note && b.type() == Note;
+    });
+
+  EventList* el = new EventList();
+  std::vector<Event>::const_iterator ia = added.cbegin();
+  for(ciEvent ie = src.cbegin(); ie != src.cend(); ++ie)
+  {
+    const unsigned tick = ie->first;
+    const bool isNote = ie->second.type() == Note;
+    // Added events go before the first existing event which sorts after them.
+    for( ; ia != added.cend(); ++ia)
+    {
+      const unsigned atick = ia->tick();
+      if(atick > tick || (atick == tick && (ia->type() == Note || !isNote)))
+        break;
+      el->insert(el->end(), std::pair<const unsigned, Event> (atick, *ia));
+    }
+    if(removed.find(ie->second.id()) == removed.end())
+      el->insert(el->end(), *ie);
+  }
+  for( ; ia != added.cend(); ++ia)
+    el->insert(el->end(), std::pair<const unsigned, Event> (ia->tick(), *ia));
+  return el;
+}
+
+//---------------------------------------------------------
+//   EventBatchBuilder
+//---------------------------------------------------------
+
+EventBatchBuilder::~EventBatchBuilder()
+{
+  for(Entry& e : _entries)
+    delete e.batch;
+}
+
+EventBatchBuilder::Entry& EventBatchBuilder::entry(const Part* part)
+{
+  std::map<const Part*, size_t>::const_iterator ip = _partEntries.find(part);
+  if(ip != _partEntries.cend())
+    return _entries[ip->second];
+
+  // The clones of a part share its events. Look for an entry of one of them.
+  for(const Part* p = part->nextClone(); p != part; p = p->nextClone())
+  {
+    ip = _partEntries.find(p);
+    if(ip != _partEntries.cend())
+    {
+      _partEntries.insert(std::make_pair(part, ip->second));
+      return _entries[ip->second];
+    }
+  }
+
+  _partEntries.insert(std::make_pair(part, _entries.size()));
+  _entries.push_back(Entry{part, new EventBatch(), std::unordered_map<EventID_t, size_t>()});
+  return _entries.back();
+}
+
+void EventBatchBuilder::change(const Event& oldEvent, const Event& newEvent, const Part* part)
+{
+  Entry& en = entry(part);
+  std::unordered_map<EventID_t, size_t>::const_iterator ic = en.index.find(oldEvent.id());
+  if(ic != en.index.cend())
+  {
+    // Merge with the earlier change of the event, like Undo::insert() does.
+    EventBatch::Change& c = en.batch->_changes[ic->second];
+    // A change of an event which was already deleted is ignored.
+    if(c.newEvent.empty())
+      return;
+    c.newEvent = newEvent;
+    if(!newEvent.empty())
+      en.index.insert(std::make_pair(newEvent.id(), ic->second));
+    return;
+  }
+
+  en.index.insert(std::make_pair(oldEvent.id(), en.batch->size()));
+  if(!newEvent.empty())
+    en.index.insert(std::make_pair(newEvent.id(), en.batch->size()));
+  en.batch->append(oldEvent, newEvent);
+  ++_count;
+}
+
+void EventBatchBuilder::modify(const Event& oldEvent, const Event& newEvent, const Part* part)
+{
+  // Equivalent to deleting then adding the same event - useless, cancels out.
+  if(oldEvent == newEvent)
+    return;
+  change(oldEvent, newEvent, part);
+}
+
+void EventBatchBuilder::remove(const Event& event, const Part* part)
+{
+  change(event, Event(), part);
+}
+
+//---------------------------------------------------------
+//   appendTo
+//---------------------------------------------------------
+
+void EventBatchBuilder::appendTo(Undo& operations, bool doCtrls, bool doClones)
+{
+  for(Entry& en : _entries)
+  {
+    if(_count >= MinBatchSize && en.part->partType() == Part::MidiPartType)
+    {
+      // The operation takes the batch.
+      operations.push_back(UndoOp(UndoOp::ModifyEventBatch, en.batch, en.part, doCtrls, doClones));
+      en.batch = nullptr;
+      continue;
+    }
+
+    for(const EventBatch::Change& c : en.batch->changes())
+    {
+      if(c.newEvent.empty())
+        operations.push_back(UndoOp(UndoOp::DeleteEvent, c.oldEvent, en.part, doCtrls, doClones));
+      else
+        operations.push_back(UndoOp(UndoOp::ModifyEvent, c.newEvent, c.oldEvent, en.part, doCtrls, doClones));
+    }
+    delete en.batch;
+    en.batch = nullptr;
+  }
+
+  _entries.clear();
+  _partEntries.clear();
+  _count = 0;
+}
+
+} // namespace MusECore
@@ -0,0 +1,120 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  eventbatch.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __EVENTBATCH_H__
+#define __EVENTBATCH_H__
+
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <unordered_map>
+
+#include "event.h"
+
+namespace MusECore {
+
+class Part;
+class Undo;
+
+//---------------------------------------------------------
+//   EventBatch
+//    Modifications and deletions of many events of a midi
+//     part, applied as a whole. The event lists of the part
+//     and its clones are rebuilt in one sorted merge and
+//     swapped in at once, instead of each event being erased
+//     and added again one by one.
+//---------------------------------------------------------
+
+class EventBatch {
+      friend class EventBatchBuilder;
+
+   public:
+      struct Change {
+            // The event in the list before the change.
+            Event oldEvent;
+            // The event replacing it, or empty if it is deleted.
+            Event newEvent;
+            };
+
+   private:
+      std::vector<Change> _changes;
+
+   public:
+      void append(const Event& oldEvent, const Event& newEvent) { _changes.push_back(Change{oldEvent, newEvent}); }
+      const std::vector<Change>& changes() const { return _changes; }
+      size_t size() const { return _changes.size(); }
+      bool empty() const { return _changes.empty(); }
+      bool hasDeletions() const;
+
+      // Returns a new list holding the events of src with the changes applied,
+      //  or with revert, undone. The caller owns it. For midi event lists only.
+      // Events are placed like EventList::add() places them.
+      EventList* apply(const EventList& src, bool revert) const;
+      };
+
+//---------------------------------------------------------
+//   EventBatchBuilder
+//    Collects event modifications and deletions in any
+//     number of parts, then appends them to an operation
+//     group: one ModifyEventBatch operation for each part
+//     and its clones, or for small edits the usual
+//     ModifyEvent and DeleteEvent operations.
+//    Changes to the same event merge like they do in Undo.
+//---------------------------------------------------------
+
+class EventBatchBuilder {
+      struct Entry {
+            const Part* part;
+            EventBatch* batch;
+            // Index of the change of each event id in the batch.
+            std::unordered_map<EventID_t, size_t> index;
+            };
+
+      std::vector<Entry> _entries;
+      // The entry of each part, and of each clone of it.
+      std::map<const Part*, size_t> _partEntries;
+      size_t _count;
+
+      Entry& entry(const Part* part);
+      void change(const Event& oldEvent, const Event& newEvent, const Part* part);
+
+   public:
+      // With fewer changes than this in all, plain event operations are used.
+      static const size_t MinBatchSize = 32;
+
+      EventBatchBuilder() : _count(0) { }
+      ~EventBatchBuilder();
+
+      void modify(const Event& oldEvent, const Event& newEvent, const Part* part);
+      void remove(const Event& event, const Part* part);
+      size_t size() const { return _count; }
+      bool empty() const { return _count == 0; }
+      // Appends the changes to the operations, and empties the builder.
+      // A ModifyEventBatch operation must be the only one changing the events
+      //  of its parts in its group, so call this last for these parts.
+      void appendTo(Undo& operations, bool doCtrls = false, bool doClones = false);
+      };
+
+} // namespace MusECore
+
+#endif
@@ -21,12 +21,82 @@
 //
 //=========================================================
 
+#include <algorithm>
+
 #include "tempo.h"
 #include "event.h"
 #include "xml.h"
 
 namespace MusECore {
 
+//---------------------------------------------------------
+//   EventListSnapshot
+//---------------------------------------------------------
+
+EventListSnapshot::const_iterator EventListSnapshot::lower_bound(unsigned tick) const
+{
+  const EL::key_compare less;
+  return std::lower_bound(_items.cbegin(), _items.cend(), tick,
+    [&less](const FlatEvent& e, unsigned t) { return less(e.tick, t); });
+}
+
+EventListSnapshot::const_iterator EventListSnapshot::upper_bound(unsigned tick) const
+{
+  const EL::key_compare less;
+  return std::upper_bound(_items.cbegin(), _items.cend(), tick,
+    [&less](unsigned t, const FlatEvent& e) { return less(t, e.tick); });
+}
+
+//---------------------------------------------------------
+//   flatEvent
+//---------------------------------------------------------
+
+FlatEvent EventList::flatEvent(ciEvent ie)
+{
+  const Event& e = ie->second;
+  return FlatEvent { ie->first, e.lenValue(), e.dataA(), e.dataB(), e.dataC(), e.type(), e.ev };
+}
+
+//---------------------------------------------------------
+//   updateSnapshot
+//   GUI thread only.
+//---------------------------------------------------------
+
+bool EventList::updateSnapshot() const
+{
+  unsigned int serial;
+  if(!_playback.needsUpdate(&serial))
+    return false;
+
+  EventListSnapshot* s = new EventListSnapshot();
+  s->_items.reserve(size());
+  for(ciEvent ie = cbegin(); ie != cend(); ++ie)
+    s->_items.push_back(flatEvent(ie));
+  _playback.publish(s, serial);
+  return true;
+}
+
+//---------------------------------------------------------
+//   flatEvents
+//   GUI thread only.
+//---------------------------------------------------------
+
+const EventListSnapshot* EventList::flatEvents() const
+{
+  updateSnapshot();
+  return _playback.published();
+}
+
+//---------------------------------------------------------
+//   playbackEvents
+//   Audio thread only.
+//---------------------------------------------------------
+
+const EventListSnapshot* EventList::playbackEvents() const
+{
+  return _playback.take();
+}
+
 //---------------------------------------------------------
 //   readEventList
 //---------------------------------------------------------
@@ -27,6 +27,7 @@
 #include "utils.h"
 
 #include "event.h"
+#include "eventbatch.h"
 #include "audio.h"
 #include "gconfig.h"
 #include "sig.h"
@@ -350,6 +351,7 @@ bool modify_velocity(const set<const Part*>& parts, int range, int rate, int off
 {
 	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	EventBatchBuilder batch;
 	
 	if ( (!events.empty()) && ((rate!=100) || (offset!=0)) )
 	{
@@ -376,10 +378,11 @@ bool modify_velocity(const set<const Part*>& parts, int range, int rate, int off
 			{
 				Event newEvent = event.clone();
 				newEvent.setVelo(velo);
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
+				batch.modify(event, newEvent, part);
 			}
 		}
 		
+		batch.appendTo(operations);
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -390,6 +393,7 @@ bool modify_off_velocity(const set<const Part*>& parts, int range, int rate, int
 {
 	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	EventBatchBuilder batch;
 	
 	if ( (!events.empty()) && ((rate!=100) || (offset!=0)) )
 	{
@@ -415,10 +419,11 @@ bool modify_off_velocity(const set<const Part*>& parts, int range, int rate, int
 			{
 				Event newEvent = event.clone();
 				newEvent.setVeloOff(velo);
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
+				batch.modify(event, newEvent, part);
 			}
 		}
 
+		batch.appendTo(operations);
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -429,6 +434,7 @@ bool modify_notelen(const set<const Part*>& parts, int range, int rate, int offs
 {
 	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	EventBatchBuilder batch;
 	map<const Part*, int> partlen;
 	
 	if ( (!events.empty()) && ((rate!=100) || (offset!=0)) )
@@ -456,13 +462,14 @@ bool modify_notelen(const set<const Part*>& parts, int range, int rate, int offs
 			{
 				Event newEvent = event.clone();
 				newEvent.setLenTick(len);
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
+				batch.modify(event, newEvent, part);
 			}
 		}
 		
 		for (map<const Part*, int>::iterator it=partlen.begin(); it!=partlen.end(); it++)
 			schedule_resize_all_same_len_clone_parts(it->first, it->second, operations);
 
+		batch.appendTo(operations);
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -500,6 +507,7 @@ bool quantize_notes(const set<const Part*>& parts, int range, int raster, bool q
 {
 	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	EventBatchBuilder batch;
 	
 	if (!events.empty())
 	{
@@ -535,10 +543,11 @@ bool quantize_notes(const set<const Part*>& parts, int range, int raster, bool q
 				Event newEvent = event.clone();
 				newEvent.setTick(begin_tick - part->tick());
 				newEvent.setLenTick(len);
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
+				batch.modify(event, newEvent, part);
 			}
 		}
 		
+		batch.appendTo(operations);
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -549,6 +558,7 @@ bool erase_notes(const set<const Part*>& parts, int range, int velo_threshold, b
 {
 	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	EventBatchBuilder batch;
 	
 	if (!events.empty())
 	{
@@ -561,9 +571,10 @@ bool erase_notes(const set<const Part*>& parts, int range, int velo_threshold, b
 			if ( (!velo_thres_used && !len_thres_used) ||
 			     (velo_thres_used && event.velo() < velo_threshold) ||
 			     (len_thres_used && int(event.lenTick()) < len_threshold) )
-				operations.push_back(UndoOp(UndoOp::DeleteEvent, event, part, false, false));
+				batch.remove(event, part);
 		}
 		
+		batch.appendTo(operations);
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -574,6 +585,7 @@ bool transpose_notes(const set<const Part*>& parts, int range, signed int halfto
 {
 	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	EventBatchBuilder batch;
 	
 	if ( (!events.empty()) && (halftonesteps!=0) )
 	{
@@ -590,9 +602,10 @@ bool transpose_notes(const set<const Part*>& parts, int range, signed int halfto
 			if (pitch > 127) pitch=127;
 			if (pitch < 0) pitch=0;
 			newEvent.setPitch(pitch);
-			operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
+			batch.modify(event, newEvent, part);
 		}
 		
+		batch.appendTo(operations);
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -603,6 +616,7 @@ bool crescendo(const set<const Part*>& parts, int range, int start_val, int end_
 {
 	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	EventBatchBuilder batch;
 	
 	int from=MusEGlobal::song->lpos();
 	int to=MusEGlobal::song->rpos();
@@ -631,9 +645,10 @@ bool crescendo(const set<const Part*>& parts, int range, int start_val, int end_
 			if (velo > 127) velo=127;
 			if (velo <= 0) velo=1;
 			newEvent.setVelo(velo);
-			operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
+			batch.modify(event, newEvent, part);
 		}
 		
+		batch.appendTo(operations);
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -644,6 +659,7 @@ bool move_notes(const set<const Part*>& parts, int range, signed int ticks)
 {
 	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	EventBatchBuilder batch;
 	map<const Part*, int> partlen;
 	
 	if ( (!events.empty()) && (ticks!=0) )
@@ -678,14 +694,15 @@ bool move_notes(const set<const Part*>& parts, int range, signed int ticks)
 			}
 			
 			if (del==false)
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, event, part, false, false));
+				batch.modify(event, newEvent, part);
 			else
-				operations.push_back(UndoOp(UndoOp::DeleteEvent, event, part, false, false));
+				batch.remove(event, part);
 		}
 		
 		for (map<const Part*, int>::iterator it=partlen.begin(); it!=partlen.end(); it++)
 			schedule_resize_all_same_len_clone_parts(it->first, it->second, operations);
 		
+		batch.appendTo(operations);
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -696,6 +713,7 @@ bool delete_overlaps(const set<const Part*>& parts, int range)
 {
 	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	EventBatchBuilder batch;
 	
 	set<const Event*> deleted_events;
 	
@@ -732,7 +750,7 @@ bool delete_overlaps(const set<const Part*>& parts, int range)
 
 						if (new_len==0)
 						{
-							operations.push_back(UndoOp(UndoOp::DeleteEvent, event2, part2, false, false));
+							batch.remove(event2, part2);
 							deleted_events.insert(&event2);
 						}
 						else
@@ -740,13 +758,14 @@ bool delete_overlaps(const set<const Part*>& parts, int range)
 							Event new_event1 = event1.clone();
 							new_event1.setLenTick(new_len);
 							
-							operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event1, event1, part1, false, false));
+							batch.modify(event1, new_event1, part1);
 						}
 					}
 				}
 			}
 		}
 		
+		batch.appendTo(operations);
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -757,6 +776,7 @@ bool legato(const set<const Part*>& parts, int range, int min_len, bool dont_sho
 {
 	map<const Event*, const Part*> events = get_events(parts, range);
 	Undo operations;
+	EventBatchBuilder batch;
 	
 	if (min_len<=0) min_len=1;
 	
@@ -799,10 +819,11 @@ bool legato(const set<const Part*>& parts, int range, int min_len, bool dont_sho
 				Event new_event1 = event1.clone();
 				new_event1.setLenTick(len);
 				
-				operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event1, event1, part1, false, false));
+				batch.modify(event1, new_event1, part1);
 			}
 		}
 		
+		batch.appendTo(operations);
 		return MusEGlobal::song->applyOperationGroup(operations);
 	}
 	else
@@ -1965,6 +1986,7 @@ void PasteEraseCtlMap::tidy()
 bool erase_items(TagEventList* tag_list, int velo_threshold, bool velo_thres_used, int len_threshold, bool len_thres_used)
 {
   Undo operations;
+  EventBatchBuilder batch;
   
   const Part* part;
     
@@ -1982,11 +2004,12 @@ bool erase_items(TagEventList* tag_list, int velo_threshold, bool velo_thres_use
               (velo_thres_used && e.velo() < velo_threshold) ||
             (len_thres_used && int(e.lenTick()) < len_threshold) )
       {
-        operations.push_back(UndoOp(UndoOp::DeleteEvent, e, part, true, true));
+        batch.remove(e, part);
       }
     }
   }
   
+  batch.appendTo(operations, true, true);
   return MusEGlobal::song->applyOperationGroup(operations);
 }
 
@@ -1998,6 +2021,7 @@ bool crescendo_items(TagEventList* tag_list, int start_val, int end_val, bool ab
     return false;
   
   Undo operations;
+  EventBatchBuilder batch;
   Pos pos;
   float curr_val;
   unsigned int pos_val = (to - from).posValue();
@@ -2030,16 +2054,18 @@ bool crescendo_items(TagEventList* tag_list, int start_val, int end_val, bool ab
       if (velo <= 0) velo=1;
       newEvent.setVelo(velo);
       
-      operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, e, part, false, false));
+      batch.modify(e, newEvent, part);
     }
   }
   
+  batch.appendTo(operations);
   return MusEGlobal::song->applyOperationGroup(operations);
 }
 
 bool delete_overlaps_items(TagEventList* tag_list)
 {
   Undo operations;
+  EventBatchBuilder batch;
   
   set<const Event*> deleted_events;
   int new_len;
@@ -2083,7 +2109,7 @@ bool delete_overlaps_items(TagEventList* tag_list)
 
           if(new_len==0)
           {
-            operations.push_back(UndoOp(UndoOp::DeleteEvent, e2, part, false, false));
+            batch.remove(e2, part);
             deleted_events.insert(&e2);
           }
           else
@@ -2091,7 +2117,7 @@ bool delete_overlaps_items(TagEventList* tag_list)
             new_event1 = e.clone();
             new_event1.setLenTick(new_len);
             
-            operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event1, e, part, false, false));
+            batch.modify(e, new_event1, part);
             
             // After resizing the event, it should not be necessary to continue with any further
             //  events in this loop since any more sorted events will come at or AFTER e2's position
@@ -2103,6 +2129,7 @@ bool delete_overlaps_items(TagEventList* tag_list)
     }
   }
   
+  batch.appendTo(operations);
   return MusEGlobal::song->applyOperationGroup(operations);
 }
 
@@ -2112,6 +2139,7 @@ bool modify_notelen_items(TagEventList* tag_list, int rate, int offset)
     return false;
     
   Undo operations;
+  EventBatchBuilder batch;
   
   unsigned int len;
   map<const Part*, int> partlen;
@@ -2145,7 +2173,7 @@ bool modify_notelen_items(TagEventList* tag_list, int rate, int offset)
       {
         newEvent = e.clone();
         newEvent.setLenTick(len);
-        operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, e, part, false, false));
+        batch.modify(e, newEvent, part);
       }
     }
     
@@ -2153,12 +2181,14 @@ bool modify_notelen_items(TagEventList* tag_list, int rate, int offset)
       schedule_resize_all_same_len_clone_parts(it->first, it->second, operations);
   }
   
+  batch.appendTo(operations);
   return MusEGlobal::song->applyOperationGroup(operations);
 }
 
 bool legato_items(TagEventList* tag_list, int min_len, bool dont_shorten)
 {
   Undo operations;
+  EventBatchBuilder batch;
   
   if (min_len<=0) min_len=1;
   
@@ -2204,11 +2234,12 @@ bool legato_items(TagEventList* tag_list, int min_len, bool dont_shorten)
         new_event1 = e.clone();
         new_event1.setLenTick(len);
         
-        operations.push_back(UndoOp(UndoOp::ModifyEvent, new_event1, e, part, false, false));
+        batch.modify(e, new_event1, part);
       }
     }
   }
   
+  batch.appendTo(operations);
   return MusEGlobal::song->applyOperationGroup(operations);
 }
 
@@ -2218,6 +2249,7 @@ bool move_items(TagEventList* tag_list, signed int ticks)
     return false;
   
   Undo operations;
+  EventBatchBuilder batch;
   map<const Part*, int> partlen;
   
   bool del;
@@ -2258,15 +2290,16 @@ bool move_items(TagEventList* tag_list, signed int ticks)
       }
       
       if (del == false)
-        operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, e, part, false, false));
+        batch.modify(e, newEvent, part);
       else
-        operations.push_back(UndoOp(UndoOp::DeleteEvent, e, part, false, false));
+        batch.remove(e, part);
     }
     
     for (map<const Part*, int>::iterator it=partlen.begin(); it!=partlen.end(); it++)
       schedule_resize_all_same_len_clone_parts(it->first, it->second, operations);
   }
   
+  batch.appendTo(operations);
   return MusEGlobal::song->applyOperationGroup(operations);
 }
 
@@ -2279,6 +2312,7 @@ bool quantize_items(TagEventList* tag_list, int raster_idx, bool quant_len, int
   const int raster = (MusEGlobal::config.division*4) / rv;
   
   Undo operations;
+  EventBatchBuilder batch;
   
   unsigned begin_tick;
   int begin_diff;
@@ -2323,11 +2357,12 @@ bool quantize_items(TagEventList* tag_list, int raster_idx, bool quant_len, int
         newEvent = e.clone();
         newEvent.setTick(begin_tick - part->tick());
         newEvent.setLenTick(len);
-        operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, e, part, false, false));
+        batch.modify(e, newEvent, part);
       }
     }
   }
   
+  batch.appendTo(operations);
   return MusEGlobal::song->applyOperationGroup(operations);
 }
 
@@ -2342,6 +2377,7 @@ bool transpose_items(TagEventList* tag_list, signed int halftonesteps)
     return false;
   
   Undo operations;
+  EventBatchBuilder batch;
   
   Event newEvent;
   int pitch;
@@ -2364,10 +2400,11 @@ bool transpose_items(TagEventList* tag_list, signed int halftonesteps)
       if (pitch > 127) pitch = 127;
       if (pitch < 0) pitch = 0;
       newEvent.setPitch(pitch);
-      operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, e, part, false, false));
+      batch.modify(e, newEvent, part);
     }
   }
   
+  batch.appendTo(operations);
   return MusEGlobal::song->applyOperationGroup(operations);
 }
 
@@ -2377,6 +2414,7 @@ bool modify_velocity_items(TagEventList* tag_list, int rate, int offset)
     return false;
   
   Undo operations;
+  EventBatchBuilder batch;
   int velo;
   Event newEvent;
   const Part* part;
@@ -2407,11 +2445,12 @@ bool modify_velocity_items(TagEventList* tag_list, int rate, int offset)
       {
         newEvent = e.clone();
         newEvent.setVelo(velo);
-        operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, e, part, false, false));
+        batch.modify(e, newEvent, part);
       }
     }
   }
   
+  batch.appendTo(operations);
   return MusEGlobal::song->applyOperationGroup(operations);
 }
 
@@ -2421,6 +2460,7 @@ bool modify_off_velocity_items(TagEventList* tag_list, int rate, int offset)
     return false;
   
   Undo operations;
+  EventBatchBuilder batch;
   int velo;
   Event newEvent;
   const Part* part;
@@ -2451,11 +2491,12 @@ bool modify_off_velocity_items(TagEventList* tag_list, int rate, int offset)
       {
         newEvent = e.clone();
         newEvent.setVeloOff(velo);
-        operations.push_back(UndoOp(UndoOp::ModifyEvent, newEvent, e, part, false, false));
+        batch.modify(e, newEvent, part);
       }
     }
   }
   
+  batch.appendTo(operations);
   return MusEGlobal::song->applyOperationGroup(operations);
 }
 
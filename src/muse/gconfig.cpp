@@ -405,7 +405,14 @@ GlobalConfigValues config = {
       true,                         // audioAutomationDrawDiscrete
       true,                         // audioAutomationShowBoxes
       true,                         // audioAutomationOptimize
-      2                             // audioAutomationPointRadius
+      2,                            // audioAutomationPointRadius
+      false,                        // parallelAudioGraph
+      0,                            // audioGraphThreads
+      0,                            // prefetchThreads
+      0,                            // peakBuildThreads
+      0,                            // pluginScanThreads
+      10,                           // recordBufferSeconds
+      512                           // undoMemoryLimit
 };
 
 } // namespace MusEGlobal
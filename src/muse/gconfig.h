@@ -447,6 +447,27 @@ struct GlobalConfigValues {
       bool audioAutomationShowBoxes;
       bool audioAutomationOptimize;
       int audioAutomationPointRadius;
+
+      // Whether to process independent audio tracks concurrently on worker threads.
+      bool parallelAudioGraph;
+      // Number of audio graph worker threads. Zero means automatic (one less than the number of cores).
+      int audioGraphThreads;
+      // Number of threads filling the wave track prefetch fifos, including
+      //  the prefetch thread itself. 0 = automatic. 1 = no extra threads.
+      int prefetchThreads;
+      // Number of threads building missing waveform peak files in the background.
+      // 0 = automatic. -1 = build them in the foreground while loading.
+      int peakBuildThreads;
+      // Number of plugin scan processes run at the same time when
+      //  creating the plugin cache. 0 = automatic. 1 = one at a time.
+      int pluginScanThreads;
+      // Seconds of recorded audio each recording track can buffer while its
+      //  file is written by the record writer thread. 0 = no record writer thread,
+      //  the prefetch thread writes the files directly.
+      int recordBufferSeconds;
+      // Megabytes of memory the undo history may hold. Beyond it, the oldest
+      //  undo steps are forgotten. 0 = no limit.
+      int undoMemoryLimit;
       };
 
 
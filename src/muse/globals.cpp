@@ -180,11 +180,12 @@ const char* midi_file_save_pattern[] = {
       };
 
 const char* med_file_pattern[] = {
-      QT_TRANSLATE_NOOP("file_patterns", "all known files (*.med *.med.gz *.med.bz2 *.mid *.midi *.kar)"),
-      QT_TRANSLATE_NOOP("file_patterns", "med Files (*.med *.med.gz *.med.bz2)"),
+      QT_TRANSLATE_NOOP("file_patterns", "all known files (*.med *.med.gz *.med.bz2 *.medb *.mid *.midi *.kar)"),
+      QT_TRANSLATE_NOOP("file_patterns", "med Files (*.med *.med.gz *.med.bz2 *.medb)"),
       QT_TRANSLATE_NOOP("file_patterns", "Uncompressed med Files (*.med)"),
       QT_TRANSLATE_NOOP("file_patterns", "gzip compressed med Files (*.med.gz)"),
       QT_TRANSLATE_NOOP("file_patterns", "bzip2 compressed med Files (*.med.bz2)"),
+      QT_TRANSLATE_NOOP("file_patterns", "Binary med Files (*.medb)"),
       QT_TRANSLATE_NOOP("file_patterns", "mid Files (*.mid *.midi *.kar *.MID *.MIDI *.KAR)"),
       QT_TRANSLATE_NOOP("file_patterns", "All Files (*)"),
     nullptr
@@ -193,6 +194,7 @@ const char* med_file_save_pattern[] = {
       QT_TRANSLATE_NOOP("file_patterns", "Uncompressed med Files (*.med)"),
       QT_TRANSLATE_NOOP("file_patterns", "gzip compressed med Files (*.med.gz)"),
       QT_TRANSLATE_NOOP("file_patterns", "bzip2 compressed med Files (*.med.bz2)"),
+      QT_TRANSLATE_NOOP("file_patterns", "Binary med Files (*.medb)"),
       QT_TRANSLATE_NOOP("file_patterns", "All Files (*)"),
     nullptr
       };
@@ -200,6 +202,7 @@ const char* project_create_file_save_pattern[] = {
       QT_TRANSLATE_NOOP("file_patterns", "Uncompressed med Files (*.med)"),
       QT_TRANSLATE_NOOP("file_patterns", "gzip compressed med Files (*.med.gz)"),
       QT_TRANSLATE_NOOP("file_patterns", "bzip2 compressed med Files (*.med.bz2)"),
+      QT_TRANSLATE_NOOP("file_patterns", "Binary med Files (*.medb)"),
     nullptr
       };
 
@@ -5391,7 +5391,7 @@ bool LV2SynthIF::getData(MidiPort *, unsigned int pos, int ports, unsigned int n
                 {
                     if(cl && plug_id != -1 && (unsigned long)cl->id() == genACnum(plug_id, k))
                     {
-                        cl->getInterpolation(slice_frame, no_auto || !_controls[k].enCtrl, &ci);
+                        cl->getPlaybackInterpolation(slice_frame, no_auto || !_controls[k].enCtrl, &ci);
                         if(icl != cll->end())
                             ++icl;
                     }
@@ -83,6 +83,8 @@
 //#include "audio_convert/audio_converter_plugin.h"
 #include "audio_convert/audio_converter_settings_group.h"
 #include "wave.h"
+#include "peak_builder.h"
+#include "record_writer.h"
 #include "conf.h"
 
 #ifdef HAVE_LASH
@@ -103,7 +105,7 @@
 #endif
 
 namespace MusECore {
-extern bool initDummyAudio();
+extern bool initDummyAudio(bool offline = false);
 #ifdef HAVE_RTAUDIO
 extern bool initRtAudio(bool forceDefault = false);
 #endif
@@ -125,6 +127,7 @@ extern void deinitLV2();
 //extern void exitMidiSequencer();
 extern void initAudio();
 extern void initAudioPrefetch();   
+extern void initAudioGraphExecutor();
 extern void initMidiSynth();
 
 #ifdef ALSA_SUPPORT
@@ -312,7 +315,9 @@ enum CommandLineParseResult
 
 CommandLineParseResult parseCommandLine(
   QCommandLineParser &parser, QString *errorMessage,
-  QString& open_filename, AudioDriverSelect& audioType, bool& force_plugin_rescan, bool& dont_plugin_rescan)
+  QString& open_filename, AudioDriverSelect& audioType, bool& force_plugin_rescan, bool& dont_plugin_rescan,
+  QString& build_peaks_dir, int& build_peaks_threads,
+  QString& render_filename, QString& render_output, QString& render_range)
 {
   parser.setApplicationDescription(APP_DESCRIPTION);
   const QString version_string(VERSION);
@@ -389,6 +394,22 @@ CommandLineParseResult parseCommandLine(
   QCommandLineOption option_u("u", QCoreApplication::translate("main",
     "Ubuntu/unity workaround: don't allow sharing menus and mdi-subwins."));
   parser.addOption(option_u);
+  QCommandLineOption option_build_peaks("build-peaks", QCoreApplication::translate("main",
+    "Build missing waveform peak files for all sound files in a project directory, then quit"), "directory");
+  parser.addOption(option_build_peaks);
+  QCommandLineOption option_build_peaks_threads("build-peaks-threads", QCoreApplication::translate("main",
+    "Number of threads used by --build-peaks (default: automatic)"), "threads");
+  parser.addOption(option_build_peaks_threads);
+  QCommandLineOption option_render("render", QCoreApplication::translate("main",
+    "Render a project's audio output to a wave file without the GUI, as fast as possible, then quit"), "project");
+  parser.addOption(option_render);
+  QCommandLineOption option_o(QStringList() << "o" << "output", QCoreApplication::translate("main",
+    "Wave file written by --render"), "file");
+  parser.addOption(option_o);
+  QCommandLineOption option_range("range", QCoreApplication::translate("main",
+    "Range rendered by --render: L-R for the left and right locators (default),\n"
+    "or start-end in seconds, an empty end meaning the end of the song"), "range");
+  parser.addOption(option_range);
   QCommandLineOption option_d("d", QCoreApplication::translate("main", "Debug mode: no threads, no RT"));
   parser.addOption(option_d);
   QCommandLineOption option_D("D", QCoreApplication::translate("main",
@@ -509,6 +530,25 @@ CommandLineParseResult parseCommandLine(
   if(parser.isSet(option_C))
     dont_plugin_rescan = true;
 
+  if(parser.isSet(option_build_peaks))
+    build_peaks_dir = parser.value(option_build_peaks);
+
+  if(parser.isSet(option_build_peaks_threads))
+    build_peaks_threads = parser.value(option_build_peaks_threads).toInt();
+
+  if(parser.isSet(option_render))
+  {
+    render_filename = parser.value(option_render);
+    if(!parser.isSet(option_o))
+    {
+      *errorMessage = "Error: --render requires an output file (-o)";
+      return CommandLineError;
+    }
+    render_output = parser.value(option_o);
+    if(parser.isSet(option_range))
+      render_range = parser.value(option_range);
+  }
+
   if(parser.isSet(option_S))
     MusEGlobal::loadMESS = false;
 
@@ -1048,12 +1088,19 @@ int main(int argc, char* argv[])
         AudioDriverSelect audioType = DriverConfigSetting;
         bool force_plugin_rescan = false;
         bool dont_plugin_rescan = false;
+        QString build_peaks_dir;
+        int build_peaks_threads = 0;
+        QString render_filename;
+        QString render_output;
+        QString render_range;
         // A block because we don't want ths hanging around. Use it then lose it.
         {
           QCommandLineParser parser;
           QString errorMessage;
           switch (parseCommandLine(parser, &errorMessage, open_filename,
-                                   audioType, force_plugin_rescan, dont_plugin_rescan))
+                                   audioType, force_plugin_rescan, dont_plugin_rescan,
+                                   build_peaks_dir, build_peaks_threads,
+                                   render_filename, render_output, render_range))
           {
             case CommandLineOk:
                 break;
@@ -1088,6 +1135,46 @@ int main(int argc, char* argv[])
         // END Parse command line options
         //----------------------------------
 
+        // Just build peak files and quit?
+        if(!build_peaks_dir.isEmpty())
+        {
+          if(!QFileInfo(build_peaks_dir).isDir())
+          {
+            fprintf(stderr, "Error: --build-peaks: not a directory: %s\n", build_peaks_dir.toLocal8Bit().constData());
+#ifdef HAVE_LASH
+            if(lash_args) lash_args_destroy(lash_args);
+#endif
+            return 1;
+          }
+          const int n = MusECore::PeakBuilder::buildDirectory(build_peaks_dir, build_peaks_threads, true);
+          fprintf(stderr, "Peak files up to date for %d sound files\n", n);
+#ifdef HAVE_LASH
+          if(lash_args) lash_args_destroy(lash_args);
+#endif
+          return 0;
+        }
+
+        // Render a project without the GUI and quit?
+        const bool render_mode = !render_filename.isEmpty();
+        if(render_mode)
+        {
+          if(!QFileInfo(render_filename).isFile())
+          {
+            fprintf(stderr, "Error: --render: no such project: %s\n", render_filename.toLocal8Bit().constData());
+#ifdef HAVE_LASH
+            if(lash_args) lash_args_destroy(lash_args);
+#endif
+            return 1;
+          }
+          // These settings are not saved in render mode.
+          MusEGlobal::config.showSplashScreen = false;
+          MusEGlobal::config.showDidYouKnow = false;
+          MusEGlobal::config.warnInitPending = false;
+          // The bounce must freewheel.
+          MusEGlobal::config.freewheelMode = true;
+          MusEGlobal::populateMidiPortsOnStart = false;
+        }
+
         // Set some AL library namespace debug flags as well.
         // Make sure the AL namespace variables mirror our variables.
         AL::debugMsg = MusEGlobal::debugMsg;
@@ -1317,7 +1404,9 @@ int main(int argc, char* argv[])
                                         // Plugin types to check.
                                         types,
                                         // Debug messages.
-                                        MusEGlobal::debugMsg);
+                                        MusEGlobal::debugMsg,
+                                        // Number of scan processes at the same time.
+                                        MusEGlobal::config.pluginScanThreads);
 
         // Done with rescan trigger. Reset it now.
         if(do_rescan)
@@ -1349,6 +1438,7 @@ int main(int argc, char* argv[])
           MusECore::initMidiSynth(); // Need to do this now so that Add Track -> Synth menu is populated when MusE is created.
 
         MusEGlobal::muse = new MusEGui::MusE();
+        MusEGlobal::muse->setHeadless(render_mode);
         app.setMuse(MusEGlobal::muse);
         
         MusEGui::init_function_dialogs();
@@ -1390,7 +1480,12 @@ int main(int argc, char* argv[])
 #ifdef HAVE_LASH
         bool using_jack = false;
 #endif
-        if (MusEGlobal::debugMode) {
+        if (render_mode) {
+            // Never busy loop with real time priority.
+            MusEGlobal::realTimeScheduling = false;
+            MusECore::initDummyAudio(true);
+        }
+        else if (MusEGlobal::debugMode) {
             MusEGlobal::realTimeScheduling = false;
             MusECore::initDummyAudio();
         }
@@ -1496,6 +1591,7 @@ int main(int argc, char* argv[])
         // setup the prefetch fifo length now that the segmentSize is known
         MusEGlobal::fifoLength = 131072 / MusEGlobal::segmentSize;
         MusECore::initAudioPrefetch();
+        MusECore::initAudioGraphExecutor();
 
         // Set up the wave module now that sampleRate and segmentSize are known.
         MusECore::SndFile::initWaveModule(
@@ -1504,6 +1600,20 @@ int main(int argc, char* argv[])
           &MusEGlobal::defaultAudioConverterSettings,
           MusEGlobal::sampleRate,
           MusEGlobal::segmentSize);
+
+        // Build missing peak files in the background, unless disabled.
+        if(MusEGlobal::config.peakBuildThreads >= 0)
+          MusECore::PeakBuilder::start(MusEGlobal::config.peakBuildThreads);
+
+        // Write recordings to disk from their own thread, unless disabled.
+        // Writes are about a quarter second each, a power of two frames.
+        if(MusEGlobal::config.recordBufferSeconds > 0)
+        {
+          unsigned write_frames = 4096;
+          while(write_frames < MusEGlobal::sampleRate / 4)
+            write_frames <<= 1;
+          MusECore::RecordWriter::start(MusEGlobal::sampleRate, write_frames, 30);
+        }
         
         if(muse_splash)
         {
@@ -1654,7 +1764,8 @@ int main(int argc, char* argv[])
         qDebug() << "->" << qPrintable(QTime::currentTime().toString("hh:mm:ss.zzz"))
                  << "Show GUI...";
 
-        MusEGlobal::muse->show();
+        if(!render_mode)
+          MusEGlobal::muse->show();
 
         // Let the configuration settings take effect. Do not save.
         MusEGlobal::muse->changeConfig(false);
@@ -1708,7 +1819,12 @@ int main(int argc, char* argv[])
         // Load the default song.
         //--------------------------------------------------
         // When restarting, override with the last project file name used.
-        if(last_project_filename.isEmpty())
+        if(render_mode)
+        {
+          // Read the project's midi ports too, for its synthesizers.
+          MusEGlobal::muse->loadDefaultSong(render_filename, false, true);
+        }
+        else if(last_project_filename.isEmpty())
         {
           MusEGlobal::muse->loadDefaultSong(open_filename, false, false);
         }
@@ -1718,18 +1834,35 @@ int main(int argc, char* argv[])
             last_project_filename, last_project_was_template, last_project_loaded_config);
         }
 
-        QTimer::singleShot(100, MusEGlobal::muse, SLOT(showDidYouKnowDialogIfEnabled()));
+        if(render_mode)
+        {
+          // Let any deferred loading finish.
+          qApp->processEvents();
+          if(MusEGlobal::muse->lastProjectFilePath().isEmpty())
+          {
+            fprintf(stderr, "Error: --render: cannot load project: %s\n", render_filename.toLocal8Bit().constData());
+            rv = 1;
+          }
+          else
+            rv = MusEGlobal::muse->renderToFile(render_output, render_range) ? 0 : 1;
+          // Shut down as when closing the main window. Nothing is saved.
+          MusEGlobal::muse->close();
+        }
+        else
+        {
+          QTimer::singleShot(100, MusEGlobal::muse, SLOT(showDidYouKnowDialogIfEnabled()));
 
-        //--------------------------------------------------
-        // Start the application...
-        //--------------------------------------------------
+          //--------------------------------------------------
+          // Start the application...
+          //--------------------------------------------------
 
-        qDebug() << "->" << qPrintable(QTime::currentTime().toString("hh:mm:ss.zzz"))
-                 << "Start application loop...";
+          qDebug() << "->" << qPrintable(QTime::currentTime().toString("hh:mm:ss.zzz"))
+                   << "Start application loop...";
 
-        qDebug() << "Total start-up time:" << timer.elapsed() << "ms";
+          qDebug() << "Total start-up time:" << timer.elapsed() << "ms";
 
-        rv = app.exec();
+          rv = app.exec();
+        }
 
         //--------------------------------------------------
         // ... Application finished.
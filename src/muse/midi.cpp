@@ -855,6 +855,33 @@ void Audio::initDevices(bool force)
             }
       }
 
+//---------------------------------------------------------
+//   seekValueVisible
+//    Whether a cached controller value at tick from part is
+//     to be sent when seeking. Sets values_found if the
+//     value lies inside its part.
+//---------------------------------------------------------
+
+static bool seekValueVisible(unsigned tick, const Part* p, bool* values_found)
+{
+  if(!p)
+    return false;
+  // Ignore values that are outside of the part.
+  if(tick < p->tick() || tick >= (p->tick() + p->lenTick()))
+    return false;
+  // Required? It seems not. From previous version of this code block, first section.
+  //if(pos < p->tick() || pos >= (p->tick() + p->lenTick()))
+  //  return false;
+  *values_found = true;
+  // Ignore if part or track is muted or off.
+  if(p->mute())
+    return false;
+  const Track* track = p->track();
+  if(!track || track->isMute() || track->off())
+    return false;
+  return true;
+}
+
 //---------------------------------------------------------
 //   seekMidi
 //   Called from audio thread only.
@@ -1039,30 +1066,40 @@ void Audio::seekMidi()
       // Find the first non-muted value at the given tick...
       bool values_found = false;
       bool found_value = false;
+      const Part* found_part = nullptr;
+      int found_val = 0;
 
-      ciMidiCtrlVal imcv = vl->upper_bound(pos);
-      while(imcv != vl->cbegin())
+      // Use the flat index if it is up to date. It finds the position in constant
+      //  time and the walk back stays in one array. Otherwise use the list.
+      if(const MidiCtrlValIndex* idx = vl->playbackIndex())
       {
-        --imcv;
-        const Part* p = imcv->second.part;
-        if(!p)
-          continue;
-        // Ignore values that are outside of the part.
-        unsigned t = imcv->first;
-        if(t < p->tick() || t >= (p->tick() + p->lenTick()))
-          continue;
-        // Required? It seems not. From previous version of this code block, first section.
-        //if(pos < p->tick() || pos >= (p->tick() + p->lenTick()))
-        //  continue;
-        values_found = true;
-        // Ignore if part or track is muted or off.
-        if(p->mute())
-          continue;
-        const Track* track = p->track();
-        if(!track || track->isMute() || track->off())
-          continue;
-        found_value = true;
-        break;
+        MidiCtrlValIndex::const_iterator imcv = idx->upper_bound(pos);
+        while(imcv != idx->begin())
+        {
+          --imcv;
+          if(seekValueVisible(imcv->tick, imcv->part, &values_found))
+          {
+            found_value = true;
+            found_part = imcv->part;
+            found_val = imcv->val;
+            break;
+          }
+        }
+      }
+      else
+      {
+        ciMidiCtrlVal imcv = vl->upper_bound(pos);
+        while(imcv != vl->cbegin())
+        {
+          --imcv;
+          if(seekValueVisible(imcv->first, imcv->second.part, &values_found))
+          {
+            found_value = true;
+            found_part = imcv->second.part;
+            found_val = imcv->second.val;
+            break;
+          }
+        }
       }
 
       if(found_value)
@@ -1074,7 +1111,7 @@ void Audio::seekMidi()
         // Is it a drum controller event, according to the track port's instrument?
         if(mp->drumController(ctlnum))
         {
-          if(const Part* p = imcv->second.part)
+          if(const Part* p = found_part)
           {
             if(const Track* t = p->track())
             {
@@ -1129,7 +1166,7 @@ void Audio::seekMidi()
           break;
         }
 
-        const MidiPlayEvent ev(0, fin_port, fin_chan, ME_CONTROLLER, fin_ctlnum, imcv->second.val);
+        const MidiPlayEvent ev(0, fin_port, fin_chan, ME_CONTROLLER, fin_ctlnum, found_val);
         // This is the audio thread. Just set directly.
         fin_mp->setHwCtrlState(ev);
         // Don't bother sending any sustain values to the device, because we already
@@ -1363,37 +1400,35 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts,
             //  no user changes in-between cycles. We don't have that capability currently anyway -
             //  to break the process up into chunks (like our controllers) depending on tempo frames, 
             //  our tempo map is not frame-accurate, only tick-accurate.
-            ciEvent ie   = events.lower_bound(stick);
-            ciEvent iend = events.upper_bound(etick);
-
             DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: part events stick:%u etick:%u\n", stick, etick);
             
-            for (; ie != iend; ++ie) {
-                  Event ev = ie->second;
+            // Plays one event. It is given as a flat copy, so that dense parts
+            //  can be played straight from the event list's snapshot.
+            auto playEvent = [&](const FlatEvent& ev) {
                   port = defaultPort; //Reset each loop
                   //
                   //  don't play any meta events
                   //
-                  if (ev.type() == Meta)
-                        continue;
+                  if (ev.type == Meta)
+                        return;
                   if (track->isDrumTrack()) {
-                        int instr = ev.pitch();
+                        int instr = ev.a;
                         // ignore muted drums
-                        if (ev.isNote() && track->drummap()[instr].mute)
-                              continue;
+                        if (ev.type == Note && track->drummap()[instr].mute)
+                              return;
                         }
 
                   if (replaceMode) {
-                      unsigned eventStart = ev.tick() + partTick;
+                      unsigned eventStart = ev.tick + partTick;
                       if (punchboth && (eventStart >= rangeStart && eventStart < rangeEnd))
-                          continue;
+                          return;
                       else if (punchin && eventStart >= rangeStart)
-                          continue;
+                          return;
                       else if (punchout && eventStart < rangeEnd)
-                          continue;
+                          return;
                   }
                   
-                  unsigned tick  = ev.tick() + offset;
+                  unsigned tick  = ev.tick + offset;
 
                   DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: event tick:%u\n", tick);
       
@@ -1422,7 +1457,7 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts,
                     if(fr < pos_fr || fr >= next_pos_fr)
                     {
                       DEBUG_MIDI_TIMING(stderr, "Audio::collectEvents: Ignoring event\n");
-                      continue;
+                      return;
                     }
                     
                     frame = fr - pos_fr;
@@ -1431,16 +1466,16 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts,
                   
                   DEBUG_MIDI(stderr, "Audio::collectEvents: event: tick:%u final frame:%u\n", tick, frame);
                     
-                  switch (ev.type()) {
+                  switch (ev.type) {
                         case Note:
                               {
-                              int len   = ev.lenTick();
-                              int pitch = ev.pitch();
-                              int velo  = ev.velo();
-                              int veloOff = ev.veloOff();
+                              int len   = (int)ev.lenTick;
+                              int pitch = ev.a;
+                              int velo  = ev.b;
+                              int veloOff = ev.c;
                               if (track->isDrumTrack())  {
                                     // Map drum-notes to the drum-map values
-                                   int instr = ev.pitch();
+                                   int instr = ev.a;
                                    pitch     = track->drummap()[instr].anote;
                                    // Default to track port if -1 and track channel if -1.
                                    port      = track->drummap()[instr].port; //This changes to non-default port
@@ -1470,7 +1505,7 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts,
                               if (velo < 1)           // no off event
                                     // Zero means zero. Should mean no note at all?
                                     //velo = 1;
-                                    continue;
+                                    return;
                               veloOff += track->velocity;
                               veloOff = (veloOff * track->compression) / 100;
                               if (veloOff > 127)
@@ -1506,7 +1541,7 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts,
                               {
                                 if (track->isDrumTrack())
                                 {
-                                  int ctl   = ev.dataA();
+                                  int ctl   = ev.a;
                                   // Is it a drum controller event, according to the track port's instrument?
                                   MusECore::MidiController *mc = MusEGlobal::midiPorts[defaultPort].drumController(ctl);
                                   if(mc)
@@ -1525,7 +1560,7 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts,
                                     MusECore::MidiPlayEvent mpeAlt(frame, port, channel,
                                                                    MusECore::ME_CONTROLLER,
                                                                    ctl | pitch,
-                                                                   ev.dataB());
+                                                                   ev.b);
                                     
                                     MidiPort* mpAlt = &MusEGlobal::midiPorts[port];
                                     // TODO Maybe grab the flag from the 'Optimize Controllers' Global Setting,
@@ -1540,7 +1575,7 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts,
                                   }
                                 }
                                 
-                                MusECore::MidiPlayEvent mpe = ev.asMidiPlayEvent(frame, port, channel);
+                                MusECore::MidiPlayEvent mpe(frame, port, channel, MusECore::ME_CONTROLLER, ev.a, ev.b);
                                 // TODO Maybe grab the flag from the 'Optimize Controllers' Global Setting,
                                 //       which so far was meant for (N)RPN stuff. For now, just force it.
                                 // This is the audio thread. Just set directly.
@@ -1554,12 +1589,26 @@ void Audio::collectEvents(MusECore::MidiTrack* track, unsigned int cts,
                           
                               if(md_writable)
                               {
-                                 md->putEvent(ev.asMidiPlayEvent(frame, port, channel), 
+                                 md->putEvent(Event(ev.base).asMidiPlayEvent(frame, port, channel), 
                                                   MidiDevice::NotLate, MidiDevice::PlaybackBuffer);
                               }
                               break;
                         }
-                  }
+                  };
+
+            const EventListSnapshot* flat = events.playbackEvents();
+            if(flat)
+            {
+              const EventListSnapshot::const_iterator iend = flat->upper_bound(etick);
+              for(EventListSnapshot::const_iterator ie = flat->lower_bound(stick); ie != iend; ++ie)
+                playEvent(*ie);
+            }
+            else
+            {
+              const ciEvent iend = events.upper_bound(etick);
+              for(ciEvent ie = events.lower_bound(stick); ie != iend; ++ie)
+                playEvent(EventList::flatEvent(ie));
+            }
             }
       }
 
@@ -23,6 +23,7 @@
 //=========================================================
 
 #include <cstdio>
+#include <algorithm>
 #include "muse_math.h"
 
 #include "globaldefs.h"
@@ -208,6 +209,20 @@ bool MidiCtrlValListList::resetAllHwVals(bool doLastHwValue)
   return changed;
 }
 
+//---------------------------------------------------------
+//   updateIndexes
+//   GUI thread only.
+//---------------------------------------------------------
+
+void MidiCtrlValListList::updateIndexes() const
+{
+  for(ciMidiCtrlValList imcvl = cbegin(); imcvl != cend(); ++imcvl)
+  {
+    if(imcvl->second)
+      imcvl->second->updateIndex();
+  }
+}
+
 //---------------------------------------------------------
 // searchControllers
 //---------------------------------------------------------
@@ -503,6 +518,153 @@ bool MidiCtrlValList::setHwVals(const double v, const double lastv)
   return true;
 }
 
+//---------------------------------------------------------
+//   MidiCtrlValIndex
+//---------------------------------------------------------
+
+void MidiCtrlValIndex::buildCheckpoints()
+{
+  _checkpoints.clear();
+  _shift = 0;
+  if(_items.empty())
+    return;
+
+  const unsigned int last_tick = _items.back().tick;
+  const size_t n = _items.size();
+  while(_shift < 31 && (size_t)(last_tick >> _shift) >= n)
+    ++_shift;
+
+  // One more checkpoint than blocks, so that each block has an end.
+  const unsigned int blocks = (last_tick >> _shift) + 1;
+  _checkpoints.resize(blocks + 1);
+  size_t i = 0;
+  for(unsigned int b = 0; b < blocks; ++b)
+  {
+    const unsigned long start = (unsigned long)b << _shift;
+    while(i < n && _items[i].tick < start)
+      ++i;
+    _checkpoints[b] = i;
+  }
+  _checkpoints[blocks] = n;
+}
+
+MidiCtrlValIndex::const_iterator MidiCtrlValIndex::lower_bound(unsigned int tick) const
+{
+  const unsigned int b = tick >> _shift;
+  if(_items.empty() || (size_t)b + 1 >= _checkpoints.size())
+    return _items.cend();
+  return std::lower_bound(_items.cbegin() + _checkpoints[b], _items.cbegin() + _checkpoints[b + 1], tick,
+    [](const MidiCtrlValIndexItem& i, unsigned int t) { return i.tick < t; });
+}
+
+MidiCtrlValIndex::const_iterator MidiCtrlValIndex::upper_bound(unsigned int tick) const
+{
+  const unsigned int b = tick >> _shift;
+  if(_items.empty() || (size_t)b + 1 >= _checkpoints.size())
+    return _items.cend();
+  return std::upper_bound(_items.cbegin() + _checkpoints[b], _items.cbegin() + _checkpoints[b + 1], tick,
+    [](unsigned int t, const MidiCtrlValIndexItem& i) { return t < i.tick; });
+}
+
+int MidiCtrlValIndex::value(unsigned int tick) const
+{
+  const_iterator i = lower_bound(tick);
+  if (i == end() || i->tick != tick) {
+        if (i == begin())
+              return CTRL_VAL_UNKNOWN;
+        --i;
+        }
+  return i->val;
+}
+
+int MidiCtrlValIndex::value(unsigned int tick, Part* part) const
+{
+  const_iterator i = lower_bound(tick);
+  for(const_iterator j = i; j != end() && j->tick == tick; ++j)
+  {
+    if(j->part == part)
+      return j->val;
+  }
+  while(i != begin())
+  {
+    --i;
+    if(i->part == part)
+      return i->val;
+  }
+  return CTRL_VAL_UNKNOWN;
+}
+
+int MidiCtrlValIndex::visibleValue(unsigned int tick, bool inclMutedParts, bool inclMutedTracks, bool inclOffTracks) const
+{
+  // See MidiCtrlValList::visibleValue().
+  const_iterator i = lower_bound(tick);
+  for(const_iterator j = i; j != end() && j->tick == tick; ++j)
+  {
+    const Part* part = j->part;
+    if(tick < part->tick() || tick >= (part->tick() + part->lenTick()))
+      continue;
+    if(!inclMutedParts && part->mute())
+      continue;
+    const Track* track = part->track();
+    if(track && ((!inclMutedTracks && track->isMute()) || (!inclOffTracks && track->off())))
+      continue;
+    return j->val;
+  }
+  while(i != begin())
+  {
+    --i;
+    const Part* part = i->part;
+    if(!inclMutedParts && part->mute())
+      continue;
+    const Track* track = part->track();
+    if(track && ((!inclMutedTracks && track->isMute()) || (!inclOffTracks && track->off())))
+      continue;
+    return i->val;
+  }
+  return CTRL_VAL_UNKNOWN;
+}
+
+//---------------------------------------------------------
+//   updateIndex
+//   GUI thread only.
+//---------------------------------------------------------
+
+bool MidiCtrlValList::updateIndex() const
+{
+  unsigned int serial;
+  if(!_playback.needsUpdate(&serial))
+    return false;
+
+  MidiCtrlValIndex* idx = new MidiCtrlValIndex();
+  idx->_items.reserve(size());
+  for(ciMidiCtrlVal i = cbegin(); i != cend(); ++i)
+    idx->_items.push_back(MidiCtrlValIndexItem { i->first, i->second.val, i->second.part });
+  idx->buildCheckpoints();
+  _playback.publish(idx, serial);
+  return true;
+}
+
+//---------------------------------------------------------
+//   index
+//   GUI thread only.
+//---------------------------------------------------------
+
+const MidiCtrlValIndex* MidiCtrlValList::index() const
+{
+  updateIndex();
+  return _playback.published();
+}
+
+//---------------------------------------------------------
+//   playbackIndex
+//   Audio thread only.
+//---------------------------------------------------------
+
+const MidiCtrlValIndex* MidiCtrlValList::playbackIndex() const
+{
+  return _playback.take();
+}
+
 //---------------------------------------------------------
 //   partAtTick
 //---------------------------------------------------------
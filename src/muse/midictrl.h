@@ -26,8 +26,13 @@
 #define __MIDICTRL_H__
 
 #include <map>
+#include <vector>
+#include <atomic>
+#include <utility>
+#include <cstddef>
 
 #include "midi_controller.h"
+#include "snapshot_exchange.h"
 
 //#define _MIDI_CTRL_DEBUG_
 // For finding exactly who may be calling insert, erase clear etc. in
@@ -49,10 +54,67 @@ struct MidiCtrlVal
   bool operator==(const MidiCtrlVal& mcv) { return part == mcv.part && val == mcv.val; }
 };
 
+//---------------------------------------------------------
+//   MidiCtrlValIndexItem
+//    A flat copy of one value in a MidiCtrlValList.
+//---------------------------------------------------------
+
+struct MidiCtrlValIndexItem
+{
+  unsigned int tick;
+  int val;
+  Part* part;
+};
+
+//---------------------------------------------------------
+//   MidiCtrlValIndex
+//    A read-only copy of a MidiCtrlValList in a flat array,
+//     sorted like the list, with a checkpoint table for
+//     finding the values around a tick in constant time.
+//    Checkpoint b holds the index of the first item at or
+//     after tick (b << _shift). The shift is chosen so that
+//     there are about as many checkpoints as items.
+//---------------------------------------------------------
+
+class MidiCtrlValIndex {
+      friend class MidiCtrlValList;
+      template <typename T> friend class SnapshotExchange;
+
+      std::vector<MidiCtrlValIndexItem> _items;
+      std::vector<unsigned int> _checkpoints;
+      unsigned int _shift;
+      // The list's serial number when the index was built.
+      unsigned int _serial;
+
+      void buildCheckpoints();
+
+   public:
+      typedef std::vector<MidiCtrlValIndexItem>::const_iterator const_iterator;
+
+      MidiCtrlValIndex() : _shift(0), _serial(0) { }
+
+      const_iterator begin() const { return _items.cbegin(); }
+      const_iterator end() const   { return _items.cend(); }
+      size_t size() const          { return _items.size(); }
+      bool empty() const           { return _items.empty(); }
+      // Like the list's lower_bound() and upper_bound().
+      const_iterator lower_bound(unsigned int tick) const;
+      const_iterator upper_bound(unsigned int tick) const;
+
+      // Like the list's methods of the same names.
+      int value(unsigned int tick) const;
+      int value(unsigned int tick, Part* part) const;
+      int visibleValue(unsigned int tick, bool inclMutedParts, bool inclMutedTracks, bool inclOffTracks) const;
+      };
+
 //---------------------------------------------------------
 //   MidiCtrlValList
 //    arrange controller events of a specific type in a
 //    list for easy retrieval
+//    Besides the map, the list keeps a flat index of its
+//     values for seeking and drawing. All changes to the
+//     items must go through the list, so that the index
+//     is known to be out of date.
 //---------------------------------------------------------
 
 typedef std::pair<unsigned int, MidiCtrlVal> MidiCtrlValListInsertPair_t;
@@ -74,12 +136,41 @@ class MidiCtrlValList : public MidiCtrlValList_t {
       int _lastValidByte1;
       int _lastValidByte0;
 
+      // Indexes of the values, for the audio thread.
+      mutable SnapshotExchange<MidiCtrlValIndex> _playback;
+
       // Hide built-in finds.
       iterator find(const unsigned int&) { return end(); };
       const_iterator find(const unsigned int&) const { return end(); };
 
    public:
       MidiCtrlValList(int num);
+
+      // The map's modifiers, marking the index out of date.
+      template <typename... Args> auto insert(Args&&... args) {
+            invalidateIndex();
+            return MidiCtrlValList_t::insert(std::forward<Args>(args)...);
+            }
+      template <typename... Args> auto erase(Args&&... args) {
+            invalidateIndex();
+            return MidiCtrlValList_t::erase(std::forward<Args>(args)...);
+            }
+      void clear() noexcept { MidiCtrlValList_t::clear(); invalidateIndex(); }
+      void swap(MidiCtrlValList& other) noexcept {
+            MidiCtrlValList_t::swap(other);
+            invalidateIndex();
+            other.invalidateIndex();
+            }
+
+      // Marks the index as out of date. Call after changing values in the list directly.
+      void invalidateIndex() { _playback.invalidate(); }
+      // GUI thread only. Builds and publishes a new index if the items changed.
+      // Returns true if a new index was published.
+      bool updateIndex() const;
+      // GUI thread only. Returns an up to date index, building it if required.
+      const MidiCtrlValIndex* index() const;
+      // Audio thread only. Returns the index, or null while it is not up to date.
+      const MidiCtrlValIndex* playbackIndex() const;
       
       Part* partAtTick(unsigned int tick) const;
       
@@ -199,6 +290,8 @@ class MidiCtrlValListList : public MidiCtrlValListList_t {
       // Equivalent to calling resetAllHwVal() on each MidiCtrlValList.
       // Returns true if either value was changed in any controller.
       bool resetAllHwVals(bool doLastHwValue);
+      // GUI thread only. Publishes fresh indexes of any lists which changed.
+      void updateIndexes() const;
       
 #ifdef _MIDI_CTRL_METHODS_DEBUG_      
       // Need to catch all insert, erase, clear etc...
@@ -25,9 +25,39 @@
 #include "xml.h"
 #include "mpevent.h"
 #include "midictrl.h"
+#include "memory.h"
 
 namespace MusECore {
 
+//---------------------------------------------------------
+//   operator new, operator delete
+//    MidiEventBases come from a pool shared by all threads.
+//    The pool is never destroyed, so that events which
+//     outlive static destruction can still be deleted.
+//---------------------------------------------------------
+
+static SharedTypedMemoryPool<MidiEventBase, 4096>& eventPool()
+      {
+      static SharedTypedMemoryPool<MidiEventBase, 4096>* pool = new SharedTypedMemoryPool<MidiEventBase, 4096>();
+      return *pool;
+      }
+
+void* MidiEventBase::operator new(size_t size)
+      {
+      if (size != sizeof(MidiEventBase))
+            return ::operator new(size);
+      return eventPool().alloc();
+      }
+
+void MidiEventBase::operator delete(void* p, size_t size)
+      {
+      if (size != sizeof(MidiEventBase)) {
+            ::operator delete(p);
+            return;
+            }
+      eventPool().free(p);
+      }
+
 //---------------------------------------------------------
 //   MidiEventBase
 //---------------------------------------------------------
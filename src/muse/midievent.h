@@ -38,6 +38,7 @@ class MidiEventBase : public EventBase {
       // NOTE: Even non-shared clone events ALWAYS share edata. edata does NOT currently require
       //        separate instances, unlike wave events which absolutely do.
       //       Be aware when iterating or modifying clones for example. (It can save time.)
+      //       Data of up to EvData::InlineSize bytes is held in edata itself and is copied instead.
       EvData edata;
 
       // Creates a non-shared clone (copies event base), including the same 'group' id.
@@ -46,6 +47,10 @@ class MidiEventBase : public EventBase {
       virtual EventBase* duplicate() const { return new MidiEventBase(*this, true); }  
 
    public:
+      // Allocated from a pool. See midievent.cpp.
+      static void* operator new(size_t size);
+      static void operator delete(void* p, size_t size);
+
       MidiEventBase(EventType t);
       // Creates a non-shared clone with same id, or duplicate with unique id, and 0 ref count and invalid Pos sn. 
       MidiEventBase(const MidiEventBase& ev, bool duplicate_not_clone = false);
@@ -44,6 +44,7 @@
 #include "wavepreview.h"
 #include "al/dsp.h"
 #include "latency_compensator.h"
+#include "record_writer.h"
 
 // REMOVE Tim. Persistent routes. Added. Make this permanent later if it works OK and makes good sense.
 #define _USE_SIMPLIFIED_SOLO_CHAIN_
@@ -398,7 +399,7 @@ void AudioTrack::processTrackCtrls(unsigned pos, int trackChans, unsigned nframe
         {
           if(cl && (unsigned long)cl->id() == k)
           {
-            cl->getInterpolation(slice_frame, no_auto || !_controls[k].enCtrl, &ci);
+            cl->getPlaybackInterpolation(slice_frame, no_auto || !_controls[k].enCtrl, &ci);
             if(icl != cll->end())
               ++icl;
           }
@@ -699,74 +700,83 @@ void AudioTrack::processTrackCtrls(unsigned pos, int trackChans, unsigned nframe
           v = _volume * _gain;
           v1  = v * (1.0 - _pan);
           v2  = v * (1.0 + _pan);
-          if(v1 > _curVol1)
+          // Settled on both sides? Do both channels in one pass.
+          // A mono track reads the same source for both.
+          if(v1 == _curVol1 && v2 == _curVol2)
           {
-            //fprintf(stderr, "C %f %f \n", v1, _curVol1);
-            if(_curVol1 == 0.0)
-              _curVol1 = 0.001;  // Kick-start it from zero at -30dB.
-            for( ; k < nsamp; ++k)
+            AL::dsp->gainPan(dp1, dp2, sp1, sp2, nsamp, _curVol1, _curVol2);
+          }
+          else
+          {
+            if(v1 > _curVol1)
             {
-              _curVol1 *= up_fact;
-              if(_curVol1 >= v1)
+              //fprintf(stderr, "C %f %f \n", v1, _curVol1);
+              if(_curVol1 == 0.0)
+                _curVol1 = 0.001;  // Kick-start it from zero at -30dB.
+              for( ; k < nsamp; ++k)
               {
-                _curVol1 = v1;
-                break;
+                _curVol1 *= up_fact;
+                if(_curVol1 >= v1)
+                {
+                  _curVol1 = v1;
+                  break;
+                }
+                *dp1++ = *sp1++ * _curVol1;
               }
-              *dp1++ = *sp1++ * _curVol1;
             }
-          }
-          else
-          if(v1 < _curVol1)
-          {
-            //fprintf(stderr, "D %f %f \n", v1, _curVol1);
-            for( ; k < nsamp; ++k)
+            else
+            if(v1 < _curVol1)
             {
-              _curVol1 *= down_fact;
-              if(_curVol1 <= v1 || _curVol1 <= 0.001)  // Or if less than -30dB.
+              //fprintf(stderr, "D %f %f \n", v1, _curVol1);
+              for( ; k < nsamp; ++k)
               {
-                _curVol1 = v1;
-                break;
+                _curVol1 *= down_fact;
+                if(_curVol1 <= v1 || _curVol1 <= 0.001)  // Or if less than -30dB.
+                {
+                  _curVol1 = v1;
+                  break;
+                }
+                *dp1++ = *sp1++ * _curVol1;
               }
-              *dp1++ = *sp1++ * _curVol1;
             }
-          }
-          for( ; k < nsamp; ++k)
-            *dp1++ = *sp1++ * _curVol1;
-
-          k = 0;
-          if(v2 > _curVol2)
-          {
-            //fprintf(stderr, "E %f %f \n", v2, _curVol2);
-            if(_curVol2 == 0.0)
-              _curVol2 = 0.001;  // Kick-start it from zero at -30dB.
             for( ; k < nsamp; ++k)
+              *dp1++ = *sp1++ * _curVol1;
+
+            k = 0;
+            if(v2 > _curVol2)
             {
-              _curVol2 *= up_fact;
-              if(_curVol2 >= v2)
+              //fprintf(stderr, "E %f %f \n", v2, _curVol2);
+              if(_curVol2 == 0.0)
+                _curVol2 = 0.001;  // Kick-start it from zero at -30dB.
+              for( ; k < nsamp; ++k)
               {
-                _curVol2 = v2;
-                break;
+                _curVol2 *= up_fact;
+                if(_curVol2 >= v2)
+                {
+                  _curVol2 = v2;
+                  break;
+                }
+                *dp2++ = *sp2++ * _curVol2;
               }
-              *dp2++ = *sp2++ * _curVol2;
             }
-          }
-          else
-          if(v2 < _curVol2)
-          {
-            //fprintf(stderr, "F %f %f \n", v2, _curVol2);
-            for( ; k < nsamp; ++k)
+            else
+            if(v2 < _curVol2)
             {
-              _curVol2 *= down_fact;
-              if(_curVol2 <= v2 || _curVol2 <= 0.001)   // Or if less than -30dB.
+              //fprintf(stderr, "F %f %f \n", v2, _curVol2);
+              for( ; k < nsamp; ++k)
               {
-                _curVol2 = v2;
-                break;
+                _curVol2 *= down_fact;
+                if(_curVol2 <= v2 || _curVol2 <= 0.001)   // Or if less than -30dB.
+                {
+                  _curVol2 = v2;
+                  break;
+                }
+                *dp2++ = *sp2++ * _curVol2;
               }
-              *dp2++ = *sp2++ * _curVol2;
             }
+            for( ; k < nsamp; ++k)
+              *dp2++ = *sp2++ * _curVol2;
           }
-          for( ; k < nsamp; ++k)
-            *dp2++ = *sp2++ * _curVol2;
         }
       }
 
@@ -1015,7 +1025,8 @@ void AudioTrack::copyData(unsigned pos,
       {
         // Activate or deactivate the plugin now, depending on the desired track and plugin active states.
         // The two calls will do nothing if already in the desired state.
-        if(isOff)
+        // A frozen synth is not needed, its output comes from the freeze file.
+        if(isOff || isFrozen())
           sif->deactivate();
         else
           sif->activate();
@@ -1060,39 +1071,60 @@ void AudioTrack::copyData(unsigned pos,
     for(i = 0; i < srcTotalOutChans; ++i)
         buffer[i] = _dataBuffers[i];
 
-    // getData can use the supplied buffers, or change buffer to point to its own local buffers or Jack buffers etc.
-    // For ex. if this is an audio input, Jack will set the pointers for us in AudioInput::getData!
-    // Don't do any processing at all if off. Whereas, mute needs to be ready for action at all times,
-    //  so still call getData before it. Off is NOT meant to be toggled rapidly, but mute is !
-    // Since the meters are cleared above, getData can contribute (add) to them directly and return HaveMeterDataOnly
-    //  if it does not want to pass the audio for listening.
-    if(!getData(pos, srcTotalOutChans, nframes, buffer))
+    if(isFrozen())
     {
-      #ifdef NODE_DEBUG_PROCESS
-      fprintf(stderr, "MusE: AudioTrack::copyData name:%s srcTotalOutChans:%d zeroing buffers\n", name().toLocal8Bit().constData(), srcTotalOutChans);
-      #endif
+      // Track is frozen. A synth still needs to consume its events, but its output is discarded.
+      // A wave track does not, its prefetch fifo is not filled while frozen.
+      if(isSynthTrack())
+        getData(pos, srcTotalOutChans, nframes, buffer);
+      // Tell the efx pipe that the track is off, so that its plugins are deactivated.
+      _efxPipe->apply(pos, trackChans, nframes, false, nullptr);
 
-      // No data was available. Track is not off. Zero the working buffers and continue on.
-      unsigned int q;
-      for(i = 0; i < srcTotalOutChans; ++i)
+      // The freeze file only holds the track channels. Any extra synth outputs are silent.
+      const int freeze_chans = getFreezeData(pos, trackChans, nframes, buffer) ? trackChans : 0;
+      for(i = freeze_chans; i < srcTotalOutChans; ++i)
+        AL::dsp->clear(buffer[i], nframes, MusEGlobal::config.useDenormalBias);
+    }
+    else
+    {
+      // getData can use the supplied buffers, or change buffer to point to its own local buffers or Jack buffers etc.
+      // For ex. if this is an audio input, Jack will set the pointers for us in AudioInput::getData!
+      // Don't do any processing at all if off. Whereas, mute needs to be ready for action at all times,
+      //  so still call getData before it. Off is NOT meant to be toggled rapidly, but mute is !
+      // Since the meters are cleared above, getData can contribute (add) to them directly and return HaveMeterDataOnly
+      //  if it does not want to pass the audio for listening.
+      if(!getData(pos, srcTotalOutChans, nframes, buffer))
       {
-        float* buf_p = buffer[i];
-        if(MusEGlobal::config.useDenormalBias)
+        #ifdef NODE_DEBUG_PROCESS
+        fprintf(stderr, "MusE: AudioTrack::copyData name:%s srcTotalOutChans:%d zeroing buffers\n", name().toLocal8Bit().constData(), srcTotalOutChans);
+        #endif
+
+        // No data was available. Track is not off. Zero the working buffers and continue on.
+        unsigned int q;
+        for(i = 0; i < srcTotalOutChans; ++i)
         {
-          for(q = 0; q < nframes; /*++q*/)
-            buf_p[q++] = MusEGlobal::denormalBias;
+          float* buf_p = buffer[i];
+          if(MusEGlobal::config.useDenormalBias)
+          {
+            for(q = 0; q < nframes; /*++q*/)
+              buf_p[q++] = MusEGlobal::denormalBias;
+          }
+          else
+            memset(buf_p, 0, sizeof(float) * nframes);
         }
-        else
-          memset(buf_p, 0, sizeof(float) * nframes);
       }
-    }
 
-    //---------------------------------------------------
-    // apply plugin chain
-    //---------------------------------------------------
+      //---------------------------------------------------
+      // apply plugin chain
+      //---------------------------------------------------
 
-    // Allow it to process even if muted so that when mute is turned off, left-over buffers (reverb tails etc) can die away.
-    _efxPipe->apply(pos, trackChans, nframes, true, buffer);
+      // Allow it to process even if muted so that when mute is turned off, left-over buffers (reverb tails etc) can die away.
+      _efxPipe->apply(pos, trackChans, nframes, true, buffer);
+
+      // Rendering a freeze file? Capture the data after the plugins, before volume and pan.
+      if(!_freezeRecFile.isNull())
+        writeFreezeData(pos, trackChans, nframes, buffer);
+    }
 
     //---------------------------------------------------
     // apply volume, pan
@@ -1109,14 +1141,9 @@ void AudioTrack::copyData(unsigned pos,
     // FIXME TODO Need multichannel changes here?
     for(int c = 0; c < trackChans; ++c)
     {
-      meter[c] = 0.0;
       float* sp = (c >= valid_out_bufs) ? buffer[c] : outBuffers[c]; // Optimize: Don't all valid outBuffers just for meters
-      for(unsigned k = 0; k < nframes; ++k)
-      {
-        const double f = fabs(*sp++); // If the track is mono pan has no effect on meters.
-        if(f > meter[c])
-          meter[c] = f;
-      }
+      // If the track is mono pan has no effect on meters.
+      meter[c] = AL::dsp->peak(sp, nframes, 0.0f);
       if(meter[c] > _meter[c])
         _meter[c] = meter[c];
       if(_meter[c] > _peak[c])
@@ -1171,14 +1198,13 @@ void AudioTrack::copyData(unsigned pos,
         AudioAux* a = (AudioAux*)((*al)[k]);
         float** dst = a->sendBuffer();
         int auxChannels = a->channels();
+        a->lockSendBuffer();
         if((trackChans ==1 && auxChannels==1) || trackChans == 2)
         {
           for(int ch = 0; ch < trackChans; ++ch)
           {
             float* db = dst[ch % a->channels()]; // no matter whether there's one or two dst buffers
-            float* sb = outBuffers[ch];
-            for(unsigned f = 0; f < nframes; ++f)
-              *db++ += (*sb++ * m);   // add to mix
+            AL::dsp->mixWithGain(db, outBuffers[ch], nframes, m);   // add to mix
           }
         }
         else if(trackChans==1 && auxChannels==2)  // copy mono to both channels
@@ -1186,11 +1212,10 @@ void AudioTrack::copyData(unsigned pos,
           for(int ch = 0; ch < auxChannels; ++ch)
           {
             float* db = dst[ch % a->channels()];
-            float* sb = outBuffers[0];
-            for(unsigned f = 0; f < nframes; ++f)
-              *db++ += (*sb++ * m);   // add to mix
+            AL::dsp->mixWithGain(db, outBuffers[0], nframes, m);   // add to mix
           }
         }
+        a->unlockSendBuffer();
       }
     }
 
@@ -1994,9 +2019,20 @@ void AudioTrack::record()
                         // Reference counting diagnostics.
                         // fprintf(stderr, "AudioTrack::record _recFile ref count:%d\n", _recFile.getRefCount());
 
-                        // FIXME If we are to support writing compressed file types, we probably shouldn't be seeking here. REMOVE Tim. Wave.
-                        _recFile->seek(pos, 0);
-                        _recFile->write(_channels, buffer, MusEGlobal::segmentSize, MusEGlobal::config.liveWaveUpdate);
+                        RecordStream* rs = _recStream.load(std::memory_order_acquire);
+                        if(rs)
+                        {
+                          // The record writer thread does the disk writing.
+                          if(!rs->put(pos, buffer))
+                            fprintf(stderr, "AudioTrack::record(): Record buffer overrun: track:%s pos:%ld\n",
+                                    name().toLocal8Bit().constData(), (long)pos);
+                        }
+                        else
+                        {
+                          // FIXME If we are to support writing compressed file types, we probably shouldn't be seeking here. REMOVE Tim. Wave.
+                          _recFile->seek(pos, 0);
+                          _recFile->write(_channels, buffer, MusEGlobal::segmentSize, MusEGlobal::config.liveWaveUpdate);
+                        }
                       }
                     }
 
@@ -2249,7 +2285,169 @@ CtrlListList* AudioTrack::noEraseController()             { return &_noEraseCont
 const CtrlListList* AudioTrack::noEraseController() const { return &_noEraseController; }
 
 SndFileR AudioTrack::recFile() const           { return _recFile; }
-void AudioTrack::setRecFile(SndFileR sf)       { _recFile = sf; }
+void AudioTrack::setRecFile(SndFileR sf)       { finishRecordStream(); _recFile = sf; }
+
+//---------------------------------------------------------
+//   prepareFreeze
+//---------------------------------------------------------
+
+void AudioTrack::prepareFreeze()
+      {
+      if(!_freezeFifo)
+        _freezeFifo = new Fifo();
+      }
+
+//---------------------------------------------------------
+//   setFreezeFile
+//    called from audio thread only
+//---------------------------------------------------------
+
+SndFileR AudioTrack::setFreezeFile(SndFileR sf)
+      {
+      SndFileR old = _freezeFile;
+      _freezeFile = sf;
+      _freezeStream.store(*sf, std::memory_order_release);
+      // The prefetch thread refills the fifo upon the next seek.
+      return old;
+      }
+
+//---------------------------------------------------------
+//   setFreezeRecFile
+//    called from audio thread only
+//---------------------------------------------------------
+
+void AudioTrack::setFreezeRecFile(SndFileR sf)
+      {
+      _freezeRecFile = sf;
+      _freezeRecPos = 0;
+      }
+
+//---------------------------------------------------------
+//   readFreezeData
+//---------------------------------------------------------
+
+void AudioTrack::readFreezeData(sf_count_t pos, int channels, unsigned frames, float** bp, bool prefetch)
+      {
+      unsigned n = 0;
+      SndFile* sf = _freezeStream.load(std::memory_order_acquire);
+      if(sf && pos < sf->samples())
+      {
+        if(!prefetch || sf != _freezeReadFile || pos != _freezeReadPos)
+          sf->seek(pos, SEEK_SET);
+        n = sf->read(channels, bp, frames, true);
+        if(prefetch)
+        {
+          _freezeReadFile = sf;
+          _freezeReadPos = pos + n;
+        }
+      }
+      // Pad with silence past the end of the file.
+      if(n < frames)
+      {
+        for(int i = 0; i < channels; ++i)
+          AL::dsp->clear(bp[i] + n, frames - n, MusEGlobal::config.useDenormalBias);
+      }
+      }
+
+//---------------------------------------------------------
+//   getFreezeData
+//    called from audio thread only
+//---------------------------------------------------------
+
+bool AudioTrack::getFreezeData(unsigned pos, int channels, unsigned nframes, float** bp)
+      {
+      if(MusEGlobal::audio->freewheel())
+      {
+        // When freewheeling, read directly from the file.
+        readFreezeData(pos, channels, nframes, bp, false);
+        return true;
+      }
+
+      if(!_freezeFifo)
+        return false;
+
+      // The frozen data is already latency corrected, so unlike wave tracks,
+      //  the requested position is used as is.
+      float* pf_buf[channels];
+      MuseCount_t fpos;
+      if(_freezeFifo->peek(channels, nframes, pf_buf, &fpos))
+        return false;
+
+      // Let the stream retard, or advance to the requested position.
+      if((MuseCount_t)pos + nframes <= fpos)
+        return false;
+      while((MuseCount_t)pos >= fpos + nframes)
+      {
+        _freezeFifo->remove();
+        if(_freezeFifo->peek(channels, nframes, pf_buf, &fpos))
+          return false;
+        if((MuseCount_t)pos + nframes <= fpos)
+          return false;
+      }
+
+      if((MuseCount_t)pos <= fpos)
+      {
+        const unsigned blanks = fpos - pos;
+        if(blanks != 0)
+        {
+          for(int i = 0; i < channels; ++i)
+            AL::dsp->clear(bp[i], blanks, MusEGlobal::config.useDenormalBias);
+        }
+        for(int i = 0; i < channels; ++i)
+          AL::dsp->cpy(bp[i] + blanks, pf_buf[i], nframes - blanks, MusEGlobal::config.useDenormalBias);
+        if((MuseCount_t)pos == fpos)
+          _freezeFifo->remove();
+        return true;
+      }
+
+      // The request straddles two buffers.
+      const unsigned buf1_pos = pos - fpos;
+      const unsigned buf1_frames = nframes - buf1_pos;
+      for(int i = 0; i < channels; ++i)
+        AL::dsp->cpy(bp[i], pf_buf[i] + buf1_pos, buf1_frames, MusEGlobal::config.useDenormalBias);
+      _freezeFifo->remove();
+
+      // Peek the next buffer but do not remove it, the rest of it is required next cycle.
+      if(_freezeFifo->peek(channels, nframes, pf_buf, &fpos) || fpos != (MuseCount_t)pos + buf1_frames)
+      {
+        for(int i = 0; i < channels; ++i)
+          AL::dsp->clear(bp[i] + buf1_frames, buf1_pos, MusEGlobal::config.useDenormalBias);
+        return true;
+      }
+      for(int i = 0; i < channels; ++i)
+        AL::dsp->cpy(bp[i] + buf1_frames, pf_buf[i], buf1_pos, MusEGlobal::config.useDenormalBias);
+      return true;
+      }
+
+//---------------------------------------------------------
+//   writeFreezeData
+//    called from audio thread only
+//---------------------------------------------------------
+
+void AudioTrack::writeFreezeData(unsigned pos, int channels, unsigned nframes, float** bp)
+      {
+      // Only render while the freeze bounce is rolling.
+      if(!MusEGlobal::audio->isPlaying() || !MusEGlobal::audio->freewheel())
+        return;
+      const sf_count_t start = MusEGlobal::song->lPos().frame();
+      if((sf_count_t)pos < start)
+        return;
+      const sf_count_t fpos = pos - start;
+      // Fill any gap with silence, so that the file stays aligned with the song.
+      while(_freezeRecPos < fpos)
+      {
+        const unsigned n = std::min(fpos - _freezeRecPos, (sf_count_t)MusEGlobal::segmentSize);
+        float* silence[channels];
+        for(int i = 0; i < channels; ++i)
+          silence[i] = audioInSilenceBuf;
+        _freezeRecFile.write(channels, silence, n, false);
+        _freezeRecPos += n;
+      }
+      if(fpos < _freezeRecPos)
+        return;
+      _freezeRecFile.write(channels, bp, nframes, false);
+      _freezeRecPos += nframes;
+      }
 
 //---------------------------------------------------------
 //   setParam
@@ -33,10 +33,14 @@
 #include "keyevent.h"
 #include "midiport.h"
 #include "metronome_class.h"
+#include "audio_graph.h"
 #include "audio_convert/audio_converter_plugin.h"
 #include "audio_convert/audio_converter_settings_group.h"
 #include "midiremote.h"
 #include "plugin.h"
+#include "audio.h"
+#include "audioprefetch.h"
+#include "eventbatch.h"
 
 // Enable for debugging:
 //#define _PENDING_OPS_DEBUG_
@@ -168,6 +172,8 @@ unsigned int PendingOperationItem::getIndex() const
     case SetTrackSolo:
     case SetTrackRecMonitor:
     case SetTrackOff:
+    case SetTrackFreeze:
+    case SetTrackFreezeRecFile:
     case ModifyPartName:
     case ModifySongLength:
     case AddMidiCtrlValList:
@@ -200,6 +206,7 @@ unsigned int PendingOperationItem::getIndex() const
     case ModifyDefaultAudioConverterSettings:
     case ModifyStretchListRatio:
     case SetAudioConverterOfflineMode:
+    case SetWaveBlockMap:
     case ModifyMarkerList:
     case ModifyTempoList:
     case ModifySigList:
@@ -363,6 +370,16 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
     }
     break;
 
+    case SetWaveBlockMap:
+      DEBUG_OPERATIONS(stderr, "PendingOperationItem::executeRTStage SetWaveBlockMap: "
+                               "sndFile:%p blockMap:%p\n", *_sndFileR, _blockMap);
+      // Transfer the previous map into the member, so that its peaks can be compared in the non-RT stage.
+      _blockMap = _sndFileR.setBlockMap(_blockMap);
+      // Let the prefetch thread refill the fifos with the new data.
+      MusEGlobal::audioPrefetch->msgSeek(MusEGlobal::audio->pos().frame(), true);
+      flags |= SC_CLIP_MODIFIED;
+    break;
+
 
     case ModifyTrackDrumMapItem:
     {
@@ -1083,6 +1100,20 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
       _track->setOff(_boolA);
       flags |= SC_MUTE;
     break;
+
+    case SetTrackFreeze:
+      DEBUG_OPERATIONS(stderr, "PendingOperationItem::executeRTStage SetTrackFreeze track:%p\n", _track);
+      // Keep the previous file until the prefetch thread is done with it.
+      _sndFileR = static_cast<AudioTrack*>(_track)->setFreezeFile(_sndFileR);
+      // Let the prefetch thread refill the freeze fifo, or the prefetch fifo after unfreezing.
+      MusEGlobal::audioPrefetch->msgSeek(MusEGlobal::audio->pos().frame(), true);
+      flags |= SC_TRACK_MODIFIED;
+    break;
+
+    case SetTrackFreezeRecFile:
+      DEBUG_OPERATIONS(stderr, "PendingOperationItem::executeRTStage SetTrackFreezeRecFile track:%p\n", _track);
+      static_cast<AudioTrack*>(_track)->setFreezeRecFile(_sndFileR);
+    break;
     
     
     case AddPart:
@@ -1295,6 +1326,7 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
       DEBUG_OPERATIONS(stderr, "PendingOperationItem::executeRTStage ModifyMidiCtrlVal: part:%p old_val:%d new_val:%d\n", 
                        _imcv->second.part, _imcv->second.val, _intA);
       _imcv->second.val = _intA;
+      _mcvl->invalidateIndex();
     break;
     
     case ModifyAudioCtrlValListList:
@@ -1332,6 +1364,7 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
       {
         // Transfers the original list back to _aud_ctrl_list so it can be deleted in the non-RT stage.
         _iCtrlList->second->swap(*_aud_ctrl_list);
+        _iCtrlList->second->invalidateSnapshot();
       }
       flags |= SC_AUDIO_CONTROLLER_LIST;
     }
@@ -1354,6 +1387,7 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
       DEBUG_OPERATIONS(stderr, "PendingOperationItem::executeRTStage DeleteAudioCtrlVal: ctrl_l:%p ctrl_num:%d frame:%d val:%f\n", 
                        _aud_ctrl_list, _aud_ctrl_list->id(), _iCtrl->first, _iCtrl->second.value());
       _aud_ctrl_list->erase(_iCtrl);
+      _aud_ctrl_list->invalidateSnapshot();
       flags |= SC_AUDIO_CONTROLLER;
     break;
     case ModifyAudioCtrlVal:
@@ -1375,6 +1409,7 @@ SongChangedStruct_t PendingOperationItem::executeRTStage()
         _aud_ctrl_list->erase(_iCtrl);
         _aud_ctrl_list->insert(CtrlListInsertPair_t(_posLenVal, new_cv));
       }
+      _aud_ctrl_list->invalidateSnapshot();
       flags |= SC_AUDIO_CONTROLLER;
     break;
     case SelectAudioCtrlVal:
@@ -1852,6 +1887,20 @@ SongChangedStruct_t PendingOperationItem::executeNonRTStage()
         delete _audio_converter;
     break;
 
+    case SetTrackFreeze:
+      // At this point this is the previous freeze file. Wait until the prefetch
+      //  thread is done reading it before the list releases it.
+      if(!_sndFileR.isNull())
+        MusEGlobal::audioPrefetch->msgSync();
+    break;
+
+    case SetWaveBlockMap:
+      // At this point _blockMap is the previous map. Only the peaks of the changed blocks are rebuilt.
+      // The map itself belongs to the file's block store.
+      if(_blockMap)
+        _sndFileR.blockMapChanged(_blockMap);
+    break;
+
     case ModifyDefaultAudioConverterSettings:
       // At this point this is the original pointer that was replaced. Delete the original object now.
       if(_audio_converter_settings)
@@ -1983,6 +2032,14 @@ SongChangedStruct_t PendingOperationItem::executeNonRTStage()
       // Delete it now.
       if(_pluginI)
         delete _pluginI;
+      // The rack's chains of bridged plugins may have changed.
+      if(_track && !_track->isMidiTrack())
+        static_cast<AudioTrack*>(_track)->efxPipe()->updateBridges();
+    break;
+
+    case SwapRackEffectPlugins:
+      if(_track && !_track->isMidiTrack())
+        static_cast<AudioTrack*>(_track)->efxPipe()->updateBridges();
     break;
 
     case MoveRackEffectPlugin:
@@ -1990,6 +2047,10 @@ SongChangedStruct_t PendingOperationItem::executeNonRTStage()
       // Delete it now.
       if(_pluginI)
         delete _pluginI;
+      if(_srcTrack && !_srcTrack->isMidiTrack())
+        static_cast<AudioTrack*>(_srcTrack)->efxPipe()->updateBridges();
+      if(_track && _track != _srcTrack && !_track->isMidiTrack())
+        static_cast<AudioTrack*>(_track)->efxPipe()->updateBridges();
     break;
 
     case ModifyMidiAudioCtrlMap:
@@ -2023,8 +2084,42 @@ SongChangedStruct_t PendingOperationList::executeRTStage()
   {
     MusEGlobal::song->updateSoloStates();
     _sc_flags |= SC_SOLO;
+    // The audio graph is stale now. It is rebuilt by the gui thread in Song::update().
+    if(MusEGlobal::audioGraph)
+      MusEGlobal::audioGraph->invalidate();
   } 
   
+  // Rescan latencies at the next cycle if the latency graph may have changed.
+  bool latency_changed = false;
+  for(iPendingOperation ip = begin(); ip != end() && !latency_changed; ++ip)
+  {
+    switch(ip->_type)
+    {
+      case PendingOperationItem::AddMidiDevice:
+      case PendingOperationItem::DeleteMidiDevice:
+      case PendingOperationItem::ModifyMidiDeviceFlags:
+      case PendingOperationItem::AddTrack:
+      case PendingOperationItem::DeleteTrack:
+      case PendingOperationItem::MoveTrack:
+      case PendingOperationItem::SetTrackRecMonitor:
+      case PendingOperationItem::SetTrackOff:
+      case PendingOperationItem::AddAuxSendValue:
+      case PendingOperationItem::AddRoute:
+      case PendingOperationItem::DeleteRoute:
+      case PendingOperationItem::SwitchMetronomeSettings:
+      case PendingOperationItem::SetRackEffectPlugin:
+      case PendingOperationItem::SwapRackEffectPlugins:
+      case PendingOperationItem::MoveRackEffectPlugin:
+        latency_changed = true;
+      break;
+
+      default:
+      break;
+    }
+  }
+  if(latency_changed)
+    MusEGlobal::audio->latencyChanged();
+  
   // To avoid doing this item by item, do it here.
   StretchList* sl;
   for(iPendingOperation ip = begin(); ip != end(); ++ip)
@@ -3771,6 +3866,52 @@ void PendingOperationList::modifyPartPortCtrlEvents(const Event& old_event, cons
   }
 }
 
+void PendingOperationList::modifyPartPortCtrlEvents(const EventBatch& batch, Part* part, bool revert)
+{
+  Track* t = part->track();
+  if(!t || !t->isMidiTrack())
+    return;
+  // Only controller events have cached values. Notes, the bulk of most batches, are skipped quickly.
+  for(const EventBatch::Change& c : batch.changes())
+  {
+    const Event& from = revert ? c.newEvent : c.oldEvent;
+    const Event& to   = revert ? c.oldEvent : c.newEvent;
+    const bool from_ctrl = !from.empty() && from.type() == Controller;
+    const bool to_ctrl   = !to.empty() && to.type() == Controller;
+    if(from_ctrl && to_ctrl)
+      modifyPartPortCtrlEvents(from, to, part);
+    else if(from_ctrl)
+      removePartPortCtrlEvents(from, part, t);
+    else if(to_ctrl)
+      // The operation will catch and ignore events which are past the end of the part.
+      addPartPortCtrlEvents(to, part, part->tick(), part->lenTick(), t);
+  }
+}
+
+//---------------------------------------------------------
+//   modifyEventBatchOperation
+//    Instead of one delete and one add operation per event
+//     and clone, each event list is rebuilt with the batch
+//     merged in and swapped in constant time.
+//---------------------------------------------------------
+
+void PendingOperationList::modifyEventBatchOperation(const EventBatch& batch, Part* part, bool revert,
+                                                     bool do_port_ctrls, bool do_clone_port_ctrls)
+{
+  if(batch.empty())
+    return;
+  Part* p = part;
+  do
+  {
+    add(PendingOperationItem(&p->nonconst_events(), batch.apply(p->events(), revert), PendingOperationItem::ModifyEventList));
+    // Like Song::changeEventOperation(), include the cached controller values of the clones only if requested.
+    if(do_port_ctrls && (do_clone_port_ctrls || p == part))
+      modifyPartPortCtrlEvents(batch, p, revert);
+    p = p->nextClone();
+  }
+  while(p != part);
+}
+
 void PendingOperationList::addPartOperation(PartList *partlist, Part* part)
 {
   // There is protection, in the catch-all Undo::insert(), from failure here (such as double add, del + add, add + del)
@@ -56,6 +56,7 @@ class AudioConverterPluginI;
 class MidiRemote;
 class PluginI;
 class PluginIBase;
+class EventBatch;
 
 typedef std::list < iMidiCtrlValList > MidiCtrlValListIterators_t;
 typedef MidiCtrlValListIterators_t::iterator iMidiCtrlValListIterators_t;
@@ -161,7 +162,8 @@ struct PendingOperationItem
     ModifyMidiDeviceAddress,         ModifyMidiDeviceFlags,       ModifyMidiDeviceName,
     SetInstrument,
     AddTrack,          DeleteTrack,  MoveTrack,                   ModifyTrackName,
-    SetTrackRecord, SetTrackMute, SetTrackSolo, SetTrackRecMonitor, SetTrackOff,
+    SetTrackRecord, SetTrackMute, SetTrackSolo, SetTrackRecMonitor, SetTrackOff, SetTrackFreeze,
+    SetTrackFreezeRecFile,
     ModifyTrackDrumMapItem, ReplaceTrackDrumMapPatchList,         UpdateDrumMaps,
     AddPart,           DeletePart,   MovePart, SelectPart, ModifyPartStart, ModifyPartLength,  ModifyPartName,
     AddEvent,          DeleteEvent,  SelectEvent,  ModifyEventList,
@@ -185,6 +187,7 @@ struct PendingOperationItem
     SetAudioConverterOfflineMode,
     AddStretchListRatioAt,   DeleteStretchListRatioAt,  ModifyStretchListRatioAt,
     ModifyStretchListRatio,
+    SetWaveBlockMap,
 
     AddAuxSendValue,   
     AddRoute,          DeleteRoute, 
@@ -250,6 +253,7 @@ struct PendingOperationItem
     bool* _bool_pointer;
     MetroAccentsMap* _newMetroAccentsMap;
     AudioConverterSettingsGroup* _audio_converter_settings;
+    WaveBlockMap* _blockMap;
     MidiRemote* _newMidiRemote;
     void *_newPluginPrograms;
   };
@@ -354,6 +358,10 @@ struct PendingOperationItem
                        PendingOperationType type = SetAudioConverterOfflineMode)
     { _type = type; _sndFileR = sf; _audio_converter = newAudioConverter; }
 
+  // The map belongs to the file's block store.
+  PendingOperationItem(SndFileR sf, WaveBlockMap* blockMap, PendingOperationType type = SetWaveBlockMap)
+    { _type = type; _sndFileR = sf; _blockMap = blockMap; }
+
 
   PendingOperationItem(float** samples, float* new_samples, int* samples_len, int new_samples_len, 
                        PendingOperationType type = ModifyAudioSamples)
@@ -446,6 +454,11 @@ struct PendingOperationItem
    // type is SetTrackRecord, SetTrackMute, SetTrackSolo, SetTrackRecMonitor, SetTrackOff
   PendingOperationItem(Track* track, bool v, PendingOperationType type)
     { _type = type; _track = track; _boolA = v; }
+
+  // type is SetTrackFreeze or SetTrackFreezeRecFile.
+  // The file can be null, to unfreeze the track or to end the freeze render.
+  PendingOperationItem(Track* track, SndFileR freezeFile, PendingOperationType type = SetTrackFreeze)
+    { _type = type; _track = track; _sndFileR = freezeFile; }
     
     
   PendingOperationItem(Part* part, const QString* new_name, PendingOperationType type = ModifyPartName)
@@ -492,6 +505,11 @@ struct PendingOperationItem
   PendingOperationItem(Part* part, const Event& ev, int v, PendingOperationType type)
     { _type = type; _part = part; _ev = ev; _intA = v; }
 
+  // Swaps the contents of orig_event_list with new_event_list in constant time.
+  // The old contents end up in new_event_list, which is deleted in the non-RT stage.
+  PendingOperationItem(EventList* orig_event_list, EventList* new_event_list, PendingOperationType type = ModifyEventList)
+    { _type = type; _orig_event_list = orig_event_list; _event_list = new_event_list; }
+
     
   PendingOperationItem(MidiCtrlValListList* mcvll, MidiCtrlValList* mcvl, int channel, int control_num, PendingOperationType type = AddMidiCtrlValList)
     { _type = type; _mcvll = mcvll; _mcvl = mcvl; _intA = channel; _intB = control_num; }
@@ -687,6 +705,11 @@ class PendingOperationList : public std::list<PendingOperationItem>
     bool removePartPortCtrlEvents(const Event& event, Part* part, Track* track);
     void removePartPortCtrlEvents(Part* part, Track* track);
     void modifyPartPortCtrlEvents(const Event& old_event, const Event& event, Part* part);
+    // Updates the cached controller values of the part for the controller events of the batch.
+    void modifyPartPortCtrlEvents(const EventBatch& batch, Part* part, bool revert);
+    // Replaces the event lists of the part and its clones with the batch applied, or with revert, undone.
+    void modifyEventBatchOperation(const EventBatch& batch, Part* part, bool revert,
+                                   bool do_port_ctrls = true, bool do_clone_port_ctrls = true);
 
     void addPartOperation(PartList *partlist, Part* part); 
     void delPartOperation(PartList *partlist, Part* part);
@@ -31,6 +31,7 @@
 
 #include <QUuid>
 #include <QString>
+#include <QByteArray>
 
 #include "pos.h"
 #include "event.h"
@@ -201,6 +202,10 @@ class Part : public PosLen {
       virtual bool closeAllEvents() { return false; };
 
       virtual void write(int, Xml&, bool isCopy = false, bool forceWavePaths = false, XmlWriteStatistics* stats = nullptr) const;
+      // The midi events in the binary form of a chunk file's event chunk.
+      QByteArray eventChunkData() const;
+      // Adds the midi events of an event chunk's data. Returns false if the data is corrupt.
+      bool readEventChunkData(const QByteArray& data);
 
       virtual void dump(int n = 0) const;
 
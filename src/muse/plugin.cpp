@@ -53,6 +53,8 @@
 #include "meter.h"
 #include "utils.h"
 #include "pluglist.h"
+#include "pluginloader.h"
+#include "plugin_bridge.h"
 #include "pluginsettings.h"
 #include "switch.h"
 #include "hex_float.h"
@@ -725,6 +727,9 @@ PluginQuirks::PluginQuirks() :
   _transportAffectsAudioLatency(false),
   _overrideReportedLatency(false),
   _latencyOverrideValue(0),
+  _serialLoad(false),
+  _runInBridge(false),
+  _blockRateControls(false),
   _fixNativeUIScaling(NatUISCaling::GLOBAL)
   { }
 
@@ -737,7 +742,8 @@ void PluginQuirks::write(int level, Xml& xml) const
       {
       // Defaults? Nothing to save.
       if(!_fixedSpeed && !_transportAffectsAudioLatency && !_overrideReportedLatency
-              && _latencyOverrideValue == 0 && _fixNativeUIScaling == NatUISCaling::GLOBAL)
+              && _latencyOverrideValue == 0 && !_serialLoad && !_runInBridge
+              && !_blockRateControls && _fixNativeUIScaling == NatUISCaling::GLOBAL)
         return;
 
       xml.tag(level++, "quirks");
@@ -754,6 +760,15 @@ void PluginQuirks::write(int level, Xml& xml) const
       if(_latencyOverrideValue != 0)
         xml.intTag(level, "latOvrVal", _latencyOverrideValue);
 
+      if(_serialLoad)
+        xml.intTag(level, "serialLoad", _serialLoad);
+
+      if(_runInBridge)
+        xml.intTag(level, "bridge", _runInBridge);
+
+      if(_blockRateControls)
+        xml.intTag(level, "blockRateCtl", _blockRateControls);
+
       if(_fixNativeUIScaling != NatUISCaling::GLOBAL)
         xml.intTag(level, "fixNatUIScal", _fixNativeUIScaling);
 
@@ -783,6 +798,12 @@ bool PluginQuirks::read(Xml& xml)
                               _overrideReportedLatency = xml.parseInt();
                         else if (tag == "latOvrVal")
                               _latencyOverrideValue = xml.parseInt();
+                        else if (tag == "serialLoad")
+                              _serialLoad = xml.parseInt();
+                        else if (tag == "bridge")
+                              _runInBridge = xml.parseInt();
+                        else if (tag == "blockRateCtl")
+                              _blockRateControls = xml.parseInt();
                         else if (tag == "fixNatUIScal")
                               _fixNativeUIScaling = (NatUISCaling)xml.parseInt();
                         else
@@ -2016,6 +2037,7 @@ Pipeline::Pipeline(const Pipeline& p, AudioTrack* t)
         }
         push_back(nullptr); // No plugin. Initialize with NULL.
       }
+      updateBridges();
       }
 
 //---------------------------------------------------------
@@ -2211,6 +2233,54 @@ void Pipeline::removeAll()
             remove(i);
       }
 
+//---------------------------------------------------------
+//   updateBridges
+//---------------------------------------------------------
+
+void Pipeline::updateBridges()
+      {
+#ifdef PLUGIN_BRIDGE_SUPPORT
+      std::vector<PluginBridge*> unused;
+      int i = 0;
+      while (i < MusECore::PipelineDepth) {
+            // The run of plugins from here which want a bridge.
+            std::vector<PluginI*> chain;
+            for (int k = i; k < MusECore::PipelineDepth && (*this)[k] && (*this)[k]->wantsBridge(); ++k)
+                  chain.push_back((*this)[k]);
+            if (chain.empty()) {
+                  PluginI* p = (*this)[i];
+                  PluginBridge* old = p ? p->setBridge(nullptr) : nullptr;
+                  if (old)
+                        unused.push_back(old);
+                  ++i;
+                  continue;
+                  }
+
+            // Keep a bridge which was given up, rather than start it again and again.
+            PluginBridge* bridge = chain.front()->bridge();
+            if (bridge && bridge->isChain(chain)) {
+                  if (bridge->failed())
+                        fprintf(stderr, "Pipeline::updateBridges: the bridge of %s was late %lu times, running in-process\n",
+                          chain.front()->name().toLocal8Bit().constData(), bridge->missCount());
+                  }
+            else
+                  bridge = PluginBridge::create(chain);
+
+            for (PluginI* p : chain)
+                  if (PluginBridge* old = p->setBridge(bridge))
+                        unused.push_back(old);
+            i += chain.size();
+            }
+
+      if (!unused.empty()) {
+            // Wait until the audio thread is done with them.
+            MusEGlobal::audio->msgAudioWait();
+            for (PluginBridge* bridge : unused)
+                  delete bridge;
+            }
+#endif
+      }
+
 // Returns the first plugin instance with the given name found in the rack.
 // TODO: Embellish these with more arguments.
 // Otherwise they are not very useful except for the one place calling them,
@@ -2564,6 +2634,24 @@ void Pipeline::apply(unsigned pos, unsigned long ports, unsigned long nframes, b
               continue;
 
             const float corr_offset = latency_corr_offsets[i];
+
+#ifdef PLUGIN_BRIDGE_SUPPORT
+            // A chain of bridged plugins runs in one host, a cycle behind. The plugins
+            //  only hand it their controls, then the chain takes this cycle's audio and
+            //  gives back the last one's. If the host is late they run in-process.
+            PluginBridge* bridge = p->bridge();
+            if (bridge && bridge->matches(*this, i, ports) && bridge->collect())
+            {
+                  float** buf = swap ? buffer : buffer1;
+                  const int stages = bridge->stages();
+                  for (int k = 0; k < stages; ++k)
+                        (*this)[i + k]->apply(pos, nframes, ports, wantActive, buf, buf, latency_corr_offsets[i + k]);
+                  bridge->post(nframes, ports, wantActive ? buf : nullptr);
+                  i += stages - 1;
+                  continue;
+            }
+#endif
+
             // If the plugin has a bypass control we let it run so it can do the pass-through,
             //  where bypass can be smoother (anti-zipper) than our simpler on/off scheme,
             //  and we manipulate the bypass control in the plugin's apply method.
@@ -2822,7 +2910,8 @@ void PluginIBase::savedNativeGeometry(int *x, int *y, int *w, int *h) const
       
 const PluginQuirks& PluginIBase::cquirks() const { return _quirks; }
 PluginQuirks& PluginIBase::quirks() { return _quirks; }
-void PluginIBase::setQuirks(const PluginQuirks& q) { _quirks = q; }
+void PluginIBase::setQuirks(const PluginQuirks& q) { _quirks = q; quirksChanged(); }
+void PluginIBase::quirksChanged() { }
 bool PluginIBase::setCustomData(const std::vector<QString> &) { return false; /* Do nothing by default */}
 MusEGui::PluginGui* PluginIBase::gui() const { return _gui; }
 void PluginIBase::showNativeGui() { _showNativeGuiPending = false; }
@@ -3034,6 +3123,9 @@ void PluginI::init()
       _showGuiPending = false;
       _showNativeGuiPending = false;
       _isFakeName = false;
+      _bridge = nullptr;
+      _cycleSlices = 0;
+      _maxCycleSlices = 0;
       }
 
 PluginI::PluginI() : PluginIBase()
@@ -3056,7 +3148,15 @@ PluginI::~PluginI()
       _oscif.oscSetPluginI(nullptr);
       #endif
 
-      if (_plugin) {
+      #ifdef PLUGIN_BRIDGE_SUPPORT
+      // Out of the rack by now, so the audio thread no longer reaches the
+      //  bridge through it. Nor through the rest of the chain if none is left.
+      if (PluginBridge* bridge = setBridge(nullptr))
+            delete bridge;
+      #endif
+
+      // No handles yet if it was dropped while its song was loading, before the loader instantiated it.
+      if (_plugin && handle) {
             deactivate();
             cleanup();
             release();
@@ -3149,6 +3249,13 @@ void PluginI::setChannels(int c)
       if (ni == instances)
             return;
 
+      // Not instantiated yet while its song is loading. The loader creates the instances.
+      if(!handle)
+      {
+        instances = ni;
+        return;
+      }
+
       LADSPA_Handle* handles = new LADSPA_Handle[ni];
 
       if(ni > instances)
@@ -3446,6 +3553,20 @@ PluginI* PluginI::createPluginI(const PluginConfiguration &config, int channels,
 //---------------------------------------------------------
 
 bool PluginI::initPluginInstance(Plugin* plug, int c, const QString& name)
+      {
+      if(preparePluginInstance(plug, c, name) || instantiatePluginInstance())
+        return true;
+      connectPluginInstance();
+      return false;
+      }
+
+//---------------------------------------------------------
+//   preparePluginInstance
+//    Picks the name and the number of instances.
+//    return true on error
+//---------------------------------------------------------
+
+bool PluginI::preparePluginInstance(Plugin* plug, int c, const QString& name)
       {
       _plugin = plug;
 
@@ -3558,6 +3679,16 @@ bool PluginI::initPluginInstance(Plugin* plug, int c, const QString& name)
       else
         instances = 1;
 
+      return false;
+      }
+
+//---------------------------------------------------------
+//   instantiatePluginInstance
+//    return true on error
+//---------------------------------------------------------
+
+bool PluginI::instantiatePluginInstance()
+      {
       handle = new LADSPA_Handle[instances];
       for(int i = 0; i < instances; ++i)
         handle[i]=nullptr;
@@ -3573,6 +3704,16 @@ bool PluginI::initPluginInstance(Plugin* plug, int c, const QString& name)
           return true;
       }
 
+      return false;
+      }
+
+//---------------------------------------------------------
+//   connectPluginInstance
+//    Sets up and connects the ports of the instances.
+//---------------------------------------------------------
+
+void PluginI::connectPluginInstance()
+      {
       unsigned long ports = _plugin->ports();
 
       controlPorts = 0;
@@ -3701,26 +3842,31 @@ bool PluginI::initPluginInstance(Plugin* plug, int c, const QString& name)
           }
         }
 #endif
-
-      return false;
       }
 
 //---------------------------------------------------------
-//   initPluginInstance
-//    return true on error
+//   findInitialPlugin
 //---------------------------------------------------------
 
-bool PluginI::initPluginInstance(int channels, const QString& name)
+Plugin* PluginI::findInitialPlugin() const
 {
   // If no plugin type was given, search all types. Type tag was added in song file version 4.
   MusEPlugin::PluginTypes_t types = _initConfig._pluginType;
   if(_initConfig._pluginType == MusEPlugin::PluginTypeNone)
     types = MusEPlugin::PluginTypesAll;
-  Plugin *plugin = MusEGlobal::plugins.find(types,
+  return MusEGlobal::plugins.find(types,
     _initConfig._file, _initConfig._uri, _initConfig._pluginLabel);
+}
+
+//---------------------------------------------------------
+//   initPluginInstance
+//    return true on error
+//---------------------------------------------------------
 
+bool PluginI::initPluginInstance(int channels, const QString& name)
+{
   // True on error. For persistence: Plugin can be null.
-  if(initPluginInstance(plugin, channels, name))
+  if(initPluginInstance(findInitialPlugin(), channels, name))
     // Return true for error. For persistence: Don't clear the initial configuration members.
     return true;
 
@@ -3807,6 +3953,11 @@ void PluginI::activate()
       for (int i = 0; i < instances; ++i)
             _plugin->activate(handle[i]);
       _curActiveState = true;
+
+      #ifdef PLUGIN_BRIDGE_SUPPORT
+      if (PluginBridge* bridge = _bridge.load())
+            bridge->reset(bridge->stageOf(this));
+      #endif
       }
 
 void PluginI::release() const
@@ -3827,6 +3978,21 @@ void PluginI::release() const
 //---------------------------------------------------------
 
 float PluginI::latency() const
+{
+  float l = pluginLatency();
+#ifdef PLUGIN_BRIDGE_SUPPORT
+  // A bridge chain hands back its audio one cycle late, whatever the state
+  //  of its plugins. The first plugin of the chain reports it.
+  if(const PluginBridge* bridge = _bridge.load())
+  {
+    if(bridge->usable() && bridge->stageOf(this) == 0)
+      l += MusEGlobal::segmentSize;
+  }
+#endif
+  return l;
+}
+
+float PluginI::pluginLatency() const
 {
   // Do not report any latency if the plugin is not active.
   if(!_curActiveState)
@@ -4314,8 +4480,12 @@ bool PluginI::readConfiguration(Xml& xml, bool readPreset, int channels)
 
                               if (!readPreset && _plugin == nullptr)
                               {
+                                    // While a song is loading, only prepare the plugin here.
+                                    // The loader instantiates and configures it when the song is read.
+                                    PluginLoader* loader = PluginLoader::current();
                                     // Returns true on error.
-                                    if (initPluginInstance(channels))
+                                    if (loader ? preparePluginInstance(findInitialPlugin(), channels, QString()) :
+                                                 initPluginInstance(channels))
                                     {
                                       // For persistence: Keep the custom data and parameters (don't clear them).
                                       // If the error was because there was no plugin available,
@@ -4344,6 +4514,8 @@ bool PluginI::readConfiguration(Xml& xml, bool readPreset, int channels)
                                       // Return an error.
                                       return true;
                                     }
+                                    if (loader)
+                                      return false;
                               }
 
                               // In case of reading a preset but there's no plugin,
@@ -4600,6 +4772,51 @@ void PluginI::guiHeartBeat()
 #endif
 }
 
+//---------------------------------------------------------
+//   quirksChanged
+//---------------------------------------------------------
+
+void PluginI::quirksChanged()
+{
+  // While a song loads, the loader sets up the bridges of the whole rack at the end.
+  if(_track && !PluginLoader::busy())
+    _track->efxPipe()->updateBridges();
+}
+
+//---------------------------------------------------------
+//   wantsBridge
+//---------------------------------------------------------
+
+bool PluginI::wantsBridge() const
+{
+#ifdef PLUGIN_BRIDGE_SUPPORT
+  // Not instantiated yet while a song is loading.
+  return cquirks()._runInBridge && _plugin && handle && controls && _track &&
+         pluginType() == MusEPlugin::PluginTypeLADSPA;
+#else
+  return false;
+#endif
+}
+
+//---------------------------------------------------------
+//   setBridge
+//---------------------------------------------------------
+
+PluginBridge* PluginI::setBridge(PluginBridge* bridge)
+{
+#ifdef PLUGIN_BRIDGE_SUPPORT
+  PluginBridge* old = _bridge.load();
+  if(old == bridge)
+    return nullptr;
+  if(bridge)
+    bridge->attach();
+  _bridge.store(bridge);
+  if(old && old->detach(this))
+    return old;
+#endif
+  return nullptr;
+}
+
 //---------------------------------------------------------
 //   makeGui
 //---------------------------------------------------------
@@ -4696,6 +4913,51 @@ QString PluginI::titlePrefix() const
   else return QString();
 }
 
+//---------------------------------------------------------
+//   isSteppedControl
+//---------------------------------------------------------
+
+bool PluginI::isSteppedControl(unsigned long i, const CtrlInterpolate& ci) const
+{
+  const CtrlValueType vt = ctrlValueType(i);
+  if(vt == VAL_INT || vt == VAL_BOOL || vt == VAL_ENUM ||
+     ctrlMode(i) == CtrlList::DISCRETE || ctrlIsTrigger(i))
+    return true;
+  // A discrete automation point is a jump, which the plugin would smooth away.
+  return !ci.doInterp && ci.eFrameValid && ci.eVal != ci.sVal;
+}
+
+//---------------------------------------------------------
+//   setControlRamp
+//    The plugin smooths its way from where the control is
+//     now to the value at the end of the cycle. It gets
+//     there by the end of the cycle at the latest, so the
+//     automation is applied up to one cycle early.
+//---------------------------------------------------------
+
+void PluginI::setControlRamp(unsigned long i, const CtrlList* cl, unsigned long frame, unsigned long n,
+                             const CtrlInterpolate& ci)
+{
+  CtrlRamp& r = controls[i].ramp;
+  r.cycleFrame = frame;
+  // Only the current value, or no automation.
+  if(!cl || !ci.eFrameValid)
+  {
+    r.endVal = (cl && ci.doInterp) ? cl->interpolate(frame, ci) : ci.sVal;
+    return;
+  }
+  const unsigned long end = frame + n;
+  if(end <= ci.eFrame)
+  {
+    r.endVal = ci.doInterp ? cl->interpolate(end, ci) : ci.sVal;
+    return;
+  }
+  // The cycle ends in a later segment.
+  CtrlInterpolate next;
+  cl->getPlaybackInterpolation(end, false, &next);
+  r.endVal = next.doInterp ? cl->interpolate(end, next) : next.sVal;
+}
+
 //---------------------------------------------------------
 //   apply
 //---------------------------------------------------------
@@ -4775,6 +5037,10 @@ void PluginI::apply(unsigned pos, unsigned long n,
     (usefixedrate || MusEGlobal::config.minControlProcessPeriod > n) ? n : MusEGlobal::config.minControlProcessPeriod;
   const unsigned long min_per_mask = min_per-1;   // min_per must be power of 2
 
+  // At control rate, automation is evaluated once per cycle for the controls that the
+  //  plugin smooths itself, and control FIFO items are taken at the start of the run.
+  const bool controlRate = !usefixedrate && MusEGlobal::audio->isPlaying() && cquirks()._blockRateControls;
+
   AutomationType at = AUTO_OFF;
   CtrlListList* cll = nullptr;
   ciCtrlList icl_first;
@@ -4791,6 +5057,20 @@ void PluginI::apply(unsigned pos, unsigned long n,
   const bool no_auto = !MusEGlobal::automation || at == AUTO_OFF;
   const unsigned long in_ctrls = _plugin->controlInPorts();
 
+#ifdef PLUGIN_BRIDGE_SUPPORT
+  // If the rack has collected the output of the bridge chain in this cycle,
+  //  the host runs the plugin and we only send it the controls.
+  PluginBridge* bridge = _bridge.load();
+  const int bridgeStage = bridge ? bridge->stageOf(this) : -1;
+  if(bridgeStage < 0 || !bridge->collected())
+    bridge = nullptr;
+  if(bridge)
+  {
+    bridge->setStageOn(bridgeStage, _curActiveState && !connectToDummyAudioPorts);
+    bridge->readControlOuts(bridgeStage, controlsOut, controlOutPorts);
+  }
+#endif
+
 // Diagnostics.
   //static long unsigned int prevcycle = 0;
   //static long unsigned int cycle = 0;
@@ -4925,6 +5205,7 @@ void PluginI::apply(unsigned pos, unsigned long n,
   }
 
   int cur_slice = 0;
+  unsigned int runs = 0;
   while(sample < fin_nsamp)
   {
     unsigned long slice_samps = fin_nsamp - sample;
@@ -4953,7 +5234,7 @@ void PluginI::apply(unsigned pos, unsigned long n,
         {
           if(cl && _id != -1 && (unsigned long)cl->id() == genACnum(_id, k))
           {
-            cl->getInterpolation(slice_frame, no_auto || !controls[k].enCtrl, &ci);
+            cl->getPlaybackInterpolation(slice_frame, no_auto || !controls[k].enCtrl, &ci);
             if(icl != cll->end())
               ++icl;
           }
@@ -4987,7 +5268,8 @@ void PluginI::apply(unsigned pos, unsigned long n,
             ++icl;
         }
 
-        if(!usefixedrate && MusEGlobal::audio->isPlaying())
+        const bool rampCtrl = controlRate && !isSteppedControl(k, ci);
+        if(!usefixedrate && MusEGlobal::audio->isPlaying() && !rampCtrl)
         {
           unsigned long samps = slice_samps;
           if(ci.eFrameValid)
@@ -5008,7 +5290,14 @@ void PluginI::apply(unsigned pos, unsigned long n,
         }
 
         float new_val;
-        if(ci.doInterp && cl)
+        if(rampCtrl)
+        {
+          // Once per cycle. Any later runs in this cycle are for stepped controls.
+          if(cur_slice == 0 || controls[k].ramp.cycleFrame != pos)
+            setControlRamp(k, (cl && (unsigned long)cl->id() == genACnum(_id, k)) ? cl : nullptr, pos, n, ci);
+          new_val = controls[k].ramp.endVal;
+        }
+        else if(ci.doInterp && cl)
           new_val = cl->interpolate(MusEGlobal::audio->isPlaying() ? slice_frame : pos, ci);
         else
           new_val = ci.sVal;
@@ -5056,7 +5345,7 @@ void PluginI::apply(unsigned pos, unsigned long n,
         }
         else
         {
-          putParam(k, ci.sVal);
+          putParam(k, rampCtrl ? new_val : ci.sVal);
         }
 
 #ifdef LV2_SUPPORT
@@ -5118,7 +5407,8 @@ void PluginI::apply(unsigned pos, unsigned long n,
             // Next events are for a later run in this period. (Autom took prio.)
            ((!usefixedrate && !found && !v.unique && (evframe - sample >= slice_samps))
             // Eat up events within minimum slice - they're too close.
-            || (found && !v.unique && (evframe - sample >= min_per))
+            // At control rate, eat up all events of the run.
+            || (found && !v.unique && !controlRate && (evframe - sample >= min_per))
             // Special for dssi-vst: Fixed rate and must reply to all.
             || (usefixedrate && found && v.unique && v.idx == index)))
         break;
@@ -5171,7 +5461,7 @@ void PluginI::apply(unsigned pos, unsigned long n,
       _controlFifo.remove();               // Done with the ring buffer's item. Remove it.
     }
 
-    if(found && !usefixedrate) // If a control FIFO item was found, takes priority over automation controller stream.
+    if(found && !usefixedrate && !controlRate) // If a control FIFO item was found, takes priority over automation controller stream.
       slice_samps = frame - sample;
 
     if(sample + slice_samps > n)    // Safety check.
@@ -5183,17 +5473,29 @@ void PluginI::apply(unsigned pos, unsigned long n,
     {
       if(_curActiveState)
       {
-        connect(ports, connectToDummyAudioPorts, sample, bufIn, bufOut);
-        for(int i = 0; i < instances; ++i)
-          _plugin->apply(handle[i], slice_samps, latency_corr_offset);
+#ifdef PLUGIN_BRIDGE_SUPPORT
+        if(bridge)
+          bridge->sendControls(bridgeStage, sample, controls, controlPorts);
+        else
+#endif
+        {
+          connect(ports, connectToDummyAudioPorts, sample, bufIn, bufOut);
+          for(int i = 0; i < instances; ++i)
+            _plugin->apply(handle[i], slice_samps, latency_corr_offset);
+        }
       }
 
       sample += slice_samps;
+      ++runs;
     }
 
     ++cur_slice; // Slice is done. Moving on to any next slice now...
   }
 
+  _cycleSlices.store(runs, std::memory_order_relaxed);
+  if(runs > _maxCycleSlices.load(std::memory_order_relaxed))
+    _maxCycleSlices.store(runs, std::memory_order_relaxed);
+
   // Diagnostics.
   //if(messprinted)
   //  prevcycle = cycle;
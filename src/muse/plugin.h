@@ -28,6 +28,7 @@
 #include <list>
 #include <vector>
 #include <map>
+#include <atomic>
 #include <QSet>
 #include <QMap>
 #include <QPair>
@@ -93,6 +94,7 @@ class AudioTrack;
 // class Xml;
 
 class PluginI;
+class PluginBridge;
 struct SongChangedStruct_t;
 
 //---------------------------------------------------------
@@ -291,6 +293,21 @@ class PluginList : public std::list<Plugin *> {
       PluginList();
       };
 
+//---------------------------------------------------------
+//   CtrlRamp
+//    Where the automation of a control goes during one cycle,
+//     for plugins fed at control rate. The plugin is given
+//     the end value at the start of the cycle and smooths
+//     its way there by itself.
+//---------------------------------------------------------
+
+struct CtrlRamp {
+      // The first frame of the cycle the ramp was set for.
+      unsigned long cycleFrame;
+      // The automation value at the end of that cycle.
+      float endVal;
+      };
+
 //---------------------------------------------------------
 //   Port
 //---------------------------------------------------------
@@ -313,6 +330,7 @@ struct Port {
       
       bool enCtrl;  // Enable controller stream.
       CtrlInterpolate interp;
+      CtrlRamp ramp;  // Control rate only.
       };
 
 //---------------------------------------------------------
@@ -336,6 +354,21 @@ public:
     bool _overrideReportedLatency;
     // Value to override the reported latency.
     int _latencyOverrideValue;
+    // Instantiate the plugin in the gui thread, one instance after another, when loading
+    //  a song. For plugins whose instantiation is not thread safe. Applies to all instances
+    //  of the plugin if set on any of them.
+    bool _serialLoad;
+    // Run the plugin in a separate bridge process, if it is a LADSPA plugin and bridge
+    //  support was built. Neighbours in the rack with this set share one process, which
+    //  adds one cycle of latency. It falls back to running in-process if the bridge is
+    //  too slow.
+    bool _runInBridge;
+    // The plugin smooths its own control changes. During playback its automation is
+    //  evaluated once per cycle, and the plugin gets the value at the end of the cycle
+    //  to move to. So automation is applied up to one cycle early, less whatever the
+    //  plugin's smoothing takes. Only stepped controls still split the cycle into
+    //  shorter runs.
+    bool _blockRateControls;
 
   PluginQuirks();
 
@@ -657,6 +690,8 @@ class PluginIBase
       const PluginQuirks& cquirks() const;
       PluginQuirks& quirks();
       void setQuirks(const PluginQuirks&);
+      // Called in the gui thread after the quirks were set or edited.
+      virtual void quirksChanged();
 
       // Returns true if, among other data, there was indeed custom data.
       // This means there is, or likely is, parameter values stored with the data,
@@ -746,6 +781,9 @@ class PluginI : public PluginIBase {
     friend class VstNativeSynth;
     friend class VstNativePluginWrapper;
 #endif
+    friend class PluginLoader;
+    friend class PluginBridge;
+
       Plugin* _plugin;
       int instances;
       AudioTrack* _track;
@@ -778,7 +816,29 @@ class PluginI : public PluginIBase {
       OscEffectIF _oscif;
       #endif
 
+      // The bridge process running the instances, if any, shared with the
+      //  rest of its chain. Read by the audio thread.
+      std::atomic<PluginBridge*> _bridge;
+
+      // Runs of the plugin in the last cycle, and the most in any cycle. Written by the audio thread.
+      std::atomic<unsigned int> _cycleSlices;
+      std::atomic<unsigned int> _maxCycleSlices;
+
       void init();
+      // The latency of the plugin itself.
+      float pluginLatency() const;
+      // Finds the plugin of the initial configuration.
+      Plugin* findInitialPlugin() const;
+      // The three steps of initPluginInstance(). Only instantiatePluginInstance() may run
+      //  in another thread, for one PluginI at a time and no other PluginI of the same plugin.
+      bool preparePluginInstance(Plugin*, int channels, const QString& name);
+      bool instantiatePluginInstance();
+      void connectPluginInstance();
+      // Whether the control must split the cycle at its changes, even at control rate.
+      bool isSteppedControl(unsigned long i, const CtrlInterpolate&) const;
+      // Sets the ramp of a control for the cycle of n frames from frame: the
+      //  automation value at the end of the cycle.
+      void setControlRamp(unsigned long i, const CtrlList*, unsigned long frame, unsigned long n, const CtrlInterpolate&);
 
    protected:
       void activate();
@@ -891,6 +951,17 @@ class PluginI : public PluginIBase {
       void nativeGuiTitleAboutToChange();
       void updateNativeGuiWindowTitle();
       void guiHeartBeat();
+      void quirksChanged();
+      // Whether the plugin is to run in a bridge process, and can.
+      bool wantsBridge() const;
+      PluginBridge* bridge() const { return _bridge.load(); }
+      // Hands the plugin to a bridge, or to none. Returns the bridge it had if
+      //  no plugin holds that any more, for the caller to delete once the audio
+      //  thread is done with it.
+      PluginBridge* setBridge(PluginBridge*);
+      // Runs of the plugin in the last cycle, and the most in any cycle.
+      unsigned int cycleSlices() const { return _cycleSlices.load(std::memory_order_relaxed); }
+      unsigned int maxCycleSlices() const { return _maxCycleSlices.load(std::memory_order_relaxed); }
 
       unsigned long parameters() const;
       unsigned long parametersOut() const;
@@ -987,6 +1058,9 @@ class Pipeline : public std::vector<PluginI*> {
       void enableController(int track_ctrl_id, bool en);
       bool controllerEnabled(int track_ctrl_id);
       float latency() const;
+      // Starts, replaces or stops the bridge processes of the rack, one for each
+      //  run of neighbouring plugins which are to run in one. Gui thread only.
+      void updateBridges();
       // Returns the first plugin instance with the given name found in the rack.
       PluginI* findPlugin(const QString &);
       // Returns the first plugin instance with the given name found in the rack. Const version.
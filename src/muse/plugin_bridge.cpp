@@ -0,0 +1,439 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  plugin_bridge.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include "config.h"
+
+#ifdef PLUGIN_BRIDGE_SUPPORT
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <new>
+#include <algorithm>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <QByteArray>
+#include <QString>
+
+#include "plugin_bridge.h"
+#include "plugin_bridge_shm.h"
+#include "plugin.h"
+#include "track.h"
+#include "globals.h"
+
+extern char** environ;
+
+using MusEPlugin::PluginBridgeShm;
+using MusEPlugin::PluginBridgeStage;
+
+namespace MusECore {
+
+static_assert(PluginBridgeShm::MaxStages >= (uint32_t)PipelineDepth, "A bridge must fit a whole rack");
+
+//---------------------------------------------------------
+//   pluginBridgeProgram
+//---------------------------------------------------------
+
+static QString pluginBridgeProgram()
+{
+  const QByteArray appDir = qgetenv("APPDIR");
+  if (!appDir.isEmpty())
+      return appDir + QString(BINDIR) + QString("/muse_plugin_bridge");
+  return QString(BINDIR) + QString("/muse_plugin_bridge");
+}
+
+static void addNs(struct timespec* ts, long long ns)
+{
+  ns += ts->tv_nsec;
+  ts->tv_sec += ns / 1000000000LL;
+  ts->tv_nsec = ns % 1000000000LL;
+}
+
+// Returns false if the deadline has passed.
+static bool timeLeft(const struct timespec& deadline, struct timespec* left)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  long long ns = (long long)(deadline.tv_sec - now.tv_sec) * 1000000000LL + (deadline.tv_nsec - now.tv_nsec);
+  if(ns <= 0)
+    return false;
+  left->tv_sec = ns / 1000000000LL;
+  left->tv_nsec = ns % 1000000000LL;
+  return true;
+}
+
+//---------------------------------------------------------
+//   PluginBridge
+//---------------------------------------------------------
+
+struct timespec PluginBridge::_deadline = { 0, 0 };
+
+PluginBridge::PluginBridge()
+  : _shm(nullptr), _size(0), _pid(-1), _channels(0), _stages(0), _refs(0),
+    _pending(false), _collected(false), _outFrames(0),
+    _misses(0), _missCount(0), _failed(false)
+{
+  for(int i = 0; i < PipelineDepth; ++i)
+  {
+    _chain[i] = nullptr;
+    _instances[i] = 0;
+  }
+}
+
+PluginBridge::~PluginBridge()
+{
+  if(_shm && _pid > 0)
+  {
+    _shm->state.store(PluginBridgeShm::Quit, std::memory_order_release);
+    MusEPlugin::bridgeFutexWake(&_shm->request);
+    // Give it a second to clean up its instances.
+    int i = 0;
+    for( ; i < 100; ++i)
+    {
+      if(waitpid(_pid, nullptr, WNOHANG) != 0)
+        break;
+      usleep(10000);
+    }
+    if(i == 100)
+    {
+      kill(_pid, SIGKILL);
+      waitpid(_pid, nullptr, 0);
+    }
+  }
+  if(_shm)
+    munmap(_shm, _size);
+}
+
+//---------------------------------------------------------
+//   create
+//---------------------------------------------------------
+
+PluginBridge* PluginBridge::create(const std::vector<PluginI*>& chain)
+{
+  if(chain.empty() || chain.size() > (size_t)PipelineDepth)
+    return nullptr;
+  // Only plain LADSPA plugins for now. They need nothing but audio and controls.
+  uint32_t controlIns = 0, controlOuts = 0;
+  for(const PluginI* p : chain)
+  {
+    if(!p->plugin() || p->pluginType() != MusEPlugin::PluginTypeLADSPA || p->instances <= 0 || !p->track())
+      return nullptr;
+    controlIns += p->plugin()->controlInPorts();
+    controlOuts += p->plugin()->controlOutPorts();
+  }
+  const unsigned long channels = chain.front()->track()->channels();
+
+  static std::atomic<unsigned int> counter(0);
+  char name[64];
+  snprintf(name, sizeof(name), "/muse-bridge-%d-%u", (int)getpid(), counter++);
+
+  const size_t size = PluginBridgeShm::totalSize(MusEGlobal::segmentSize, channels, controlOuts);
+
+  const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if(fd < 0)
+  {
+    perror("PluginBridge: shm_open");
+    return nullptr;
+  }
+  if(ftruncate(fd, size) != 0)
+  {
+    perror("PluginBridge: ftruncate");
+    close(fd);
+    shm_unlink(name);
+    return nullptr;
+  }
+  void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mem == MAP_FAILED)
+  {
+    perror("PluginBridge: mmap");
+    shm_unlink(name);
+    return nullptr;
+  }
+
+  PluginBridge* bridge = new PluginBridge();
+  bridge->_size = size;
+  bridge->_channels = channels;
+  bridge->_stages = chain.size();
+  bridge->_sent.assign(controlIns, NAN);
+  PluginBridgeShm* shm = new (mem) PluginBridgeShm();
+  bridge->_shm = shm;
+
+  shm->magic = PluginBridgeShm::Magic;
+  shm->version = PluginBridgeShm::Version;
+  shm->sampleRate = MusEGlobal::sampleRate;
+  shm->maxFrames = MusEGlobal::segmentSize;
+  shm->channels = channels;
+  shm->stages = chain.size();
+  shm->controlOuts = controlOuts;
+  uint32_t cinBase = 0, coutBase = 0;
+  for(size_t i = 0; i < chain.size(); ++i)
+  {
+    PluginI* p = chain[i];
+    const Plugin* plugin = p->plugin();
+    PluginBridgeStage& st = shm->stage[i];
+    strncpy(st.libPath, plugin->filePath().toLocal8Bit().constData(), sizeof(st.libPath) - 1);
+    strncpy(st.label, plugin->label().toLocal8Bit().constData(), sizeof(st.label) - 1);
+    st.instances = p->instances;
+    st.audioIns = plugin->inports() * p->instances;
+    st.audioOuts = plugin->outports() * p->instances;
+    st.controlIns = plugin->controlInPorts();
+    st.controlOuts = plugin->controlOutPorts();
+    st.controlInBase = cinBase;
+    st.controlOutBase = coutBase;
+    cinBase += st.controlIns;
+    coutBase += st.controlOuts;
+    bridge->_chain[i] = p;
+    bridge->_instances[i] = p->instances;
+  }
+
+  const QByteArray prog = pluginBridgeProgram().toLocal8Bit();
+  char* argv[] = { const_cast<char*>(prog.constData()), name, nullptr };
+  if(posix_spawn(&bridge->_pid, prog.constData(), nullptr, nullptr, argv, environ) != 0)
+  {
+    fprintf(stderr, "PluginBridge: cannot start %s\n", prog.constData());
+    bridge->_pid = -1;
+  }
+  else
+  {
+    // Wait for the host to load the plugins.
+    const struct timespec poll = { 0, 100000000L };
+    for(int ms = 0; ms < StartTimeoutMs; ms += 100)
+    {
+      if(shm->state.load(std::memory_order_acquire) != PluginBridgeShm::Starting)
+        break;
+      if(waitpid(bridge->_pid, nullptr, WNOHANG) != 0)
+      {
+        bridge->_pid = -1;
+        break;
+      }
+      MusEPlugin::bridgeFutexWait(&shm->state, PluginBridgeShm::Starting, &poll);
+    }
+  }
+  // The host has mapped it by now, or never will.
+  shm_unlink(name);
+
+  if(shm->state.load(std::memory_order_acquire) != PluginBridgeShm::Ready)
+  {
+    fprintf(stderr, "PluginBridge: the host of %s did not start, running in-process\n",
+      chain.front()->name().toLocal8Bit().constData());
+    delete bridge;
+    return nullptr;
+  }
+  return bridge;
+}
+
+//---------------------------------------------------------
+//   isChain
+//---------------------------------------------------------
+
+bool PluginBridge::isChain(const std::vector<PluginI*>& chain) const
+{
+  if(chain.size() != (size_t)_stages || !chain.front()->track() ||
+     (unsigned long)chain.front()->track()->channels() != _channels)
+    return false;
+  for(int i = 0; i < _stages; ++i)
+  {
+    if(_chain[i].load() != chain[i] || _instances[i] != chain[i]->instances)
+      return false;
+  }
+  return true;
+}
+
+bool PluginBridge::detach(const PluginI* p)
+{
+  for(int i = 0; i < _stages; ++i)
+  {
+    if(_chain[i].load() == p)
+      _chain[i].store(nullptr);
+  }
+  return --_refs == 0;
+}
+
+int PluginBridge::stageOf(const PluginI* p) const
+{
+  for(int i = 0; i < _stages; ++i)
+  {
+    if(_chain[i].load() == p)
+      return i;
+  }
+  return -1;
+}
+
+//---------------------------------------------------------
+//   beginCycle
+//---------------------------------------------------------
+
+void PluginBridge::beginCycle(unsigned long nframes)
+{
+  clock_gettime(CLOCK_MONOTONIC, &_deadline);
+  addNs(&_deadline, (long long)nframes * 10000000LL * BudgetPercent / MusEGlobal::sampleRate);
+}
+
+void PluginBridge::miss()
+{
+  ++_missCount;
+  if(++_misses >= MaxMisses)
+    _failed = true;
+}
+
+//---------------------------------------------------------
+//   matches
+//---------------------------------------------------------
+
+bool PluginBridge::matches(const Pipeline& pipe, int idx, unsigned long ports) const
+{
+  if(_failed || ports != _channels || idx < 0 || idx + _stages > PipelineDepth)
+    return false;
+  for(int i = 0; i < _stages; ++i)
+  {
+    const PluginI* p = pipe[idx + i];
+    if(!p || p != _chain[i].load() || p->_bridge.load() != this || p->instances != _instances[i])
+      return false;
+  }
+  return true;
+}
+
+//---------------------------------------------------------
+//   collect
+//---------------------------------------------------------
+
+bool PluginBridge::collect()
+{
+  _collected = false;
+  if(_failed)
+    return false;
+
+  if(_pending)
+  {
+    const uint32_t req = _shm->request.load(std::memory_order_relaxed);
+    struct timespec left;
+    for(;;)
+    {
+      const uint32_t rep = _shm->reply.load(std::memory_order_acquire);
+      if(rep == req)
+        break;
+      if(!timeLeft(_deadline, &left))
+      {
+        miss();
+        return false;
+      }
+      MusEPlugin::bridgeFutexWait(&_shm->reply, rep, &left);
+    }
+    _pending = false;
+  }
+  _misses = 0;
+  _collected = true;
+  return true;
+}
+
+void PluginBridge::reset(int stage)
+{
+  if(stage >= 0 && stage < _stages)
+    _shm->stage[stage].resets.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void PluginBridge::setStageOn(int stage, bool on)
+{
+  if(stage >= 0 && stage < _stages)
+    _shm->stage[stage].on = on;
+}
+
+//---------------------------------------------------------
+//   sendControls
+//---------------------------------------------------------
+
+void PluginBridge::sendControls(int stage, unsigned long frame, const Port* controls, unsigned long controlPorts)
+{
+  if(stage < 0 || stage >= _stages)
+    return;
+  const PluginBridgeStage& st = _shm->stage[stage];
+  // Any left over when the ring is full go with a later run.
+  const unsigned long cins = std::min<unsigned long>(controlPorts, st.controlIns);
+  for(unsigned long k = 0; k < cins; ++k)
+  {
+    const uint32_t port = st.controlInBase + k;
+    const float v = controls[k].val;
+    if(v == _sent[port])
+      continue;
+    if(!_shm->pushControl(port, frame, v))
+      break;
+    _sent[port] = v;
+  }
+}
+
+void PluginBridge::readControlOuts(int stage, Port* controlsOut, unsigned long controlOutPorts)
+{
+  if(stage < 0 || stage >= _stages)
+    return;
+  const PluginBridgeStage& st = _shm->stage[stage];
+  const float* couts = _shm->controlOutValues() + st.controlOutBase;
+  for(unsigned long k = 0; k < controlOutPorts && k < st.controlOuts; ++k)
+    controlsOut[k].val = couts[k];
+}
+
+//---------------------------------------------------------
+//   post
+//---------------------------------------------------------
+
+void PluginBridge::post(unsigned long nframes, unsigned long ports, float** buffer)
+{
+  if(!_collected)
+    return;
+  _collected = false;
+
+  const unsigned long n = std::min<unsigned long>(nframes, _shm->maxFrames);
+  // The buffer is the input and the output. Hand the input over first.
+  for(unsigned long c = 0; c < _channels; ++c)
+  {
+    if(buffer && c < ports)
+      memcpy(_shm->audioIn(c), buffer[c], n * sizeof(float));
+    else
+      memset(_shm->audioIn(c), 0, n * sizeof(float));
+  }
+  if(buffer)
+  {
+    // Silence until the host has had a cycle.
+    const unsigned long m = std::min(n, _outFrames);
+    for(unsigned long c = 0; c < _channels && c < ports; ++c)
+    {
+      memcpy(buffer[c], _shm->audioOut(c), m * sizeof(float));
+      memset(buffer[c] + m, 0, (nframes - m) * sizeof(float));
+    }
+  }
+  _outFrames = n;
+
+  _shm->frames = n;
+  _shm->request.store(_shm->request.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  MusEPlugin::bridgeFutexWake(&_shm->request);
+  _pending = true;
+}
+
+} // namespace MusECore
+
+#endif // PLUGIN_BRIDGE_SUPPORT
@@ -0,0 +1,153 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  plugin_bridge.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PLUGIN_BRIDGE_H__
+#define __PLUGIN_BRIDGE_H__
+
+#include <atomic>
+#include <vector>
+#include <sys/types.h>
+#include <time.h>
+
+#include "globaldefs.h"
+
+namespace MusEPlugin {
+struct PluginBridgeShm;
+}
+
+namespace MusECore {
+
+class PluginI;
+class Pipeline;
+struct Port;
+
+//---------------------------------------------------------
+//   PluginBridge
+//    Runs a chain of LADSPA rack plugins in a
+//     muse_plugin_bridge process, on its own realtime
+//     thread. Consecutive plugins in a rack which are to
+//     run in a separate process share one host, which runs
+//     them in series. Audio and controls go through shared
+//     memory.
+//    The chain runs one cycle behind: the audio thread
+//     collects the last cycle's output at the start of the
+//     chain, and posts this cycle's input without waiting,
+//     so the host runs concurrently with the rest of the
+//     graph. The first plugin of the chain reports the extra
+//     cycle as latency.
+//    The audio thread waits for the host until a share of
+//     the engine cycle has passed. If it is late the
+//     plugins run their own instances for that cycle
+//     instead, and after too many late cycles in a row the
+//     bridge is given up for good.
+//    Created and deleted in the gui thread, where the
+//     plugins of the chain hold it. Everything else is for
+//     the audio thread.
+//---------------------------------------------------------
+
+class PluginBridge {
+      MusEPlugin::PluginBridgeShm* _shm;
+      size_t _size;
+      pid_t _pid;
+      unsigned long _channels;
+      int _stages;
+      // The plugins of the chain. Null once a plugin is gone.
+      std::atomic<PluginI*> _chain[PipelineDepth];
+      int _instances[PipelineDepth];
+      // Plugins holding the bridge. Gui thread only.
+      int _refs;
+      // The control values last sent, of all stages. NaN until sent once.
+      std::vector<float> _sent;
+      // A request was posted and not collected yet.
+      bool _pending;
+      // Collected in this cycle, and not posted yet.
+      bool _collected;
+      // Frames of the output the host has ready.
+      unsigned long _outFrames;
+      unsigned int _misses;
+      unsigned long _missCount;
+      std::atomic<bool> _failed;
+
+      // When the bridges must have answered in this engine cycle.
+      static struct timespec _deadline;
+
+      PluginBridge();
+      void miss();
+
+   public:
+      // Share of the cycle the audio thread waits for the bridge, in percent.
+      static constexpr int BudgetPercent = 50;
+      // Late cycles in a row after which the bridge is given up.
+      static constexpr unsigned int MaxMisses = 16;
+      // How long to wait for the host to start, in milliseconds.
+      static constexpr int StartTimeoutMs = 5000;
+
+      // Starts a host for the plugins, which follow each other in the
+      //  rack of their track. Returns null if they can not be bridged
+      //  or the host did not start.
+      static PluginBridge* create(const std::vector<PluginI*>& chain);
+      // Stops the host.
+      ~PluginBridge();
+
+      // Whether the bridge was made for these plugins, as they are now.
+      bool isChain(const std::vector<PluginI*>& chain) const;
+      void attach() { ++_refs; }
+      // The plugin no longer holds the bridge. Returns true if no plugin does.
+      bool detach(const PluginI*);
+
+      int stages() const { return _stages; }
+      // The position of the plugin in the chain, or -1.
+      int stageOf(const PluginI*) const;
+      bool usable() const { return !_failed; }
+      bool failed() const { return _failed; }
+      // Late cycles so far.
+      unsigned long missCount() const { return _missCount; }
+
+      // Sets the deadline of the bridges in this engine
+      //  cycle. Called at the start of the cycle.
+      static void beginCycle(unsigned long nframes);
+      // Whether the chain starts at this position of the rack, just as
+      //  the bridge was made for it.
+      bool matches(const Pipeline&, int idx, unsigned long ports) const;
+      // Waits for the output of the last cycle. Returns false if the
+      //  host is late. The plugins must then run in-process.
+      bool collect();
+      // Between collect() and post(). The plugins of the chain send
+      //  their controls then, instead of running.
+      bool collected() const { return _collected; }
+      // Re-activates the instances of a stage in the host.
+      void reset(int stage);
+      // Whether the stage runs in this cycle, or passes the audio through.
+      void setStageOn(int stage, bool on);
+      // Sends the controls which changed, to take effect at the frame.
+      void sendControls(int stage, unsigned long frame, const Port* controls, unsigned long controlPorts);
+      // The control outputs of the last cycle.
+      void readControlOuts(int stage, Port* controlsOut, unsigned long controlOutPorts);
+      // Hands this cycle's audio to the host, and replaces it with the
+      //  output of the last one. The buffer can be null to send silence.
+      void post(unsigned long nframes, unsigned long ports, float** buffer);
+      };
+
+} // namespace MusECore
+
+#endif
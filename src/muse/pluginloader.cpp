@@ -0,0 +1,214 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  pluginloader.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#include <stdio.h>
+#include <map>
+#include <set>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+#include "pluginloader.h"
+#include "plugin.h"
+#include "track.h"
+#include "ctrl.h"
+#include "globals.h"
+
+namespace MusECore {
+
+PluginLoader* PluginLoader::_current = nullptr;
+bool PluginLoader::_finishing = false;
+
+//---------------------------------------------------------
+//   PluginLoader
+//---------------------------------------------------------
+
+PluginLoader::PluginLoader()
+{
+  if(!_current)
+    _current = this;
+}
+
+PluginLoader::~PluginLoader()
+{
+  finish();
+}
+
+void PluginLoader::add(PluginI* plugin)
+{
+  _items.push_back(Item{plugin, false});
+}
+
+void PluginLoader::addTrack(AudioTrack* track)
+{
+  if(std::find(_tracks.cbegin(), _tracks.cend(), track) == _tracks.cend())
+    _tracks.push_back(track);
+}
+
+//---------------------------------------------------------
+//   instantiate
+//---------------------------------------------------------
+
+void PluginLoader::instantiate()
+{
+  // A plugin loads serially if any of its instances asks for it.
+  // Native VST plugins always do. They expect to be created in the gui thread,
+  //  and each instance creates a QObject driven by the gui heartbeat timer.
+  std::set<const Plugin*> serialPlugins;
+  for(const Item& it : _items)
+  {
+    if(it.plugin->initialConfiguration()._quirks._serialLoad ||
+       it.plugin->plugin()->pluginType() == MusEPlugin::PluginTypeLinuxVST)
+      serialPlugins.insert(it.plugin->plugin());
+  }
+
+  // Group the items into lanes, each created in turn by one thread.
+  // Lilv's world, which opens the LV2 libraries, is not thread safe. All LV2 plugins share a lane.
+  static const char lv2Lane = 0;
+  std::map<const void*, size_t> laneIndex;
+  std::vector<std::vector<Item*> > lanes;
+  std::vector<Item*> serial;
+  for(Item& it : _items)
+  {
+    const Plugin* p = it.plugin->plugin();
+    if(serialPlugins.find(p) != serialPlugins.end())
+    {
+      serial.push_back(&it);
+      continue;
+    }
+    const void* key = p->pluginType() == MusEPlugin::PluginTypeLV2 ? (const void*)&lv2Lane : (const void*)p;
+    std::map<const void*, size_t>::const_iterator il = laneIndex.find(key);
+    if(il == laneIndex.cend())
+    {
+      il = laneIndex.insert(std::make_pair(key, lanes.size())).first;
+      lanes.push_back(std::vector<Item*>());
+    }
+    lanes[il->second].push_back(&it);
+  }
+  // Start with the longest lanes.
+  std::stable_sort(lanes.begin(), lanes.end(),
+    [](const std::vector<Item*>& a, const std::vector<Item*>& b) { return a.size() > b.size(); });
+
+  std::atomic<size_t> nextLane(0);
+  auto work = [&lanes, &nextLane]() {
+    for(size_t l = nextLane++; l < lanes.size(); l = nextLane++)
+    {
+      for(Item* it : lanes[l])
+        it->failed = it->plugin->instantiatePluginInstance();
+    }
+  };
+
+  unsigned int threads = std::thread::hardware_concurrency();
+  if(threads == 0)
+    threads = 2;
+  threads = std::min<size_t>(std::min(threads, MaxThreads), lanes.size());
+  // The gui thread works along.
+  std::vector<std::thread> pool;
+  for(unsigned int i = 1; i < threads; ++i)
+    pool.emplace_back(work);
+  work();
+  for(std::thread& t : pool)
+    t.join();
+
+  for(Item* it : serial)
+    it->failed = it->plugin->instantiatePluginInstance();
+
+  if(MusEGlobal::debugMsg)
+    fprintf(stderr, "PluginLoader: %zu plugins in %zu lanes on %u threads, %zu serial\n",
+      _items.size(), lanes.size(), threads, serial.size());
+}
+
+//---------------------------------------------------------
+//   finish
+//---------------------------------------------------------
+
+void PluginLoader::finish()
+{
+  if(_current != this)
+    return;
+  // From here on plugins and tracks are set up right away again.
+  _current = nullptr;
+  _finishing = true;
+
+  if(!_items.empty())
+    instantiate();
+
+  for(Item& it : _items)
+  {
+    PluginI* pi = it.plugin;
+    PluginConfiguration& pic = pi->initialConfiguration();
+    if(it.failed)
+    {
+      fprintf(stderr, "Error initializing plugin instance (%s, %s, %s)\n",
+        pic._file.toLocal8Bit().constData(),
+        pic._uri.toLocal8Bit().constData(),
+        pic._pluginLabel.toLocal8Bit().constData());
+      // Take it out of the rack.
+      AudioTrack* track = pi->track();
+      const int idx = pi->id();
+      if(track && idx >= 0 && idx < MusECore::PipelineDepth && (*track->efxPipe())[idx] == pi)
+      {
+        (*track->efxPipe())[idx] = nullptr;
+        // The track took over its controllers and midi assignments when it was read.
+        //  Remove them as well. Mapping the track below would otherwise move a plugin
+        //  from a lower slot into this one, and drop that plugin's own controllers.
+        CtrlListList* cll = track->controller();
+        const int end_id = genACnum(idx + 1, 0);
+        for(iCtrlList icl = cll->lower_bound(genACnum(idx, 0)); icl != cll->end() && icl->first < end_id; )
+        {
+          CtrlList* cl = icl->second;
+          ++icl;
+          track->removeController(cl->id());
+          delete cl;
+        }
+      }
+      delete pi;
+      continue;
+    }
+
+    pi->connectPluginInstance();
+
+    // Like PluginI::readConfiguration() when not loading a song.
+    pic._fileVerMaj = pic._fileVerMin = -1;
+    pi->configure(PluginIBase::ConfigAll);
+    pic._initParams.clear();
+    pic._accumulatedCustomParams.clear();
+  }
+
+  // The tracks were already added to the song, so the guis can find their plugins.
+  for(AudioTrack* track : _tracks)
+  {
+    track->mapRackPluginsToControllers();
+    track->showPendingPluginGuis();
+  }
+
+  // Each rack starts its bridges in one go, now that all its plugins are configured.
+  _finishing = false;
+  for(AudioTrack* track : _tracks)
+    track->efxPipe()->updateBridges();
+
+  _items.clear();
+  _tracks.clear();
+}
+
+} // namespace MusECore
@@ -0,0 +1,87 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  pluginloader.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __PLUGINLOADER_H__
+#define __PLUGINLOADER_H__
+
+#include <vector>
+
+namespace MusECore {
+
+class PluginI;
+class AudioTrack;
+
+//---------------------------------------------------------
+//   PluginLoader
+//    While a song is read, its rack plugins are only
+//     prepared, and the tracks do not map them to their
+//     controllers yet. When the song has been read, the
+//     loader instantiates all the plugins at once on a pool
+//     of threads, then connects and configures them, maps
+//     the tracks and starts the bridge processes of the racks
+//     in the gui thread, in one go before the sequencer starts
+//     again.
+//    The instances of one plugin, and all LV2 plugins, are
+//     created one after another by the same thread. Native
+//     VST plugins and plugins with the serial load quirk are
+//     created in the gui thread after all others.
+//    Gui thread only. One loader at a time.
+//---------------------------------------------------------
+
+class PluginLoader {
+      struct Item {
+            PluginI* plugin;
+            bool failed;
+            };
+
+      std::vector<Item> _items;
+      std::vector<AudioTrack*> _tracks;
+
+      static PluginLoader* _current;
+      static bool _finishing;
+
+      void instantiate();
+
+   public:
+      // Most threads used to instantiate, including the gui thread.
+      static constexpr unsigned int MaxThreads = 8;
+
+      PluginLoader();
+      // Finishes, if not done yet.
+      ~PluginLoader();
+
+      // The loader of the song being read, or null.
+      static PluginLoader* current() { return _current; }
+      // From reading the song until its plugins are set up.
+      static bool busy() { return _current || _finishing; }
+
+      // The plugin must be in the rack of its track.
+      void add(PluginI*);
+      void addTrack(AudioTrack*);
+      // Instantiates and configures the plugins, maps the tracks, and ends loading.
+      void finish();
+      };
+
+} // namespace MusECore
+
+#endif
@@ -46,6 +46,7 @@
 #include "ctrl.h"
 #include "globals.h"
 #include "metronome_class.h"
+#include "audio_graph.h"
 #include "undo.h"
 
 namespace MusECore {
@@ -279,6 +280,11 @@ void Audio::msgSetChannels(AudioTrack* node, int n)
       msg.snode = node;
       msg.ival  = n;
       sendMsg(&msg);
+
+      // The rack plugins may have a different number of instances now.
+      Pipeline* pl = node->efxPipe();
+      if (pl)
+            pl->updateBridges();
       }
 
 //---------------------------------------------------------
@@ -749,9 +755,10 @@ void Audio::msgSetSendMetronome(AudioTrack* track, bool b)
 //---------------------------------------------------------
 //   msgBounce
 //    start bounce operation
+//    forceFreewheel: Use freewheel mode regardless of the config.
 //---------------------------------------------------------
 
-void Audio::msgBounce()
+void Audio::msgBounce(bool forceFreewheel)
       {
       if (!MusEGlobal::checkAudioDevice()) return;
 
@@ -775,7 +782,7 @@ void Audio::msgBounce()
       _bounceState = BounceStart;
       
 // REMOVE Tim. latency. Added. Moved here from audio thread process code (via Song::seqSignal()).
-      if(MusEGlobal::config.freewheelMode)
+      if(forceFreewheel || MusEGlobal::config.freewheelMode)
       {
         MusEGlobal::audioDevice->setFreewheel(true);
         // Wait a few cycles for the freewheel to take effect.
@@ -804,6 +811,9 @@ void Audio::msgIdle(bool on)
       msg.id = SEQM_IDLE;
       msg.a  = on;
       sendMessage(&msg, false);
+      // Structures may have been edited while idle. Rebuild the audio graph.
+      if(!on && MusEGlobal::audioGraph)
+            MusEGlobal::audioGraph->rebuild();
       }
 
 //---------------------------------------------------------
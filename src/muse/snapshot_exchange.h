@@ -0,0 +1,126 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  snapshot_exchange.h
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+#ifndef __SNAPSHOT_EXCHANGE_H__
+#define __SNAPSHOT_EXCHANGE_H__
+
+#include <atomic>
+
+namespace MusECore {
+
+//---------------------------------------------------------
+//   SnapshotExchange
+//    Hands read-only snapshots of a container from the GUI
+//     thread to the audio thread without locking.
+//    The GUI thread builds snapshots and hands them over
+//     through _pending. The audio thread takes them at its
+//     next lookup and hands the old one back through
+//     _retired, for the GUI thread to delete.
+//    The container bumps the serial number whenever its
+//     items change. A snapshot is only used while its
+//     _serial member equals it.
+//    Copies start out without a snapshot.
+//---------------------------------------------------------
+
+template <typename T> class SnapshotExchange {
+      // Bumped whenever the container's items change.
+      std::atomic<unsigned int> _serial;
+      // Audio thread only.
+      T* _current;
+      std::atomic<T*> _pending;
+      std::atomic<T*> _retired;
+      // GUI thread only. The last published snapshot. It is one of the above,
+      //  and it is only deleted after a newer one was published.
+      T* _published;
+
+   public:
+      SnapshotExchange()
+        : _serial(1), _current(nullptr), _pending(nullptr), _retired(nullptr), _published(nullptr) { }
+      SnapshotExchange(const SnapshotExchange&)
+        : _serial(1), _current(nullptr), _pending(nullptr), _retired(nullptr), _published(nullptr) { }
+      ~SnapshotExchange()
+      {
+        delete _current;
+        delete _pending.load();
+        delete _retired.load();
+      }
+      SnapshotExchange& operator=(const SnapshotExchange&)
+      {
+        // The items were replaced. Keep our own snapshots but mark them out of date.
+        invalidate();
+        return *this;
+      }
+
+      // Marks the snapshots as out of date.
+      void invalidate() { _serial.fetch_add(1, std::memory_order_release); }
+      unsigned int serial() const { return _serial.load(std::memory_order_acquire); }
+
+      // GUI thread only. Deletes any snapshot handed back by the audio thread.
+      //  Returns true if a new snapshot is needed, with the serial number to
+      //  build it for.
+      bool needsUpdate(unsigned int* serial)
+      {
+        delete _retired.exchange(nullptr, std::memory_order_acq_rel);
+        *serial = _serial.load(std::memory_order_acquire);
+        return !_published || _published->_serial != *serial;
+      }
+      // GUI thread only. Publishes a snapshot built for the serial
+      //  number given by needsUpdate(), and takes ownership of it.
+      void publish(T* s, unsigned int serial)
+      {
+        s->_serial = serial;
+        _published = s;
+        // Replace any snapshot which the audio thread has not taken yet.
+        delete _pending.exchange(s, std::memory_order_acq_rel);
+      }
+      // GUI thread only. The last published snapshot. Null if there is none.
+      const T* published() const { return _published; }
+
+      // Audio thread only. Takes any newly published snapshot, as long as the
+      //  previous one can be handed back. Returns the current snapshot, or null
+      //  while it is not up to date. Sets taken if a new one was taken.
+      const T* take(bool* taken = nullptr)
+      {
+        if(taken)
+          *taken = false;
+        if(_pending.load(std::memory_order_relaxed) && !_retired.load(std::memory_order_acquire))
+        {
+          T* s = _pending.exchange(nullptr, std::memory_order_acq_rel);
+          if(s)
+          {
+            if(_current)
+              _retired.store(_current, std::memory_order_release);
+            _current = s;
+            if(taken)
+              *taken = true;
+          }
+        }
+        if(!_current || _current->_serial != _serial.load(std::memory_order_acquire))
+          return nullptr;
+        return _current;
+      }
+      };
+
+} // namespace MusECore
+
+#endif
@@ -24,6 +24,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <errno.h>
+#include <algorithm>
 //#include <iostream>
 
 #include <QDir>
@@ -74,10 +75,14 @@
 #include "marker/marker.h"
 #include "route.h"
 #include "audio.h"
+#include "audioprefetch.h"
 #include "midiport.h"
 #include "audiodev.h"
 #include "synthdialog.h"
 #include "plugin.h"
+#include "audio_graph.h"
+#include "peak_builder.h"
+#include "wave_helper.h"
 
 // For debugging output: Uncomment the fprintf section.
 #define ERROR_TIMESTRETCH(dev, format, args...)  fprintf(dev, format, ##args)
@@ -121,6 +126,7 @@ Song::Song(const char* name)
 
       undoList     = new UndoList(true);  // "true" means "this is an undoList",
       redoList     = new UndoList(false); // "false" means "redoList"
+      _undoMemory  = 0;
       _markerList  = new MarkerList;
       _globalPitchShift = 0;
       bounceTrack = nullptr;
@@ -3146,6 +3152,9 @@ void Song::cmdAddRecordedWave(MusECore::WaveTrack* track, MusECore::Pos s, MusEC
         }
       }
 
+      // Wait for the record writer thread, if used, to write the rest.
+      track->finishRecordStream();
+
       // It should now be safe to work with the resultant sndfile here in the GUI thread.
       // No other thread should be touching it right now.
       MusECore::SndFileR f = track->recFile();
@@ -3710,6 +3719,9 @@ void Song::update(MusECore::SongChangedStruct_t flags, bool allowRecursion)
                    "                          probably cause windows being not up-to-date.\n", (long unsigned int) flags.flagsHi(), (long unsigned int) flags.flagsLo(), level);
             return;
             }
+      // Rebuild the audio graph if the track or route structure may have changed.
+      if(MusEGlobal::audioGraph && (flags & (SC_TRACK_INSERTED | SC_TRACK_REMOVED | SC_ROUTE | SC_AUX)))
+            MusEGlobal::audioGraph->rebuild();
       ++level;
       emit songChanged(flags);
       --level;
@@ -3798,7 +3810,7 @@ void Song::dumpMaster()
       }
 
 
-void Song::normalizePart(MusECore::Part *part)
+void Song::normalizePart(MusECore::Part *part, Undo& operations)
 {
    const MusECore::EventList& evs = part->events();
    for(MusECore::ciEvent it = evs.begin(); it != evs.end(); ++it)
@@ -3810,79 +3822,44 @@ void Song::normalizePart(MusECore::Part *part)
       if(file.isNull())
         continue;
 
-      QString tmpWavFile;
-      if (!MusEGlobal::getUniqueTmpfileName("tmp_musewav",".wav", tmpWavFile))
-      {
-         return;
-      }
-
-      MusEGlobal::audio->msgIdle(true); // Not good with playback during operations
-      
-      MusECore::SndFile tmpFile(tmpWavFile);
-      unsigned int file_channels = file.channels();
-      tmpFile.setFormat(file.format(), file_channels, file.samplerate());
-      if (tmpFile.openWrite())
-      {
-         MusEGlobal::audio->msgIdle(false);
-         fprintf(stderr, "Could not open temporary file...\n");
-         return;
-      }
-      float*   tmpdata[file_channels];
-      unsigned tmpdatalen = file.samples();
-      for (unsigned i=0; i<file_channels; i++)
-      {
-         tmpdata[i] = new float[tmpdatalen];
-      }
-      file.seek(0, 0);
-      file.readWithHeap(file_channels, tmpdata, tmpdatalen);
-      file.close();
-      tmpFile.write(file_channels, tmpdata, tmpdatalen, MusEGlobal::config.liveWaveUpdate);
-      tmpFile.close();
-
-      float loudest = 0.0;
-      for (unsigned i=0; i<file_channels; i++)
+      // Each file is normalized once, even if several events use it.
+      bool done = false;
+      for(const UndoOp& op : operations)
       {
-         for (unsigned j=0; j<tmpdatalen; j++)
+         if(op.type == UndoOp::ModifyWaveBlocks && op._blockFile->canonicalPath() == file.canonicalPath())
          {
-            if (tmpdata[i][j]  > loudest)
-            {
-               loudest = tmpdata[i][j];
-            }
-         }
-      }
-
-      double scale = 0.99 / (double)loudest;
-      for (unsigned i=0; i<file_channels; i++)
-      {
-         for (unsigned j=0; j<tmpdatalen; j++)
-         {
-            tmpdata[i][j] = (float) ((double)tmpdata[i][j] * scale);
+            done = true;
+            break;
          }
       }
+      if(done)
+        continue;
 
-      file.openWrite();
-      file.seek(0, 0);
-      file.write(file_channels, tmpdata, tmpdatalen, MusEGlobal::config.liveWaveUpdate);
-      file.update();
-      file.close();
-      file.openRead();
+      if(!sndFileEnsureBlockStore(file))
+        return;
 
-      for (unsigned i=0; i<file_channels; i++)
+      // The edit goes into new blocks of the file, one block at a time.
+      const sf_count_t len = file.samples();
+      MusECore::WaveBlockMap* map = file.newBlockMap();
+      const float loudest = sndFileBlocksLoudest(file, map, 0, len);
+      if(loudest <= 0.0)
+        continue;
+      if(!sndFileBlocksGain(file, map, 0, len, 0.99 / (double)loudest))
       {
-         delete[] tmpdata[i];
+         fprintf(stderr, "Could not write edited blocks of %s\n", file.canonicalPath().toLocal8Bit().constData());
+         return;
       }
 
       // Undo handling
-      MusEGlobal::song->cmdChangeWave(ev, tmpWavFile, 0, tmpdatalen);
-      MusEGlobal::audio->msgIdle(false); // Not good with playback during operations
-      //sf.update();
+      operations.push_back(UndoOp(UndoOp::ModifyWaveBlocks, file, file.blockMap(), map));
    }
 }
 
 void Song::normalizeWaveParts(Part *partCursor)
 {
    MusECore::TrackList* tracks=MusEGlobal::song->tracks();
-   bool undoStarted = false;
+   Undo operations;
+   bool partSelected = false;
    for (MusECore::TrackList::const_iterator t_it=tracks->begin(); t_it!=tracks->end(); t_it++)
    {
       if((*t_it)->type() != MusECore::Track::WAVE)
@@ -3894,28 +3871,19 @@ void Song::normalizeWaveParts(Part *partCursor)
       {
          if (p_it->second->selected())
          {
-            MusECore::Part* part = p_it->second;
-            if(!undoStarted)
-            {
-               undoStarted = true;
-               MusEGlobal::song->startUndo();
-            }
-
-            normalizePart(part);
-
+            partSelected = true;
+            normalizePart(p_it->second, operations);
          }
       }
    }
    //if nothing selected, normilize current part under mouse (if given)
-   if(!undoStarted && partCursor)
+   if(!partSelected && partCursor)
    {
-      undoStarted = true;
-      MusEGlobal::song->startUndo();
-      normalizePart(partCursor);
+      normalizePart(partCursor, operations);
    }
-   if(undoStarted)
+   if(!operations.empty())
    {
-      MusEGlobal::song->endUndo(SC_CLIP_MODIFIED);
+      MusEGlobal::song->applyOperationGroup(operations);
    }
 }
 
@@ -3967,6 +3935,29 @@ void Song::beat()
       for(ciTrack it = _tracks.begin(); it != _tracks.end(); ++it)
         (*it)->guiHeartBeat();
 
+      // Hand the audio thread fresh snapshots of any automation lists which changed.
+      for(ciTrack it = _tracks.begin(); it != _tracks.end(); ++it)
+      {
+        if(!(*it)->isMidiTrack())
+          static_cast<AudioTrack*>(*it)->controller()->updateSnapshots();
+      }
+
+      // Likewise for the events of midi parts.
+      for(ciMidiTrack it = _midis.begin(); it != _midis.end(); ++it)
+      {
+        const PartList* pl = (*it)->cparts();
+        for(ciPart ip = pl->begin(); ip != pl->end(); ++ip)
+          ip->second->events().updateSnapshot();
+      }
+
+      // And for the controller value caches of the midi ports, used when seeking.
+      for(int i = 0; i < MIDI_PORTS; ++i)
+        MusEGlobal::midiPorts[i].controller()->updateIndexes();
+
+      // Let waveform views draw any peaks which were built in the background since last time.
+      if(PeakBuilder::takeChanged())
+        update(SC_WAVE_PEAKS);
+
       enum {
         RTM_NONE,
         RTM_STOP,
@@ -4597,11 +4588,31 @@ void Song::endMsgCmd()
             
             if(MusEGlobal::redoAction)
               MusEGlobal::redoAction->setEnabled(false);
+            packUndoHistory();
             setUndoRedoText();
             emit songChanged(updateFlags);
             }
       }
 
+//---------------------------------------------------------
+//   packUndoHistory
+//---------------------------------------------------------
+
+void Song::packUndoHistory()
+      {
+      undoList->pack();
+      redoList->pack();
+      const size_t redoMemory = redoList->memoryUsage();
+      if (MusEGlobal::config.undoMemoryLimit > 0) {
+            const size_t limit = size_t(MusEGlobal::config.undoMemoryLimit) * 1024 * 1024;
+            // Forget the oldest undo steps first. The redo steps are only forgotten
+            //  if they alone are beyond the limit.
+            undoList->trim(limit - std::min(limit, redoMemory));
+            redoList->trim(limit - std::min(limit, undoList->memoryUsage()));
+            }
+      _undoMemory = undoList->memoryUsage() + redoList->memoryUsage();
+      }
+
 //---------------------------------------------------------
 //   undo
 //---------------------------------------------------------
@@ -4619,10 +4630,15 @@ void Song::undo()
       if (opGroup.empty())
             return;
       
+      opGroup.unpack();
       MusEGlobal::audio->msgRevertOperationGroup(opGroup);
       
       redoList->push_back(opGroup);
       undoList->pop_back();
+      // Keep the step which may be added to or undone next unpacked.
+      if(!undoList->empty())
+        undoList->back().unpack();
+      packUndoHistory();
 
       if(MusEGlobal::redoAction)
         MusEGlobal::redoAction->setEnabled(true);
@@ -4651,10 +4667,14 @@ void Song::redo()
       if (opGroup.empty())
             return;
       
+      opGroup.unpack();
       MusEGlobal::audio->msgExecuteOperationGroup(opGroup);
       
       undoList->push_back(opGroup);
       redoList->pop_back();
+      if(!redoList->empty())
+        redoList->back().unpack();
+      packUndoHistory();
       
       if(MusEGlobal::undoAction)
         MusEGlobal::undoAction->setEnabled(true);
@@ -4800,6 +4820,7 @@ void Song::clear(bool signal, bool clear_all)
 
       undoList->clearDelete();
       redoList->clearDelete();
+      _undoMemory = 0;
       if(MusEGlobal::undoAction)
         MusEGlobal::undoAction->setEnabled(false);
       if(MusEGlobal::redoAction)
@@ -4986,6 +5007,8 @@ void Song::seqSignal(int fd)
                         break;
                   case '1':         // PLAY
                         do_set_sync_timeout = true;
+                        // The prefetch counters cover one run of the transport.
+                        MusEGlobal::audioPrefetch->resetStats();
                         setStopPlay(true);
                         break;
                   case '2':   // record
@@ -142,6 +142,8 @@ class Song : public QObject {
 
       UndoList* undoList;
       UndoList* redoList;
+      // Rough memory held by the undo and redo lists, as of the last change to them.
+      size_t _undoMemory;
       // New items created in GUI thread awaiting addition in audio thread.
       PendingOperationList pendingOperations;
       
@@ -222,7 +224,7 @@ class Song : public QObject {
 
       void checkSongSampleRate();
       
-      void normalizePart(MusECore::Part *part);
+      void normalizePart(MusECore::Part *part, Undo& operations);
 
       // Fills operations if given, otherwise creates and executes its own operations list.
       void processTrackAutomationEvents(AudioTrack *atrack, Undo* operations = 0);
@@ -621,6 +623,9 @@ class Song : public QObject {
 
       void addUndo(UndoOp i);
       void setUndoRedoText();
+      // Packs the older undo steps, and forgets the oldest ones beyond the configured undo memory limit.
+      void packUndoHistory();
+      size_t undoMemoryUsage() const { return _undoMemory; }
 
       // Returns true if audio controller move mode has begun (a BeginAudioCtrlMoveMode command was run).
       bool audioCtrlMoveModeBegun() const;
@@ -29,6 +29,7 @@
 #include <QMessageBox>
 #include <QCheckBox>
 #include <QString>
+#include <QDataStream>
 
 #include "app.h"
 #include "song.h"
@@ -42,6 +43,7 @@
 #include "scoreedit.h"
 #include "globals.h"
 #include "xml.h"
+#include "xml_chunks.h"
 #include "drummap.h"
 #include "drum_ordering.h"
 #include "event.h"
@@ -57,6 +59,7 @@
 #include "gconfig.h"
 #include "config.h"
 #include "missing_plugins.h"
+#include "pluginloader.h"
 
 // Forwards from header:
 #include "xml_statistics.h"
@@ -134,12 +137,126 @@ void Scale::read(Xml& xml)
             }
       }
 
+//---------------------------------------------------------
+//   eventChunkData
+//    Per event: u32 tick, u32 length, i32 type, i32 a, b, c,
+//    u32 data length and the data. Ticks are absolute, as in
+//    the song text.
+//---------------------------------------------------------
+
+QByteArray Part::eventChunkData() const
+      {
+      QByteArray data;
+      QDataStream s(&data, QIODevice::WriteOnly);
+      s.setByteOrder(QDataStream::LittleEndian);
+      const EventList& el = events();
+      s << quint32(el.size());
+      for (ciEvent ie = el.cbegin(); ie != el.cend(); ++ie) {
+            const Event& e = ie->second;
+            // Like the event tags, only notes and controllers keep their length.
+            const unsigned len = (e.type() == Note || e.type() == Controller) ? e.lenTick() : 0;
+            s << quint32(e.tick() + tick()) << quint32(len) << qint32(e.type())
+              << qint32(e.dataA()) << qint32(e.dataB()) << qint32(e.dataC()) << quint32(e.dataLen());
+            if (e.dataLen())
+                  s.writeRawData((const char*)e.data(), e.dataLen());
+            }
+      return data;
+      }
+
+//---------------------------------------------------------
+//   readEventChunkData
+//---------------------------------------------------------
+
+bool Part::readEventChunkData(const QByteArray& data)
+      {
+      QDataStream s(data);
+      s.setByteOrder(QDataStream::LittleEndian);
+      quint32 n = 0;
+      s >> n;
+      std::vector<unsigned char> buf;
+      for (quint32 i = 0; i < n && s.status() == QDataStream::Ok; ++i) {
+            quint32 tick, len, dataLen;
+            qint32 type, a, b, c;
+            s >> tick >> len >> type >> a >> b >> c >> dataLen;
+            if (s.status() != QDataStream::Ok || type == Wave)
+                  return false;
+            buf.resize(dataLen);
+            if (dataLen && s.readRawData((char*)buf.data(), dataLen) != (int)dataLen)
+                  return false;
+            Event e((EventType)type);
+            e.setTick(tick);
+            e.setLenTick(len);
+            e.setA(a);
+            e.setB(b);
+            e.setC(c);
+            if (dataLen)
+                  e.setData(buf.data(), dataLen);
+            // Stored ticks are absolute, as for the event tags.
+            e.setPosValue(e.posValue() - posValue(e.pos().type()));
+            addEvent(e);
+            }
+      return s.status() == QDataStream::Ok;
+      }
+
+//---------------------------------------------------------
+//   writeEventChunk
+//    Writes the midi events of a part to a chunk of a chunk
+//    file, and a reference to the chunk to the song text.
+//---------------------------------------------------------
+
+static void writeEventChunk(int level, Xml& xml, const Part* part)
+      {
+      const int idx = xml.chunkWriter()->add(XmlEventChunk, 1, part->eventChunkData());
+      xml.put(level, "<events chunk=\"%d\" />", idx);
+      }
+
+//---------------------------------------------------------
+//   readEventChunk
+//    Reads the events tag of a chunk file and adds the
+//    events of the chunk to the part.
+//---------------------------------------------------------
+
+static void readEventChunk(Xml& xml, Part* part)
+      {
+      int idx = -1;
+      for (;;) {
+            Xml::Token token = xml.parse();
+            const QString& tag = xml.s1();
+            switch (token) {
+                  case Xml::Error:
+                  case Xml::End:
+                        return;
+                  case Xml::Attribut:
+                        if (tag == "chunk")
+                              idx = xml.s2().toInt();
+                        break;
+                  case Xml::TagEnd:
+                        if (tag == "events")
+                              goto events_read_end;
+                        break;
+                  default:
+                        break;
+                  }
+            }
+
+events_read_end:
+      uint32_t version = 0;
+      const QByteArray* data = xml.chunkReader() ? xml.chunkReader()->chunk(idx, XmlEventChunk, &version) : nullptr;
+      if (!data || version > 1) {
+            fprintf(stderr, "readEventChunk: no event chunk %d for part %s\n", idx, part->name().toLocal8Bit().constData());
+            return;
+            }
+      if (!part->readEventChunkData(*data))
+            fprintf(stderr, "readEventChunk: event chunk %d is corrupt\n", idx);
+      }
+
 //---------------------------------------------------------
 //   Part::readFromXml
 //---------------------------------------------------------
 
 Part* Part::readFromXml(Xml& xml, Track* track, XmlReadStatistics* stats, bool doClone, bool trackIsParent)
       {
+      XmlReadSectionTimer sectionTimer(stats, QStringLiteral("part"));
       int cloneId = -1;
       QUuid cloneUuid;
       QUuid trackUuid;
@@ -387,6 +504,14 @@ Part* Part::readFromXml(Xml& xml, Track* track, XmlReadStatistics* stats, bool d
                               else // ...Otherwise a clone was created, so we don't need the events.
                                 xml.skip(tag);
                         }
+                        else if (tag == "events")
+                        {
+                              // The events of a chunk file.
+                              if(!clone)
+                                readEventChunk(xml, npart);
+                              else
+                                xml.skip(tag);
+                        }
                         else
                               xml.unknown("readXmlPart");
                         break;
@@ -527,8 +652,12 @@ void Part::write(int level, Xml& xml, bool isCopy, bool forceWavePaths, XmlWrite
       // Otherwise another part with that clonemaster serial number has already written
       //  its events. Don't bother writing this part's events since they would be redundant.
       if ( !clonemasterIDFound ) {
-            for (ciEvent e = events().begin(); e != events().end(); ++e)
-                  e->second.write(level, xml, *this, forceWavePaths);
+            // When writing a chunk file, midi events go to a binary chunk.
+            if (midi && xml.chunkWriter())
+                  writeEventChunk(level, xml, this);
+            else
+                  for (ciEvent e = events().begin(); e != events().end(); ++e)
+                        e->second.write(level, xml, *this, forceWavePaths);
             }
       xml.etag(--level, "part");
       }
@@ -591,7 +720,34 @@ void Song::checkSongSampleRate()
 
 void Song::read(Xml& xml, bool /*isTemplate*/)
       {
+      enum SongTag { SongMaster, SongInfo, SongShowInfo, SongLoop, SongPunchin, SongPunchout,
+        SongRecord, SongSolo, SongType, SongRecMode, SongCycle, SongClick, SongQuantize, SongLen,
+        SongFollow, SongMidiDivision, SongSampleRate, SongTempoList, SongSigList, SongKeyList,
+        SongMidiTrack, SongDrumTrack, SongNewDrumTrack, SongWaveTrack, SongAudioInput,
+        SongAudioOutput, SongAudioGroup, SongAudioAux, SongSynthI, SongRoute, SongMarker,
+        SongGlobalPitchShift, SongAutomation, SongCpos, SongLpos, SongRpos, SongDrumMap,
+        SongDrumOrdering, SongMidiAssign };
+      static const XmlTagDispatch songTags {
+        { "master", SongMaster }, { "info", SongInfo }, { "showinfo", SongShowInfo },
+        { "loop", SongLoop }, { "punchin", SongPunchin }, { "punchout", SongPunchout },
+        { "record", SongRecord }, { "solo", SongSolo }, { "type", SongType },
+        { "recmode", SongRecMode }, { "cycle", SongCycle }, { "click", SongClick },
+        { "quantize", SongQuantize }, { "len", SongLen }, { "follow", SongFollow },
+        { "midiDivision", SongMidiDivision }, { "sampleRate", SongSampleRate },
+        { "tempolist", SongTempoList }, { "siglist", SongSigList }, { "keylist", SongKeyList },
+        { "miditrack", SongMidiTrack }, { "drumtrack", SongDrumTrack },
+        { "newdrumtrack", SongNewDrumTrack }, { "wavetrack", SongWaveTrack },
+        { "AudioInput", SongAudioInput }, { "AudioOutput", SongAudioOutput },
+        { "AudioGroup", SongAudioGroup }, { "AudioAux", SongAudioAux }, { "SynthI", SongSynthI },
+        { "Route", SongRoute }, { "marker", SongMarker },
+        { "globalPitchShift", SongGlobalPitchShift }, { "automation", SongAutomation },
+        { "cpos", SongCpos }, { "lpos", SongLpos }, { "rpos", SongRpos },
+        { "drummap", SongDrumMap }, { "drum_ordering", SongDrumOrdering },
+        { "midiAssign", SongMidiAssign } };
+
       XmlReadStatistics stats;
+      // Instantiates the rack plugins of all tracks at once, when the song has been read.
+      PluginLoader pluginLoader;
 
       for (;;) {
          if (MusEGlobal::muse->progress) {
@@ -606,155 +762,193 @@ void Song::read(Xml& xml, bool /*isTemplate*/)
                   case Xml::End:
                         goto song_read_end;
                   case Xml::TagStart:
-                        if (tag == "master")
                         {
-                              // Avoid emitting songChanged.
-                              // Tick parameter is not used.
-                              MusEGlobal::tempomap.setMasterFlag(0, xml.parseInt());
-                        }
-                        else if (tag == "info")
-                              songInfoStr = xml.parse1();
-                        else if (tag == "showinfo")
-                              showSongInfo = xml.parseInt();
-                        else if (tag == "loop")
-                              setLoop(xml.parseInt());
-                        else if (tag == "punchin")
-                              setPunchin(xml.parseInt());
-                        else if (tag == "punchout")
-                              setPunchout(xml.parseInt());
-                        else if (tag == "record")
-                        // This doesn't work as there are no tracks yet at this point and this is checked
-                        // in setRecord. So better make it clear and explicit.
-                        // (Using the default autoRecEnable==true would seem wrong too at this point.)
-                        // setRecord(xml.parseInt());
-                              setRecord(false);
-                        else if (tag == "solo")
-                              soloFlag = xml.parseInt();
-                        else if (tag == "type")          // Obsolete.
-                              xml.parseInt();
-                        else if (tag == "recmode")
-                              _recMode  = xml.parseInt();
-                        else if (tag == "cycle")
-                              _cycleMode  = xml.parseInt();
-                        else if (tag == "click")
-                              setClick(xml.parseInt());
-                        else if (tag == "quantize")
-                              _quantize  = xml.parseInt();
-                        else if (tag == "len")
-                              _songLenTicks  = xml.parseInt();
-                        else if (tag == "follow")
-                              _follow  = FollowMode(xml.parseInt());
-                        else if (tag == "midiDivision") {
-                              // TODO: Compare with current global setting and convert the
-                              //  song if required - similar to how the song vs. global
-                              //  sample rate ratio is handled. Ignore for now.
-                              xml.parseInt();
-                            }
-                        else if (tag == "sampleRate") {
-                              // Ignore. Sample rate setting is handled by the
-                              //  song discovery mechanism (in MusE::loadProjectFile1()).
-                              xml.parseInt();
-                            }
-                        else if (tag == "tempolist") {
-                              MusEGlobal::tempomap.read(xml);
-                              }
-                        else if (tag == "siglist")
-                              MusEGlobal::sigmap.read(xml);
-                        else if (tag == "keylist") {
-                              MusEGlobal::keymap.read(xml);
+                        XmlReadSectionTimer sectionTimer(&stats, tag);
+                        switch (songTags.id(tag)) {
+                              case SongMaster:
+                                    // Avoid emitting songChanged.
+                                    // Tick parameter is not used.
+                                    MusEGlobal::tempomap.setMasterFlag(0, xml.parseInt());
+                                    break;
+                              case SongInfo:
+                                    songInfoStr = xml.parse1();
+                                    break;
+                              case SongShowInfo:
+                                    showSongInfo = xml.parseInt();
+                                    break;
+                              case SongLoop:
+                                    setLoop(xml.parseInt());
+                                    break;
+                              case SongPunchin:
+                                    setPunchin(xml.parseInt());
+                                    break;
+                              case SongPunchout:
+                                    setPunchout(xml.parseInt());
+                                    break;
+                              case SongRecord:
+                                    // This doesn't work as there are no tracks yet at this point and this is checked
+                                    // in setRecord. So better make it clear and explicit.
+                                    // (Using the default autoRecEnable==true would seem wrong too at this point.)
+                                    // setRecord(xml.parseInt());
+                                    setRecord(false);
+                                    break;
+                              case SongSolo:
+                                    soloFlag = xml.parseInt();
+                                    break;
+                              case SongType:          // Obsolete.
+                                    xml.parseInt();
+                                    break;
+                              case SongRecMode:
+                                    _recMode  = xml.parseInt();
+                                    break;
+                              case SongCycle:
+                                    _cycleMode  = xml.parseInt();
+                                    break;
+                              case SongClick:
+                                    setClick(xml.parseInt());
+                                    break;
+                              case SongQuantize:
+                                    _quantize  = xml.parseInt();
+                                    break;
+                              case SongLen:
+                                    _songLenTicks  = xml.parseInt();
+                                    break;
+                              case SongFollow:
+                                    _follow  = FollowMode(xml.parseInt());
+                                    break;
+                              case SongMidiDivision:
+                                    // TODO: Compare with current global setting and convert the
+                                    //  song if required - similar to how the song vs. global
+                                    //  sample rate ratio is handled. Ignore for now.
+                                    xml.parseInt();
+                                    break;
+                              case SongSampleRate:
+                                    // Ignore. Sample rate setting is handled by the
+                                    //  song discovery mechanism (in MusE::loadProjectFile1()).
+                                    xml.parseInt();
+                                    break;
+                              case SongTempoList:
+                                    MusEGlobal::tempomap.read(xml);
+                                    break;
+                              case SongSigList:
+                                    MusEGlobal::sigmap.read(xml);
+                                    break;
+                              case SongKeyList:
+                                    MusEGlobal::keymap.read(xml);
+                                    break;
+                              case SongMidiTrack: {
+                                    MidiTrack* track = new MidiTrack();
+                                    track->read(xml, &stats);
+                                    insertTrack0(track, -1);
+                                    }
+                                    break;
+                              case SongDrumTrack: { // Old drumtrack is obsolete.
+                                    MidiTrack* track = new MidiTrack();
+                                    track->setType(Track::DRUM);
+                                    track->read(xml, &stats);
+                                    track->convertToType(Track::DRUM); // Convert the notes and controllers.
+                                    insertTrack0(track, -1);
+                                    }
+                                    break;
+                              case SongNewDrumTrack: {
+                                    MidiTrack* track = new MidiTrack();
+                                    track->setType(Track::DRUM);
+                                    track->read(xml, &stats);
+                                    insertTrack0(track, -1);
+                                    }
+                                    break;
+                              case SongWaveTrack: {
+                                    MusECore::WaveTrack* track = new MusECore::WaveTrack();
+                                    track->read(xml, &stats);
+                                    insertTrack0(track,-1);
+                                    track->showPendingPluginGuis();
+                                    }
+                                    break;
+                              case SongAudioInput: {
+                                    AudioInput* track = new AudioInput();
+                                    track->read(xml, &stats);
+                                    insertTrack0(track,-1);
+                                    track->showPendingPluginGuis();
+                                    }
+                                    break;
+                              case SongAudioOutput: {
+                                    AudioOutput* track = new AudioOutput();
+                                    track->read(xml, &stats);
+                                    insertTrack0(track,-1);
+                                    track->showPendingPluginGuis();
+                                    }
+                                    break;
+                              case SongAudioGroup: {
+                                    AudioGroup* track = new AudioGroup();
+                                    track->read(xml, &stats);
+                                    insertTrack0(track,-1);
+                                    track->showPendingPluginGuis();
+                                    }
+                                    break;
+                              case SongAudioAux: {
+                                    AudioAux* track = new AudioAux();
+                                    track->read(xml, &stats);
+                                    insertTrack0(track,-1);
+                                    track->showPendingPluginGuis();
+                                    }
+                                    break;
+                              case SongSynthI: {
+                                    SynthI* track = new SynthI();
+                                    track->read(xml, &stats);
+                                    // Done in SynthI::read()
+                                    // insertTrack(track,-1);
+                                    //track->showPendingPluginNativeGuis();
+                                    }
+                                    break;
+                              case SongRoute:
+                                    readRoute(xml);
+                                    break;
+                              case SongMarker:
+                                    readMarker(xml);
+                                    break;
+                              case SongGlobalPitchShift:
+                                    _globalPitchShift = xml.parseInt();
+                                    break;
+                              // REMOVE Tim. automation. Removed.
+                              // Deprecated. MusEGlobal::automation is now fixed TRUE
+                              //  for now until we decide what to do with it.
+                              case SongAutomation:
+                                    //      MusEGlobal::automation = xml.parseInt();
+                                    xml.parseInt();
+                                    break;
+                              case SongCpos: {
+                                    int pos = xml.parseInt();
+                                    Pos p(pos, true);
+                                    setPos(Song::CPOS, p, false, false, false);
+                                    }
+                                    break;
+                              case SongLpos: {
+                                    int pos = xml.parseInt();
+                                    Pos p(pos, true);
+                                    setPos(Song::LPOS, p, false, false, false);
+                                    }
+                                    break;
+                              case SongRpos: {
+                                    int pos = xml.parseInt();
+                                    Pos p(pos, true);
+                                    setPos(Song::RPOS, p, false, false, false);
+                                    }
+                                    break;
+                              case SongDrumMap:
+                                    readDrumMap(xml, false);
+                                    break;
+                              case SongDrumOrdering:
+                                    MusEGlobal::global_drum_ordering.read(xml);
+                                    break;
+                              case SongMidiAssign:
+                                    // Any assignments read here will have no track.
+                                    _midiAssignments.read(xml, nullptr);
+                                    break;
+                              default:
+                                    xml.unknown("Song");
+                                    break;
                               }
-                        else if (tag == "miditrack") {
-                              MidiTrack* track = new MidiTrack();
-                              track->read(xml, &stats);
-                              insertTrack0(track, -1);
-                              }
-                        else if (tag == "drumtrack") { // Old drumtrack is obsolete.
-                              MidiTrack* track = new MidiTrack();
-                              track->setType(Track::DRUM);
-                              track->read(xml, &stats);
-                              track->convertToType(Track::DRUM); // Convert the notes and controllers.
-                              insertTrack0(track, -1);
-                              }
-                        else if (tag == "newdrumtrack") {
-                              MidiTrack* track = new MidiTrack();
-                              track->setType(Track::DRUM);
-                              track->read(xml, &stats);
-                              insertTrack0(track, -1);
-                              }
-                        else if (tag == "wavetrack") {
-                              MusECore::WaveTrack* track = new MusECore::WaveTrack();
-                              track->read(xml, &stats);
-                              insertTrack0(track,-1);
-                              track->showPendingPluginGuis();
-                              }
-                        else if (tag == "AudioInput") {
-                              AudioInput* track = new AudioInput();
-                              track->read(xml, &stats);
-                              insertTrack0(track,-1);
-                              track->showPendingPluginGuis();
-                              }
-                        else if (tag == "AudioOutput") {
-                              AudioOutput* track = new AudioOutput();
-                              track->read(xml, &stats);
-                              insertTrack0(track,-1);
-                              track->showPendingPluginGuis();
-                              }
-                        else if (tag == "AudioGroup") {
-                              AudioGroup* track = new AudioGroup();
-                              track->read(xml, &stats);
-                              insertTrack0(track,-1);
-                              track->showPendingPluginGuis();
-                              }
-                        else if (tag == "AudioAux") {
-                              AudioAux* track = new AudioAux();
-                              track->read(xml, &stats);
-                              insertTrack0(track,-1);
-                              track->showPendingPluginGuis();
-                              }
-                        else if (tag == "SynthI") {
-                              SynthI* track = new SynthI();
-                              track->read(xml, &stats);
-                              // Done in SynthI::read()
-                              // insertTrack(track,-1);
-                              //track->showPendingPluginNativeGuis();
-                              }
-                        else if (tag == "Route") {
-                              readRoute(xml);
-                              }
-                        else if (tag == "marker")
-                              readMarker(xml);
-                        else if (tag == "globalPitchShift")
-                              _globalPitchShift = xml.parseInt();
-                        // REMOVE Tim. automation. Removed.
-                        // Deprecated. MusEGlobal::automation is now fixed TRUE
-                        //  for now until we decide what to do with it.
-                        else if (tag == "automation")
-                        //      MusEGlobal::automation = xml.parseInt();
-                              xml.parseInt();
-                        else if (tag == "cpos") {
-                              int pos = xml.parseInt();
-                              Pos p(pos, true);
-                              setPos(Song::CPOS, p, false, false, false);
-                              }
-                        else if (tag == "lpos") {
-                              int pos = xml.parseInt();
-                              Pos p(pos, true);
-                              setPos(Song::LPOS, p, false, false, false);
-                              }
-                        else if (tag == "rpos") {
-                              int pos = xml.parseInt();
-                              Pos p(pos, true);
-                              setPos(Song::RPOS, p, false, false, false);
-                              }
-                        else if (tag == "drummap")
-                              readDrumMap(xml, false);
-                        else if (tag == "drum_ordering")
-                              MusEGlobal::global_drum_ordering.read(xml);
-                        else if (tag == "midiAssign")
-                              // Any assignments read here will have no track.
-                              _midiAssignments.read(xml, nullptr);
-                        else
-                              xml.unknown("Song");
+                        }
                         break;
                   case Xml::Attribut:
                         break;
@@ -768,6 +962,13 @@ void Song::read(Xml& xml, bool /*isTemplate*/)
             }
             
 song_read_end:
+      {
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      pluginLoader.finish();
+      stats.addSectionTime("plugins", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+      }
+      if (MusEGlobal::debugMsg)
+            stats.dumpSectionTimes();
       dirty = false;
       }
 
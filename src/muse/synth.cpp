@@ -364,16 +364,18 @@ static SynthI* createSynthInstance(
                   delete si;
                   fprintf(stderr, "createSynthInstance: synthi class:%s label:%s can not be created\n",
                           file.toLocal8Bit().constData(), label.toLocal8Bit().constData());
-                  QMessageBox::warning(0,"Synth instantiation error!",
-                              "Synth: " + label + " can not be created!");
+                  if(!MusEGlobal::muse || !MusEGlobal::muse->headless())
+                    QMessageBox::warning(0,"Synth instantiation error!",
+                                "Synth: " + label + " can not be created!");
                   return nullptr;
                }
             }
       else {
             fprintf(stderr, "createSynthInstance: synthi class:%s uri:%s label:%s not found\n",
                     file.toLocal8Bit().constData(), uri.toLocal8Bit().constData(), label.toLocal8Bit().constData());
-            QMessageBox::warning(0,"Synth not found!",
-                        "Synth: " + label + " not found, if the project is saved it will be removed from the project");
+            if(!MusEGlobal::muse || !MusEGlobal::muse->headless())
+              QMessageBox::warning(0,"Synth not found!",
+                          "Synth: " + label + " not found, if the project is saved it will be removed from the project");
       }
 
       return si;
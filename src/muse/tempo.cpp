@@ -31,6 +31,7 @@
 #include "xml.h"
 
 #include <stdint.h>
+#include <algorithm>
 
 namespace MusEGlobal {
 MusECore::TempoList tempomap;
@@ -50,6 +51,9 @@ TempoList::TempoList()
       _tempoSN     = 1;
       _globalTempo = 100;
       useList      = true;
+      _segmentsSN  = -1;
+      _segmentCursor.store(0);
+      rebuildSegments();
       }
 
 TempoList::~TempoList()
@@ -68,6 +72,10 @@ void TempoList::copy(const TempoList& src)
   for (iTEvent i = begin(); i != end(); ++i)
     delete i->second;
   TEMPOLIST::clear();
+  invalidateSegments();
+  // Leave room for added items, so that normalizing in the realtime stage
+  //  after a swap() does not need to allocate.
+  _segments.reserve(2 * src.size() + 16);
 
   for (ciTEvent i = src.cbegin(); i != src.cend(); ++i)
   {
@@ -81,12 +89,25 @@ void TempoList::copy(const TempoList& src)
   }
 }
 
+//---------------------------------------------------------
+//   swap
+//---------------------------------------------------------
+
+void TempoList::swap(TempoList& other)
+{
+  TEMPOLIST::swap(other);
+  _segments.swap(other._segments);
+  invalidateSegments();
+  other.invalidateSegments();
+}
+
 //---------------------------------------------------------
 //   add
 //---------------------------------------------------------
 
 void TempoList::add(unsigned tick, int tempo, bool do_normalize)
       {
+      invalidateSegments();
       if (tick > MAX_TICK)
             tick = MAX_TICK;
       iTEvent e = upper_bound(tick);
@@ -107,6 +128,7 @@ void TempoList::add(unsigned tick, int tempo, bool do_normalize)
 
 void TempoList::add(unsigned tick, TEvent* e, bool do_normalize)
 {
+  invalidateSegments();
   int tempo = e->tempo;
   std::pair<iTEvent, bool> res = insert(std::pair<const unsigned, TEvent*> (tick, e));
   if(!res.second)
@@ -155,6 +177,115 @@ void TempoList::normalize()
       //  and if they are the same a cached value is returned.
       // Otherwise if the serial numbers are not the same the value is recalculated.
       ++_tempoSN;
+      rebuildSegments();
+      }
+
+//---------------------------------------------------------
+//   rebuildSegments
+//---------------------------------------------------------
+
+void TempoList::rebuildSegments()
+      {
+      _segments.resize(size());
+      int idx = 0;
+      for (ciTEvent e = begin(); e != end(); ++e, ++idx) {
+            TempoSegment& seg = _segments[idx];
+            seg.tick    = e->second->tick;
+            seg.endTick = e->first;
+            seg.frame   = e->second->frame;
+            seg.tempo   = e->second->tempo;
+            }
+      _segmentCursor.store(0, std::memory_order_relaxed);
+      _segmentsSN = _tempoSN;
+      }
+
+//---------------------------------------------------------
+//   findTick
+//---------------------------------------------------------
+
+bool TempoList::findTick(unsigned tick, TempoSegment* seg) const
+      {
+      if (_segmentsSN != _tempoSN) {
+            ciTEvent i = upper_bound(tick);
+            if (i == end())
+                  return false;
+            seg->tick    = i->second->tick;
+            seg->endTick = i->first;
+            seg->frame   = i->second->frame;
+            seg->tempo   = i->second->tempo;
+            return true;
+            }
+
+      const int sz = _segments.size();
+      const TempoSegment* segs = _segments.data();
+      // Same semantics as upper_bound() on the list: The first segment ending after the tick.
+      auto contains = [segs, tick](int c) {
+            return tick < segs[c].endTick && (c == 0 || tick >= segs[c - 1].endTick);
+            };
+      int c = _segmentCursor.load(std::memory_order_relaxed);
+      if (c >= sz || !contains(c)) {
+            if (c + 1 < sz && contains(c + 1))
+                  ++c;
+            else {
+                  const TempoSegment* i = std::upper_bound(segs, segs + sz, tick,
+                     [](unsigned t, const TempoSegment& s) { return t < s.endTick; });
+                  if (i == segs + sz)
+                        return false;
+                  c = i - segs;
+                  }
+            _segmentCursor.store(c, std::memory_order_relaxed);
+            }
+      *seg = segs[c];
+      return true;
+      }
+
+//---------------------------------------------------------
+//   findFrame
+//---------------------------------------------------------
+
+bool TempoList::findFrame(unsigned frame, TempoSegment* seg) const
+      {
+      if (_segmentsSN != _tempoSN) {
+            ciTEvent e;
+            for (e = begin(); e != end();) {
+                  ciTEvent ee = e;
+                  ++ee;
+                  if (ee == end())
+                        break;
+                  if (frame < ee->second->frame)
+                        break;
+                  e = ee;
+                  }
+            if (e == end())
+                  return false;
+            seg->tick    = e->second->tick;
+            seg->endTick = e->first;
+            seg->frame   = e->second->frame;
+            seg->tempo   = e->second->tempo;
+            return true;
+            }
+
+      const int sz = _segments.size();
+      if (sz == 0)
+            return false;
+      const TempoSegment* segs = _segments.data();
+      // The last segment starting at or before the frame. The first segment covers any frame before it.
+      auto contains = [segs, sz, frame](int c) {
+            return (c == 0 || frame >= segs[c].frame) && (c + 1 == sz || frame < segs[c + 1].frame);
+            };
+      int c = _segmentCursor.load(std::memory_order_relaxed);
+      if (c >= sz || !contains(c)) {
+            if (c + 1 < sz && contains(c + 1))
+                  ++c;
+            else {
+                  const TempoSegment* i = std::upper_bound(segs + 1, segs + sz, frame,
+                     [](unsigned f, const TempoSegment& s) { return f < s.frame; });
+                  c = (i - segs) - 1;
+                  }
+            _segmentCursor.store(c, std::memory_order_relaxed);
+            }
+      *seg = segs[c];
+      return true;
       }
 
 //---------------------------------------------------------
@@ -182,6 +313,7 @@ void TempoList::clear()
       TEMPOLIST::clear();
       insert(std::pair<const unsigned, TEvent*> (MAX_TICK+1, new TEvent(500000, 0)));
       ++_tempoSN;
+      rebuildSegments();
       }
 
 //---------------------------------------------------------
@@ -216,14 +348,8 @@ void TempoList::eraseRange(unsigned stick, unsigned etick)
 
 int TempoList::tempo(unsigned tick) const
       {
-      if (useList) {
-            ciTEvent i = upper_bound(tick);
-            if (i == end()) {
-                  printf("no TEMPO at tick %d,0x%x\n", tick, tick);
-                  return 1000;
-                  }
-            return i->second->tempo;
-            }
+      if (useList)
+            return tempoAt(tick);
       else
             return _tempo;
       }
@@ -245,12 +371,12 @@ float TempoList::bpmAt(unsigned tick) const
 
 int TempoList::tempoAt(unsigned tick) const
       {
-            ciTEvent i = upper_bound(tick);
-            if (i == end()) {
+            TempoSegment seg;
+            if (!findTick(tick, &seg)) {
                   printf("tempoAt: no TEMPO at tick %d,0x%x\n", tick, tick);
                   return 1000;
                   }
-            return i->second->tempo;
+            return seg.tempo;
       }
 
 //---------------------------------------------------------
@@ -269,6 +395,7 @@ void TempoList::del(unsigned tick, bool do_normalize)
 
 void TempoList::del(iTEvent e, bool do_normalize)
       {
+      invalidateSegments();
       iTEvent ne = e;
       ++ne;
       if (ne == end()) {
@@ -333,7 +460,11 @@ void TempoList::delTempo(unsigned tick, bool do_normalize)
 void TempoList::setStaticTempo(int newTempo)
       {
       _tempo = newTempo;
+      // The list did not change. Keep the segments valid.
+      const bool valid = _segmentsSN == _tempoSN;
       ++_tempoSN;
+      if (valid)
+            _segmentsSN = _tempoSN;
       }
 
 //---------------------------------------------------------
@@ -344,7 +475,11 @@ bool TempoList::setMasterFlag(unsigned /*tick*/, bool val)
       {
       if (useList != val) {
             useList = val;
+            // The list did not change. Keep the segments valid.
+            const bool valid = _segmentsSN == _tempoSN;
             ++_tempoSN;
+            if (valid)
+                  _segmentsSN = _tempoSN;
             return true;
             }
       return false;
@@ -394,15 +529,15 @@ unsigned TempoList::tick2frame(unsigned tick, int* sn, LargeIntRoundMode round_m
       const uint64_t numer = (uint64_t)MusEGlobal::sampleRate;
       const uint64_t denom = (uint64_t)MusEGlobal::config.division * (uint64_t)_globalTempo * 10000UL;
       if (useList) {
-            ciTEvent i = upper_bound(tick);
-            if (i == end()) {
+            TempoSegment seg;
+            if (!findTick(tick, &seg)) {
                   printf("tick2frame(%d,0x%x): not found\n", tick, tick);
                   return 0;
                   }
             // Tick resolution is less than frame resolution. 
             // Round up so that the reciprocal function (frame to tick) matches value for value.
-            f = i->second->frame + muse_multiply_64_div_64_to_64(
-              numer * (uint64_t)i->second->tempo, tick - i->second->tick, denom, round_mode);
+            f = seg.frame + muse_multiply_64_div_64_to_64(
+              numer * (uint64_t)seg.tempo, tick - seg.tick, denom, round_mode);
             }
       else {
             // Tick resolution is less than frame resolution. 
@@ -434,19 +569,14 @@ unsigned TempoList::frame2tick(unsigned frame, int* sn, LargeIntRoundMode round_
       const uint64_t numer = (uint64_t)MusEGlobal::config.division * (uint64_t)_globalTempo * 10000UL;
       const uint64_t denom = (uint64_t)MusEGlobal::sampleRate;
       if (useList) {
-            ciTEvent e;
-            for (e = begin(); e != end();) {
-                  ciTEvent ee = e;
-                  ++ee;
-                  if (ee == end())
-                        break;
-                  if (frame < ee->second->frame)
-                        break;
-                  e = ee;
+            TempoSegment seg;
+            if (!findFrame(frame, &seg)) {
+                  printf("frame2tick(%d): not found\n", frame);
+                  return 0;
                   }
             // Normally do not round up here since (audio) frame resolution is higher than tick resolution.
-            tick = e->second->tick + muse_multiply_64_div_64_to_64(
-              numer, frame - e->second->frame, denom * (uint64_t)e->second->tempo, round_mode);
+            tick = seg.tick + muse_multiply_64_div_64_to_64(
+              numer, frame - seg.frame, denom * (uint64_t)seg.tempo, round_mode);
             }
       else
             // Normally do not round up here since (audio) frame resolution is higher than tick resolution.
@@ -466,25 +596,24 @@ unsigned TempoList::deltaTick2frame(unsigned tick1, unsigned tick2, int* sn, Lar
       const uint64_t numer = (uint64_t)MusEGlobal::sampleRate;
       const uint64_t denom = (uint64_t)MusEGlobal::config.division * (uint64_t)_globalTempo * 10000UL;
       if (useList) {
-            ciTEvent i = upper_bound(tick1);
-            if (i == end()) {
+            TempoSegment seg;
+            if (!findTick(tick1, &seg)) {
                   printf("TempoList::deltaTick2frame: tick1:%d not found\n", tick1);
                   // abort();
                   return 0;
                   }
             // Tick resolution is less than frame resolution. 
             // Round up so that the reciprocal function (frame to tick) matches value for value.
-            f1 = i->second->frame + muse_multiply_64_div_64_to_64(
-              numer * (uint64_t)i->second->tempo, tick1 - i->second->tick, denom, round_mode);
+            f1 = seg.frame + muse_multiply_64_div_64_to_64(
+              numer * (uint64_t)seg.tempo, tick1 - seg.tick, denom, round_mode);
 
-            i = upper_bound(tick2);
-            if (i == end()) {
+            if (!findTick(tick2, &seg)) {
                   return 0;
                   }
             // Tick resolution is less than frame resolution. 
             // Round up so that the reciprocal function (frame to tick) matches value for value.
-            f2 = i->second->frame + muse_multiply_64_div_64_to_64(
-              numer * (uint64_t)i->second->tempo, tick2 - i->second->tick, denom, round_mode);
+            f2 = seg.frame + muse_multiply_64_div_64_to_64(
+              numer * (uint64_t)seg.tempo, tick2 - seg.tick, denom, round_mode);
             }
       else {
             // Tick resolution is less than frame resolution. 
@@ -512,32 +641,18 @@ unsigned TempoList::deltaFrame2tick(unsigned frame1, unsigned frame2, int* sn, L
       const uint64_t numer = (uint64_t)MusEGlobal::config.division * (uint64_t)_globalTempo * 10000UL;
       const uint64_t denom = (uint64_t)MusEGlobal::sampleRate;
       if (useList) {
-            ciTEvent e;
-            for (e = begin(); e != end();) {
-                  ciTEvent ee = e;
-                  ++ee;
-                  if (ee == end())
-                        break;
-                  if (frame1 < ee->second->frame)
-                        break;
-                  e = ee;
-                  }
+            TempoSegment seg;
+            if (!findFrame(frame1, &seg))
+                  return 0;
             // Normally do not round up here since (audio) frame resolution is higher than tick resolution.
-            tick1 = e->second->tick + muse_multiply_64_div_64_to_64(
-              numer, frame1 - e->second->frame, denom * (uint64_t)e->second->tempo, round_mode);
+            tick1 = seg.tick + muse_multiply_64_div_64_to_64(
+              numer, frame1 - seg.frame, denom * (uint64_t)seg.tempo, round_mode);
             
-            for (e = begin(); e != end();) {
-                  ciTEvent ee = e;
-                  ++ee;
-                  if (ee == end())
-                        break;
-                  if (frame2 < ee->second->frame)
-                        break;
-                  e = ee;
-                  }
+            if (!findFrame(frame2, &seg))
+                  return 0;
             // Normally do not round up here since (audio) frame resolution is higher than tick resolution.
-            tick2 = e->second->tick + muse_multiply_64_div_64_to_64(
-              numer, frame2 - e->second->frame, denom * (uint64_t)e->second->tempo, round_mode);
+            tick2 = seg.tick + muse_multiply_64_div_64_to_64(
+              numer, frame2 - seg.frame, denom * (uint64_t)seg.tempo, round_mode);
             }
       else
       {
@@ -572,6 +687,7 @@ void TempoList::write(int level, Xml& xml) const
 
 void TempoList::read(Xml& xml)
       {
+      invalidateSegments();
       for (;;) {
             Xml::Token token = xml.parse();
             const QString& tag = xml.s1();
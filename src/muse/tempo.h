@@ -26,6 +26,7 @@
 
 #include <map>
 #include <vector>
+#include <atomic>
 
 #include "large_int.h"
 
@@ -61,6 +62,18 @@ struct TEvent {
             }
       };
 
+//---------------------------------------------------------
+//   TempoSegment
+//    One tempo event of the list, in a flat array.
+//---------------------------------------------------------
+
+struct TempoSegment {
+      unsigned tick;      // start of the segment
+      unsigned endTick;   // start of the next segment, the list key
+      unsigned frame;     // precomputed frame at tick
+      int tempo;
+      };
+
 //---------------------------------------------------------
 //   TempoList
 //---------------------------------------------------------
@@ -80,11 +93,26 @@ class TempoList : public TEMPOLIST {
       int _tempo;             // tempo if not using tempo list
       int _globalTempo;       // %percent 50-200%
 
+      // Sorted flat copy of the list for fast lookups. It is rebuilt by normalize()
+      //  and is only used while _segmentsSN matches _tempoSN. Otherwise the list
+      //  itself is searched, for example while normalizing is deferred.
+      std::vector<TempoSegment> _segments;
+      int _segmentsSN;
+      // Index of the last segment found. Sequential lookups during playback
+      //  usually hit the same segment or the next one.
+      mutable std::atomic<int> _segmentCursor;
+
       void add(unsigned tick, int tempo, bool do_normalize = true);
       void add(unsigned tick, TEvent* e, bool do_normalize = true);
       void del(iTEvent, bool do_normalize = true);
       void del(unsigned tick, bool do_normalize = true);
 
+      void rebuildSegments();
+      void invalidateSegments() { _segmentsSN = -1; }
+      // Find the segment containing the tick or the frame. Return false if not found.
+      bool findTick(unsigned tick, TempoSegment* seg) const;
+      bool findFrame(unsigned frame, TempoSegment* seg) const;
+
    public:
       TempoList();
       ~TempoList();
@@ -92,6 +120,9 @@ class TempoList : public TEMPOLIST {
       // Makes a copy of the source list including all allocated items.
       // This clears and deletes existing items in the destination list.
       void copy(const TempoList& src);
+      // Exchanges the items with another list in constant time. The segment storage
+      //  is exchanged too, so that normalizing afterwards does not need to allocate.
+      void swap(TempoList& other);
 
       void normalize();
       void clear();
@@ -31,6 +31,7 @@
 #include <QUuid>
 
 #include <vector>
+#include <atomic>
 #include <algorithm>
 
 #include "wave.h" // for SndFileR
@@ -59,6 +60,7 @@ struct DrumMap;
 class WorkingDrumMapList;
 class WorkingDrumMapPatchList;
 class LatencyCompensator;
+class RecordStream;
 struct XmlReadStatistics;
 struct XmlWriteStatistics;
 
@@ -688,7 +690,34 @@ class AudioTrack : public Track {
       float _previousLatency;
 
       Fifo fifo;                    // fifo -> _recFile
+      // Deep buffer between fifo and _recFile, written by the RecordWriter thread.
+      // Only while the writer is running and the track is prepared for recording.
+      // Read by the prefetch thread, which writes the recording.
+      std::atomic<RecordStream*> _recStream;
       bool _processed;
+
+      // Track freeze. While a freeze file is set, the track's own data and its
+      //  plugin chain are bypassed and the file is streamed back instead.
+      SndFileR _freezeFile;
+      // The freeze file as seen by the prefetch thread, which must not copy
+      //  _freezeFile while the audio thread replaces it. Set along with it.
+      std::atomic<SndFile*> _freezeStream;
+      // Filled by the prefetch thread from _freezeStream. Allocated on first use.
+      Fifo* _freezeFifo;
+      unsigned _freezeWritePos;
+      // The file and position last read by the prefetch thread, to avoid
+      //  needless seeks. Prefetch thread only.
+      SndFile* _freezeReadFile;
+      sf_count_t _freezeReadPos;
+      // Exclusively for rendering the freeze file.
+      SndFileR _freezeRecFile;
+      sf_count_t _freezeRecPos;
+
+      // Fills the buffers from the freeze fifo, or from the file when freewheeling.
+      // Returns true if there was data. Called from audio thread only.
+      bool getFreezeData(unsigned pos, int channels, unsigned nframes, float** bp);
+      // Writes rendered data to _freezeRecFile. Called from audio thread only.
+      void writeFreezeData(unsigned pos, int channels, unsigned nframes, float** bp);
       
       // Checks for old all green plugin controller colors and changes them
       //  to the new random color scheme.
@@ -748,7 +777,38 @@ class AudioTrack : public Track {
       void updateUiWindowTitles();
 
       SndFileR recFile() const;
+      // Finishes any record stream first. Called from gui thread only.
       void setRecFile(SndFileR sf);
+      RecordStream* recordStream() const { return _recStream; }
+      // Waits until the recording fifo and the record stream are written out, then removes
+      //  the record stream. Called from gui thread only, when recording has stopped.
+      void finishRecordStream();
+
+      // Only wave tracks and synth tracks can be frozen.
+      bool canFreeze() const { return type() == WAVE || type() == AUDIO_SOFTSYNTH; }
+      bool isFrozen() const { return !_freezeFile.isNull(); }
+      SndFileR freezeFile() const { return _freezeFile; }
+      // Allocates the freeze fifo. Called from gui thread only, before freezing.
+      void prepareFreeze();
+      // Called from audio thread only, by the SetTrackFreeze operation.
+      // Returns the previous file, which the prefetch thread may still be reading.
+      SndFileR setFreezeFile(SndFileR sf);
+      // The freeze file for the prefetch thread. Null if the track is not frozen.
+      SndFile* freezeStream() const { return _freezeStream.load(std::memory_order_acquire); }
+      // Sets the file which receives the rendered track during a freeze bounce.
+      // Called from audio thread only, by the SetTrackFreezeRecFile operation.
+      void setFreezeRecFile(SndFileR sf);
+      SndFileR freezeRecFile() const { return _freezeRecFile; }
+      Fifo* freezeFifo() { return _freezeFifo; }
+      unsigned freezeWritePos() const { return _freezeWritePos; }
+      void setFreezeWritePos(unsigned p) { _freezeWritePos = p; }
+      // Reads from the freeze file, padding with silence past its end.
+      // Called from prefetch thread, or from audio thread when freewheeling.
+      //  Only the prefetch thread may set prefetch, and the file is always
+      //  seeked otherwise.
+      void readFreezeData(sf_count_t pos, int channels, unsigned frames, float** bp, bool prefetch);
+      // Forces a seek upon the next read. Called from prefetch thread only, upon a seek.
+      void resetFreezeReadPos() { _freezeReadFile = nullptr; }
 
       CtrlListList* controller()         { return &_controller; }
       const CtrlListList* controller() const { return &_controller; }
@@ -1012,6 +1072,9 @@ class AudioAux : public AudioTrack {
       float* buffer[MusECore::MAX_CHANNELS];
       static bool _isVisible;
       int _index;
+      // Guards the send buffers when tracks are processed concurrently
+      //  by the audio graph executor.
+      std::atomic_flag _sendBufferLock = ATOMIC_FLAG_INIT;
    public:
       AudioAux();
       AudioAux(const AudioAux& t, int flags);
@@ -1029,6 +1092,8 @@ class AudioAux : public AudioTrack {
                 s._trackChannels._inChannels = 0;
                 return s; }
       float** sendBuffer() { return buffer; }
+      void lockSendBuffer() { while(_sendBufferLock.test_and_set(std::memory_order_acquire)) ; }
+      void unlockSendBuffer() { _sendBufferLock.clear(std::memory_order_release); }
       static  void setVisible(bool t) { _isVisible = t; }
       virtual int height() const;
       static bool visible() { return _isVisible; }
@@ -1047,6 +1112,10 @@ class WaveTrack : public AudioTrack {
       //  the prefetch can pump as much buffers as required while
       //  keeping track of the last buffer position stamp.
       unsigned _prefetchWritePos;
+      // Prefetch fifo diagnostics. Written by the audio and prefetch threads.
+      std::atomic<unsigned int> _prefetchUnderruns;
+      std::atomic<int> _prefetchFill;
+      std::atomic<int> _prefetchMinFill;
       static bool _isVisible;
 
       void internal_assign(const Track&, int flags);
@@ -1099,6 +1168,18 @@ class WaveTrack : public AudioTrack {
       inline unsigned prefetchWritePos() const { return _prefetchWritePos; }
       inline void setPrefetchWritePos(unsigned p) { _prefetchWritePos = p; }
 
+      // Prefetch fifo diagnostics.
+      // Number of times the audio thread found the prefetch fifo empty.
+      unsigned int prefetchUnderruns() const { return _prefetchUnderruns.load(std::memory_order_relaxed); }
+      // Number of full fifo buffers found when the prefetch last serviced the track.
+      int prefetchFill() const { return _prefetchFill.load(std::memory_order_relaxed); }
+      // Lowest number of full fifo buffers found during playback since the last reset.
+      // -1 if not serviced during playback yet.
+      int prefetchMinFill() const { return _prefetchMinFill.load(std::memory_order_relaxed); }
+      // Called from prefetch thread, before filling the fifo.
+      void updatePrefetchFill(int fill, bool isPlaying);
+      void resetPrefetchStats();
+
       virtual void setChannels(int n);
       virtual bool hasAuxSend() const { return true; }
       bool canEnableRecord() const;
@@ -150,6 +150,7 @@ struct SongChangedStruct_t
 #define SC_AUDIO_CTRL_MOVE_MODE       MusECore::SongChangedStruct_t(0x10000000000000) // The audio controller move mode was changed.
 #define SC_MIDI_REMOTE                MusECore::SongChangedStruct_t(0x20000000000000) // The midi remote settings changed.
 #define SC_MIDI_AUDIO_CTRL_MAPPER     MusECore::SongChangedStruct_t(0x40000000000000) // The midi to audio control mapper values or list changed.
+#define SC_WAVE_PEAKS                 MusECore::SongChangedStruct_t(0x80000000000000) // More waveform peak data became available.
 #define SC_EVERYTHING                 MusECore::SongChangedStruct_t(-1, -1)       // global update
 
 
@@ -39,11 +39,13 @@
 #include "al/al.h"
 
 #include <set>
+#include <algorithm>
 
 // Forwards from header:
 #include "track.h"
 #include "part.h"
 #include "plugin.h"
+#include "eventbatch.h"
 
 // Enable for debugging:
 //#define _UNDO_DEBUG_
@@ -344,6 +346,7 @@ const char* UndoOp::typeName()
             "AddTrack", "DeleteTrack", 
             "AddPart",  "DeletePart", "MovePart", "ModifyPartStart", "ModifyPartLength", "ModifyPartName", "SelectPart",
             "AddEvent", "DeleteEvent", "ModifyEvent", "SelectEvent",
+            "ModifyEventBatch",
             "AddAudioCtrlVal", "AddAudioCtrlValStruct",
             "DeleteAudioCtrlVal", "ModifyAudioCtrlVal", "ModifyAudioCtrlValList",
             "SelectAudioCtrlVal", "SetAudioCtrlPasteEraseMode", "BeginAudioCtrlMoveMode", "EndAudioCtrlMoveMode", /*"SetAudioCtrlMoveMode",*/
@@ -352,8 +355,9 @@ const char* UndoOp::typeName()
             "AddKey",   "DeleteKey",   "ModifyKey",
             "ModifyTrackName", "ModifyTrackChannel",
             "SetTrackRecord", "SetTrackMute", "SetTrackSolo", "SetTrackRecMonitor", "SetTrackOff",
+            "SetTrackFreeze",
             "MoveTrack",
-            "ModifyClip", "AddMarker", "DeleteMarker", "ModifyMarker", "SetMarkerPos",
+            "ModifyClip", "ModifyWaveBlocks", "AddMarker", "DeleteMarker", "ModifyMarker", "SetMarkerPos",
             "ChangeRackEffectPlugin", "SwapRackEffectPlugins", "MoveRackEffectPlugin",
 
             "ModifySongLen", "SetInstrument", "DoNothing",
@@ -410,6 +414,18 @@ void UndoOp::dump()
             case SetTrackOff:
                   printf("%s %d\n", track->name().toLocal8Bit().constData(), a);
                   break;
+            case SetTrackFreeze:
+                  printf("%s <%s>-<%s>\n", track->name().toLocal8Bit().constData(),
+                         _oldFreezeFile->isNull() ? "" : _oldFreezeFile->path().toLocal8Bit().constData(),
+                         _newFreezeFile->isNull() ? "" : _newFreezeFile->path().toLocal8Bit().constData());
+                  break;
+            case ModifyWaveBlocks:
+                  printf("%s map:%p -> %p\n", _blockFile->path().toLocal8Bit().constData(),
+                         _oldBlockMap, _newBlockMap);
+                  break;
+            case ModifyEventBatch:
+                  printf("part:%p changes:%zu\n", part, _eventBatch ? _eventBatch->size() : 0);
+                  break;
             default:      
                   break;
             }
@@ -546,6 +562,36 @@ void deleteUndoOp(UndoOp& op, bool doUndos = true, bool doRedos = true)
           }
           break;
 
+    case UndoOp::ModifyWaveBlocks:
+          // The maps belong to the file's block store.
+          if (op._blockFile)
+          {
+            delete op._blockFile;
+            op._blockFile = nullptr;
+          }
+          break;
+
+    case UndoOp::ModifyEventBatch:
+          if (op._eventBatch)
+          {
+            delete op._eventBatch;
+            op._eventBatch = nullptr;
+          }
+          break;
+
+    case UndoOp::SetTrackFreeze:
+          if (op._oldFreezeFile)
+          {
+            delete op._oldFreezeFile;
+            op._oldFreezeFile = nullptr;
+          }
+          if (op._newFreezeFile)
+          {
+            delete op._newFreezeFile;
+            op._newFreezeFile = nullptr;
+          }
+          break;
+
     case UndoOp::ModifyAudioCtrlValList:
           if(op._eraseCtrlList)
           {
@@ -607,6 +653,257 @@ Undo::iterator Undo::deleteAndErase(Undo::iterator iuo)
   return erase(iuo);
 }
 
+//---------------------------------------------------------
+//    UndoCtrlValChunk
+//---------------------------------------------------------
+
+UndoCtrlValChunk::UndoCtrlValChunk(const CtrlList& cl)
+{
+  _items.reserve(cl.size());
+  for(ciCtrl ic = cl.cbegin(); ic != cl.cend(); ++ic)
+    _items.push_back(Item{ic->first, ic->second.flags(), ic->second.value()});
+}
+
+bool UndoCtrlValChunk::equals(const CtrlList& cl) const
+{
+  if(cl.size() != _items.size())
+    return false;
+  std::vector<Item>::const_iterator ii = _items.cbegin();
+  for(ciCtrl ic = cl.cbegin(); ic != cl.cend(); ++ic, ++ii)
+  {
+    if(ii->frame != ic->first || ii->flags != ic->second.flags() || ii->value != ic->second.value())
+      return false;
+  }
+  return true;
+}
+
+CtrlList* UndoCtrlValChunk::toCtrlList(int id) const
+{
+  CtrlList* cl = new CtrlList(id);
+  for(std::vector<Item>::const_iterator ii = _items.cbegin(); ii != _items.cend(); ++ii)
+    cl->insert(cl->end(), CtrlListInsertPair_t(ii->frame, CtrlVal(ii->value, ii->flags)));
+  return cl;
+}
+
+//---------------------------------------------------------
+//    memoryUsage
+//    Rough estimates, for keeping the undo history within
+//     the configured memory limit.
+//---------------------------------------------------------
+
+// An event base with its allocation, and its node in an event list.
+static const size_t undoEventSize = 160;
+// A part without its events.
+static const size_t undoPartSize = 256;
+// A controller point and its node in a controller list.
+static const size_t undoCtrlItemSize = sizeof(CtrlListInsertPair_t) + 4 * sizeof(void*);
+
+static size_t undoEventMemory(const Event& e)
+{
+  return e.empty() ? 0 : undoEventSize + e.dataLen();
+}
+
+static size_t undoPartMemory(const Part* part)
+{
+  return part ? undoPartSize + part->events().size() * undoEventSize : 0;
+}
+
+static size_t undoCtrlListMemory(const CtrlList* cl)
+{
+  return cl ? sizeof(CtrlList) + cl->size() * undoCtrlItemSize : 0;
+}
+
+static size_t undoCtrlListListMemory(const CtrlListList* cll)
+{
+  size_t sz = 0;
+  if(cll)
+  {
+    for(ciCtrlList icl = cll->cbegin(); icl != cll->cend(); ++icl)
+      sz += undoCtrlListMemory(icl->second);
+  }
+  return sz;
+}
+
+static size_t undoCtrlChunkMemory(const UndoCtrlValChunkPtr& chunk)
+{
+  // A shared chunk is split among the operations sharing it.
+  return chunk ? chunk->memoryUsage() / chunk.use_count() : 0;
+}
+
+static size_t undoTrackMemory(const Track* track)
+{
+  if(!track)
+    return 0;
+  size_t sz = sizeof(Track);
+  for(ciPart ip = track->cparts()->cbegin(); ip != track->cparts()->cend(); ++ip)
+    sz += undoPartMemory(ip->second);
+  if(!track->isMidiTrack())
+    sz += undoCtrlListListMemory(static_cast<const AudioTrack*>(track)->controller());
+  return sz;
+}
+
+size_t UndoOp::memoryUsage(bool doUndos, bool doRedos) const
+{
+  // The operation and its node in the undo list.
+  size_t sz = sizeof(UndoOp) + 2 * sizeof(void*);
+
+  // Like deleteUndoOp(), only count what is held by the undo system and not used by the song.
+  switch(type)
+  {
+    case DeleteTrack:
+          if(doUndos)
+            sz += undoTrackMemory(track);
+          break;
+    case AddTrack:
+          if(doRedos)
+            sz += undoTrackMemory(track);
+          break;
+    case DeletePart:
+          if(doUndos)
+            sz += undoPartMemory(part);
+          break;
+    case AddPart:
+          if(doRedos)
+            sz += undoPartMemory(part);
+          break;
+
+    case DeleteEvent:
+          if(doUndos)
+            sz += undoEventMemory(nEvent);
+          break;
+    case AddEvent:
+          if(doRedos)
+            sz += undoEventMemory(nEvent);
+          break;
+    case ModifyEvent:
+          sz += undoEventMemory(doUndos ? oEvent : nEvent);
+          break;
+    case ModifyEventBatch:
+          if(_eventBatch)
+          {
+            for(const EventBatch::Change& c : _eventBatch->changes())
+              sz += sizeof(EventBatch::Change) + undoEventMemory(doUndos ? c.oldEvent : c.newEvent);
+          }
+          break;
+
+    case ChangeRackEffectPlugin:
+          sz += undoCtrlListListMemory(_ctrlListList);
+          break;
+    case MoveRackEffectPlugin:
+          sz += undoCtrlListListMemory(_plugMoveDstCtrlListList);
+          break;
+
+    case ModifyAudioCtrlValList:
+          sz += undoCtrlListMemory(_eraseCtrlList);
+          sz += undoCtrlListMemory(_addCtrlList);
+          sz += undoCtrlListMemory(_recoverableEraseCtrlList);
+          sz += undoCtrlListMemory(_recoverableAddCtrlList);
+          sz += undoCtrlListMemory(_doNotEraseCtrlList);
+          sz += undoCtrlChunkMemory(_packedEraseCtrl);
+          sz += undoCtrlChunkMemory(_packedAddCtrl);
+          break;
+
+    default:
+          break;
+  }
+  return sz;
+}
+
+//---------------------------------------------------------
+//    pack
+//---------------------------------------------------------
+
+bool UndoOp::pack(UndoCtrlValChunkCache& cache)
+{
+  if(type != ModifyAudioCtrlValList || _packedEraseCtrl || _packedAddCtrl)
+    return false;
+  // Song::undoAudioCtrlMoveEnd() looks for the lists used while moving points. Leave those alone.
+  if((_recoverableEraseCtrlList && !_recoverableEraseCtrlList->empty()) ||
+     (_recoverableAddCtrlList && !_recoverableAddCtrlList->empty()) ||
+     (_doNotEraseCtrlList && !_doNotEraseCtrlList->empty()))
+    return false;
+  if(!_eraseCtrlList && !_addCtrlList)
+    return false;
+
+  // The points erased by an edit are very often the points added by the previous
+  //  edit of the same controller. Share those.
+  UndoCtrlValChunkPtr& last = cache[std::pair<const Track*, int>(track, _audioCtrlIdModify)];
+  if(_eraseCtrlList)
+  {
+    if(last && last->equals(*_eraseCtrlList))
+      _packedEraseCtrl = last;
+    else
+      _packedEraseCtrl = std::make_shared<const UndoCtrlValChunk>(*_eraseCtrlList);
+    delete _eraseCtrlList;
+    _eraseCtrlList = nullptr;
+  }
+  if(_addCtrlList)
+  {
+    _packedAddCtrl = std::make_shared<const UndoCtrlValChunk>(*_addCtrlList);
+    last = _packedAddCtrl;
+    delete _addCtrlList;
+    _addCtrlList = nullptr;
+  }
+
+  delete _recoverableEraseCtrlList;
+  _recoverableEraseCtrlList = nullptr;
+  delete _recoverableAddCtrlList;
+  _recoverableAddCtrlList = nullptr;
+  delete _doNotEraseCtrlList;
+  _doNotEraseCtrlList = nullptr;
+  return true;
+}
+
+void Undo::pack(UndoCtrlValChunkCache& cache, bool doUndos, bool doRedos)
+{
+  if(_packed)
+    return;
+  _memory = 0;
+  for(iUndoOp i = begin(); i != end(); ++i)
+  {
+    i->pack(cache);
+    _memory += i->memoryUsage(doUndos, doRedos);
+  }
+  _packed = true;
+}
+
+//---------------------------------------------------------
+//    unpack
+//---------------------------------------------------------
+
+void UndoOp::unpack()
+{
+  if(type != ModifyAudioCtrlValList)
+    return;
+  if(_packedEraseCtrl)
+  {
+    _eraseCtrlList = _packedEraseCtrl->toCtrlList(_audioCtrlIdModify);
+    _packedEraseCtrl.reset();
+  }
+  if(_packedAddCtrl)
+  {
+    _addCtrlList = _packedAddCtrl->toCtrlList(_audioCtrlIdModify);
+    _packedAddCtrl.reset();
+  }
+}
+
+void Undo::unpack()
+{
+  for(iUndoOp i = begin(); i != end(); ++i)
+    i->unpack();
+  _packed = false;
+}
+
+size_t Undo::memoryUsage(bool doUndos, bool doRedos) const
+{
+  if(_packed)
+    return _memory;
+  size_t sz = 0;
+  for(ciUndoOp i = cbegin(); i != cend(); ++i)
+    sz += i->memoryUsage(doUndos, doRedos);
+  return sz;
+}
+
 //---------------------------------------------------------
 //    clearDelete
 //---------------------------------------------------------
@@ -638,6 +935,55 @@ void UndoList::clearDelete()
   }
 
   clear();
+  _ctrlChunks.clear();
+}
+
+//---------------------------------------------------------
+//    pack
+//---------------------------------------------------------
+
+void UndoList::pack()
+{
+  if(empty())
+    return;
+  // The newest step is still being added to, and is the next to be undone or redone.
+  iUndo last = end();
+  --last;
+  for(iUndo iu = begin(); iu != last; ++iu)
+    iu->pack(_ctrlChunks, isUndo, !isUndo);
+}
+
+//---------------------------------------------------------
+//    memoryUsage
+//---------------------------------------------------------
+
+size_t UndoList::memoryUsage() const
+{
+  size_t sz = 0;
+  for(ciUndo iu = cbegin(); iu != cend(); ++iu)
+    sz += iu->memoryUsage(isUndo, !isUndo);
+  return sz;
+}
+
+//---------------------------------------------------------
+//    trim
+//---------------------------------------------------------
+
+bool UndoList::trim(size_t maxBytes)
+{
+  size_t sz = memoryUsage();
+  bool trimmed = false;
+  // The front step is the one furthest from the current state, in both undo and redo lists.
+  while(size() > 1 && sz > maxBytes)
+  {
+    Undo& u = front();
+    sz -= std::min(sz, u.memoryUsage(isUndo, !isUndo));
+    for(iUndoOp i = u.begin(); i != u.end(); ++i)
+      deleteUndoOp(*i, isUndo, !isUndo);
+    pop_front();
+    trimmed = true;
+  }
+  return trimmed;
 }
 
 //---------------------------------------------------------
@@ -754,6 +1100,7 @@ void Undo::insert(Undo::iterator position, Undo::size_type n, const UndoOp& op)
 void Undo::insert(Undo::iterator position, const UndoOp& op)
 {
   UndoOp n_op = op;
+  _packed = false;
 
 #ifdef _UNDO_DEBUG_
   switch(n_op.type)
@@ -796,6 +1143,9 @@ void Undo::insert(Undo::iterator position, const UndoOp& op)
     case UndoOp::SetTrackOff:
       fprintf(stderr, "Undo::insert: SetTrackOff\n");
     break;
+    case UndoOp::SetTrackFreeze:
+      fprintf(stderr, "Undo::insert: SetTrackFreeze\n");
+    break;
     
     
     case UndoOp::AddPart:
@@ -830,6 +1180,9 @@ void Undo::insert(Undo::iterator position, const UndoOp& op)
     case UndoOp::ModifyEvent:
       fprintf(stderr, "Undo::insert: ModifyEvent\n");
     break;
+    case UndoOp::ModifyEventBatch:
+      fprintf(stderr, "Undo::insert: ModifyEventBatch\n");
+    break;
     case UndoOp::SelectEvent:
       fprintf(stderr, "Undo::insert: SelectEvent\n");
     break;
@@ -903,6 +1256,9 @@ void Undo::insert(Undo::iterator position, const UndoOp& op)
     case UndoOp::ModifyClip:
       fprintf(stderr, "Undo::insert: ModifyClip\n");
     break;
+    case UndoOp::ModifyWaveBlocks:
+      fprintf(stderr, "Undo::insert: ModifyWaveBlocks\n");
+    break;
     
     
     case UndoOp::AddMarker:
@@ -962,7 +1318,9 @@ void Undo::insert(Undo::iterator position, const UndoOp& op)
 #endif
 
   // (NOTE: Use this handy speed-up 'if' line to exclude unhandled operation types)
-  if(n_op.type != UndoOp::ModifyTrackChannel && n_op.type != UndoOp::ModifyClip && n_op.type != UndoOp::DoNothing) 
+  if(n_op.type != UndoOp::ModifyTrackChannel && n_op.type != UndoOp::ModifyClip &&
+     n_op.type != UndoOp::ModifyWaveBlocks && n_op.type != UndoOp::ModifyEventBatch &&
+     n_op.type != UndoOp::DoNothing) 
   {
     // TODO FIXME: Must look beyond position and optimize in that direction too !
     //for(Undo::iterator iuo = begin(); iuo != position; ++iuo)
@@ -2627,6 +2985,20 @@ UndoOp::UndoOp(UndoType type_, const Event& nev, const Part* part_, bool a_, boo
         doClones = b_;
       }
       }
+
+UndoOp::UndoOp(UndoType type_, EventBatch* batch, const Part* part_, bool doCtrls_, bool doClones_, bool noUndo)
+      {
+      assert(type_==ModifyEventBatch);
+      assert(batch);
+      assert(part_);
+
+      type   = type_;
+      _eventBatch = batch;
+      part   = part_;
+      doCtrls = doCtrls_;
+      doClones = doClones_;
+      _noUndo = noUndo;
+      }
       
 UndoOp::UndoOp(UndoType type_, const Marker& oldMarker_, const Marker& newMarker_, bool noUndo)
       {
@@ -2697,6 +3069,31 @@ UndoOp::UndoOp(UndoOp::UndoType type_, const Track* track_, const QString& old_n
   _newName = new QString(new_name);
 }
 
+UndoOp::UndoOp(UndoOp::UndoType type_, const Track* track_, const SndFileR& oldFreezeFile, const SndFileR& newFreezeFile, bool noUndo)
+{
+  assert(type_==SetTrackFreeze);
+  assert(track_);
+
+  type = type_;
+  track = track_;
+  _noUndo = noUndo;
+  _oldFreezeFile = new SndFileR(oldFreezeFile);
+  _newFreezeFile = new SndFileR(newFreezeFile);
+}
+
+UndoOp::UndoOp(UndoOp::UndoType type_, const SndFileR& file, WaveBlockMap* oldBlockMap, WaveBlockMap* newBlockMap, bool noUndo)
+{
+  assert(type_==ModifyWaveBlocks);
+  assert(oldBlockMap && newBlockMap);
+
+  type = type_;
+  track = nullptr;
+  _noUndo = noUndo;
+  _blockFile = new SndFileR(file);
+  _oldBlockMap = oldBlockMap;
+  _newBlockMap = newBlockMap;
+}
+
 UndoOp::UndoOp(UndoType type_, int ctrlID, unsigned int frame, const CtrlVal& cv, const Track* track_, bool noUndo)
 {
   assert(type_== AddAudioCtrlValStruct);
@@ -3113,6 +3510,10 @@ void Song::revertOperationGroup1(Undo& operations)
                         sndFileApplyUndoFile(i->nEvent, i->tmpwavfile, i->startframe, i->endframe);
                         updateFlags |= SC_CLIP_MODIFIED;
                         break;
+                  case UndoOp::ModifyWaveBlocks:
+                        pendingOperations.add(PendingOperationItem(*i->_blockFile, i->_oldBlockMap, PendingOperationItem::SetWaveBlockMap));
+                        updateFlags |= SC_CLIP_MODIFIED;
+                        break;
                   case UndoOp::ModifyTrackChannel:
                         if (editable_track->isMidiTrack())
                         {
@@ -3169,6 +3570,12 @@ void Song::revertOperationGroup1(Undo& operations)
                         updateFlags |= SC_MUTE;
                         break;
 
+                  case UndoOp::SetTrackFreeze:
+                        static_cast<AudioTrack*>(editable_track)->prepareFreeze();
+                        pendingOperations.add(PendingOperationItem(editable_track, *i->_oldFreezeFile, PendingOperationItem::SetTrackFreeze));
+                        updateFlags |= SC_TRACK_MODIFIED;
+                        break;
+
                         
                   case UndoOp::AddRoute:
 #ifdef _UNDO_DEBUG_
@@ -3327,6 +3734,17 @@ void Song::revertOperationGroup1(Undo& operations)
                         updateFlags |= SC_EVENT_MODIFIED;
                         break;
 
+                  case UndoOp::ModifyEventBatch:
+#ifdef _UNDO_DEBUG_
+                        fprintf(stderr, "Song::revertOperationGroup1:ModifyEventBatch\n");
+#endif                        
+                        pendingOperations.modifyEventBatchOperation(*i->_eventBatch, editable_part, true, i->doCtrls, i->doClones);
+                        updateFlags |= SC_EVENT_MODIFIED;
+                        // Deleted events come back.
+                        if(i->_eventBatch->hasDeletions())
+                          updateFlags |= SC_EVENT_INSERTED;
+                        break;
+
                         
                   case UndoOp::AddAudioCtrlVal:
                   {
@@ -4467,6 +4885,10 @@ void Song::executeOperationGroup1(Undo& operations)
                         sndFileApplyUndoFile(i->nEvent, i->tmpwavfile, i->startframe, i->endframe);
                         updateFlags |= SC_CLIP_MODIFIED;
                         break;
+                  case UndoOp::ModifyWaveBlocks:
+                        pendingOperations.add(PendingOperationItem(*i->_blockFile, i->_newBlockMap, PendingOperationItem::SetWaveBlockMap));
+                        updateFlags |= SC_CLIP_MODIFIED;
+                        break;
                   case UndoOp::ModifyTrackChannel:
                      if (editable_track->isMidiTrack())
                         {
@@ -4523,6 +4945,12 @@ void Song::executeOperationGroup1(Undo& operations)
                         updateFlags |= SC_MUTE;
                         break;
 
+                  case UndoOp::SetTrackFreeze:
+                        static_cast<AudioTrack*>(editable_track)->prepareFreeze();
+                        pendingOperations.add(PendingOperationItem(editable_track, *i->_newFreezeFile, PendingOperationItem::SetTrackFreeze));
+                        updateFlags |= SC_TRACK_MODIFIED;
+                        break;
+
                         
                   case UndoOp::AddRoute:
 #ifdef _UNDO_DEBUG_
@@ -4734,6 +5162,16 @@ void Song::executeOperationGroup1(Undo& operations)
                         updateFlags |= SC_EVENT_MODIFIED;
                         break;
 
+                  case UndoOp::ModifyEventBatch:
+#ifdef _UNDO_DEBUG_
+                        fprintf(stderr, "Song::executeOperationGroup1:ModifyEventBatch\n");
+#endif                        
+                        pendingOperations.modifyEventBatchOperation(*i->_eventBatch, editable_part, false, i->doCtrls, i->doClones);
+                        updateFlags |= SC_EVENT_MODIFIED;
+                        if(i->_eventBatch->hasDeletions())
+                          updateFlags |= SC_EVENT_REMOVED;
+                        break;
+
                         
                   case UndoOp::AddAudioCtrlVal:
                   {
@@ -25,6 +25,10 @@
 #define __UNDO_H__
 
 #include <list>
+#include <map>
+#include <memory>
+#include <vector>
+#include <utility>
 
 #include <QString>
 
@@ -43,10 +47,44 @@ class MidiPort;
 class MidiInstrument;
 class Track;
 class Part;
+class EventBatch;
 class PluginConfiguration;
 class PluginI;
 
 extern std::list<QString> temporaryWavFiles; //!< Used for storing all tmp-files, for cleanup on shutdown
+
+//---------------------------------------------------------
+//   UndoCtrlValChunk
+//    The points of a controller list kept by an undo step
+//     which is no longer the newest one, packed into an
+//     immutable array. Steps holding identical points share
+//     the same chunk.
+//---------------------------------------------------------
+
+class UndoCtrlValChunk {
+   public:
+      struct Item {
+            unsigned int frame;
+            CtrlVal::CtrlValueFlags flags;
+            double value;
+            };
+
+   private:
+      std::vector<Item> _items;
+
+   public:
+      UndoCtrlValChunk(const CtrlList& cl);
+      bool equals(const CtrlList& cl) const;
+      // Returns a new list holding the points, which the caller owns.
+      CtrlList* toCtrlList(int id) const;
+      size_t size() const { return _items.size(); }
+      size_t memoryUsage() const { return sizeof(UndoCtrlValChunk) + _items.capacity() * sizeof(Item); }
+      };
+
+typedef std::shared_ptr<const UndoCtrlValChunk> UndoCtrlValChunkPtr;
+// The last chunk packed for each track and controller id.
+typedef std::map<std::pair<const Track*, int>, UndoCtrlValChunkPtr> UndoCtrlValChunkCache;
+
 //---------------------------------------------------------
 //   UndoOp
 //---------------------------------------------------------
@@ -57,6 +95,8 @@ struct UndoOp {
             AddTrack, DeleteTrack,
             AddPart,  DeletePart,  MovePart, ModifyPartStart, ModifyPartLength, ModifyPartName, SelectPart,
             AddEvent, DeleteEvent, ModifyEvent, SelectEvent,
+            // Modifies and deletes many events of a part and its clones at once. See EventBatchBuilder.
+            ModifyEventBatch,
             AddAudioCtrlVal, AddAudioCtrlValStruct,
             DeleteAudioCtrlVal, ModifyAudioCtrlVal, ModifyAudioCtrlValList,
             SelectAudioCtrlVal, SetAudioCtrlPasteEraseMode, BeginAudioCtrlMoveMode, EndAudioCtrlMoveMode,
@@ -67,8 +107,10 @@ struct UndoOp {
             AddKey,   DeleteKey,   ModifyKey,
             ModifyTrackName, ModifyTrackChannel,
             SetTrackRecord, SetTrackMute, SetTrackSolo, SetTrackRecMonitor, SetTrackOff,
+            SetTrackFreeze,
             MoveTrack,
             ModifyClip,
+            ModifyWaveBlocks,
             AddMarker, DeleteMarker, ModifyMarker,
             // This one is provided separately for optimizing repeated adjustments. It is 'combo breaker' -aware.
             SetMarkerPos,
@@ -205,6 +247,20 @@ struct UndoOp {
                   QString* _oldName;
                   QString* _newName;
                 };
+            struct {
+                  SndFileR* _oldFreezeFile;
+                  SndFileR* _newFreezeFile;
+                };
+            struct {
+                  SndFileR* _blockFile;
+                  // Owned by the file's block store.
+                  WaveBlockMap* _oldBlockMap;
+                  WaveBlockMap* _newBlockMap;
+                };
+            struct {
+                  // Owned by the operation.
+                  EventBatch* _eventBatch;
+                };
             struct {
                   int trackno;
                 };
@@ -231,8 +287,19 @@ struct UndoOp {
       // If _noUndo is set, the operation cannot be undone. It is a 'one time' operation, removed after execution.
       // It allows mixed undoable and non-undoable operations in one list, all executed in one RT cycle.
       bool _noUndo;
+
+      // The erase and add lists of a ModifyAudioCtrlValList operation, while packed.
+      UndoCtrlValChunkPtr _packedEraseCtrl;
+      UndoCtrlValChunkPtr _packedAddCtrl;
       
       const char* typeName();
+      // Rough number of bytes held by the operation.
+      size_t memoryUsage(bool doUndos, bool doRedos) const;
+      // Packs the controller lists of a ModifyAudioCtrlValList operation into shared chunks.
+      // Returns false if the operation cannot be packed.
+      bool pack(UndoCtrlValChunkCache& cache);
+      // Unpacks the controller lists again. The operation must be unpacked before it is executed.
+      void unpack();
       void dump();
       
       UndoOp();
@@ -252,6 +319,8 @@ struct UndoOp {
              Pos::TType new_time_type = Pos::TICKS, bool noUndo = false);
       UndoOp(UndoType type, const Event& nev, const Event& oev, const Part* part, bool doCtrls, bool doClones, bool noUndo = false);
       UndoOp(UndoType type, const Event& nev, const Part* part, bool, bool, bool noUndo = false);
+      // Takes the batch. The operation must be the only one changing the events of the part in its group.
+      UndoOp(UndoType type, EventBatch* batch, const Part* part, bool doCtrls, bool doClones, bool noUndo = false);
       UndoOp(UndoType type, const Event& changedEvent, const QString& changeData, int startframe, int endframe, bool noUndo = false);
       UndoOp(UndoType type, const Marker& oldMarker, const Marker& newMarker, bool noUndo = false);
       UndoOp(UndoType type, const Marker& marker, bool noUndo = false);
@@ -260,6 +329,10 @@ struct UndoOp {
       //UndoOp(UndoType type, MarkerList** oldMarkerList, MarkerList* newMarkerList, bool noUndo = false);
 
       UndoOp(UndoType type, const Track* track, const QString& old_name, const QString& new_name, bool noUndo = false);
+      // Sets or clears a track's freeze file. Either file can be null.
+      UndoOp(UndoType type, const Track* track, const SndFileR& oldFreezeFile, const SndFileR& newFreezeFile, bool noUndo = false);
+      // Switches a sound file between two copy-on-write block maps.
+      UndoOp(UndoType type, const SndFileR& file, WaveBlockMap* oldBlockMap, WaveBlockMap* newBlockMap, bool noUndo = false);
       // Because of C++ ambiguity complaints, these arguments are in a funny order.
       // It seems our CtrlVal(double) constructor can be interpreted as CtrlVal(unsigned int) !
       UndoOp(UndoType type, int ctrlID, unsigned int frame, const CtrlVal& cv, const Track* track, bool noUndo = false);
@@ -297,9 +370,12 @@ struct UndoOp {
 
 class Undo : public std::list<UndoOp> {
    public:
-      Undo() : std::list<UndoOp>() { combobreaker=false; }
-      Undo(const Undo& other) : std::list<UndoOp>(other) { this->combobreaker=other.combobreaker; }
-      Undo& operator=(const Undo& other) { std::list<UndoOp>::operator=(other); this->combobreaker=other.combobreaker; return *this;}
+      Undo() : std::list<UndoOp>() { combobreaker=false; _packed=false; _memory=0; }
+      Undo(const Undo& other) : std::list<UndoOp>(other)
+        { this->combobreaker=other.combobreaker; this->_packed=other._packed; this->_memory=other._memory; }
+      Undo& operator=(const Undo& other)
+        { std::list<UndoOp>::operator=(other); this->combobreaker=other.combobreaker;
+          this->_packed=other._packed; this->_memory=other._memory; return *this;}
 
       bool empty() const;
       
@@ -321,6 +397,18 @@ class Undo : public std::list<UndoOp> {
       void insert(iterator position, const UndoOp& op);
       void insert (iterator position, size_type n, const UndoOp& op);
       iterator deleteAndErase(iterator);
+
+      // Packs the operations for keeping in the history, and remembers their memory usage.
+      void pack(UndoCtrlValChunkCache& cache, bool doUndos, bool doRedos);
+      // Unpacks the operations, before executing or reverting them.
+      void unpack();
+      bool packed() const { return _packed; }
+      size_t memoryUsage(bool doUndos, bool doRedos) const;
+
+   private:
+      bool _packed;
+      // Memory usage, while packed.
+      size_t _memory;
 };
 
 typedef Undo::iterator iUndoOp;
@@ -331,9 +419,18 @@ typedef Undo::const_reverse_iterator criUndoOp;
 class UndoList : public std::list<Undo> {
    protected:
       bool isUndo;
+      UndoCtrlValChunkCache _ctrlChunks;
    public:
       void clearDelete();
       UndoList(bool _isUndo) : std::list<Undo>() { isUndo=_isUndo; }
+
+      // Packs all steps but the newest one.
+      void pack();
+      // Rough number of bytes held by the list.
+      size_t memoryUsage() const;
+      // Deletes the oldest steps until the list holds no more than maxBytes,
+      //  always keeping the newest step. Returns true if steps were deleted.
+      bool trim(size_t maxBytes);
 };
 
 typedef UndoList::iterator iUndo;
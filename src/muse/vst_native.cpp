@@ -2899,7 +2899,7 @@ bool VstNativeSynthIF::getData(MidiPort* /*mp*/, unsigned pos, int ports, unsign
         {
           if(cl && plug_id != -1 && (unsigned long)cl->id() == genACnum(plug_id, k))
           {
-            cl->getInterpolation(slice_frame, no_auto || !_controls[k].enCtrl, &ci);
+            cl->getPlaybackInterpolation(slice_frame, no_auto || !_controls[k].enCtrl, &ci);
             if(icl != cll->end())
               ++icl;
           }
@@ -21,6 +21,9 @@
 //
 //=========================================================
 
+#include <vector>
+#include <algorithm>
+
 #include <QFile>
 #include <QFileInfo>
 #include <QString>
@@ -28,6 +31,7 @@
 #include <QMessageBox>
 
 #include "wave_helper.h"
+#include "wave_blocks.h"
 #include "globals.h"
 #include "gconfig.h"
 #include "song.h"
@@ -219,6 +223,86 @@ void sndFileApplyUndoFile(const Event& original, const QString* tmpfile, unsigne
       MusEGlobal::audio->msgIdle(false);
       }
 
+//---------------------------------------------------------
+//   sndFileEnsureBlockStore
+//---------------------------------------------------------
+
+bool sndFileEnsureBlockStore(SndFileR sndFile)
+      {
+      if (sndFile.isNull())
+            return false;
+      if (sndFile.hasBlockStore())
+            return true;
+      QString sidePath;
+      if (!MusEGlobal::getUniqueTmpfileName("tmp_musewav", ".blk", sidePath))
+            return false;
+      // The file's handles are swapped.
+      MusEGlobal::audio->msgIdle(true);
+      const bool err = sndFile.createBlockStore(sidePath);
+      MusEGlobal::audio->msgIdle(false);
+      if (err) {
+            fprintf(stderr, "sndFileEnsureBlockStore: Cannot edit %s - Aborting\n",
+                    sndFile.canonicalPath().toLocal8Bit().constData());
+            return false;
+            }
+      return true;
+      }
+
+//---------------------------------------------------------
+//   sndFileBlocksLoudest
+//---------------------------------------------------------
+
+float sndFileBlocksLoudest(SndFileR sndFile, const WaveBlockMap* map, sf_count_t pos, sf_count_t n)
+      {
+      const int channels = sndFile.channels();
+      const sf_count_t chunk = WaveBlockStore::BlockFrames;
+      std::vector<float> buffer(chunk * channels);
+      float* data[channels];
+      for (int i = 0; i < channels; ++i)
+            data[i] = buffer.data() + i * chunk;
+
+      float loudest = 0.0;
+      for (sf_count_t off = 0; off < n; off += chunk) {
+            const sf_count_t len = std::min(chunk, n - off);
+            sndFile.readBlocks(map, pos + off, channels, data, len);
+            for (int i = 0; i < channels; ++i) {
+                  for (sf_count_t j = 0; j < len; ++j) {
+                        if (data[i][j] > loudest)
+                              loudest = data[i][j];
+                        }
+                  }
+            }
+      return loudest;
+      }
+
+//---------------------------------------------------------
+//   sndFileBlocksGain
+//---------------------------------------------------------
+
+bool sndFileBlocksGain(SndFileR sndFile, WaveBlockMap* map, sf_count_t pos, sf_count_t n, double gain)
+      {
+      const int channels = sndFile.channels();
+      const sf_count_t chunk = WaveBlockStore::BlockFrames;
+      std::vector<float> buffer(chunk * channels);
+      float* data[channels];
+      for (int i = 0; i < channels; ++i)
+            data[i] = buffer.data() + i * chunk;
+
+      for (sf_count_t off = 0; off < n; ) {
+            // Keep to block boundaries, so that each block is written once.
+            const sf_count_t len = std::min(n - off, chunk - (pos + off) % chunk);
+            sndFile.readBlocks(map, pos + off, channels, data, len);
+            for (int i = 0; i < channels; ++i) {
+                  for (sf_count_t j = 0; j < len; ++j)
+                        data[i][j] = (float) ((double)data[i][j] * gain);
+                  }
+            if (sndFile.writeBlocks(map, pos + off, channels, data, len))
+                  return false;
+            off += len;
+            }
+      return true;
+      }
+
 //---------------------------------------------------------
 //   sndFileGetWave
 //   If audioConverterSettings and stretchList are given, they are assigned.
@@ -265,10 +349,10 @@ SndFileR sndFileGetWave(const QString& inName, bool readOnlyFlag, bool openFlag,
               error = f->openWrite();
               // if peak cache is older than wave file we reacquire the cache
               QFileInfo wavinfo(name);
-              QString cacheName = wavinfo.absolutePath() + QString("/") + wavinfo.completeBaseName() + QString(".wca");
+              QString cacheName = SndFile::peakFilePath(name);
               QFileInfo wcainfo(cacheName);
               if (!wcainfo.exists() || wcainfo.lastModified() < wavinfo.lastModified()) {
-                    QFile(cacheName).remove();
+                    SndFile::removePeakFiles(name);
                     f->readCache(cacheName,true);
                     }
 
@@ -278,7 +362,8 @@ SndFileR sndFileGetWave(const QString& inName, bool readOnlyFlag, bool openFlag,
                 name.toLocal8Bit().constData(),
                 readOnlyFlag ? "writing" : "reading",
                 f->strerror().toLocal8Bit().constData());
-                if(showErrorBox)
+                // Nobody to click it away when rendering from the command line.
+                if(showErrorBox && !(MusEGlobal::muse && MusEGlobal::muse->headless()))
                   QMessageBox::critical(nullptr, QObject::tr("MusE import error."),
                                   QObject::tr("MusE failed to import the file.\n"
                                   "Possibly this wasn't a sound file?\n"
@@ -33,6 +33,14 @@ namespace MusECore {
 
 extern bool sndFileCheckCopyOnWrite(const SndFileR sndFile);
 extern void sndFileApplyUndoFile(const Event& original, const QString* tmpfile, unsigned startframe, unsigned endframe);
+// Gives a sound file a copy-on-write block store for destructive edits, with its side
+//  file in the project's tmp_musewav directory. Returns false on error.
+extern bool sndFileEnsureBlockStore(SndFileR sndFile);
+// Returns the loudest positive sample of frames [pos, pos + n) as described by a block map.
+extern float sndFileBlocksLoudest(SndFileR sndFile, const WaveBlockMap* map, sf_count_t pos, sf_count_t n);
+// Applies a gain to frames [pos, pos + n) of a block map from SndFile::newBlockMap(),
+//  one block at a time. Returns false on error.
+extern bool sndFileBlocksGain(SndFileR sndFile, WaveBlockMap* map, sf_count_t pos, sf_count_t n, double gain);
 // If audioConverterSettings and stretchList are given, they are assigned.
 extern SndFileR sndFileGetWave(const QString& name, bool readOnlyFlag, bool openFlag = true, bool showErrorBox = true, 
                  const AudioConverterSettingsGroup* audioConverterSettings = nullptr, const StretchList* stretchList = nullptr);
@@ -47,6 +47,8 @@
 
 #include <set>
 
+#include <vector>
+#include <algorithm>
 #include <limits.h>
 #include <stdio.h>
 #include "muse_math.h"
@@ -66,6 +68,7 @@
 #include "shortcuts.h"
 #include "editgain.h"
 #include "wave.h"
+#include "wave_blocks.h"
 #include "waveedit.h"
 #include "fastlog.h"
 #include "utils.h"
@@ -241,7 +244,7 @@ void WaveCanvas::updateItems()
 
 void WaveCanvas::songChanged(MusECore::SongChangedStruct_t flags)
       {
-      if (flags & ~(SC_SELECTION | SC_PART_SELECTION | SC_TRACK_SELECTION)) {
+      if (flags & ~(SC_SELECTION | SC_PART_SELECTION | SC_TRACK_SELECTION | SC_WAVE_PEAKS)) {
             // TODO FIXME: don't we actually only want SC_PART_*, and maybe SC_TRACK_DELETED?
             //             (same in waveview.cpp)
             updateItems();
@@ -296,7 +299,7 @@ void WaveCanvas::songChanged(MusECore::SongChangedStruct_t flags)
       }
             
       
-      if (flags & SC_CLIP_MODIFIED) {
+      if (flags & (SC_CLIP_MODIFIED | SC_WAVE_PEAKS)) {
             redraw(); // Boring, but the only thing possible to do
             }
       if (flags & SC_TEMPO) {
@@ -2925,6 +2928,18 @@ void WaveCanvas::modifySelection(int operation, unsigned startpos, unsigned stop
             QString newFilePath;
             if(MusECore::getUniqueFileName(filePath, newFilePath))
             {
+              // The copy must have the edits made so far.
+              if(file.hasBlockEdits())
+              {
+                MusEGlobal::audio->msgIdle(true);
+                const bool err = file.commitBlocks();
+                MusEGlobal::audio->msgIdle(false);
+                if(err)
+                {
+                  printf("MusE Error: Could not write pending edits to sound file: %s\n", file.canonicalPath().toLocal8Bit().constData());
+                  continue;
+                }
+              }
               {
                 QFile qf(file.canonicalPath());
                 if(!qf.copy(newFilePath)) // Copy the file
@@ -2996,7 +3011,12 @@ void WaveCanvas::modifySelection(int operation, unsigned startpos, unsigned stop
           }
         }
          
-         MusEGlobal::song->startUndo();
+         //
+         // Edits are written into new blocks of each file's block store, and take
+         //  effect when the operation group swaps in the new block maps.
+         //
+         const unsigned chunk = MusECore::WaveBlockStore::BlockFrames;
+         std::vector<std::pair<MusECore::SndFileR, MusECore::WaveBlockMap*> > edits;
          for (MusECore::iWaveSelection i = selection.begin(); i != selection.end(); i++) {
                MusECore::WaveEventSelection w = *i;
                if(w.event.empty())
@@ -3007,79 +3027,113 @@ void WaveCanvas::modifySelection(int operation, unsigned startpos, unsigned stop
                unsigned sx            = w.startframe;
                unsigned ex            = w.endframe;
                unsigned file_channels = file.channels();
+               if (ex <= sx)
+                     continue;
 
-               QString tmpWavFile;
-               if (!MusEGlobal::getUniqueTmpfileName("tmp_musewav",".wav", tmpWavFile)) {
+               if (!MusECore::sndFileEnsureBlockStore(file))
                      break;
-                     }
 
-               MusEGlobal::audio->msgIdle(true); // Not good with playback during operations
-               MusECore::SndFile tmpFile(tmpWavFile);
-               tmpFile.setFormat(file.format(), file_channels, file.samplerate());
-               if (tmpFile.openWrite()) {
-                     MusEGlobal::audio->msgIdle(false);
-                     printf("Could not open temporary file...\n");
-                     break;
+               // One edit map per file, shared by all selections of the file.
+               MusECore::WaveBlockMap* map = nullptr;
+               for (auto& e : edits) {
+                     if (e.first.canonicalPath() == file.canonicalPath()) {
+                           map = e.second;
+                           break;
+                           }
+                     }
+               if (!map && operation != COPY) {
+                     map = file.newBlockMap();
+                     edits.push_back(std::make_pair(file, map));
                      }
 
-               //
-               // Write out data that will be changed to temp file
-               //
                unsigned tmpdatalen = ex - sx;
                off_t    tmpdataoffset = sx;
-               float*   tmpdata[file_channels];
-
-               for (unsigned i=0; i<file_channels; i++) {
-                     tmpdata[i] = new float[tmpdatalen];
-                     }
-               file.seek(tmpdataoffset, 0);
-               file.readWithHeap(file_channels, tmpdata, tmpdatalen);
-               file.close();
-               tmpFile.write(file_channels, tmpdata, tmpdatalen, MusEGlobal::config.liveWaveUpdate);
-               tmpFile.close();
+               bool     error = false;
 
                switch(operation)
                {
                      case MUTE:
-                           muteSelection(file_channels, tmpdata, tmpdatalen);
-                           break;
-
                      case NORMALIZE:
-                           normalizeSelection(file_channels, tmpdata, tmpdatalen);
-                           break;
-
                      case FADE_IN:
-                           fadeInSelection(file_channels, tmpdata, tmpdatalen);
-                           break;
-
                      case FADE_OUT:
-                           fadeOutSelection(file_channels, tmpdata, tmpdatalen);
+                     case GAIN:
+                           {
+                           // Per-sample operations go through one block at a time.
+                           double gain = paramA;
+                           if (operation == NORMALIZE) {
+                                 float loudest = MusECore::sndFileBlocksLoudest(file, map, sx, tmpdatalen);
+                                 gain = loudest > 0.0 ? 0.99 / (double)loudest : 1.0;
+                                 }
+                           std::vector<float> buffer(chunk * file_channels);
+                           float* tmpdata[file_channels];
+                           for (unsigned i=0; i<file_channels; i++)
+                                 tmpdata[i] = buffer.data() + i * chunk;
+
+                           for (unsigned off = 0; off < tmpdatalen && !error; ) {
+                                 // Keep to block boundaries, so that each block is written once.
+                                 unsigned n = std::min(tmpdatalen - off, chunk - (sx + off) % chunk);
+                                 if (operation != MUTE)
+                                       file.readBlocks(map, sx + off, file_channels, tmpdata, n);
+                                 switch(operation)
+                                 {
+                                       case MUTE:
+                                             muteSelection(file_channels, tmpdata, n);
+                                             break;
+                                       case FADE_IN:
+                                             fadeInSelection(file_channels, tmpdata, n, off, tmpdatalen);
+                                             break;
+                                       case FADE_OUT:
+                                             fadeOutSelection(file_channels, tmpdata, n, off, tmpdatalen);
+                                             break;
+                                       default:
+                                             applyGain(file_channels, tmpdata, n, gain);
+                                             break;
+                                 }
+                                 error = file.writeBlocks(map, sx + off, file_channels, tmpdata, n);
+                                 off += n;
+                                 }
+                           }
                            break;
 
                      case REVERSE:
-                           reverseSelection(file_channels, tmpdata, tmpdatalen);
-                           break;
-
-                     case GAIN:
-                           applyGain(file_channels, tmpdata, tmpdatalen, paramA);
-                           break;
                      case CUT:
-                           copySelection(file_channels, tmpdata, tmpdatalen, true, file.format(), file.samplerate());
-                           break;
                      case COPY:
-                           copySelection(file_channels, tmpdata, tmpdatalen, false, file.format(), file.samplerate());
-                           break;
                      case PASTE:
+                     case EDIT_EXTERNAL:
+                           {
+                           // These need the whole selection at once.
+                           std::vector<float> buffer((size_t)tmpdatalen * file_channels);
+                           float* tmpdata[file_channels];
+                           for (unsigned i=0; i<file_channels; i++)
+                                 tmpdata[i] = buffer.data() + (size_t)i * tmpdatalen;
+                           file.readBlocks(map ? map : file.blockMap(), tmpdataoffset, file_channels, tmpdata, tmpdatalen);
+
+                           switch(operation)
                            {
-                           MusECore::SndFile pasteFile(copiedPart);
-                           pasteFile.openRead();
-                           pasteFile.seek(tmpdataoffset, 0);
-                           pasteFile.readWithHeap(file_channels, tmpdata, tmpdatalen);
+                                 case REVERSE:
+                                       reverseSelection(file_channels, tmpdata, tmpdatalen);
+                                       break;
+                                 case CUT:
+                                       copySelection(file_channels, tmpdata, tmpdatalen, true, file.format(), file.samplerate());
+                                       break;
+                                 case COPY:
+                                       copySelection(file_channels, tmpdata, tmpdatalen, false, file.format(), file.samplerate());
+                                       break;
+                                 case PASTE:
+                                       {
+                                       MusECore::SndFile pasteFile(copiedPart);
+                                       pasteFile.openRead();
+                                       pasteFile.seek(tmpdataoffset, 0);
+                                       pasteFile.readWithHeap(file_channels, tmpdata, tmpdatalen);
+                                       }
+                                       break;
+                                 case EDIT_EXTERNAL:
+                                       editExternal(file.format(), file.samplerate(), file_channels, tmpdata, tmpdatalen);
+                                       break;
+                           }
+                           if (map)
+                                 error = file.writeBlocks(map, tmpdataoffset, file_channels, tmpdata, tmpdatalen);
                            }
-                           break;
-
-                     case EDIT_EXTERNAL:
-                           editExternal(file.format(), file.samplerate(), file_channels, tmpdata, tmpdatalen);
                            break;
 
                      default:
@@ -3088,22 +3142,18 @@ void WaveCanvas::modifySelection(int operation, unsigned startpos, unsigned stop
 
                }
 
-               file.openWrite();
-               file.seek(tmpdataoffset, 0);
-               file.write(file_channels, tmpdata, tmpdatalen, MusEGlobal::config.liveWaveUpdate);
-               file.update();
-               file.close();
-               file.openRead();
-
-               for (unsigned i=0; i<file_channels; i++) {
-                     delete[] tmpdata[i];
+               if (error) {
+                     printf("Could not write edited blocks of %s\n", file.canonicalPath().toLocal8Bit().constData());
+                     break;
                      }
-
-               // Undo handling
-               MusEGlobal::song->cmdChangeWave(w.event, tmpWavFile, sx, ex);
-               MusEGlobal::audio->msgIdle(false); // Not good with playback during operations
                }
-         MusEGlobal::song->endUndo(SC_CLIP_MODIFIED);
+
+         // Undo handling
+         MusECore::Undo operations;
+         for (auto& e : edits)
+               operations.push_back(MusECore::UndoOp(MusECore::UndoOp::ModifyWaveBlocks, e.first, e.first.blockMap(), e.second));
+         if (!operations.empty())
+               MusEGlobal::song->applyOperationGroup(operations);
          redraw();
       }
 
@@ -3148,37 +3198,14 @@ void WaveCanvas::muteSelection(unsigned channels, float** data, unsigned length)
             }
       }
 
-//---------------------------------------------------------
-//   normalizeSelection
-//---------------------------------------------------------
-void WaveCanvas::normalizeSelection(unsigned channels, float** data, unsigned length)
-      {
-      float loudest = 0.0;
-
-      for (unsigned i=0; i<channels; i++) {
-            for (unsigned j=0; j<length; j++) {
-                  if (data[i][j]  > loudest)
-                        loudest = data[i][j];
-                  }
-            }
-
-      double scale = 0.99 / (double)loudest;
-
-      for (unsigned i=0; i<channels; i++) {
-            for (unsigned j=0; j<length; j++) {
-                  data[i][j] = (float) ((double)data[i][j] * scale);
-                  }
-            }
-      }
-
 //---------------------------------------------------------
 //   fadeInSelection
 //---------------------------------------------------------
-void WaveCanvas::fadeInSelection(unsigned channels, float** data, unsigned length)
+void WaveCanvas::fadeInSelection(unsigned channels, float** data, unsigned length, unsigned offset, unsigned total)
       {
       for (unsigned i=0; i<channels; i++) {
             for (unsigned j=0; j<length; j++) {
-                  double scale = (double) j / (double)length ;
+                  double scale = (double) (offset + j) / (double)total ;
                   data[i][j] = (float) ((double)data[i][j] * scale);
                   }
             }
@@ -3187,11 +3214,11 @@ void WaveCanvas::fadeInSelection(unsigned channels, float** data, unsigned lengt
 //---------------------------------------------------------
 //   fadeOutSelection
 //---------------------------------------------------------
-void WaveCanvas::fadeOutSelection(unsigned channels, float** data, unsigned length)
+void WaveCanvas::fadeOutSelection(unsigned channels, float** data, unsigned length, unsigned offset, unsigned total)
       {
       for (unsigned i=0; i<channels; i++) {
             for (unsigned j=0; j<length; j++) {
-                  double scale = (double) (length - j) / (double)length ;
+                  double scale = (double) (total - offset - j) / (double)total ;
                   data[i][j] = (float) ((double)data[i][j] * scale);
                   }
             }
@@ -3296,7 +3323,7 @@ void WaveCanvas::editExternal(unsigned file_format, unsigned file_samplerate, un
           }
       QDir dir = exttmpFile.dirPath();
       dir.remove(exttmpFileName);
-      dir.remove(exttmpFile.basename() + ".wca");
+      MusECore::SndFile::removePeakFiles(exttmpFileName);
       }
 
       
@@ -161,9 +161,10 @@ class WaveCanvas : public EventCanvas {
       MusECore::WaveSelectionList getSelection(unsigned startpos, unsigned stoppos);
       void modifySelection(int operation, unsigned startpos, unsigned stoppos, double paramA); //!< Modifies selection
       void muteSelection(unsigned channels, float** data, unsigned length); //!< Mutes selection
-      void normalizeSelection(unsigned channels, float** data, unsigned length); //!< Normalizes selection
-      void fadeInSelection(unsigned channels, float** data, unsigned length); //!< Linear fade in of selection
-      void fadeOutSelection(unsigned channels, float** data, unsigned length); //!< Linear fade out of selection
+      //! Linear fade in of length frames at offset into a selection of total frames
+      void fadeInSelection(unsigned channels, float** data, unsigned length, unsigned offset, unsigned total);
+      //! Linear fade out of length frames at offset into a selection of total frames
+      void fadeOutSelection(unsigned channels, float** data, unsigned length, unsigned offset, unsigned total);
       void reverseSelection(unsigned channels, float** data, unsigned length); //!< Reverse selection
       void applyGain(unsigned channels, float** data, unsigned length, double gain); //!< Apply gain to selection
       void copySelection(unsigned file_channels, float** tmpdata, unsigned tmpdatalen, bool blankData, unsigned format, unsigned sampleRate);
@@ -33,6 +33,7 @@
 #include "part.h"
 #include "wave_helper.h"
 #include "audio_fifo.h"
+#include "memory.h"
 
 #include <iostream>
 #include "muse_math.h"
@@ -43,6 +44,35 @@
 
 namespace MusECore {
 
+//---------------------------------------------------------
+//   operator new, operator delete
+//    WaveEventBases come from a pool shared by all threads.
+//    The pool is never destroyed, so that events which
+//     outlive static destruction can still be deleted.
+//---------------------------------------------------------
+
+static SharedTypedMemoryPool<WaveEventBase, 256>& eventPool()
+      {
+      static SharedTypedMemoryPool<WaveEventBase, 256>* pool = new SharedTypedMemoryPool<WaveEventBase, 256>();
+      return *pool;
+      }
+
+void* WaveEventBase::operator new(size_t size)
+      {
+      if (size != sizeof(WaveEventBase))
+            return ::operator new(size);
+      return eventPool().alloc();
+      }
+
+void WaveEventBase::operator delete(void* p, size_t size)
+      {
+      if (size != sizeof(WaveEventBase)) {
+            ::operator delete(p);
+            return;
+            }
+      eventPool().free(p);
+      }
+
 //---------------------------------------------------------
 //   WaveEvent
 //---------------------------------------------------------
@@ -49,6 +49,10 @@ class WaveEventBase : public EventBase {
       virtual EventBase* duplicate() const { return new WaveEventBase(*this, true); } 
 
    public:
+      // Allocated from a pool. See waveevent.cpp.
+      static void* operator new(size_t size);
+      static void operator delete(void* p, size_t size);
+
       WaveEventBase(EventType t);
       // Creates a non-shared clone with same id, or duplicate with unique id, and 0 ref count and invalid Pos sn. 
       WaveEventBase(const WaveEventBase& ev, bool duplicate_not_clone = false);
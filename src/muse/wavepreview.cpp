@@ -1,5 +1,12 @@
 #include "wavepreview.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <QLayout>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QFileSystemModel>
+#include <QAbstractItemView>
 
 
 namespace MusEGlobal
@@ -10,159 +17,409 @@ MusECore::WavePreview *wavePreview = nullptr;
 namespace MusECore
 {
 
-WavePreview::WavePreview(int segmentSize):
-   sf(0),
-   src(0),
-   isPlaying(false),
-   sem(1)
+WavePreview::WavePreview(int /*segmentSize*/):
+   _writeIdx(0),
+   _readIdx(0),
+   _readPos(0),
+   _playingSerial(0),
+   _lastSerial(0),
+   _quit(false),
+   _playRequested(false),
+   _playSampleRate(0),
+   _playSerial(0),
+   _headBytes(0)
 {
-   segSize = segmentSize * 10;
-   tmpbuffer = new float [segSize];
-   srcbuffer = new float [segSize];
+   _blocks = new Block [NumBlocks];
+   _stream.headPos = 0;
+   _stream.sf = 0;
+   _stream.src = 0;
+   _stream.ratio = 1.0;
+   _stream.serial = 0;
+   _stream.done = true;
+   _stream.eof = false;
+   _thread = std::thread(&WavePreview::run, this);
 }
 
 WavePreview::~WavePreview()
 {
-   stop();
-   delete[] tmpbuffer;
-   delete[] srcbuffer;
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _playingSerial.store(0, std::memory_order_release);
+      _quit = true;
+      _cond.notify_one();
+   }
+   _thread.join();
+   closeStream();
+   delete[] _blocks;
 }
 
-long WavePreview::static_srcCallback (void *cb_data, float **data)
+//---------------------------------------------------------
+//   play
+//---------------------------------------------------------
+
+void WavePreview::play(QString path, int systemSampleRate)
 {
-   MusECore::WavePreview *wp = (MusECore::WavePreview *)cb_data;
-   wp->nread = sf_readf_float(wp->sf, wp->tmpbuffer, wp->segSize / wp->sfi.channels);
-   *data = wp->tmpbuffer;
-   return wp->nread;
+   std::lock_guard<std::mutex> lock(_mutex);
+   if(++_lastSerial == 0)
+      ++_lastSerial;
+   // From now on the audio thread skips any blocks of an earlier file.
+   _playingSerial.store(_lastSerial, std::memory_order_release);
+   _playRequested = true;
+   _playPath = path;
+   _playSampleRate = systemSampleRate;
+   _playSerial = _lastSerial;
+   _cond.notify_one();
 }
 
-void WavePreview::play(QString path, int systemSampleRate)
+//---------------------------------------------------------
+//   stop
+//---------------------------------------------------------
+
+void WavePreview::stop()
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   _playingSerial.store(0, std::memory_order_release);
+   _playRequested = true;
+   _playPath.clear();
+   _cond.notify_one();
+}
+
+//---------------------------------------------------------
+//   prefetch
+//---------------------------------------------------------
+
+void WavePreview::prefetch(const QString& path)
 {
-   stop();
-   memset(&sfi, 0, sizeof(sfi));   
-   sf = sf_open(path.toUtf8().data(), SFM_READ, &sfi);
-   if(sf)
+   std::lock_guard<std::mutex> lock(_mutex);
+   if(std::find(_prefetch.begin(), _prefetch.end(), path) != _prefetch.end())
+      return;
+   // The latest first. Forget the oldest ones if the mouse moves faster than we read.
+   _prefetch.push_front(path);
+   if(_prefetch.size() > 32)
+      _prefetch.pop_back();
+   _cond.notify_one();
+}
+
+//---------------------------------------------------------
+//   run
+//    The reader thread.
+//---------------------------------------------------------
+
+void WavePreview::run()
+{
+   std::unique_lock<std::mutex> lock(_mutex);
+   for(;;)
    {
-      int err = 0;
-      //src = src_new(SRC_SINC_BEST_QUALITY, sfi.channels, &err);
-      src = src_callback_new(static_srcCallback, SRC_SINC_MEDIUM_QUALITY, sfi.channels, &err, this);
-      if(src)
+      if(_quit)
+         break;
+
+      if(_playRequested)
       {
-         p1 = tmpbuffer;
-         p2 = srcbuffer;      
-         f1 = 0;
-         f2 = 0;
-         nread = 0;
-         sd.src_ratio = ((double)systemSampleRate) / (double)sfi.samplerate;
-         isPlaying = true;      
+         _playRequested = false;
+         const QString path = _playPath;
+         const int sampleRate = _playSampleRate;
+         const unsigned int serial = _playSerial;
+         lock.unlock();
+         closeStream();
+         if(!path.isEmpty())
+            openStream(path, sampleRate, serial);
+         lock.lock();
+         continue;
       }
-      else
+
+      // Keep the ring full.
+      if(_stream.src)
+      {
+         lock.unlock();
+         if(!fillBlocks())
+            closeStream();
+         lock.lock();
+      }
+
+      if(!_prefetch.empty())
       {
-         sf_close(sf);
-         sf = 0;
+         const QString path = _prefetch.front();
+         _prefetch.pop_front();
+         lock.unlock();
+         if(!findHead(path))
+            loadHead(path);
+         lock.lock();
+         continue;
       }
 
+      // Posted while the ring was being filled?
+      if(_quit || _playRequested)
+         continue;
+
+      if(_stream.src)
+         _cond.wait_for(lock, std::chrono::milliseconds(10));
+      else
+         _cond.wait(lock);
    }
+}
 
+//---------------------------------------------------------
+//   findHead
+//    Returns the cached head of a file, if it is still
+//     up to date.
+//---------------------------------------------------------
+
+std::shared_ptr<const WavePreview::Head> WavePreview::findHead(const QString& path)
+{
+   for(std::list<std::shared_ptr<const Head> >::iterator i = _heads.begin(); i != _heads.end(); ++i)
+   {
+      if((*i)->path != path)
+         continue;
+      const QFileInfo fi(path);
+      if(fi.size() != (*i)->fileSize || fi.lastModified().toMSecsSinceEpoch() != (*i)->fileTime)
+      {
+         _headBytes -= (*i)->data.size() * sizeof(float);
+         _heads.erase(i);
+         return std::shared_ptr<const Head>();
+      }
+      // Most recently used first.
+      _heads.splice(_heads.begin(), _heads, i);
+      return _heads.front();
+   }
+   return std::shared_ptr<const Head>();
 }
 
-void WavePreview::stop()
+//---------------------------------------------------------
+//   loadHead
+//    Decodes the first seconds of a file into the cache.
+//---------------------------------------------------------
+
+std::shared_ptr<const WavePreview::Head> WavePreview::loadHead(const QString& path)
 {
-   isPlaying = false;
-   sem.acquire();
-   if(sf)
+   const QFileInfo fi(path);
+   SF_INFO sfi;
+   memset(&sfi, 0, sizeof(sfi));
+   SNDFILE *sf = sf_open(path.toUtf8().constData(), SFM_READ, &sfi);
+   if(!sf)
+      return std::shared_ptr<const Head>();
+   if(sfi.channels <= 0 || sfi.samplerate <= 0)
    {
       sf_close(sf);
-      sf = 0;
+      return std::shared_ptr<const Head>();
    }
-   if(src)
+
+   std::shared_ptr<Head> head = std::make_shared<Head>();
+   head->path = path;
+   head->fileSize = fi.size();
+   head->fileTime = fi.lastModified().toMSecsSinceEpoch();
+   head->channels = sfi.channels;
+   head->sampleRate = sfi.samplerate;
+   sf_count_t want = (sf_count_t)HeadSeconds * sfi.samplerate;
+   if(sfi.frames > 0 && sfi.frames < want)
+      want = sfi.frames;
+   head->data.resize(want * sfi.channels);
+   head->frames = sf_readf_float(sf, head->data.data(), want);
+   if(head->frames < 0)
+      head->frames = 0;
+   head->data.resize(head->frames * sfi.channels);
+   head->data.shrink_to_fit();
+   head->complete = head->frames < want || head->frames == sfi.frames;
+   sf_close(sf);
+
+   _heads.push_front(head);
+   _headBytes += head->data.size() * sizeof(float);
+   // Forget the least recently used heads. Any stream still holds on to its own.
+   while(_headBytes > HeadCacheBytes && _heads.size() > 1)
    {
-      src_delete(src);
-      src = 0;           
+      _headBytes -= _heads.back()->data.size() * sizeof(float);
+      _heads.pop_back();
    }
-   sem.release();
+   return head;
 }
 
-void WavePreview::addData(int channels, int nframes, float *buffer[])
+//---------------------------------------------------------
+//   openStream
+//---------------------------------------------------------
+
+void WavePreview::openStream(const QString& path, int systemSampleRate, unsigned int serial)
+{
+   std::shared_ptr<const Head> head = findHead(path);
+   if(!head)
+      head = loadHead(path);
+   int err = 0;
+   SRC_STATE *src = head ? src_callback_new(static_srcCallback, SRC_SINC_MEDIUM_QUALITY, head->channels, &err, this) : 0;
+   if(!src)
+   {
+      // Nothing to play. Unless something else was started meanwhile, stop.
+      unsigned int s = serial;
+      _playingSerial.compare_exchange_strong(s, 0, std::memory_order_acq_rel);
+      return;
+   }
+
+   _stream.head = head;
+   _stream.headPos = 0;
+   _stream.sf = 0;
+   _stream.src = src;
+   _stream.ratio = ((double)systemSampleRate) / (double)head->sampleRate;
+   _stream.serial = serial;
+   _stream.done = false;
+   _stream.eof = false;
+   _stream.readBuffer.resize(BlockFrames * head->channels);
+   _stream.srcBuffer.resize(BlockFrames * head->channels);
+}
+
+//---------------------------------------------------------
+//   closeStream
+//---------------------------------------------------------
+
+void WavePreview::closeStream()
+{
+   if(_stream.sf)
+   {
+      sf_close(_stream.sf);
+      _stream.sf = 0;
+   }
+   if(_stream.src)
+   {
+      src_delete(_stream.src);
+      _stream.src = 0;
+   }
+   _stream.head.reset();
+   _stream.done = true;
+}
+
+//---------------------------------------------------------
+//   static_srcCallback
+//    Feeds the resampler the cached head, then the rest
+//     of the file.
+//---------------------------------------------------------
+
+long WavePreview::static_srcCallback (void *cb_data, float **data)
 {
-   if(sf && isPlaying)
-   {     
-      sem.acquire();
+   Stream& st = ((WavePreview *)cb_data)->_stream;
+   const Head& head = *st.head;
+   if(st.headPos < head.frames)
+   {
+      const sf_count_t n = std::min<sf_count_t>(head.frames - st.headPos, BlockFrames);
+      // The resampler only reads the input.
+      *data = const_cast<float *>(head.data.data()) + st.headPos * head.channels;
+      st.headPos += n;
+      return n;
+   }
+   if(head.complete || st.eof)
+      return 0;
 
-      if(!isPlaying)
+   if(!st.sf)
+   {
+      memset(&st.sfi, 0, sizeof(st.sfi));
+      st.sf = sf_open(head.path.toUtf8().constData(), SFM_READ, &st.sfi);
+      if(!st.sf || st.sfi.channels != head.channels || sf_seek(st.sf, head.frames, SEEK_SET) < 0)
       {
-         sem.release();
-         return;
+         st.eof = true;
+         return 0;
       }
+   }
+   const sf_count_t n = sf_readf_float(st.sf, st.readBuffer.data(), BlockFrames);
+   if(n <= 0)
+   {
+      st.eof = true;
+      return 0;
+   }
+   *data = st.readBuffer.data();
+   return n;
+}
 
-      memset(srcbuffer, 0, sizeof(segSize) * sizeof(float));
-      /*p2 = srcbuffer;
-      f2 = 0; 
-      
-      while(true)
-      {         
-         if(nread <= 0)
-         {
-            f1 = 0;
-            p1 = tmpbuffer;
-            nread = sf_readf_float(sf, tmpbuffer, nframes);
+//---------------------------------------------------------
+//   fillBlocks
+//---------------------------------------------------------
 
-            if(nread <= 0)
-            {
-               isPlaying = false;
-               return;
-            }
-         }
-         sd.data_in = p1;
-         sd.data_out = p2;
-         sd.end_of_input = (nread == nframes) ? false : true;
-         sd.input_frames = nread;
-         sd.output_frames = nframes - f2;
-         sd.input_frames_used = sd.output_frames_gen = 0;
-         int err = src_process(src, &sd);
-         if(err != 0)
-         {
-            break;
-         }
-         p1 += sd.input_frames_used * sfi.channels;
-         p2 += sd.output_frames_gen * sfi.channels;
-         f1 += sd.input_frames_used;
-         f2 += sd.output_frames_gen;
-         nread -= sd.input_frames_used;
-         if((f2 >= nframes) || sd.end_of_input)
-         {
-            break;
-         }         
-      }*/
-      
-      int rd = src_callback_read(src, sd.src_ratio, nframes, srcbuffer);
-      if(rd < nframes)
+bool WavePreview::fillBlocks()
+{
+   const int fileChannels = _stream.head->channels;
+   const int chans = std::min(fileChannels, MaxChannels);
+   while(!_stream.done)
+   {
+      // Stopped, or another file was started?
+      if(_playingSerial.load(std::memory_order_acquire) != _stream.serial)
+         return false;
+      const unsigned int w = _writeIdx.load(std::memory_order_relaxed);
+      if(w - _readIdx.load(std::memory_order_acquire) >= NumBlocks)
+         return true;
+
+      Block& b = _blocks[w % NumBlocks];
+      long rd = src_callback_read(_stream.src, _stream.ratio, BlockFrames, _stream.srcBuffer.data());
+      if(rd < 0)
+         rd = 0;
+      for(long k = 0; k < rd; ++k)
       {
-         isPlaying = false;
+         for(int i = 0; i < chans; ++i)
+            b.data[k * MaxChannels + i] = _stream.srcBuffer[k * fileChannels + i];
       }
+      b.serial = _stream.serial;
+      b.channels = chans;
+      b.frames = rd;
+      b.last = rd < BlockFrames;
+      _stream.done = b.last;
+      _writeIdx.store(w + 1, std::memory_order_release);
+   }
+   return false;
+}
+
+//---------------------------------------------------------
+//   addData
+//    Mixes the next blocks into the buffers. Audio thread only.
+//---------------------------------------------------------
 
-      if(rd == 0)
+void WavePreview::addData(int channels, int nframes, float *buffer[])
+{
+   const unsigned int serial = _playingSerial.load(std::memory_order_acquire);
+   if(serial == 0)
+      return;
+
+   int done = 0;
+   while(done < nframes)
+   {
+      const unsigned int r = _readIdx.load(std::memory_order_relaxed);
+      // Nothing read yet? Play silence until the reader catches up.
+      if(r == _writeIdx.load(std::memory_order_acquire))
+         break;
+
+      const Block& b = _blocks[r % NumBlocks];
+      // Skip what is left of an earlier file.
+      if(b.serial != serial)
       {
-         sem.release();
-         return;
+         _readPos = 0;
+         _readIdx.store(r + 1, std::memory_order_release);
+         continue;
       }
-      
-      int chns = std::min(channels, sfi.channels);
+
+      const int n = std::min(b.frames - _readPos, nframes - done);
+      const int chns = std::min(channels, b.channels);
       for(int i = 0; i < chns; i++)
       {
          if(!buffer[i])
            continue;
-         for(int k = 0; k < nframes; k++)
+         const float *src = b.data + _readPos * MaxChannels + i;
+         for(int k = 0; k < n; k++)
          {
-            buffer [i] [k] += srcbuffer [k * sfi.channels + i];
-            if((channels > 1) && (sfi.channels == 1))
+            buffer [i] [done + k] += src [k * MaxChannels];
+            if((channels > 1) && (b.channels == 1) && buffer [1])
             {
-               buffer [1] [k] += srcbuffer [k * sfi.channels + i];
+               buffer [1] [done + k] += src [k * MaxChannels];
             }
+         }
+      }
+      _readPos += n;
+      done += n;
 
+      if(_readPos >= b.frames)
+      {
+         const bool last = b.last;
+         _readPos = 0;
+         _readIdx.store(r + 1, std::memory_order_release);
+         if(last)
+         {
+            // Finished. Unless something else was started meanwhile, stop.
+            unsigned int s = serial;
+            _playingSerial.compare_exchange_strong(s, 0, std::memory_order_acq_rel);
+            break;
          }
       }
-      sem.release();
    }
 }
 
@@ -193,6 +450,16 @@ void AudioPreviewDialog::urlChanged(const QString &str)
    }
 }
 
+void AudioPreviewDialog::itemEntered(const QModelIndex &index)
+{
+   // Read ahead the file under the mouse, so that it plays at once when selected.
+   const QString path = index.data(QFileSystemModel::FilePathRole).toString();
+   if(!path.isEmpty())
+   {
+      MusEGlobal::wavePreview->prefetch(path);
+   }
+}
+
 void AudioPreviewDialog::startStopWave()
 {
    if(MusEGlobal::wavePreview->getIsPlaying())
@@ -249,6 +516,16 @@ AudioPreviewDialog::AudioPreviewDialog(QWidget *parent, int systemSampleRate)
     //this->layout()->addWidget(cb);
     this->layout()->addWidget(chAutoPlay);
     this->layout()->addWidget(btnStop);
+
+    const char *viewNames [] = { "listView", "treeView" };
+    for(const char *viewName : viewNames)
+    {
+       QAbstractItemView *v = findChild<QAbstractItemView *>(viewName);
+       if(!v)
+         continue;
+       v->setMouseTracking(true);
+       connect(v, SIGNAL(entered(const QModelIndex&)), this, SLOT(itemEntered(const QModelIndex&)));
+    }
     startTimer(30);
 
 }
@@ -4,41 +4,138 @@
 #include <stdio.h>
 #include <sndfile.h>
 #include <samplerate.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <QString>
 #include <QFileDialog>
 #include <QComboBox>
-#include <QSemaphore>
 #include <QCheckBox>
 #include <QPushButton>
 
+class QModelIndex;
+
 namespace MusECore
 {
 
+//---------------------------------------------------------
+//   WavePreview
+//    Plays audio files for previewing. A reader thread
+//     decodes and resamples the file and hands the audio
+//     to the audio thread in blocks through a lock-free
+//     ring, so the audio thread never touches the file.
+//    The first seconds of recently played or prefetched
+//     files are kept decoded, so they start at once.
+//---------------------------------------------------------
+
 class WavePreview
 {
+public:
+   // Frames per block, channels kept per block, and blocks in the ring.
+   static constexpr int BlockFrames = 1024;
+   static constexpr int MaxChannels = 2;
+   static constexpr unsigned int NumBlocks = 128;
+   // Seconds of each file kept decoded in the cache, and the cache size in bytes.
+   static constexpr int HeadSeconds = 3;
+   static constexpr size_t HeadCacheBytes = 64 * 1024 * 1024;
+
 private:
-   SNDFILE *sf;
-   SF_INFO sfi;
-   SRC_STATE *src;
-   bool isPlaying;
-   float *tmpbuffer;
-   float *srcbuffer;
-   int segSize;
-   float *p1;
-   float *p2;      
-   int f1;
-   int f2;
-   SRC_DATA sd;
-   sf_count_t nread;
-   QSemaphore sem;
+   // The decoded first seconds of a file, in file frames and channels.
+   struct Head
+   {
+      QString path;
+      qint64 fileSize;
+      qint64 fileTime;
+      int channels;
+      int sampleRate;
+      // Interleaved.
+      std::vector<float> data;
+      sf_count_t frames;
+      // Whether the head is the whole file.
+      bool complete;
+   };
+
+   // A block of resampled audio in the ring.
+   struct Block
+   {
+      // The play serial of the file the block belongs to.
+      unsigned int serial;
+      int channels;
+      int frames;
+      // Whether this is the last block of the file.
+      bool last;
+      float data[BlockFrames * MaxChannels];
+   };
+
+   // Reader thread only. The file being streamed.
+   struct Stream
+   {
+      std::shared_ptr<const Head> head;
+      sf_count_t headPos;
+      SNDFILE *sf;
+      SF_INFO sfi;
+      SRC_STATE *src;
+      double ratio;
+      unsigned int serial;
+      // Whether the last block was written, and whether the file ended.
+      bool done;
+      bool eof;
+      std::vector<float> readBuffer;
+      std::vector<float> srcBuffer;
+   };
+
+   // The ring. The reader thread writes, the audio thread reads.
+   Block *_blocks;
+   std::atomic<unsigned int> _writeIdx;
+   std::atomic<unsigned int> _readIdx;
+   // Audio thread only. Frames of the current block already played.
+   int _readPos;
+
+   // The serial of the file being played, or zero if stopped.
+   std::atomic<unsigned int> _playingSerial;
+   // Gui thread only.
+   unsigned int _lastSerial;
+
+   // Requests to the reader thread, protected by the mutex.
+   std::mutex _mutex;
+   std::condition_variable _cond;
+   std::thread _thread;
+   bool _quit;
+   bool _playRequested;
+   QString _playPath;
+   int _playSampleRate;
+   unsigned int _playSerial;
+   std::deque<QString> _prefetch;
+
+   // Reader thread only. The cached heads, most recently used first.
+   std::list<std::shared_ptr<const Head> > _heads;
+   size_t _headBytes;
+   Stream _stream;
+
+   void run();
+   std::shared_ptr<const Head> findHead(const QString& path);
+   std::shared_ptr<const Head> loadHead(const QString& path);
+   void openStream(const QString& path, int systemSampleRate, unsigned int serial);
+   void closeStream();
+   // Fills free blocks of the ring. Returns false if the file ended.
+   bool fillBlocks();
    static long static_srcCallback (void *cb_data, float **data);
+
 public:
    WavePreview(int segmentSize);
    virtual ~WavePreview();
    void play(QString path, int systemSampleRate);
    void stop();
+   // Decodes the first seconds of a file in the background, so that it plays at once.
+   void prefetch(const QString& path);
+   // Audio thread only.
    void addData(int channels, int nframes, float *buffer []);
-   bool getIsPlaying() { return isPlaying; }
+   bool getIsPlaying() { return _playingSerial.load(std::memory_order_acquire) != 0; }
 
 };
 
@@ -51,6 +148,7 @@ private:
     int _systemSampleRate;
 private slots:
     void urlChanged(const QString &str);
+    void itemEntered(const QModelIndex &index);
     void startStopWave();
 public slots:
     virtual int exec();
@@ -57,11 +57,13 @@ namespace MusECore {
 WaveTrack::WaveTrack() : AudioTrack(Track::WAVE, 1)
 {
   _prefetchWritePos = ~0;
+  resetPrefetchStats();
 }
 
 WaveTrack::WaveTrack(const WaveTrack& wt, int flags) : AudioTrack(wt, flags)
 {
   _prefetchWritePos = ~0;
+  resetPrefetchStats();
 
   internal_assign(wt, flags | Track::ASSIGN_PROPERTIES);
 }
@@ -404,6 +406,7 @@ bool WaveTrack::getPrefetchData(
     if(_prefetchFifo.peek(dstChannels, nframe, pf_buf, &pos))
     {
       fprintf(stderr, "WaveTrack::getPrefetchData(%s) (prefetch peek A) fifo underrun\n", name().toLocal8Bit().constData());
+      _prefetchUnderruns.fetch_add(1, std::memory_order_relaxed);
       return false;
     }
 
@@ -437,6 +440,7 @@ bool WaveTrack::getPrefetchData(
         if(_prefetchFifo.peek(dstChannels, nframe, pf_buf, &pos))
         {
           fprintf(stderr, "WaveTrack::getPrefetchData(%s) (prefetch peek B) fifo underrun\n", name().toLocal8Bit().constData());
+          _prefetchUnderruns.fetch_add(1, std::memory_order_relaxed);
           return false;
         }
 
@@ -512,6 +516,7 @@ bool WaveTrack::getPrefetchData(
       if(_prefetchFifo.peek(dstChannels, nframe, pf_buf, &pos))
       {
         fprintf(stderr, "WaveTrack::getPrefetchData(%s) (prefetch peek C) fifo underrun\n", name().toLocal8Bit().constData());
+        _prefetchUnderruns.fetch_add(1, std::memory_order_relaxed);
         return false;
       }
       
@@ -789,6 +794,30 @@ void WaveTrack::setChannels(int n)
             }
       }
 
+//---------------------------------------------------------
+//   updatePrefetchFill
+//    called from prefetch thread
+//---------------------------------------------------------
+
+void WaveTrack::updatePrefetchFill(int fill, bool isPlaying)
+{
+  _prefetchFill.store(fill, std::memory_order_relaxed);
+  // Only playback fill levels are meaningful for the minimum.
+  // A seek always starts with an empty fifo.
+  if(!isPlaying)
+    return;
+  const int min_fill = _prefetchMinFill.load(std::memory_order_relaxed);
+  if(min_fill < 0 || fill < min_fill)
+    _prefetchMinFill.store(fill, std::memory_order_relaxed);
+}
+
+void WaveTrack::resetPrefetchStats()
+{
+  _prefetchUnderruns.store(0, std::memory_order_relaxed);
+  _prefetchFill.store(0, std::memory_order_relaxed);
+  _prefetchMinFill.store(-1, std::memory_order_relaxed);
+}
+
 void WaveTrack::clearPrefetchFifo()
 { 
   _prefetchFifo.clear();
@@ -21,6 +21,8 @@
 //
 //=========================================================
 
+#include <stdio.h>
+
 #include "xml_statistics.h"
 
 // Forwards from header:
@@ -112,5 +114,39 @@ bool XmlReadStatistics::cloneNumExists(int cloneNum) const
   return false;
 }
 
+void XmlReadStatistics::addSectionTime(const QString& tag, double ms)
+{
+  for(std::vector<XmlReadSectionTime>::iterator it = _sectionTimes.begin(); it != _sectionTimes.end(); ++it)
+  {
+    if(it->_tag == tag)
+    {
+      ++it->_count;
+      it->_ms += ms;
+      return;
+    }
+  }
+  _sectionTimes.push_back(XmlReadSectionTime{tag, 1, ms});
+}
+
+void XmlReadStatistics::dumpSectionTimes() const
+{
+  fprintf(stderr, "Xml read times:\n");
+  for(std::vector<XmlReadSectionTime>::const_iterator it = _sectionTimes.cbegin(); it != _sectionTimes.cend(); ++it)
+    fprintf(stderr, "  %-20s %8d sections %12.3f ms\n", it->_tag.toLocal8Bit().constData(), it->_count, it->_ms);
+}
+
+XmlReadSectionTimer::XmlReadSectionTimer(XmlReadStatistics* stats, const QString& tag)
+  : _stats(stats), _tag(tag)
+{
+  if(_stats)
+    _start = std::chrono::steady_clock::now();
+}
+
+XmlReadSectionTimer::~XmlReadSectionTimer()
+{
+  if(_stats)
+    _stats->addSectionTime(_tag, std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - _start).count());
+}
 
 } // namespace MusECore
@@ -25,6 +25,8 @@
 #define __XML_STATISTICS_H__
 
 #include <QUuid>
+#include <QString>
+#include <chrono>
 #include <set>
 #include <vector>
 
@@ -56,10 +58,27 @@ struct XmlReadStatsStruct
   XmlReadStatsStruct(Part* part, const QUuid& fileUuid, int cloneNum = -1);
 };
 
+struct XmlReadSectionTime
+{
+  QString _tag;
+  // Number of sections read with this tag.
+  int _count;
+  // Total time spent reading them, in milliseconds.
+  double _ms;
+};
+
 struct XmlReadStatistics
 {
   // The order in the list gives the clone group counter.
   std::vector<XmlReadStatsStruct> _parts;
+  // Time spent reading each kind of section, in order of first appearance.
+  // Sections may be nested, for example parts are read within tracks.
+  std::vector<XmlReadSectionTime> _sectionTimes;
+
+  // Adds the time spent reading one section with the given tag.
+  void addSectionTime(const QString& tag, double ms);
+  // Prints the section times to stderr.
+  void dumpSectionTimes() const;
 
   Part* findClonemasterPart(const QUuid&) const;
   bool clonemasterPartExists(const QUuid&) const;
@@ -67,6 +86,18 @@ struct XmlReadStatistics
   bool cloneNumExists(int cloneNum) const;
 };
 
+// Adds the time from its construction to its destruction as one section to the statistics, if any.
+class XmlReadSectionTimer
+{
+  XmlReadStatistics* _stats;
+  QString _tag;
+  std::chrono::steady_clock::time_point _start;
+
+public:
+  XmlReadSectionTimer(XmlReadStatistics* stats, const QString& tag);
+  ~XmlReadSectionTimer();
+};
+
 }   // namespace MusECore
 
 #endif
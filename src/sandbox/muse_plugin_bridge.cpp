@@ -0,0 +1,480 @@
+//=========================================================
+//  MusE
+//  Linux Music Editor
+//
+//  muse_plugin_bridge.cpp
+//  (C) Copyright 2026 The MusE developers
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; version 2 of
+//  the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+//=========================================================
+
+//---------------------------------------------------------
+//  Runs a chain of LADSPA plugins of a MusE rack, in this
+//   separate process. MusE creates the shared memory
+//   described in plugin_bridge_shm.h and starts us with
+//   its name. We process one cycle of the whole chain each
+//   time MusE posts a request, on a realtime thread if we
+//   are allowed one.
+//  Usage: muse_plugin_bridge <shared memory name>
+//---------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ladspa.h>
+
+#include "plugin_bridge_shm.h"
+
+using MusEPlugin::PluginBridgeShm;
+using MusEPlugin::PluginBridgeStage;
+using MusEPlugin::PluginBridgeControl;
+
+namespace MusEPluginBridge {
+
+// How long to sleep between checks that MusE is still there.
+static const long IdleTimeoutNs = 500000000L;
+
+struct AudioPort {
+  LADSPA_Handle handle;
+  unsigned long port;
+};
+
+struct Stage {
+  const LADSPA_Descriptor* descr;
+  std::vector<LADSPA_Handle> handles;
+  // Of all instances, in instance order.
+  std::vector<AudioPort> audioIns;
+  std::vector<AudioPort> audioOuts;
+  uint32_t resets;
+};
+
+struct Host {
+  PluginBridgeShm* shm;
+  std::vector<Stage> stages;
+  // Storage of the control ports of all stages. The instances of a stage share theirs.
+  std::vector<LADSPA_Data> controlIns;
+  std::vector<LADSPA_Data> controlOuts;
+  std::vector<LADSPA_Data> controlOutsDummy;
+  // Two sets of chain channels the stages take turns writing.
+  std::vector<float> work;
+  std::vector<float> silence;
+  std::vector<float> dummy;
+  // The channels into each stage, and out of the last one. Set up each cycle.
+  std::vector<float*> route;
+  std::vector<PluginBridgeControl> events;
+  pid_t parent;
+};
+
+//---------------------------------------------------------
+//   findDescriptor
+//---------------------------------------------------------
+
+static const LADSPA_Descriptor* findDescriptor(const char* libPath, const char* label)
+{
+  void* lib = dlopen(libPath, RTLD_NOW);
+  if(!lib)
+  {
+    fprintf(stderr, "muse_plugin_bridge: dlopen(%s) failed: %s\n", libPath, dlerror());
+    return nullptr;
+  }
+  LADSPA_Descriptor_Function ladspa = (LADSPA_Descriptor_Function)dlsym(lib, "ladspa_descriptor");
+  if(!ladspa)
+  {
+    fprintf(stderr, "muse_plugin_bridge: %s is not a LADSPA library\n", libPath);
+    return nullptr;
+  }
+  const LADSPA_Descriptor* d;
+  for(unsigned long i = 0; (d = ladspa(i)) != nullptr; ++i)
+  {
+    if(strcmp(d->Label, label) == 0)
+      return d;
+  }
+  fprintf(stderr, "muse_plugin_bridge: no plugin %s in %s\n", label, libPath);
+  return nullptr;
+}
+
+//---------------------------------------------------------
+//   setupStage
+//    Instantiates the instances of a stage and connects
+//     their control ports. The audio ports are connected
+//     for each run.
+//    Returns true on success.
+//---------------------------------------------------------
+
+static bool setupStage(Host* host, PluginBridgeStage* ps, Stage* st)
+{
+  ps->libPath[sizeof(ps->libPath) - 1] = 0;
+  ps->label[sizeof(ps->label) - 1] = 0;
+  const LADSPA_Descriptor* d = findDescriptor(ps->libPath, ps->label);
+  if(!d)
+    return false;
+  st->descr = d;
+  st->resets = ps->resets.load(std::memory_order_acquire);
+
+  unsigned long ains = 0, aouts = 0, cins = 0, couts = 0;
+  for(unsigned long k = 0; k < d->PortCount; ++k)
+  {
+    const LADSPA_PortDescriptor pd = d->PortDescriptors[k];
+    if(LADSPA_IS_PORT_AUDIO(pd))
+      LADSPA_IS_PORT_INPUT(pd) ? ++ains : ++aouts;
+    else if(LADSPA_IS_PORT_CONTROL(pd))
+      LADSPA_IS_PORT_INPUT(pd) ? ++cins : ++couts;
+  }
+  if(ains * ps->instances != ps->audioIns || aouts * ps->instances != ps->audioOuts ||
+     cins != ps->controlIns || couts != ps->controlOuts ||
+     ps->controlInBase + cins > host->controlIns.size() ||
+     ps->controlOutBase + couts > host->controlOuts.size())
+  {
+    fprintf(stderr, "muse_plugin_bridge: %s: port counts do not match\n", d->Label);
+    return false;
+  }
+
+  for(uint32_t i = 0; i < ps->instances; ++i)
+  {
+    LADSPA_Handle h = d->instantiate(d, host->shm->sampleRate);
+    if(!h)
+    {
+      fprintf(stderr, "muse_plugin_bridge: %s: cannot instantiate\n", d->Label);
+      return false;
+    }
+    st->handles.push_back(h);
+
+    unsigned long cin = ps->controlInBase, cout = ps->controlOutBase;
+    for(unsigned long k = 0; k < d->PortCount; ++k)
+    {
+      const LADSPA_PortDescriptor pd = d->PortDescriptors[k];
+      if(LADSPA_IS_PORT_AUDIO(pd))
+      {
+        if(LADSPA_IS_PORT_INPUT(pd))
+          st->audioIns.push_back(AudioPort{h, k});
+        else
+          st->audioOuts.push_back(AudioPort{h, k});
+      }
+      else if(LADSPA_IS_PORT_CONTROL(pd))
+      {
+        if(LADSPA_IS_PORT_INPUT(pd))
+          d->connect_port(h, k, &host->controlIns[cin++]);
+        else
+          // Like MusE, only the outputs of the first instance count.
+          d->connect_port(h, k, i == 0 ? &host->controlOuts[cout++] : &host->controlOutsDummy[cout++]);
+      }
+    }
+  }
+  return true;
+}
+
+//---------------------------------------------------------
+//   setup
+//    Returns true on success.
+//---------------------------------------------------------
+
+static bool setup(Host* host)
+{
+  PluginBridgeShm* shm = host->shm;
+  if(shm->stages == 0 || shm->stages > PluginBridgeShm::MaxStages)
+    return false;
+
+  uint32_t cins = 0;
+  for(uint32_t s = 0; s < shm->stages; ++s)
+  {
+    const uint32_t end = shm->stage[s].controlInBase + shm->stage[s].controlIns;
+    if(end > cins)
+      cins = end;
+  }
+  host->controlIns.assign(cins, 0.0f);
+  host->controlOuts.assign(shm->controlOuts, 0.0f);
+  host->controlOutsDummy.assign(shm->controlOuts, 0.0f);
+  host->work.assign(2 * shm->channels * shm->maxFrames, 0.0f);
+  host->silence.assign(shm->maxFrames, 0.0f);
+  host->dummy.assign(shm->maxFrames, 0.0f);
+  host->route.assign((shm->stages + 1) * shm->channels, nullptr);
+  host->events.reserve(PluginBridgeShm::RingSize);
+
+  host->stages.resize(shm->stages);
+  for(uint32_t s = 0; s < shm->stages; ++s)
+  {
+    if(!setupStage(host, &shm->stage[s], &host->stages[s]))
+      return false;
+  }
+  return true;
+}
+
+static void activate(Stage* st)
+{
+  if(!st->descr->activate)
+    return;
+  for(LADSPA_Handle h : st->handles)
+    st->descr->activate(h);
+}
+
+static void deactivate(Stage* st)
+{
+  if(!st->descr->deactivate)
+    return;
+  for(LADSPA_Handle h : st->handles)
+    st->descr->deactivate(h);
+}
+
+//---------------------------------------------------------
+//   setRoute
+//    Each stage which is on reads the channels the one
+//     before wrote, and writes the other work set. A stage
+//     which is off passes its input on.
+//---------------------------------------------------------
+
+static void setRoute(Host* host)
+{
+  PluginBridgeShm* shm = host->shm;
+  const uint32_t chans = shm->channels;
+  for(uint32_t c = 0; c < chans; ++c)
+    host->route[c] = shm->audioIn(c);
+  int w = 0;
+  for(uint32_t s = 0; s < shm->stages; ++s)
+  {
+    float** src = &host->route[s * chans];
+    float** dst = &host->route[(s + 1) * chans];
+    for(uint32_t c = 0; c < chans; ++c)
+      dst[c] = shm->stage[s].on ? &host->work[(w * chans + c) * shm->maxFrames] : src[c];
+    if(shm->stage[s].on)
+      w ^= 1;
+  }
+}
+
+//---------------------------------------------------------
+//   runStages
+//    Runs the stages which are on over a slice of the cycle.
+//---------------------------------------------------------
+
+static void runStages(Host* host, unsigned long offset, unsigned long n)
+{
+  PluginBridgeShm* shm = host->shm;
+  const uint32_t chans = shm->channels;
+  for(uint32_t s = 0; s < shm->stages; ++s)
+  {
+    if(!shm->stage[s].on)
+      continue;
+    Stage& st = host->stages[s];
+    const LADSPA_Descriptor* d = st.descr;
+    float** src = &host->route[s * chans];
+    float** dst = &host->route[(s + 1) * chans];
+
+    for(size_t j = 0; j < st.audioIns.size(); ++j)
+      d->connect_port(st.audioIns[j].handle, st.audioIns[j].port,
+                      (j < chans ? src[j] : host->silence.data()) + offset);
+    for(size_t j = 0; j < st.audioOuts.size(); ++j)
+      d->connect_port(st.audioOuts[j].handle, st.audioOuts[j].port,
+                      (j < chans ? dst[j] : host->dummy.data()) + offset);
+    // Channels the plugin does not write keep their audio, like in the rack.
+    for(uint32_t c = st.audioOuts.size(); c < chans; ++c)
+      memcpy(dst[c] + offset, src[c] + offset, n * sizeof(float));
+
+    for(LADSPA_Handle h : st.handles)
+      d->run(h, n);
+  }
+}
+
+//---------------------------------------------------------
+//   takeControls
+//    Takes the control changes of this cycle off the ring,
+//     in frame order.
+//---------------------------------------------------------
+
+static void takeControls(Host* host, unsigned long frames)
+{
+  host->events.clear();
+  PluginBridgeControl c;
+  while(host->shm->popControl(&c))
+  {
+    if(c.port >= host->controlIns.size())
+      continue;
+    if(c.frame >= frames)
+      c.frame = frames ? frames - 1 : 0;
+    // The stages send theirs one after the other. Keep the order of equal frames.
+    size_t i = host->events.size();
+    host->events.push_back(c);
+    for( ; i > 0 && host->events[i - 1].frame > c.frame; --i)
+      host->events[i] = host->events[i - 1];
+    host->events[i] = c;
+  }
+}
+
+//---------------------------------------------------------
+//   process
+//    Serves requests until MusE quits or goes away.
+//---------------------------------------------------------
+
+static void process(Host* host)
+{
+  PluginBridgeShm* shm = host->shm;
+  uint32_t done = shm->reply.load(std::memory_order_acquire);
+  const struct timespec idle = { 0, IdleTimeoutNs };
+
+  while(shm->state.load(std::memory_order_acquire) != PluginBridgeShm::Quit)
+  {
+    const uint32_t req = shm->request.load(std::memory_order_acquire);
+    if(req == done)
+    {
+      if(getppid() != host->parent)
+        break;
+      MusEPlugin::bridgeFutexWait(&shm->request, done, &idle);
+      continue;
+    }
+
+    for(uint32_t s = 0; s < shm->stages; ++s)
+    {
+      Stage& st = host->stages[s];
+      const uint32_t r = shm->stage[s].resets.load(std::memory_order_acquire);
+      if(r != st.resets)
+      {
+        st.resets = r;
+        deactivate(&st);
+        activate(&st);
+      }
+    }
+
+    unsigned long frames = shm->frames;
+    if(frames > shm->maxFrames)
+      frames = shm->maxFrames;
+    takeControls(host, frames);
+    setRoute(host);
+
+    // Run up to each control change, like MusE does in-process.
+    size_t e = 0;
+    unsigned long pos = 0;
+    while(pos < frames)
+    {
+      for( ; e < host->events.size() && host->events[e].frame <= pos; ++e)
+        host->controlIns[host->events[e].port] = host->events[e].value;
+      const unsigned long end = e < host->events.size() ? host->events[e].frame : frames;
+      runStages(host, pos, end - pos);
+      pos = end;
+    }
+    for( ; e < host->events.size(); ++e)
+      host->controlIns[host->events[e].port] = host->events[e].value;
+
+    float** out = &host->route[shm->stages * shm->channels];
+    for(uint32_t c = 0; c < shm->channels; ++c)
+      memcpy(shm->audioOut(c), out[c], frames * sizeof(float));
+    if(!host->controlOuts.empty())
+      memcpy(shm->controlOutValues(), host->controlOuts.data(), host->controlOuts.size() * sizeof(float));
+
+    done = req;
+    shm->reply.store(done, std::memory_order_release);
+    MusEPlugin::bridgeFutexWake(&shm->reply);
+  }
+}
+
+//---------------------------------------------------------
+//   setRealtime
+//    Like the audio thread, if the user may.
+//---------------------------------------------------------
+
+static void setRealtime()
+{
+  struct sched_param sp;
+  memset(&sp, 0, sizeof(sp));
+  sp.sched_priority = sched_get_priority_max(SCHED_FIFO) - 10;
+  if(pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) != 0)
+    fprintf(stderr, "muse_plugin_bridge: cannot run with realtime priority\n");
+  mlockall(MCL_CURRENT | MCL_FUTURE);
+}
+
+} // namespace MusEPluginBridge
+
+//---------------------------------------------------------
+//   main
+//---------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+  using namespace MusEPluginBridge;
+
+  if(argc != 2)
+  {
+    fprintf(stderr, "usage: %s <shared memory name>\n", argv[0]);
+    return 1;
+  }
+
+  Host host;
+  host.parent = getppid();
+  // Do not outlive MusE.
+  prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+  const int fd = shm_open(argv[1], O_RDWR, 0);
+  if(fd < 0)
+  {
+    perror("muse_plugin_bridge: shm_open");
+    return 1;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PluginBridgeShm))
+  {
+    close(fd);
+    return 1;
+  }
+  void* mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(mem == MAP_FAILED)
+  {
+    perror("muse_plugin_bridge: mmap");
+    return 1;
+  }
+  host.shm = static_cast<PluginBridgeShm*>(mem);
+  PluginBridgeShm* shm = host.shm;
+
+  if(shm->magic != PluginBridgeShm::Magic || shm->version != PluginBridgeShm::Version ||
+     (size_t)st.st_size < shm->totalSize())
+  {
+    fprintf(stderr, "muse_plugin_bridge: bad shared memory\n");
+    return 1;
+  }
+  if(!setup(&host))
+  {
+    shm->state.store(PluginBridgeShm::Failed, std::memory_order_release);
+    MusEPlugin::bridgeFutexWake(&shm->state);
+    return 1;
+  }
+  for(Stage& s : host.stages)
+    activate(&s);
+  setRealtime();
+
+  shm->state.store(PluginBridgeShm::Ready, std::memory_order_release);
+  MusEPlugin::bridgeFutexWake(&shm->state);
+
+  process(&host);
+
+  for(Stage& s : host.stages)
+  {
+    deactivate(&s);
+    if(s.descr->cleanup)
+    {
+      for(LADSPA_Handle h : s.handles)
+        s.descr->cleanup(h);
+    }
+  }
+  munmap(mem, st.st_size);
+  return 0;
+}
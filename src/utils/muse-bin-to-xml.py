@@ -0,0 +1,199 @@
+#!/usr/bin/python3
+#=============================================================================
+#  MusE
+#  Linux Music Editor
+#
+#  muse-bin-to-xml.py
+#  (C) Copyright 2026 The MusE developers
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the
+#  Free Software Foundation, Inc.,
+#  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+#=============================================================================
+
+#
+# Converts a binary MusE song file (*.medb) to the text format (*.med),
+# for example to diff two versions of a song.
+# The output is the same as MusE writes when saving the song as *.med.
+#
+
+from __future__ import print_function
+
+import re
+import struct
+import sys
+import zlib
+
+MAGIC = b"MusEBSng"
+FORMAT_VERSION = 1
+
+SONG_CHUNK  = b"SONG"
+EVENT_CHUNK = b"EVNT"
+CTRL_CHUNK  = b"CTRL"
+
+# Event types, as in type_defs.h
+NOTE = 0
+CONTROLLER = 1
+
+# CtrlVal::VAL_NON_GROUP_END
+VAL_NON_GROUP_END = 0x02
+
+def fail(msg):
+    print("muse-bin-to-xml: " + msg, file=sys.stderr)
+    sys.exit(1)
+
+def read_chunks(data):
+    if data[:8] != MAGIC:
+        fail("not a binary MusE song file")
+    version, count = struct.unpack_from("<II", data, 8)
+    if version > FORMAT_VERSION:
+        fail("file format %d is newer than this tool supports" % version)
+    chunks = []
+    pos = 16
+    for i in range(count):
+        if len(data) - pos < 20:
+            fail("chunk %d is truncated" % i)
+        ctype = data[pos:pos + 4]
+        cversion, size, crc = struct.unpack_from("<IQI", data, pos + 4)
+        pos += 20
+        payload = data[pos:pos + size]
+        if len(payload) != size:
+            fail("chunk %d is truncated" % i)
+        if zlib.crc32(payload) & 0xffffffff != crc:
+            fail("chunk %d has a bad checksum" % i)
+        chunks.append((ctype, cversion, payload))
+        pos += size
+    if not chunks or chunks[0][0] != SONG_CHUNK:
+        fail("file has no song")
+    return chunks
+
+def get_chunk(chunks, index, ctype):
+    if index < 0 or index >= len(chunks) or chunks[index][0] != ctype:
+        fail("missing %s chunk %d" % (ctype.decode(), index))
+    if chunks[index][1] > 1:
+        fail("%s chunk %d has unknown version %d" % (ctype.decode(), index, chunks[index][1]))
+    return chunks[index][2]
+
+# As MusELib::museStringFromDouble()
+def string_from_double(v):
+    s = "%.100g" % v
+    if len(s) > 10:
+        s = v.hex()
+        if "p" in s:
+            mant, exp = s.split("p")
+            if "." in mant:
+                mant = mant.rstrip("0").rstrip(".")
+            s = mant + "p" + exp
+    return s
+
+# As MidiEventBase::write()
+def write_events(out, level, payload):
+    ind = "  " * level
+    (n,) = struct.unpack_from("<I", payload, 0)
+    pos = 4
+    for i in range(n):
+        tick, length, etype, a, b, c, datalen = struct.unpack_from("<IIiiiiI", payload, pos)
+        pos += 28
+        data = payload[pos:pos + datalen]
+        pos += datalen
+        line = ind + '<event tick="%d"' % tick
+        if etype == NOTE:
+            line += ' len="%d"' % length
+        elif etype == CONTROLLER:
+            line += ' type="%d"' % etype
+            if length != 0:
+                line += ' len="%d"' % length
+        else:
+            line += ' type="%d"' % etype
+        if a:
+            line += ' a="%d"' % a
+        if b:
+            line += ' b="%d"' % b
+        if c:
+            line += ' c="%d"' % c
+        if datalen:
+            line += ' datalen="%d">\n' % datalen
+            line += ind + "  "
+            for k in range(datalen):
+                if k and (k % 16) == 0:
+                    line += "\n" + ind + "  "
+                line += "%02x " % data[k]
+            line += "\n" + ind + "</event>\n"
+        else:
+            line += " />\n"
+        out.write(line)
+
+# As CtrlList::write()
+def write_controller(out, level, attrs, payload):
+    ind = "  " * level
+    ind1 = "  " * (level + 1)
+    (n,) = struct.unpack_from("<I", payload, 0)
+    if n == 0:
+        out.write(ind + "<controller " + attrs + " />\n")
+        return
+    out.write(ind + "<controller " + attrs + ">\n")
+    pos = 4
+    i = 0
+    for k in range(n):
+        frame, value, flags = struct.unpack_from("<IdI", payload, pos)
+        pos += 16
+        flags &= ~VAL_NON_GROUP_END
+        s = "%d %s" % (frame, string_from_double(value))
+        if flags:
+            s += " %d" % flags
+        s += ", "
+        out.write(s if i else ind1 + s)
+        i += 1
+        if i >= 4:
+            out.write(ind1 + "\n")
+            i = 0
+    if i:
+        out.write(ind1 + "\n")
+    out.write(ind + "</controller>\n")
+
+EVENTS_RE = re.compile(r'^( *)<events chunk="(\d+)" />$')
+CTRL_RE = re.compile(r'^( *)<controller (.*) chunk="(\d+)" />$')
+
+def convert(data, out):
+    chunks = read_chunks(data)
+    text = chunks[0][2].decode("utf-8")
+    for line in text.splitlines(True):
+        stripped = line.rstrip("\n")
+        m = EVENTS_RE.match(stripped)
+        if m:
+            write_events(out, len(m.group(1)) // 2,
+                         get_chunk(chunks, int(m.group(2)), EVENT_CHUNK))
+            continue
+        m = CTRL_RE.match(stripped)
+        if m:
+            write_controller(out, len(m.group(1)) // 2, m.group(2),
+                             get_chunk(chunks, int(m.group(3)), CTRL_CHUNK))
+            continue
+        out.write(line)
+
+def main():
+    if len(sys.argv) < 2 or len(sys.argv) > 3:
+        print("usage: muse-bin-to-xml.py <song.medb> [<song.med>]", file=sys.stderr)
+        print("  Writes the song as text to <song.med>, or to standard output.", file=sys.stderr)
+        sys.exit(1)
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], "w", encoding="utf-8", newline="") as out:
+            convert(data, out)
+    else:
+        convert(data, sys.stdout)
+
+if __name__ == "__main__":
+    main()